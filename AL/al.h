@@ -656,6 +656,132 @@ typedef void          (AL_APIENTRY *LPALTRACEMESSAGE)(const ALchar *str);
 typedef void          (AL_APIENTRY *LPALTRACEBUFFERLABEL)(ALuint name, const ALchar *str);
 typedef void          (AL_APIENTRY *LPALTRACESOURCELABEL)(ALuint name, const ALchar *str);
 
+#define AL_MOJOAL_phase_vocoder_pitch 1
+#define AL_PHASE_VOCODER_PITCH_MOJOAL            0x4D02
+
+#define AL_MOJOAL_source_batch 1
+typedef void          (AL_APIENTRY *LPALSOURCEFVBATCHMOJOAL)(ALsizei n, const ALuint *sources, ALenum param, const ALfloat *values);
+typedef void          (AL_APIENTRY *LPALSOURCEIVBATCHMOJOAL)(ALsizei n, const ALuint *sources, ALenum param, const ALint *values);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alSourcefvBatchMOJOAL(ALsizei n, const ALuint *sources, ALenum param, const ALfloat *values);
+AL_API void AL_APIENTRY alSourceivBatchMOJOAL(ALsizei n, const ALuint *sources, ALenum param, const ALint *values);
+#endif
+
+#define AL_SOFT_source_latency 1
+#define AL_SAMPLE_OFFSET_LATENCY_SOFT            0x1200
+#define AL_SEC_OFFSET_LATENCY_SOFT               0x1201
+#define AL_SAMPLE_OFFSET_CLOCK_SOFT              0x1202  /* these two are part of ALC_SOFT_device_clock. */
+#define AL_SEC_OFFSET_CLOCK_SOFT                 0x1203
+#if defined(_MSC_VER)
+typedef __int64 ALint64SOFT;
+typedef unsigned __int64 ALuint64SOFT;
+#else
+#include <stdint.h>
+typedef int64_t ALint64SOFT;
+typedef uint64_t ALuint64SOFT;
+#endif
+typedef void          (AL_APIENTRY *LPALSOURCEDSOFT)(ALuint source, ALenum param, ALdouble value);
+typedef void          (AL_APIENTRY *LPALSOURCE3DSOFT)(ALuint source, ALenum param, ALdouble value1, ALdouble value2, ALdouble value3);
+typedef void          (AL_APIENTRY *LPALSOURCEDVSOFT)(ALuint source, ALenum param, const ALdouble *values);
+typedef void          (AL_APIENTRY *LPALGETSOURCEDSOFT)(ALuint source, ALenum param, ALdouble *value);
+typedef void          (AL_APIENTRY *LPALGETSOURCE3DSOFT)(ALuint source, ALenum param, ALdouble *value1, ALdouble *value2, ALdouble *value3);
+typedef void          (AL_APIENTRY *LPALGETSOURCEDVSOFT)(ALuint source, ALenum param, ALdouble *values);
+typedef void          (AL_APIENTRY *LPALSOURCEI64SOFT)(ALuint source, ALenum param, ALint64SOFT value);
+typedef void          (AL_APIENTRY *LPALSOURCE3I64SOFT)(ALuint source, ALenum param, ALint64SOFT value1, ALint64SOFT value2, ALint64SOFT value3);
+typedef void          (AL_APIENTRY *LPALSOURCEI64VSOFT)(ALuint source, ALenum param, const ALint64SOFT *values);
+typedef void          (AL_APIENTRY *LPALGETSOURCEI64SOFT)(ALuint source, ALenum param, ALint64SOFT *value);
+typedef void          (AL_APIENTRY *LPALGETSOURCE3I64SOFT)(ALuint source, ALenum param, ALint64SOFT *value1, ALint64SOFT *value2, ALint64SOFT *value3);
+typedef void          (AL_APIENTRY *LPALGETSOURCEI64VSOFT)(ALuint source, ALenum param, ALint64SOFT *values);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alSourcedSOFT(ALuint source, ALenum param, ALdouble value);
+AL_API void AL_APIENTRY alSource3dSOFT(ALuint source, ALenum param, ALdouble value1, ALdouble value2, ALdouble value3);
+AL_API void AL_APIENTRY alSourcedvSOFT(ALuint source, ALenum param, const ALdouble *values);
+AL_API void AL_APIENTRY alGetSourcedSOFT(ALuint source, ALenum param, ALdouble *value);
+AL_API void AL_APIENTRY alGetSource3dSOFT(ALuint source, ALenum param, ALdouble *value1, ALdouble *value2, ALdouble *value3);
+AL_API void AL_APIENTRY alGetSourcedvSOFT(ALuint source, ALenum param, ALdouble *values);
+AL_API void AL_APIENTRY alSourcei64SOFT(ALuint source, ALenum param, ALint64SOFT value);
+AL_API void AL_APIENTRY alSource3i64SOFT(ALuint source, ALenum param, ALint64SOFT value1, ALint64SOFT value2, ALint64SOFT value3);
+AL_API void AL_APIENTRY alSourcei64vSOFT(ALuint source, ALenum param, const ALint64SOFT *values);
+AL_API void AL_APIENTRY alGetSourcei64SOFT(ALuint source, ALenum param, ALint64SOFT *value);
+AL_API void AL_APIENTRY alGetSource3i64SOFT(ALuint source, ALenum param, ALint64SOFT *value1, ALint64SOFT *value2, ALint64SOFT *value3);
+AL_API void AL_APIENTRY alGetSourcei64vSOFT(ALuint source, ALenum param, ALint64SOFT *values);
+#endif
+
+#define AL_SOFT_deferred_updates 1
+#define AL_DEFERRED_UPDATES_SOFT                 0xC002
+typedef void          (AL_APIENTRY *LPALDEFERUPDATESSOFT)(void);
+typedef void          (AL_APIENTRY *LPALPROCESSUPDATESSOFT)(void);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alDeferUpdatesSOFT(void);
+AL_API void AL_APIENTRY alProcessUpdatesSOFT(void);
+#endif
+
+#define AL_SOFT_callback_buffer 1
+#define AL_BUFFER_CALLBACK_FUNCTION_SOFT         0x19A0
+#define AL_BUFFER_CALLBACK_USER_PARAM_SOFT       0x19A1
+typedef ALsizei       (AL_APIENTRY *ALBUFFERCALLBACKTYPESOFT)(ALvoid *userptr, ALvoid *sampledata, ALsizei numbytes);
+typedef void          (AL_APIENTRY *LPALBUFFERCALLBACKSOFT)(ALuint buffer, ALenum format, ALsizei freq, ALBUFFERCALLBACKTYPESOFT callback, ALvoid *userptr);
+typedef void          (AL_APIENTRY *LPALGETBUFFERPTRSOFT)(ALuint buffer, ALenum param, ALvoid **value);
+typedef void          (AL_APIENTRY *LPALGETBUFFER3PTRSOFT)(ALuint buffer, ALenum param, ALvoid **value1, ALvoid **value2, ALvoid **value3);
+typedef void          (AL_APIENTRY *LPALGETBUFFERPTRVSOFT)(ALuint buffer, ALenum param, ALvoid **values);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferCallbackSOFT(ALuint buffer, ALenum format, ALsizei freq, ALBUFFERCALLBACKTYPESOFT callback, ALvoid *userptr);
+AL_API void AL_APIENTRY alGetBufferPtrSOFT(ALuint buffer, ALenum param, ALvoid **value);
+AL_API void AL_APIENTRY alGetBuffer3PtrSOFT(ALuint buffer, ALenum param, ALvoid **value1, ALvoid **value2, ALvoid **value3);
+AL_API void AL_APIENTRY alGetBufferPtrvSOFT(ALuint buffer, ALenum param, ALvoid **values);
+#endif
+
+#define AL_SOFT_buffer_sub_data 1
+#define AL_BYTE_RW_OFFSETS_SOFT                  0x1031
+#define AL_SAMPLE_RW_OFFSETS_SOFT                0x1032
+typedef void          (AL_APIENTRY *LPALBUFFERSUBDATASOFT)(ALuint buffer, ALenum format, const ALvoid *data, ALsizei offset, ALsizei length);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferSubDataSOFT(ALuint buffer, ALenum format, const ALvoid *data, ALsizei offset, ALsizei length);
+#endif
+
+#define AL_SOFT_map_buffer 1
+typedef unsigned int ALbitfieldSOFT;
+#define AL_MAP_READ_BIT_SOFT                     0x00000001
+#define AL_MAP_WRITE_BIT_SOFT                    0x00000002
+#define AL_MAP_PERSISTENT_BIT_SOFT               0x00000004
+#define AL_PRESERVE_DATA_BIT_SOFT                0x00000008
+typedef void          (AL_APIENTRY *LPALBUFFERSTORAGESOFT)(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq, ALbitfieldSOFT flags);
+typedef void *        (AL_APIENTRY *LPALMAPBUFFERSOFT)(ALuint buffer, ALsizei offset, ALsizei length, ALbitfieldSOFT access);
+typedef void          (AL_APIENTRY *LPALUNMAPBUFFERSOFT)(ALuint buffer);
+typedef void          (AL_APIENTRY *LPALFLUSHMAPPEDBUFFERSOFT)(ALuint buffer, ALsizei offset, ALsizei length);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferStorageSOFT(ALuint buffer, ALenum format, const ALvoid *data, ALsizei size, ALsizei freq, ALbitfieldSOFT flags);
+AL_API void * AL_APIENTRY alMapBufferSOFT(ALuint buffer, ALsizei offset, ALsizei length, ALbitfieldSOFT access);
+AL_API void AL_APIENTRY alUnmapBufferSOFT(ALuint buffer);
+AL_API void AL_APIENTRY alFlushMappedBufferSOFT(ALuint buffer, ALsizei offset, ALsizei length);
+#endif
+
+#define AL_SOFT_block_alignment 1
+#define AL_UNPACK_BLOCK_ALIGNMENT_SOFT           0x200C
+#define AL_PACK_BLOCK_ALIGNMENT_SOFT             0x200D
+
+/* alBufferDataStatic uses (data) in place; it has to stay valid and unchanged
+   until the buffer is deleted or given new data. */
+#define AL_EXT_STATIC_BUFFER 1
+typedef void          (AL_APIENTRY *PFNALBUFFERDATASTATICPROC)(const ALint buffer, ALenum format, ALvoid *data, ALsizei size, ALsizei freq);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferDataStatic(const ALint buffer, ALenum format, ALvoid *data, ALsizei size, ALsizei freq);
+#endif
+
+/* Give a buffer (size) bytes of a file, starting at (offset), played straight
+   from a read-only memory mapping, so only the parts being played get read in.
+   A (size) of zero means the rest of the file. A (format) of AL_NONE means
+   there's a .WAV file at (offset), which says what the format and (freq) are.
+   The file descriptor is only used during the call; the app can close it after.
+   The file must not shrink while the buffer uses it. */
+#define AL_MOJOAL_file_buffer 1
+typedef void          (AL_APIENTRY *LPALBUFFERFILEMOJOAL)(ALuint buffer, const ALchar *path, ALint64SOFT offset, ALsizei size, ALenum format, ALsizei freq);
+typedef void          (AL_APIENTRY *LPALBUFFERFILEDESCRIPTORMOJOAL)(ALuint buffer, int fd, ALint64SOFT offset, ALsizei size, ALenum format, ALsizei freq);
+#ifdef AL_ALEXT_PROTOTYPES
+AL_API void AL_APIENTRY alBufferFileMOJOAL(ALuint buffer, const ALchar *path, ALint64SOFT offset, ALsizei size, ALenum format, ALsizei freq);
+AL_API void AL_APIENTRY alBufferFileDescriptorMOJOAL(ALuint buffer, int fd, ALint64SOFT offset, ALsizei size, ALenum format, ALsizei freq);
+#endif
+
 #if defined(__cplusplus)
 }  /* extern "C" */
 #endif
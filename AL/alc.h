@@ -234,6 +234,71 @@ typedef void           (ALC_APIENTRY *LPALCCAPTURESAMPLES)(ALCdevice *device, AL
 typedef void          (AL_APIENTRY *LPALCTRACEDEVICELABEL)(ALCdevice *device, const ALCchar *str);
 typedef void          (AL_APIENTRY *LPALCTRACECONTEXTLABEL)(ALCcontext *ctx, const ALCchar *str);
 
+#define ALC_SOFT_loopback 1
+#define ALC_BYTE_SOFT                            0x1400
+#define ALC_UNSIGNED_BYTE_SOFT                   0x1401
+#define ALC_SHORT_SOFT                           0x1402
+#define ALC_UNSIGNED_SHORT_SOFT                  0x1403
+#define ALC_INT_SOFT                             0x1404
+#define ALC_UNSIGNED_INT_SOFT                    0x1405
+#define ALC_FLOAT_SOFT                           0x1406
+#define ALC_MONO_SOFT                            0x1500
+#define ALC_STEREO_SOFT                          0x1501
+#define ALC_QUAD_SOFT                            0x1503
+#define ALC_5POINT1_SOFT                         0x1504
+#define ALC_6POINT1_SOFT                         0x1505
+#define ALC_7POINT1_SOFT                         0x1506
+#define ALC_FORMAT_CHANNELS_SOFT                 0x1990
+#define ALC_FORMAT_TYPE_SOFT                     0x1991
+typedef ALCdevice*    (ALC_APIENTRY *LPALCLOOPBACKOPENDEVICESOFT)(const ALCchar *devicename);
+typedef ALCboolean    (ALC_APIENTRY *LPALCISRENDERFORMATSUPPORTEDSOFT)(ALCdevice *device, ALCsizei freq, ALCenum channels, ALCenum type);
+typedef void          (ALC_APIENTRY *LPALCRENDERSAMPLESSOFT)(ALCdevice *device, ALCvoid *buffer, ALCsizei samples);
+#ifdef AL_ALEXT_PROTOTYPES
+ALC_API ALCdevice* ALC_APIENTRY alcLoopbackOpenDeviceSOFT(const ALCchar *devicename);
+ALC_API ALCboolean ALC_APIENTRY alcIsRenderFormatSupportedSOFT(ALCdevice *device, ALCsizei freq, ALCenum channels, ALCenum type);
+ALC_API void       ALC_APIENTRY alcRenderSamplesSOFT(ALCdevice *device, ALCvoid *buffer, ALCsizei samples);
+#endif
+
+#define ALC_MOJOAL_mixer_threads 1
+#define ALC_MIXER_THREADS_MOJOAL                 0x4D01
+
+#define ALC_MOJOAL_period_frames 1
+#define ALC_PERIOD_FRAMES_MOJOAL                 0x4D03
+
+/* ALC_FAST_MATH_MOJOAL defaults to ALC_FALSE (precise C runtime math); set it to ALC_TRUE to use faster approximations. */
+#define ALC_MOJOAL_fast_math 1
+#define ALC_FAST_MATH_MOJOAL                     0x4D04
+
+#define ALC_MOJOAL_native_buffer_format 1
+#define ALC_NATIVE_BUFFER_FORMAT_MOJOAL          0x4D05
+
+#define ALC_SOFT_device_clock 1
+#if defined(_MSC_VER)
+typedef __int64 ALCint64SOFT;
+typedef unsigned __int64 ALCuint64SOFT;
+#else
+#include <stdint.h>
+typedef int64_t ALCint64SOFT;
+typedef uint64_t ALCuint64SOFT;
+#endif
+#define ALC_DEVICE_CLOCK_SOFT                    0x1600
+#define ALC_DEVICE_LATENCY_SOFT                  0x1601
+#define ALC_DEVICE_CLOCK_LATENCY_SOFT            0x1602
+typedef void          (ALC_APIENTRY *LPALCGETINTEGER64VSOFT)(ALCdevice *device, ALCenum pname, ALCsizei size, ALCint64SOFT *values);
+#ifdef AL_ALEXT_PROTOTYPES
+ALC_API void ALC_APIENTRY alcGetInteger64vSOFT(ALCdevice *device, ALCenum pname, ALCsizei size, ALCint64SOFT *values);
+#endif
+
+#define ALC_SOFT_output_mode 1
+#define ALC_OUTPUT_MODE_SOFT                     0x19AC
+#define ALC_ANY_SOFT                             0x19AD
+#define ALC_STEREO_BASIC_SOFT                    0x19AE
+#define ALC_STEREO_UHJ_SOFT                      0x19AF
+#define ALC_STEREO_HRTF_SOFT                     0x19B2
+#define ALC_SURROUND_5_1_SOFT                    0x1504
+#define ALC_SURROUND_6_1_SOFT                    0x1505
+#define ALC_SURROUND_7_1_SOFT                    0x1506
+
 #if defined(__cplusplus)
 }
 #endif
@@ -7,7 +7,7 @@
  */
 
 #include <stdio.h>
-#include <stdlib.h>  /* needed for alloca */
+#include <stdlib.h>
 #include <math.h>
 #include <float.h>
 
@@ -23,12 +23,34 @@
   #define M_PI (3.14159265358979323846264338327950288)
 #endif
 
+/* We implement the extensions declared in our headers, so we want their prototypes. */
+#define AL_ALEXT_PROTOTYPES 1
+
 #include "al.h"
 #include "alc.h"
 #include "SDL.h"
 
+/* AL_MOJOAL_file_buffer maps files into memory where we know how; elsewhere it reads them in. */
+#ifndef MOJOAL_HAVE_MMAP
+#  if defined(__unix__) || defined(__APPLE__)
+#    define MOJOAL_HAVE_MMAP 1
+#  else
+#    define MOJOAL_HAVE_MMAP 0
+#  endif
+#endif
+#if MOJOAL_HAVE_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
 /* This is for debugging and/or pulling the fire alarm. */
+#ifndef FORCE_SCALAR_FALLBACK
 #define FORCE_SCALAR_FALLBACK 0
+#endif
 #if FORCE_SCALAR_FALLBACK
 #  ifdef __SSE__
 #    undef __SSE__
@@ -61,10 +83,34 @@
 #include <xmmintrin.h>
 #endif
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #ifdef __ARM_NEON__
 #include <arm_neon.h>
 #endif
 
+/* AVX and AVX2 aren't guaranteed on x86, so we build those mixers with
+   per-function target attributes and only use them if the CPU says it's
+   okay at runtime. Visual Studio lets you use the intrinsics without any
+   special compiler flags. */
+#if !FORCE_SCALAR_FALLBACK && defined(__SSE__) && (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#define HAVE_AVX_MIXERS 1
+#define AVX_TARGET __attribute__((target("avx")))
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#elif !FORCE_SCALAR_FALLBACK && defined(_MSC_VER) && (_MSC_VER >= 1700) && (defined(_M_IX86) || defined(_M_X64))
+#define HAVE_AVX_MIXERS 1
+#define AVX_TARGET
+#define AVX2_TARGET
+#else
+#define HAVE_AVX_MIXERS 0
+#endif
+
+#if HAVE_AVX_MIXERS
+#include <immintrin.h>
+#endif
+
 #define OPENAL_VERSION_MAJOR 1
 #define OPENAL_VERSION_MINOR 1
 #define OPENAL_VERSION_STRING3(major, minor) #major "." #minor
@@ -77,6 +123,60 @@
 
 #define DEFAULT_PLAYBACK_DEVICE "Default OpenAL playback device"
 #define DEFAULT_CAPTURE_DEVICE "Default OpenAL capture device"
+#define DEFAULT_LOOPBACK_DEVICE "OpenAL loopback device"
+
+/* Sample frames a loopback device mixes at a time during alcRenderSamplesSOFT(). */
+#ifndef OPENAL_LOOPBACK_PERIOD_FRAMES
+#define OPENAL_LOOPBACK_PERIOD_FRAMES 1024
+#endif
+
+/* Sample frames an SDL playback device mixes per callback, unless ALC_REFRESH or ALC_PERIOD_FRAMES_MOJOAL ask for something else. */
+#ifndef OPENAL_DEFAULT_PERIOD_FRAMES
+#define OPENAL_DEFAULT_PERIOD_FRAMES 1024
+#endif
+
+/* Smallest and largest device periods an app can ask for. */
+#ifndef OPENAL_MIN_PERIOD_FRAMES
+#define OPENAL_MIN_PERIOD_FRAMES 64
+#endif
+#ifndef OPENAL_MAX_PERIOD_FRAMES
+#define OPENAL_MAX_PERIOD_FRAMES 8192
+#endif
+
+/* Most channels we mix to (7.1). Sources keep a gain for each of them. */
+#define OPENAL_MAX_OUTPUT_CHANNELS 8
+
+/* Most channels a buffer can have (7.1, from AL_EXT_MCFORMATS). */
+#define OPENAL_MAX_BUFFER_CHANNELS 8
+
+/* Resampling positions are fixed point, with this many bits for the fraction of a sample frame. */
+#define RESAMPLE_FRAC_BITS 16
+#define RESAMPLE_FRAC_ONE (1 << RESAMPLE_FRAC_BITS)
+#define RESAMPLE_FRAC_MASK (RESAMPLE_FRAC_ONE - 1)
+#define RESAMPLE_FRAC_SCALE (1.0f / ((float) RESAMPLE_FRAC_ONE))
+#define RESAMPLE_MAX_STEP (255 << RESAMPLE_FRAC_BITS)  /* we'll never skip more than this many frames per output frame. */
+
+/* Most sample frames a mixer worker thread mixes at a time; bigger device periods are mixed in several passes. */
+#ifndef OPENAL_MIXER_THREAD_CHUNK_FRAMES
+#define OPENAL_MIXER_THREAD_CHUNK_FRAMES 1024
+#endif
+
+/* Sample frames an AL_SOFT_callback_buffer source holds between pulls from
+   the app. Mixes that need more than this just call the app more than once. */
+#ifndef OPENAL_CALLBACK_BUFFER_FRAMES
+#define OPENAL_CALLBACK_BUFFER_FRAMES 1024
+#endif
+#define OPENAL_CALLBACK_MAX_FRAMESIZE (OPENAL_MAX_BUFFER_CHANNELS * sizeof (float))  /* 7.1 float32. */
+
+/* Most threads a context will mix with if ALC_MIXER_THREADS_MOJOAL asks for more. */
+#ifndef OPENAL_MAX_MIXER_THREADS
+#define OPENAL_MAX_MIXER_THREADS 64
+#endif
+
+/* Most sources the mixer spatializes in one batch. Must be a multiple of 4, for SIMD. */
+#ifndef OPENAL_SPATIALIZE_BATCH_SIZE
+#define OPENAL_SPATIALIZE_BATCH_SIZE 64
+#endif
 
 /* Number of buffers to allocate at once when we need a new block during alGenBuffers(). */
 #ifndef OPENAL_BUFFER_BLOCK_SIZE
@@ -88,6 +188,13 @@
 #define OPENAL_SOURCE_BLOCK_SIZE 64
 #endif
 
+/* Most sample frames per block AL_SOFT_block_alignment allows for compressed
+   formats. This covers any block a .WAV file's 16-bit block size can describe,
+   and keeps the block's size in bytes well inside an ALsizei. */
+#ifndef OPENAL_MAX_BLOCK_ALIGNMENT
+#define OPENAL_MAX_BLOCK_ALIGNMENT 131072
+#endif
+
 /* AL_EXT_FLOAT32 support... */
 #ifndef AL_FORMAT_MONO_FLOAT32
 #define AL_FORMAT_MONO_FLOAT32 0x10010
@@ -97,6 +204,91 @@
 #define AL_FORMAT_STEREO_FLOAT32 0x10011
 #endif
 
+/* AL_EXT_IMA4 support... */
+#ifndef AL_FORMAT_MONO_IMA4
+#define AL_FORMAT_MONO_IMA4 0x1300
+#endif
+
+#ifndef AL_FORMAT_STEREO_IMA4
+#define AL_FORMAT_STEREO_IMA4 0x1301
+#endif
+
+/* AL_SOFT_MSADPCM support... */
+#ifndef AL_FORMAT_MONO_MSADPCM_SOFT
+#define AL_FORMAT_MONO_MSADPCM_SOFT 0x1302
+#endif
+
+#ifndef AL_FORMAT_STEREO_MSADPCM_SOFT
+#define AL_FORMAT_STEREO_MSADPCM_SOFT 0x1303
+#endif
+
+/* AL_EXT_MCFORMATS support... */
+#ifndef AL_FORMAT_QUAD8
+#define AL_FORMAT_QUAD8 0x1204
+#endif
+
+#ifndef AL_FORMAT_QUAD16
+#define AL_FORMAT_QUAD16 0x1205
+#endif
+
+#ifndef AL_FORMAT_QUAD32
+#define AL_FORMAT_QUAD32 0x1206
+#endif
+
+#ifndef AL_FORMAT_51CHN8
+#define AL_FORMAT_51CHN8 0x120A
+#endif
+
+#ifndef AL_FORMAT_51CHN16
+#define AL_FORMAT_51CHN16 0x120B
+#endif
+
+#ifndef AL_FORMAT_51CHN32
+#define AL_FORMAT_51CHN32 0x120C
+#endif
+
+#ifndef AL_FORMAT_61CHN8
+#define AL_FORMAT_61CHN8 0x120D
+#endif
+
+#ifndef AL_FORMAT_61CHN16
+#define AL_FORMAT_61CHN16 0x120E
+#endif
+
+#ifndef AL_FORMAT_61CHN32
+#define AL_FORMAT_61CHN32 0x120F
+#endif
+
+#ifndef AL_FORMAT_71CHN8
+#define AL_FORMAT_71CHN8 0x1210
+#endif
+
+#ifndef AL_FORMAT_71CHN16
+#define AL_FORMAT_71CHN16 0x1211
+#endif
+
+#ifndef AL_FORMAT_71CHN32
+#define AL_FORMAT_71CHN32 0x1212
+#endif
+
+/* AL_EXT_MULAW support... */
+#ifndef AL_FORMAT_MONO_MULAW_EXT
+#define AL_FORMAT_MONO_MULAW_EXT 0x10014
+#endif
+
+#ifndef AL_FORMAT_STEREO_MULAW_EXT
+#define AL_FORMAT_STEREO_MULAW_EXT 0x10015
+#endif
+
+/* AL_EXT_ALAW support... */
+#ifndef AL_FORMAT_MONO_ALAW_EXT
+#define AL_FORMAT_MONO_ALAW_EXT 0x10016
+#endif
+
+#ifndef AL_FORMAT_STEREO_ALAW_EXT
+#define AL_FORMAT_STEREO_ALAW_EXT 0x10017
+#endif
+
 /* ALC_EXT_DISCONNECTED support... */
 #ifndef ALC_CONNECTED
 #define ALC_CONNECTED 0x313
@@ -198,6 +390,15 @@ The locking strategy for this OpenAL implementation:
   them atomically to a linked list that other threads can pick up for
   alSourceUnqueueBuffers.
 
+- If a context is created with ALC_MIXER_THREADS_MOJOAL > 1, its playlist
+  is split between the mixer thread and a pool of worker threads, each
+  mixing every Nth playing source into its own buffer, which are summed
+  into the device's stream at the end. The mixer thread holds the context's
+  source lock for the whole time the workers are running, so from the API's
+  point of view, this looks the same as the mixer mixing those sources one
+  at a time (but the lock can be held a little longer). Removing finished
+  sources from the playlist is still only done by the mixer thread.
+
 - Capture just locks the SDL audio device for everything, since it's a very
   lightweight load and a much simplified API; good enough. The capture device
   thread is an almost-constant minimal load (1 or 2 memcpy's, depending on the
@@ -244,6 +445,36 @@ static int has_neon = 0;
 #endif
 #endif
 
+/* The best mixing functions this CPU can run, chosen once by prep_alc_device(). */
+typedef void (*MixFloat32Fn)(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes);
+typedef ALsizei (*ResampleFloat32Fn)(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *frac, const Uint32 step);
+typedef void (*AccumulateFloat32Fn)(const float * restrict data, float * restrict stream, const int samples);
+typedef void (*MixFloat32SurroundFn)(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int outchannels);
+typedef void (*MixFloat32MatrixFn)(const ALfloat * restrict matrix, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int channels, const int outchannels);
+typedef void (*MixSint16Fn)(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes);
+typedef ALsizei (*ResampleSint16Fn)(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *frac, const Uint32 step);
+typedef void (*ExpandTable8Fn)(const float * restrict table, const Uint8 * restrict data, float * restrict outdata, const int samples);
+
+typedef struct MixerKernels
+{
+    const char *name;
+    MixFloat32Fn mix_float32_c1;
+    MixFloat32Fn mix_float32_c2;
+    ResampleFloat32Fn resample_float32_c1;
+    ResampleFloat32Fn resample_float32_c2;
+    AccumulateFloat32Fn accumulate_float32;
+    MixFloat32SurroundFn mix_float32_c1_surround;
+    MixFloat32SurroundFn mix_float32_c2_surround;
+    MixFloat32MatrixFn mix_float32_matrix;
+    MixSint16Fn mix_sint16_c1;
+    MixSint16Fn mix_sint16_c2;
+    ResampleSint16Fn resample_sint16_c1;
+    ResampleSint16Fn resample_sint16_c2;
+    ExpandTable8Fn expand_table8;
+} MixerKernels;
+
+static MixerKernels mixer_kernels;
+
 /* no threads in Emscripten (at the moment...!) */
 #if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
 #define init_api_lock() 1
@@ -403,16 +634,65 @@ static void free_simd_aligned(void *ptr)
     }
 }
 
+/* A sequence lock, for things the mixer publishes to other threads. The
+   mixer never waits on readers; readers just try again if the mixer was in
+   the middle of an update while they were looking. Only one thread may ever
+   write at a time. The count is odd while an update is in progress. */
+static void seqlock_write_begin(SDL_atomic_t *seq)
+{
+    SDL_AtomicIncRef(seq);
+    SDL_MemoryBarrierRelease();
+}
+
+static void seqlock_write_end(SDL_atomic_t *seq)
+{
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicIncRef(seq);
+}
+
+static int seqlock_read_begin(SDL_atomic_t *seq)
+{
+    int retval;
+    while ((retval = SDL_AtomicGet(seq)) & 1) {
+        /* spin; the writer is only ever a few stores away from done. */
+    }
+    SDL_MemoryBarrierAcquire();
+    return retval;
+}
+
+static ALboolean seqlock_read_retry(SDL_atomic_t *seq, const int start)
+{
+    SDL_MemoryBarrierAcquire();
+    return (SDL_AtomicGet(seq) != start) ? AL_TRUE : AL_FALSE;
+}
+
 
 typedef struct ALbuffer
 {
     ALboolean allocated;
     ALuint name;
     ALint channels;
-    ALint bits;  /* always float32 internally, but this is what alBufferData saw */
+    ALint bits;  /* this is what alBufferData saw, which isn't necessarily what we store. */
     ALsizei frequency;
     ALsizei len;   /* length of data in bytes. */
-    const float *data;  /* we only work in Float32 format. */
+    ALenum alformat;  /* the AL_FORMAT_* the app gave us, which alBufferSubDataSOFT has to match. */
+    SDL_AudioFormat format;  /* AUDIO_F32SYS, unless ALC_NATIVE_BUFFER_FORMAT_MOJOAL or AL_SOFT_map_buffer kept the app's format. Compressed formats are always kept. */
+    ALint framesize;  /* bytes per sample frame of data, in (format). Zero for compressed formats. */
+    ALsizei block_frames;  /* compressed formats decode a block at a time: sample frames per block... */
+    ALsizei block_bytes;  /* ...and bytes per block. Both zero for everything else. */
+    ALsizei unpack_block_alignment;  /* AL_SOFT_block_alignment, in sample frames. Zero means the format's default. */
+    ALsizei pack_block_alignment;
+    const void *data;
+    ALsizei capacity;  /* bytes allocated at (data), which can be more than (len) if a smaller upload reused it. */
+    ALboolean app_owned;  /* alBufferDataStatic: (data) is the app's memory; never write to it or free it. AL_MOJOAL_file_buffer sets it too. */
+    void *file_mapping;  /* AL_MOJOAL_file_buffer: the read-only mapping of the file that (data) points into, or NULL. */
+    size_t file_mapping_len;
+    ALbitfieldSOFT access;  /* AL_SOFT_map_buffer: the AL_MAP_*_BIT_SOFT flags alBufferStorageSOFT allowed. */
+    ALbitfieldSOFT mapped_access;  /* nonzero while alMapBufferSOFT has it mapped. API thread only. */
+    ALsizei mapped_offset;
+    ALsizei mapped_len;
+    ALBUFFERCALLBACKTYPESOFT callback;  /* AL_SOFT_callback_buffer: the mixer pulls data from this instead of using (data). */
+    ALvoid *callback_userptr;
     SDL_atomic_t refcount;  /* if zero, can be deleted or alBufferData'd */
 } ALbuffer;
 
@@ -440,19 +720,55 @@ typedef struct BufferQueue
 
 #define pitch_framesize 1024
 #define pitch_framesize2 512
-typedef struct PitchState
+#define pitch_osamp 4
+#define pitch_stepsize (pitch_framesize / pitch_osamp)
+#define pitch_fft_passes 5  /* log4(pitch_framesize); the FFT is radix-4, so pitch_framesize has to be a power of 4. */
+#define pitch_bins_padded (pitch_framesize2+4)  /* we use bins 0 through pitch_framesize2, padded out to a multiple of 4 for SIMD. */
+
+/* this is allocated with calloc_simd_aligned(), so the arrays can be used with aligned SIMD loads. */
+typedef struct PitchState PitchState;
+SIMDALIGNEDSTRUCT PitchState
 {
     /* !!! FIXME: this is a wild amount of memory for pitch-shifting! */
     ALfloat infifo[pitch_framesize];
-    ALfloat outfifo[pitch_framesize];
-    ALfloat workspace[2*pitch_framesize];
-    ALfloat lastphase[pitch_framesize2+1];
-    ALfloat sumphase[pitch_framesize2+1];
+    ALfloat outfifo[pitch_stepsize];
+    ALfloat fftreal[pitch_framesize];
+    ALfloat fftimag[pitch_framesize];
+    ALfloat lastphase[pitch_bins_padded];
+    ALfloat sumphase[pitch_bins_padded];
     ALfloat outputaccum[2*pitch_framesize];
-    ALfloat synmagn[pitch_framesize2+1];
-    ALfloat synfreq[pitch_framesize2+1];
+    ALfloat synmagn[pitch_bins_padded];
+    ALfloat synfreq[pitch_bins_padded];
     ALint rover;
-} PitchState;
+    ALboolean fast_math;  /* copied from the context when this is allocated. */
+};
+
+/* These never change, so they're built once, the first time a source needs the phase vocoder. */
+SIMDALIGNEDSTRUCT PitchTables
+{
+    ALfloat window[pitch_framesize];  /* Hann window for analysis. */
+    ALfloat synthesis_window[pitch_framesize];  /* same window, with the output scaling folded in. */
+    ALfloat twiddles[(4 + 16 + 64 + 256) * 6];  /* for each FFT pass after the first: real, imaginary parts of w^j, w^2j, w^3j. */
+    Uint16 digitrev[pitch_framesize];  /* base-4 digit reversal: where each input sample goes before the first FFT pass. */
+};
+static struct PitchTables pitch_tables;
+static ALboolean pitch_tables_ready = AL_FALSE;
+
+/* where decoding a compressed buffer left off, so the next mix can pick up
+   from there instead of going back to the start of the block. */
+typedef struct CompressedDecoder
+{
+    const ALbuffer *buffer;  /* NULL until something is decoded. */
+    ALsizei block;  /* the block being decoded... */
+    ALsizei frame;  /* ...and the next frame of it to decode. */
+    int sample1[2];  /* IMA4: the last sample. MSADPCM: the last two. */
+    int sample2[2];
+    int step[2];  /* IMA4: step index. MSADPCM: delta. */
+    int coef1[2];  /* MSADPCM: the block's predictor. */
+    int coef2[2];
+    float recent[2][2];  /* the last two frames decoded, newest first, so the resampler can reread them. */
+    int cached;  /* how many of (recent) are good. */
+} CompressedDecoder;
 
 
 typedef struct ALsource ALsource;
@@ -463,7 +779,8 @@ SIMDALIGNEDSTRUCT ALsource
     ALfloat position[4];
     ALfloat velocity[4];
     ALfloat direction[4];
-    ALfloat panning[2];  /* we only do stereo for now */
+    ALfloat panning[OPENAL_MAX_OUTPUT_CHANNELS];  /* gain for each output channel. Stereo output only uses the first two. */
+    ALfloat channel_matrix[OPENAL_MAX_BUFFER_CHANNELS * OPENAL_MAX_OUTPUT_CHANNELS];  /* AL_EXT_MCFORMATS buffers: gain from each buffer channel to each output channel. */
     SDL_atomic_t mixer_accessible;
     SDL_atomic_t state;  /* initial, playing, paused, stopped */
     ALuint name;
@@ -479,20 +796,33 @@ SIMDALIGNEDSTRUCT ALsource
     ALfloat max_distance;
     ALfloat rolloff_factor;
     ALfloat pitch;
+    ALfloat mixer_pitch;  /* AL_PITCH as of the last recalc, so deferred updates don't reach the mixer early. Mixer only. */
+    ALfloat doppler_pitch;  /* playback rate change from the Doppler effect. Worked out by the mixer during recalc; AL_SAMPLE_RW_OFFSETS_SOFT peeks at it. */
+    CompressedDecoder decoder;  /* Mixer only, except seeking resets it under the source lock. */
     ALfloat cone_inner_angle;
     ALfloat cone_outer_angle;
     ALfloat cone_outer_gain;
     ALbuffer *buffer;
-    SDL_AudioStream *stream;  /* for resampling. */
     SDL_atomic_t total_queued_buffers;   /* everything queued, playing and processed. AL_BUFFERS_QUEUED value. */
     BufferQueue buffer_queue;
     BufferQueue buffer_queue_processed;
-    ALsizei offset;  /* offset in bytes for converted stream! */
+    ALsizei offset;  /* offset in sample frames into the current buffer. */
+    Uint32 offset_frac;  /* fraction of a sample frame past offset, in RESAMPLE_FRAC_BITS fixed point. */
     ALboolean offset_latched;  /* AL_SEC_OFFSET, etc, say set values apply to next alSourcePlay if not currently playing! */
+    SDL_atomic_t mixed_offset_seq;  /* seqlock for mixed_offset and mixed_clock. */
+    Sint64 mixed_offset;  /* source_calculate_offset() as of the end of the last mix. Written by whoever is mixing this source, read by anyone. */
+    Uint64 mixed_clock;  /* the device's clock_frames when mixed_offset is reached. */
     ALint queue_channels;
     ALsizei queue_frequency;
-    PitchState *pitchstate;
+    PitchState *pitchstate;  /* only allocated for AL_PHASE_VOCODER_PITCH_MOJOAL sources that change pitch. */
+    ALboolean vocoder_pitch;  /* AL_PHASE_VOCODER_PITCH_MOJOAL: shift pitch without changing speed. */
+    Uint8 *callback_data;  /* AL_SOFT_callback_buffer frames pulled from the app but not mixed yet. Allocated for the first callback buffer, kept until the source is deleted. */
+    ALsizei callback_frames;  /* frames in callback_data; (offset) counts from the start of it. */
+    Uint64 callback_played;  /* frames dropped from the front of callback_data since the source started, for AL_SAMPLE_OFFSET. */
+    ALboolean callback_ended;  /* the app gave us less than we asked for, so stop when callback_data runs out. */
     ALsource *playlist_next;  /* linked list that contains currently-playing sources! Only touched by mixer thread! */
+    ALboolean just_played;  /* just (re)started, so it needs spatializing even if updates are deferred. Mixer only. */
+    ALCboolean mixer_keep;  /* result of mixing this source on a worker thread, so the mixer thread can update the playlist afterwards. */
 };
 
 /* !!! FIXME: buffers and sources use almost identical code for blocks */
@@ -510,17 +840,80 @@ typedef struct SourcePlayTodo
     struct SourcePlayTodo *next;
 } SourcePlayTodo;
 
+/* Surround output pans mono sources with 2D VBAP (vector base amplitude
+   panning): the source lands between the two adjacent speakers around the
+   listener that surround its direction. Each pair gets the inverse of the
+   matrix made of its speakers' unit vectors, so a pair's gains for a
+   direction are one 2x2 multiply; we do every pair at once and use the one
+   where neither gain comes out negative. Stereo output uses constant power
+   panning instead, and doesn't use this. */
+typedef struct SpeakerPanning
+{
+    int num_pairs;
+    ALfloat gain1_x[OPENAL_MAX_OUTPUT_CHANNELS];  /* struct of arrays, one element per pair, so SIMD can do four pairs at once. */
+    ALfloat gain1_y[OPENAL_MAX_OUTPUT_CHANNELS];
+    ALfloat gain2_x[OPENAL_MAX_OUTPUT_CHANNELS];
+    ALfloat gain2_y[OPENAL_MAX_OUTPUT_CHANNELS];
+    Uint8 channel1[OPENAL_MAX_OUTPUT_CHANNELS];  /* output channel for each speaker in the pair. */
+    Uint8 channel2[OPENAL_MAX_OUTPUT_CHANNELS];
+} SpeakerPanning;
+
+/* Before mixing, every playing source that needs its panning and Doppler
+   pitch recalculated gets gathered into one of these, struct of arrays, so
+   SIMD can spatialize four sources at once instead of spending three lanes
+   of a vector on one source's x, y and z. When the listener moves, that's
+   every playing source, every time we mix. */
+typedef struct SpatializeBatch SpatializeBatch;
+SIMDALIGNEDSTRUCT SpatializeBatch
+{
+    /* keep the arrays first so they're aligned for SIMD. Positions are relative to the listener. */
+    ALfloat position_x[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat position_y[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat position_z[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat velocity_x[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat velocity_y[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat velocity_z[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat direction_x[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat direction_y[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat direction_z[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat listener_velocity_scale[OPENAL_SPATIALIZE_BATCH_SIZE];  /* 0.0f for source-relative sources, which move with the listener. */
+    ALfloat gain[OPENAL_SPATIALIZE_BATCH_SIZE];  /* AL_GAIN going in, the final gain coming out. */
+    ALfloat min_gain[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat max_gain[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat reference_distance[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat max_distance[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat rolloff_factor[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat cone_inner_angle[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat cone_outer_angle[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat cone_outer_gain[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat pan_x[OPENAL_SPATIALIZE_BATCH_SIZE];  /* direction to the source in the listener's horizontal plane: x is to the right... */
+    ALfloat pan_y[OPENAL_SPATIALIZE_BATCH_SIZE];  /* ...and y is straight ahead. */
+    ALfloat stereo_left[OPENAL_SPATIALIZE_BATCH_SIZE];  /* constant power panning, with the final gain applied. */
+    ALfloat stereo_right[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALfloat doppler_pitch[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALsource *sources[OPENAL_SPATIALIZE_BATCH_SIZE];
+    ALboolean spatialize[OPENAL_SPATIALIZE_BATCH_SIZE];  /* AL_FALSE for sources that only get AL_GAIN, like stereo buffers. */
+    int count;
+};
+
 struct ALCdevice_struct
 {
     char *name;
     ALCenum error;
     SDL_atomic_t connected;
     ALCboolean iscapture;
+    ALCboolean isloopback;
     SDL_AudioDeviceID sdldevice;
 
-    ALint channels;
+    ALint channels;  /* what we mix to: 2, or 4, 6, 7 or 8 for surround. */
     ALint frequency;
     ALCsizei framesize;
+    ALCenum output_mode;  /* ALC_OUTPUT_MODE_SOFT */
+    SpeakerPanning speakers;  /* only used if channels > 2. */
+    ALCsizei period_frames;  /* most sample frames we'll be asked to mix at once. */
+    SDL_atomic_t clock_seq;  /* seqlock for clock_frames. */
+    Uint64 clock_frames;  /* ALC_SOFT_device_clock: sample frames mixed since the device opened. Written by the mixer, read by anyone. */
+    Uint64 clock_frames_after_mix;  /* what clock_frames will be when the current mix is done. Mixer only. */
 
     union {
         struct {
@@ -529,6 +922,12 @@ struct ALCdevice_struct
             ALCsizei num_buffer_blocks;
             BufferQueueItem *buffer_queue_pool;  /* mixer thread doesn't touch this. */
             void *source_todo_pool;  /* void* because we'll atomicgetptr it. */
+            struct {
+                SDL_mutex *lock;  /* stands in for SDL_LockAudioDevice, since there's no SDL device. */
+                SDL_AudioCVT cvt;  /* converts our float32 mix to the app's format, if necessary. */
+                ALCsizei framesize;  /* size of a sample frame in the app's format. */
+                float *mixbuf;  /* NULL if we can mix directly into the app's buffer. */
+            } loopback;  /* only used if isloopback */
         } playback;
         struct {
             RingBuffer ring;  /* only used if iscapture */
@@ -536,6 +935,26 @@ struct ALCdevice_struct
     };
 };
 
+/* Temporary buffers for the mixer come out of here, so mixing never allocates
+   and doesn't need stack space proportional to the device period. Each thread
+   that mixes gets its own. */
+typedef struct MixScratch
+{
+    float *buffer;  /* SIMD-aligned. */
+    ALsizei capacity;  /* in floats. */
+    ALsizei used;  /* in floats. Reset at the start of each mix. */
+} MixScratch;
+
+typedef struct MixerWorker
+{
+    ALCcontext *ctx;
+    SDL_Thread *thread;
+    SDL_sem *wake;
+    float *mixbuf;  /* SIMD-aligned. This worker's share of the playlist accumulates here. */
+    MixScratch scratch;
+    int index;  /* this worker mixes every Nth playing source, starting with this one. */
+} MixerWorker;
+
 struct ALCcontext_struct
 {
     /* keep these first to help guarantee that its elements are aligned for SIMD */
@@ -560,6 +979,9 @@ struct ALCcontext_struct
     ALfloat doppler_factor;
     ALfloat doppler_velocity;
     ALfloat speed_of_sound;
+    ALCboolean fast_math;  /* ALC_FAST_MATH_MOJOAL: use our approximations instead of the C runtime for the 3D and vocoder math. */
+    ALCboolean native_buffer_format;  /* ALC_NATIVE_BUFFER_FORMAT_MOJOAL: alBufferData keeps 8 and 16-bit data as-is instead of converting to float32. */
+    ALboolean deferring;  /* AL_SOFT_deferred_updates. Only changed while holding source_lock. */
 
     SDL_mutex *source_lock;
 
@@ -567,13 +989,27 @@ struct ALCcontext_struct
     ALsource *playlist;  /* linked list of currently-playing sources. Mixer thread only! */
     ALsource *playlist_tail;  /* end of playlist so we know if last item is being readded. Mixer thread only! */
 
+    MixScratch scratch;  /* for the thread that calls mix_context(). */
+    SpatializeBatch spatialize;  /* mixer thread only. */
+
+    int num_mixer_threads;  /* includes the thread that calls mix_context(), so 1 means "mix serially." */
+    MixerWorker *mixer_workers;  /* num_mixer_threads-1 of these. */
+    SDL_sem *mixer_workers_done;
+    SDL_atomic_t mixer_workers_quit;
+    int mixer_work_len;  /* bytes of stream for the workers to mix. Only touched while the mixer thread waits for them. */
+
     ALCcontext *prev;  /* contexts are in a double-linked list */
     ALCcontext *next;
 };
 
 /* forward declarations */
+static Sint64 source_calculate_offset(const ALsource *src);
+static const ALbuffer *source_offset_buffer(const ALsource *src);
+static void source_get_offset_clock(ALCcontext *ctx, ALsource *src, Sint64 *offset, Uint64 *clock);
 static float source_get_offset(ALsource *src, ALenum param);
+static void source_get_rw_offsets(ALCcontext *ctx, ALsource *src, const ALenum param, ALint *values);
 static void source_set_offset(ALsource *src, ALenum param, ALfloat value);
+static void choose_mixer_kernels(void);
 
 /* the just_queued list is backwards. Add it to the queue in the correct order. */
 static void queue_new_buffer_items_recursive(BufferQueue *queue, BufferQueueItem *items)
@@ -666,10 +1102,32 @@ static ALCenum null_device_error = ALC_NO_ERROR;
 #define ALC_EXTENSION_ITEMS \
     ALC_EXTENSION_ITEM(ALC_ENUMERATION_EXT) \
     ALC_EXTENSION_ITEM(ALC_EXT_CAPTURE) \
-    ALC_EXTENSION_ITEM(ALC_EXT_DISCONNECT)
+    ALC_EXTENSION_ITEM(ALC_EXT_DISCONNECT) \
+    ALC_EXTENSION_ITEM(ALC_SOFT_loopback) \
+    ALC_EXTENSION_ITEM(ALC_MOJOAL_mixer_threads) \
+    ALC_EXTENSION_ITEM(ALC_MOJOAL_period_frames) \
+    ALC_EXTENSION_ITEM(ALC_MOJOAL_fast_math) \
+    ALC_EXTENSION_ITEM(ALC_MOJOAL_native_buffer_format) \
+    ALC_EXTENSION_ITEM(ALC_SOFT_device_clock) \
+    ALC_EXTENSION_ITEM(ALC_SOFT_output_mode)
 
 #define AL_EXTENSION_ITEMS \
-    AL_EXTENSION_ITEM(AL_EXT_FLOAT32)
+    AL_EXTENSION_ITEM(AL_EXT_FLOAT32) \
+    AL_EXTENSION_ITEM(AL_MOJOAL_phase_vocoder_pitch) \
+    AL_EXTENSION_ITEM(AL_SOFT_source_latency) \
+    AL_EXTENSION_ITEM(AL_SOFT_deferred_updates) \
+    AL_EXTENSION_ITEM(AL_MOJOAL_source_batch) \
+    AL_EXTENSION_ITEM(AL_SOFT_callback_buffer) \
+    AL_EXTENSION_ITEM(AL_SOFT_buffer_sub_data) \
+    AL_EXTENSION_ITEM(AL_SOFT_map_buffer) \
+    AL_EXTENSION_ITEM(AL_EXT_STATIC_BUFFER) \
+    AL_EXTENSION_ITEM(AL_MOJOAL_file_buffer) \
+    AL_EXTENSION_ITEM(AL_EXT_IMA4) \
+    AL_EXTENSION_ITEM(AL_SOFT_MSADPCM) \
+    AL_EXTENSION_ITEM(AL_SOFT_block_alignment) \
+    AL_EXTENSION_ITEM(AL_EXT_MCFORMATS) \
+    AL_EXTENSION_ITEM(AL_EXT_MULAW) \
+    AL_EXTENSION_ITEM(AL_EXT_ALAW)
 
 
 static void set_alc_error(ALCdevice *device, const ALCenum error)
@@ -685,54 +1143,89 @@ static void set_alc_error(ALCdevice *device, const ALCenum error)
 #define context_needs_recalc(ctx) SDL_MemoryBarrierRelease(); ctx->recalc = AL_TRUE;
 #define source_needs_recalc(src) SDL_MemoryBarrierRelease(); src->recalc = AL_TRUE;
 
-static ALCdevice *prep_alc_device(const char *devicename, const ALCboolean iscapture)
+static ALCdevice *prep_alc_device(const char *devicename, const ALCboolean iscapture, const ALCboolean isloopback)
 {
+    /* loopback devices never talk to the audio hardware, so they work on machines without any. */
+    const Uint32 subsystems = isloopback ? 0 : SDL_INIT_AUDIO;
     ALCdevice *dev = NULL;
 
-    if (SDL_InitSubSystem(SDL_INIT_AUDIO) == -1) {
+    if (SDL_InitSubSystem(subsystems) == -1) {
         return NULL;
     }
 
     #ifdef __SSE__
     if (!SDL_HasSSE()) {
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        SDL_QuitSubSystem(subsystems);
         return NULL;  /* whoa! Better order a new Pentium III from Gateway 2000! */
     }
     #endif
 
     #if defined(__ARM_NEON__) && !NEED_SCALAR_FALLBACK
     if (!SDL_HasNEON()) {
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        SDL_QuitSubSystem(subsystems);
         return NULL;  /* :( */
     }
     #elif defined(__ARM_NEON__) && NEED_SCALAR_FALLBACK
     has_neon = SDL_HasNEON();
     #endif
 
+    choose_mixer_kernels();
+
     if (!init_api_lock()) {
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        SDL_QuitSubSystem(subsystems);
         return NULL;
     }
 
     dev = (ALCdevice *) SDL_calloc(1, sizeof (ALCdevice));
     if (!dev) {
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        SDL_QuitSubSystem(subsystems);
         return NULL;
     }
 
     dev->name = SDL_strdup(devicename);
     if (!dev->name) {
         SDL_free(dev);
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        SDL_QuitSubSystem(subsystems);
         return NULL;
     }
 
+    if (isloopback) {
+        dev->playback.loopback.lock = SDL_CreateMutex();
+        if (!dev->playback.loopback.lock) {
+            SDL_free(dev->name);
+            SDL_free(dev);
+            return NULL;
+        }
+    }
+
     SDL_AtomicSet(&dev->connected, ALC_TRUE);
     dev->iscapture = iscapture;
+    dev->isloopback = isloopback;
 
     return dev;
 }
 
+/* This holds off the mixer, so you can change the device's context list, etc.
+   For SDL-backed devices, this is the SDL audio device lock. Loopback devices
+   mix on whatever thread calls alcRenderSamplesSOFT(), so they have their own. */
+static void lock_mixer(ALCdevice *device)
+{
+    if (device->isloopback) {
+        SDL_LockMutex(device->playback.loopback.lock);
+    } else {
+        SDL_LockAudioDevice(device->sdldevice);
+    }
+}
+
+static void unlock_mixer(ALCdevice *device)
+{
+    if (device->isloopback) {
+        SDL_UnlockMutex(device->playback.loopback.lock);
+    } else {
+        SDL_UnlockAudioDevice(device->sdldevice);
+    }
+}
+
 /* no api lock; this creates it and otherwise doesn't have any state that can race */
 ALCdevice *alcOpenDevice(const ALCchar *devicename)
 {
@@ -740,7 +1233,7 @@ ALCdevice *alcOpenDevice(const ALCchar *devicename)
         devicename = DEFAULT_PLAYBACK_DEVICE;  /* so ALC_DEVICE_SPECIFIER is meaningful */
     }
 
-    return prep_alc_device(devicename, ALC_FALSE);
+    return prep_alc_device(devicename, ALC_FALSE, ALC_FALSE);
 
     /* we don't open an SDL audio device until the first context is
        created, so we can attempt to match audio formats. */
@@ -772,6 +1265,11 @@ ALCboolean alcCloseDevice(ALCdevice *device)
         SDL_CloseAudioDevice(device->sdldevice);
     }
 
+    if (device->isloopback) {
+        free_simd_aligned(device->playback.loopback.mixbuf);
+        SDL_DestroyMutex(device->playback.loopback.lock);
+    }
+
     for (i = 0; i < device->playback.num_buffer_blocks; i++) {
         SDL_free(device->playback.buffer_blocks[i]);
     }
@@ -792,13 +1290,26 @@ ALCboolean alcCloseDevice(ALCdevice *device)
     }
 
     SDL_free(device->name);
+    SDL_QuitSubSystem(device->isloopback ? 0 : SDL_INIT_AUDIO);
     SDL_free(device);
-    SDL_QuitSubSystem(SDL_INIT_AUDIO);
 
     return ALC_TRUE;
 }
 
 
+/* AL_EXT_MCFORMATS buffers are in SDL's channel order for the same layout, which is also what we mix to. */
+static Uint8 mcformat_channels(const ALCenum alfmt)
+{
+    switch (alfmt) {
+        case AL_FORMAT_QUAD8: case AL_FORMAT_QUAD16: case AL_FORMAT_QUAD32: return 4;
+        case AL_FORMAT_51CHN8: case AL_FORMAT_51CHN16: case AL_FORMAT_51CHN32: return 6;
+        case AL_FORMAT_61CHN8: case AL_FORMAT_61CHN16: case AL_FORMAT_61CHN32: return 7;
+        case AL_FORMAT_71CHN8: case AL_FORMAT_71CHN16: case AL_FORMAT_71CHN32: return 8;
+        default: break;
+    }
+    return 0;
+}
+
 static ALCboolean alcfmt_to_sdlfmt(const ALCenum alfmt, SDL_AudioFormat *sdlfmt, Uint8 *channels, ALCsizei *framesize)
 {
     switch (alfmt) {
@@ -832,6 +1343,30 @@ static ALCboolean alcfmt_to_sdlfmt(const ALCenum alfmt, SDL_AudioFormat *sdlfmt,
             *channels = 2;
             *framesize = 8;
             break;
+        case AL_FORMAT_QUAD8:
+        case AL_FORMAT_51CHN8:
+        case AL_FORMAT_61CHN8:
+        case AL_FORMAT_71CHN8:
+            *sdlfmt = AUDIO_U8;
+            *channels = mcformat_channels(alfmt);
+            *framesize = *channels;
+            break;
+        case AL_FORMAT_QUAD16:
+        case AL_FORMAT_51CHN16:
+        case AL_FORMAT_61CHN16:
+        case AL_FORMAT_71CHN16:
+            *sdlfmt = AUDIO_S16SYS;
+            *channels = mcformat_channels(alfmt);
+            *framesize = *channels * 2;
+            break;
+        case AL_FORMAT_QUAD32:
+        case AL_FORMAT_51CHN32:
+        case AL_FORMAT_61CHN32:
+        case AL_FORMAT_71CHN32:
+            *sdlfmt = AUDIO_F32SYS;
+            *channels = mcformat_channels(alfmt);
+            *framesize = *channels * 4;
+            break;
         default:
             return ALC_FALSE;
     }
@@ -839,6 +1374,94 @@ static ALCboolean alcfmt_to_sdlfmt(const ALCenum alfmt, SDL_AudioFormat *sdlfmt,
     return ALC_TRUE;
 }
 
+/* buffer formats SDL doesn't have; these are never handed to SDL. Buffers
+   keep them compressed and the mixer decodes them a block at a time.
+   SDL_AUDIO_BITSIZE() says 4 for both, which is what AL_BITS should report. */
+#define MOJOAL_AUDIO_IMA4 0x0004
+#define MOJOAL_AUDIO_MSADPCM 0x0104
+
+/* G.711 buffers are stored as-is, too, and expanded by the mixer. SDL_AUDIO_BITSIZE() says 8 for these. */
+#define MOJOAL_AUDIO_MULAW 0x0108
+#define MOJOAL_AUDIO_ALAW 0x0208
+
+/* alcfmt_to_sdlfmt(), plus the formats that only buffers can use. The block-compressed ones report a (framesize) of zero. */
+static ALboolean alfmt_to_buffer_format(const ALenum alfmt, SDL_AudioFormat *sdlfmt, Uint8 *channels, ALCsizei *framesize)
+{
+    switch (alfmt) {
+        case AL_FORMAT_MONO_MULAW_EXT:
+        case AL_FORMAT_STEREO_MULAW_EXT:
+            *sdlfmt = MOJOAL_AUDIO_MULAW;
+            *channels = (alfmt == AL_FORMAT_MONO_MULAW_EXT) ? 1 : 2;
+            *framesize = *channels;
+            return AL_TRUE;
+        case AL_FORMAT_MONO_ALAW_EXT:
+        case AL_FORMAT_STEREO_ALAW_EXT:
+            *sdlfmt = MOJOAL_AUDIO_ALAW;
+            *channels = (alfmt == AL_FORMAT_MONO_ALAW_EXT) ? 1 : 2;
+            *framesize = *channels;
+            return AL_TRUE;
+        case AL_FORMAT_MONO_IMA4:
+        case AL_FORMAT_STEREO_IMA4:
+            *sdlfmt = MOJOAL_AUDIO_IMA4;
+            *channels = (alfmt == AL_FORMAT_MONO_IMA4) ? 1 : 2;
+            *framesize = 0;
+            return AL_TRUE;
+        case AL_FORMAT_MONO_MSADPCM_SOFT:
+        case AL_FORMAT_STEREO_MSADPCM_SOFT:
+            *sdlfmt = MOJOAL_AUDIO_MSADPCM;
+            *channels = (alfmt == AL_FORMAT_MONO_MSADPCM_SOFT) ? 1 : 2;
+            *framesize = 0;
+            return AL_TRUE;
+        default: break;
+    }
+
+    return alcfmt_to_sdlfmt(alfmt, sdlfmt, channels, framesize) ? AL_TRUE : AL_FALSE;
+}
+
+/* IMA4 blocks hold 1+8n sample frames (65 by default), MSADPCM blocks hold
+   an even number of them (64 by default), per AL_SOFT_block_alignment.
+   Uncompressed formats get zeroes. */
+static ALboolean buffer_block_layout(const SDL_AudioFormat format, const int channels, ALsizei alignment, ALsizei *block_frames, ALsizei *block_bytes)
+{
+    *block_frames = *block_bytes = 0;
+    if (alignment > OPENAL_MAX_BLOCK_ALIGNMENT) {
+        return AL_FALSE;
+    } else if (format == MOJOAL_AUDIO_IMA4) {
+        alignment = alignment ? alignment : 65;
+        if ((alignment - 1) % 8) {
+            return AL_FALSE;
+        }
+        *block_frames = alignment;
+        *block_bytes = channels * (4 + ((alignment - 1) / 2));  /* 4 byte header per channel, then 4 bits a sample. */
+    } else if (format == MOJOAL_AUDIO_MSADPCM) {
+        alignment = alignment ? alignment : 64;
+        if ((alignment < 2) || (alignment % 2)) {
+            return AL_FALSE;
+        }
+        *block_frames = alignment;
+        *block_bytes = channels * (7 + ((alignment - 2) / 2));  /* 7 byte header (with 2 samples) per channel, then 4 bits a sample. */
+    }
+    return AL_TRUE;
+}
+
+/* our own buffer formats, which SDL_ConvertAudio can't do anything with. */
+static ALboolean sdl_converts_format(const SDL_AudioFormat format)
+{
+    return ((format != MOJOAL_AUDIO_IMA4) && (format != MOJOAL_AUDIO_MSADPCM) && (format != MOJOAL_AUDIO_MULAW) && (format != MOJOAL_AUDIO_ALAW)) ? AL_TRUE : AL_FALSE;
+}
+
+/* what to fill buffer storage in (format) with to make it silent. */
+static int buffer_silence_byte(const SDL_AudioFormat format)
+{
+    switch (format) {
+        case AUDIO_U8: return 0x80;
+        case MOJOAL_AUDIO_MULAW: return 0xFF;
+        case MOJOAL_AUDIO_ALAW: return 0xD5;  /* A-law has no true zero; this is the smallest positive value. */
+        default: break;
+    }
+    return 0;
+}
+
 static void mix_float32_c1_scalar(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes)
 {
     const ALfloat left = panning[0];
@@ -960,10 +1583,10 @@ static void mix_float32_c1_sse(const ALfloat * restrict panning, const float * r
                 const __m128 vstream2 = _mm_load_ps(stream+4);
                 const __m128 vstream3 = _mm_load_ps(stream+8);
                 const __m128 vstream4 = _mm_load_ps(stream+12);
-                _mm_store_ps(stream, _mm_add_ps(vstream1, _mm_shuffle_ps(vdataload1, vdataload1, _MM_SHUFFLE(0, 0, 1, 1))));
-                _mm_store_ps(stream+4, _mm_add_ps(vstream2, _mm_shuffle_ps(vdataload1, vdataload1, _MM_SHUFFLE(2, 2, 3, 3))));
-                _mm_store_ps(stream+8, _mm_add_ps(vstream3, _mm_shuffle_ps(vdataload2, vdataload2, _MM_SHUFFLE(0, 0, 1, 1))));
-                _mm_store_ps(stream+12, _mm_add_ps(vstream4, _mm_shuffle_ps(vdataload2, vdataload2, _MM_SHUFFLE(2, 2, 3, 3))));
+                _mm_store_ps(stream, _mm_add_ps(vstream1, _mm_shuffle_ps(vdataload1, vdataload1, _MM_SHUFFLE(1, 1, 0, 0))));
+                _mm_store_ps(stream+4, _mm_add_ps(vstream2, _mm_shuffle_ps(vdataload1, vdataload1, _MM_SHUFFLE(3, 3, 2, 2))));
+                _mm_store_ps(stream+8, _mm_add_ps(vstream3, _mm_shuffle_ps(vdataload2, vdataload2, _MM_SHUFFLE(1, 1, 0, 0))));
+                _mm_store_ps(stream+12, _mm_add_ps(vstream4, _mm_shuffle_ps(vdataload2, vdataload2, _MM_SHUFFLE(3, 3, 2, 2))));
             }
         }
         for (i = 0; i < leftover; i++, stream += 2) {
@@ -981,10 +1604,10 @@ static void mix_float32_c1_sse(const ALfloat * restrict panning, const float * r
             const __m128 vstream2 = _mm_load_ps(stream+4);
             const __m128 vstream3 = _mm_load_ps(stream+8);
             const __m128 vstream4 = _mm_load_ps(stream+12);
-            _mm_store_ps(stream, _mm_add_ps(vstream1, _mm_mul_ps(_mm_shuffle_ps(vdataload1, vdataload1, _MM_SHUFFLE(0, 0, 1, 1)), vleftright)));
-            _mm_store_ps(stream+4, _mm_add_ps(vstream2, _mm_mul_ps(_mm_shuffle_ps(vdataload1, vdataload1, _MM_SHUFFLE(2, 2, 3, 3)), vleftright)));
-            _mm_store_ps(stream+8, _mm_add_ps(vstream3, _mm_mul_ps(_mm_shuffle_ps(vdataload2, vdataload2, _MM_SHUFFLE(0, 0, 1, 1)), vleftright)));
-            _mm_store_ps(stream+12, _mm_add_ps(vstream4, _mm_mul_ps(_mm_shuffle_ps(vdataload2, vdataload2, _MM_SHUFFLE(2, 2, 3, 3)), vleftright)));
+            _mm_store_ps(stream, _mm_add_ps(vstream1, _mm_mul_ps(_mm_shuffle_ps(vdataload1, vdataload1, _MM_SHUFFLE(1, 1, 0, 0)), vleftright)));
+            _mm_store_ps(stream+4, _mm_add_ps(vstream2, _mm_mul_ps(_mm_shuffle_ps(vdataload1, vdataload1, _MM_SHUFFLE(3, 3, 2, 2)), vleftright)));
+            _mm_store_ps(stream+8, _mm_add_ps(vstream3, _mm_mul_ps(_mm_shuffle_ps(vdataload2, vdataload2, _MM_SHUFFLE(1, 1, 0, 0)), vleftright)));
+            _mm_store_ps(stream+12, _mm_add_ps(vstream4, _mm_mul_ps(_mm_shuffle_ps(vdataload2, vdataload2, _MM_SHUFFLE(3, 3, 2, 2)), vleftright)));
         }
         for (i = 0; i < leftover; i++, stream += 2) {
             const float samp = *(data++);
@@ -1163,2948 +1786,7407 @@ static void mix_float32_c2_neon(const ALfloat * restrict panning, const float *
 }
 #endif
 
+/* These sum one mix buffer into another, for the parallel mixer. */
+static void accumulate_float32_scalar(const float * restrict data, float * restrict stream, const int samples)
+{
+    const int unrolled = samples / 8;
+    const int leftover = samples % 8;
+    int i;
 
-/****************************************************************************
-*
-* pitch_fft and pitch_shift are modified versions of code from:
-*
-*    http://blogs.zynaptiq.com/bernsee/pitch-shifting-using-the-ft/
-*
-*   The original code has this copyright/license:
-*
-*****************************************************************************
-*
-* COPYRIGHT 1999-2015 Stephan M. Bernsee <s.bernsee [AT] zynaptiq [DOT] com>
-*
-* 						The Wide Open License (WOL)
-*
-* Permission to use, copy, modify, distribute and sell this software and its
-* documentation for any purpose is hereby granted without fee, provided that
-* the above copyright notice and this license appear in all source copies. 
-* THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT EXPRESS OR IMPLIED WARRANTY OF
-* ANY KIND. See http://www.dspguru.com/wol.htm for more information.
-*
-*****************************************************************************/ 
-
-/* FFT routine, (C)1996 S.M.Bernsee. */
-static void pitch_fft(float *fftBuffer, int fftFrameSize, int sign)
-{
-    float wr, wi, arg, *p1, *p2, temp;
-    float tr, ti, ur, ui, *p1r, *p1i, *p2r, *p2i;
-    int i, bitm, j, le, le2, k;
-
-    for (i = 2; i < 2*fftFrameSize-2; i += 2) {
-        for (bitm = 2, j = 0; bitm < 2*fftFrameSize; bitm <<= 1) {
-            if (i & bitm) j++;
-            j <<= 1;
-        }
-        if (i < j) {
-            p1 = fftBuffer+i; p2 = fftBuffer+j;
-            temp = *p1; *(p1++) = *p2;
-            *(p2++) = temp; temp = *p1;
-            *p1 = *p2; *p2 = temp;
-        }
-    }
-    const int endval = (int)(SDL_log(fftFrameSize)/SDL_log(2.)+.5);   /* !!! FIXME: precalc this. */
-    for (k = 0, le = 2; k < endval; k++) {
-        le <<= 1;
-        le2 = le>>1;
-        ur = 1.0f;
-        ui = 0.0f;
-        arg = (float) (M_PI / (le2>>1));
-        wr = SDL_cosf(arg);
-        wi = sign*SDL_sinf(arg);
-        for (j = 0; j < le2; j += 2) {
-            p1r = fftBuffer+j; p1i = p1r+1;
-            p2r = p1r+le2; p2i = p2r+1;
-            for (i = j; i < 2*fftFrameSize; i += le) {
-                tr = *p2r * ur - *p2i * ui;
-                ti = *p2r * ui + *p2i * ur;
-                *p2r = *p1r - tr; *p2i = *p1i - ti;
-                *p1r += tr; *p1i += ti;
-                p1r += le; p1i += le;
-                p2r += le; p2i += le;
-            }
-            tr = ur*wr - ui*wi;
-            ui = ur*wi + ui*wr;
-            ur = tr;
-        }
+    for (i = 0; i < unrolled; i++, data += 8, stream += 8) {
+        stream[0] += data[0];
+        stream[1] += data[1];
+        stream[2] += data[2];
+        stream[3] += data[3];
+        stream[4] += data[4];
+        stream[5] += data[5];
+        stream[6] += data[6];
+        stream[7] += data[7];
+    }
+    for (i = 0; i < leftover; i++) {
+        *(stream++) += *(data++);
     }
 }
 
-static void pitch_shift(ALsource *src, const ALbuffer *buffer, int numSampsToProcess, const float *indata, float *outdata)
+#ifdef __SSE__
+static void accumulate_float32_sse(const float * restrict data, float * restrict stream, const int samples)
 {
-    const float pitchShift = src->pitch;
-    const float sampleRate = (float) buffer->frequency;
-    const int osamp = 4;
-    const int stepSize = pitch_framesize / osamp;
-    const int inFifoLatency = pitch_framesize - stepSize;
-    const double freqPerBin = sampleRate / (double)pitch_framesize;
-    const double expct = 2.0 * M_PI * ((double)stepSize / (double)pitch_framesize);
-
-    double magn, phase, tmp, window, real, imag;
-    int i,k, qpd, index;
-    PitchState *state = src->pitchstate;
-
-    SDL_assert(state != NULL);
+    const int unrolled = samples / 16;
+    const int leftover = samples % 16;
+    int i;
 
-    if (state->rover == 0) state->rover = inFifoLatency;
+    if ( (((size_t)stream) % 16) || (((size_t)data) % 16) ) {
+        /* unaligned, do scalar version. */
+        accumulate_float32_scalar(data, stream, samples);
+        return;
+    }
 
-    /* main processing loop */
-    for (i = 0; i < numSampsToProcess; i++){
+    for (i = 0; i < unrolled; i++, data += 16, stream += 16) {
+        const __m128 vdata1 = _mm_load_ps(data);
+        const __m128 vdata2 = _mm_load_ps(data+4);
+        const __m128 vdata3 = _mm_load_ps(data+8);
+        const __m128 vdata4 = _mm_load_ps(data+12);
+        _mm_store_ps(stream, _mm_add_ps(_mm_load_ps(stream), vdata1));
+        _mm_store_ps(stream+4, _mm_add_ps(_mm_load_ps(stream+4), vdata2));
+        _mm_store_ps(stream+8, _mm_add_ps(_mm_load_ps(stream+8), vdata3));
+        _mm_store_ps(stream+12, _mm_add_ps(_mm_load_ps(stream+12), vdata4));
+    }
+    accumulate_float32_scalar(data, stream, leftover);
+}
+#endif
 
-        /* As long as we have not yet collected enough data just read in */
-        state->infifo[state->rover] = indata[i];
-        outdata[i] = state->outfifo[state->rover-inFifoLatency];
-        state->rover++;
+#ifdef __ARM_NEON__
+static void accumulate_float32_neon(const float * restrict data, float * restrict stream, const int samples)
+{
+    const int unrolled = samples / 16;
+    const int leftover = samples % 16;
+    int i;
 
-        /* now we have enough data for processing */
-        if (state->rover >= pitch_framesize) {
-            state->rover = inFifoLatency;
+    if ( (((size_t)stream) % 16) || (((size_t)data) % 16) ) {
+        /* unaligned, do scalar version. */
+        accumulate_float32_scalar(data, stream, samples);
+        return;
+    }
 
-            /* do windowing and re,im interleave */
-            for (k = 0; k < pitch_framesize;k++) {
-                window = -.5*SDL_cos(2.*M_PI*(double)k/(double)pitch_framesize)+.5;
-                state->workspace[2*k] = (ALfloat) (state->infifo[k] * window);
-                state->workspace[2*k+1] = 0.0f;
-            }
+    for (i = 0; i < unrolled; i++, data += 16, stream += 16) {
+        const float32x4_t vdata1 = vld1q_f32(data);
+        const float32x4_t vdata2 = vld1q_f32(data+4);
+        const float32x4_t vdata3 = vld1q_f32(data+8);
+        const float32x4_t vdata4 = vld1q_f32(data+12);
+        vst1q_f32(stream, vaddq_f32(vld1q_f32(stream), vdata1));
+        vst1q_f32(stream+4, vaddq_f32(vld1q_f32(stream+4), vdata2));
+        vst1q_f32(stream+8, vaddq_f32(vld1q_f32(stream+8), vdata3));
+        vst1q_f32(stream+12, vaddq_f32(vld1q_f32(stream+12), vdata4));
+    }
+    accumulate_float32_scalar(data, stream, leftover);
+}
+#endif
 
+/* Surround output (quad and up) mixes through these. Mono sources get a
+   gain per output channel; stereo sources aren't spatialized, so they only
+   ever land on the front left and right speakers, which are always the first
+   two channels. (panning) always has OPENAL_MAX_OUTPUT_CHANNELS gains, so
+   the SIMD versions can load all of it without checking. */
+static void mix_float32_c1_surround_scalar(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int outchannels)
+{
+    ALsizei i;
+    int j;
 
-            /* ***************** ANALYSIS ******************* */
-            /* do transform */
-            pitch_fft(state->workspace, pitch_framesize, -1);
+    for (i = 0; i < mixframes; i++, stream += outchannels) {
+        const float samp = *(data++);
+        for (j = 0; j < outchannels; j++) {
+            stream[j] += samp * panning[j];
+        }
+    }
+}
 
-            /* this is the analysis step */
-            for (k = 0; k <= pitch_framesize2; k++) {
+static void mix_float32_c2_surround_scalar(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int outchannels)
+{
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    ALsizei i;
 
-                /* de-interlace FFT buffer */
-                real = state->workspace[2*k];
-                imag = state->workspace[2*k+1];
+    for (i = 0; i < mixframes; i++, data += 2, stream += outchannels) {
+        stream[0] += data[0] * left;
+        stream[1] += data[1] * right;
+    }
+}
 
-                /* compute magnitude and phase */
-                magn = 2.*SDL_sqrt(real*real + imag*imag);
-                phase = SDL_atan2(imag,real);
+#ifdef __SSE__
+/* output frames aren't 16-byte multiples for most layouts, so these don't try to stay aligned. */
+SDL_FORCE_INLINE void mix_float32_c1_surround_sse_layout(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int outchannels)
+{
+    const __m128 vzero = _mm_setzero_ps();
+    const __m128 vgains1 = _mm_loadu_ps(panning);
+    const __m128 vgains2 = _mm_loadu_ps(panning + 4);
+    ALsizei i;
 
-                /* compute phase difference */
-                tmp = phase - state->lastphase[k];
-                state->lastphase[k] = (ALfloat) phase;
+    if (outchannels == 6) {  /* two 5.1 frames fill exactly three registers, so do them in pairs. */
+        const __m128 vgains3 = _mm_shuffle_ps(vgains2, vgains1, _MM_SHUFFLE(1, 0, 1, 0));  /* 4 5 0 1 */
+        const __m128 vgains4 = _mm_shuffle_ps(vgains1, vgains2, _MM_SHUFFLE(1, 0, 3, 2));  /* 2 3 4 5 */
+        for (i = 0; i < (mixframes / 2); i++, data += 2, stream += 12) {
+            const __m128 vsamps = _mm_loadl_pi(vzero, (const __m64 *) data);
+            const __m128 vsamp1 = _mm_shuffle_ps(vsamps, vsamps, _MM_SHUFFLE(0, 0, 0, 0));
+            const __m128 vsamp12 = _mm_shuffle_ps(vsamps, vsamps, _MM_SHUFFLE(1, 1, 0, 0));
+            const __m128 vsamp2 = _mm_shuffle_ps(vsamps, vsamps, _MM_SHUFFLE(1, 1, 1, 1));
+            _mm_storeu_ps(stream, _mm_add_ps(_mm_loadu_ps(stream), _mm_mul_ps(vsamp1, vgains1)));
+            _mm_storeu_ps(stream+4, _mm_add_ps(_mm_loadu_ps(stream+4), _mm_mul_ps(vsamp12, vgains3)));
+            _mm_storeu_ps(stream+8, _mm_add_ps(_mm_loadu_ps(stream+8), _mm_mul_ps(vsamp2, vgains4)));
+        }
+        mix_float32_c1_surround_scalar(panning, data, stream, mixframes % 2, outchannels);
+    } else {
+        for (i = 0; i < mixframes; i++, stream += outchannels) {
+            const __m128 vsamp = _mm_set1_ps(*(data++));
+            _mm_storeu_ps(stream, _mm_add_ps(_mm_loadu_ps(stream), _mm_mul_ps(vsamp, vgains1)));
+            if (outchannels == 8) {
+                _mm_storeu_ps(stream+4, _mm_add_ps(_mm_loadu_ps(stream+4), _mm_mul_ps(vsamp, vgains2)));
+            } else if (outchannels == 7) {
+                _mm_storel_pi((__m64 *) (stream+4), _mm_add_ps(_mm_loadl_pi(vzero, (const __m64 *) (stream+4)), _mm_mul_ps(vsamp, vgains2)));
+                _mm_store_ss(stream+6, _mm_add_ss(_mm_load_ss(stream+6), _mm_mul_ss(vsamp, _mm_movehl_ps(vgains2, vgains2))));
+            }
+        }
+    }
+}
 
-                /* subtract expected phase difference */
-                tmp -= (double)k*expct;
+static void mix_float32_c1_surround_sse(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int outchannels)
+{
+    /* each layout gets its own copy of the loop, with outchannels as a constant. */
+    switch (outchannels) {
+        case 4: mix_float32_c1_surround_sse_layout(panning, data, stream, mixframes, 4); break;
+        case 6: mix_float32_c1_surround_sse_layout(panning, data, stream, mixframes, 6); break;
+        case 7: mix_float32_c1_surround_sse_layout(panning, data, stream, mixframes, 7); break;
+        case 8: mix_float32_c1_surround_sse_layout(panning, data, stream, mixframes, 8); break;
+        default: mix_float32_c1_surround_scalar(panning, data, stream, mixframes, outchannels); break;
+    }
+}
 
-                /* map delta phase into +/- Pi interval */
-                qpd = (int) (tmp/M_PI);
-                if (qpd >= 0) qpd += qpd&1;
-                else qpd -= qpd&1;
-                tmp -= M_PI*(double)qpd;
+static void mix_float32_c2_surround_sse(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int outchannels)
+{
+    const __m128 vzero = _mm_setzero_ps();
+    const __m128 vleftright = _mm_loadl_pi(vzero, (const __m64 *) panning);
+    ALsizei i;
 
-                /* get deviation from bin frequency from the +/- Pi interval */
-                tmp = osamp*tmp/(2.*M_PI);
+    for (i = 0; i < mixframes; i++, data += 2, stream += outchannels) {
+        const __m128 vdata = _mm_loadl_pi(vzero, (const __m64 *) data);
+        _mm_storel_pi((__m64 *) stream, _mm_add_ps(_mm_loadl_pi(vzero, (const __m64 *) stream), _mm_mul_ps(vdata, vleftright)));
+    }
+}
+#endif
 
-                /* compute the k-th partials' true frequency */
-                tmp = (double)k*freqPerBin + tmp*freqPerBin;
+#ifdef __ARM_NEON__
+SDL_FORCE_INLINE void mix_float32_c1_surround_neon_layout(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int outchannels)
+{
+    const float32x4_t vgains1 = vld1q_f32(panning);
+    const float32x4_t vgains2 = vld1q_f32(panning + 4);
+    ALsizei i;
 
-                /* store magnitude and true frequency in analysis arrays */
-                state->workspace[2*k] = (ALfloat) magn;
-                state->workspace[2*k+1] = (ALfloat) tmp;
-
-            }
-
-            /* ***************** PROCESSING ******************* */
-            /* this does the actual pitch shifting */
-            SDL_memset(state->synmagn, '\0', sizeof (state->synmagn));
-            for (k = 0; k <= pitch_framesize2; k++) {
-                index = (int) (k*pitchShift);
-                if (index <= pitch_framesize2) { 
-                    state->synmagn[index] += state->workspace[2*k];
-                    state->synfreq[index] = state->workspace[2*k+1] * pitchShift;
-                } 
-            }
-            
-            /* ***************** SYNTHESIS ******************* */
-            /* this is the synthesis step */
-            for (k = 0; k <= pitch_framesize2; k++) {
-
-                /* get magnitude and true frequency from synthesis arrays */
-                magn = state->synmagn[k];
-                tmp = state->synfreq[k];
-
-                /* subtract bin mid frequency */
-                tmp -= (double)k*freqPerBin;
-
-                /* get bin deviation from freq deviation */
-                tmp /= freqPerBin;
-
-                /* take osamp into account */
-                tmp = 2.*M_PI*tmp/osamp;
-
-                /* add the overlap phase advance back in */
-                tmp += (double)k*expct;
-
-                /* accumulate delta phase to get bin phase */
-                state->sumphase[k] += (ALfloat) tmp;
-                phase = state->sumphase[k];
-
-                /* get real and imag part and re-interleave */
-                state->workspace[2*k] = (ALfloat) (magn*SDL_cos(phase));
-                state->workspace[2*k+1] = (ALfloat) (magn*SDL_sin(phase));
-            } 
-
-            /* zero negative frequencies */
-            for (k = pitch_framesize+2; k < 2*pitch_framesize; k++) state->workspace[k] = 0.;
-
-            /* do inverse transform */
-            pitch_fft(state->workspace, pitch_framesize, 1);
-
-            /* do windowing and add to output accumulator */ 
-            for(k=0; k < pitch_framesize; k++) {
-                window = -.5*SDL_cos(2.*M_PI*(double)k/(double)pitch_framesize)+.5;
-                state->outputaccum[k] += (ALfloat) (2.*window*state->workspace[2*k]/(pitch_framesize2*osamp));
+    if (outchannels == 6) {  /* two 5.1 frames fill exactly three registers, so do them in pairs. */
+        const float32x4_t vgains3 = vcombine_f32(vget_low_f32(vgains2), vget_low_f32(vgains1));  /* 4 5 0 1 */
+        const float32x4_t vgains4 = vcombine_f32(vget_high_f32(vgains1), vget_low_f32(vgains2));  /* 2 3 4 5 */
+        for (i = 0; i < (mixframes / 2); i++, data += 2, stream += 12) {
+            const float32x2_t vsamps = vld1_f32(data);
+            const float32x4_t vsamp12 = vcombine_f32(vdup_lane_f32(vsamps, 0), vdup_lane_f32(vsamps, 1));
+            vst1q_f32(stream, vmlaq_f32(vld1q_f32(stream), vdupq_lane_f32(vsamps, 0), vgains1));
+            vst1q_f32(stream+4, vmlaq_f32(vld1q_f32(stream+4), vsamp12, vgains3));
+            vst1q_f32(stream+8, vmlaq_f32(vld1q_f32(stream+8), vdupq_lane_f32(vsamps, 1), vgains4));
+        }
+        mix_float32_c1_surround_scalar(panning, data, stream, mixframes % 2, outchannels);
+    } else {
+        for (i = 0; i < mixframes; i++, stream += outchannels) {
+            const float samp = *(data++);
+            const float32x4_t vsamp = vdupq_n_f32(samp);
+            vst1q_f32(stream, vmlaq_f32(vld1q_f32(stream), vsamp, vgains1));
+            if (outchannels == 8) {
+                vst1q_f32(stream+4, vmlaq_f32(vld1q_f32(stream+4), vsamp, vgains2));
+            } else if (outchannels == 7) {
+                vst1_f32(stream+4, vmla_f32(vld1_f32(stream+4), vget_low_f32(vsamp), vget_low_f32(vgains2)));
+                stream[6] += samp * panning[6];
             }
-            for (k = 0; k < stepSize; k++) state->outfifo[k] = state->outputaccum[k];
-
-            /* shift accumulator */
-            SDL_memmove(state->outputaccum, state->outputaccum+stepSize, pitch_framesize*sizeof(float));
-
-            /* move input FIFO */
-            for (k = 0; k < inFifoLatency; k++) state->infifo[k] = state->infifo[k+stepSize];
         }
     }
 }
 
-static void mix_buffer(ALsource *src, const ALbuffer *buffer, const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes)
+static void mix_float32_c1_surround_neon(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int outchannels)
 {
-    if ((src->pitch != 1.0f) && (src->pitchstate != NULL)) {
-        float *pitched = (float *) alloca(mixframes * buffer->channels * sizeof (float));
-        pitch_shift(src, buffer, mixframes * buffer->channels, data, pitched);
-        data = pitched;
+    /* each layout gets its own copy of the loop, with outchannels as a constant. */
+    switch (outchannels) {
+        case 4: mix_float32_c1_surround_neon_layout(panning, data, stream, mixframes, 4); break;
+        case 6: mix_float32_c1_surround_neon_layout(panning, data, stream, mixframes, 6); break;
+        case 7: mix_float32_c1_surround_neon_layout(panning, data, stream, mixframes, 7); break;
+        case 8: mix_float32_c1_surround_neon_layout(panning, data, stream, mixframes, 8); break;
+        default: mix_float32_c1_surround_scalar(panning, data, stream, mixframes, outchannels); break;
     }
+}
 
-    const ALfloat left = panning[0];
-    const ALfloat right = panning[1];
-    FIXME("currently expects output to be stereo");
-    if ((left != 0.0f) || (right != 0.0f)) {  /* don't bother mixing in silence. */
-        if (buffer->channels == 1) {
-            #ifdef __SSE__
-            if (has_sse) { mix_float32_c1_sse(panning, data, stream, mixframes); } else
-            #elif defined(__ARM_NEON__)
-            if (has_neon) { mix_float32_c1_neon(panning, data, stream, mixframes); } else
-            #endif
-            {
-            #if NEED_SCALAR_FALLBACK
-            mix_float32_c1_scalar(panning, data, stream, mixframes);
-            #else
-            SDL_assert(!"uhoh, we didn't compile in enough mixers!");
-            #endif
-            }
-        } else {
-            SDL_assert(buffer->channels == 2);
-            #ifdef __SSE__
-            if (has_sse) { mix_float32_c2_sse(panning, data, stream, mixframes); } else
-            #elif defined(__ARM_NEON__)
-            if (has_neon) { mix_float32_c2_neon(panning, data, stream, mixframes); } else
-            #endif
-            {
-            #if NEED_SCALAR_FALLBACK
-            mix_float32_c2_scalar(panning, data, stream, mixframes);
-            #else
-            SDL_assert(!"uhoh, we didn't compile in enough mixers!");
-            #endif
+static void mix_float32_c2_surround_neon(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int outchannels)
+{
+    const float32x2_t vleftright = vld1_f32(panning);
+    ALsizei i;
+
+    for (i = 0; i < mixframes; i++, data += 2, stream += outchannels) {
+        vst1_f32(stream, vmla_f32(vld1_f32(stream), vld1_f32(data), vleftright));
+    }
+}
+#endif
+
+/* Multichannel buffers (AL_EXT_MCFORMATS) mix through a matrix instead:
+   (matrix) has a row of OPENAL_MAX_OUTPUT_CHANNELS gains for each buffer
+   channel, so downmixing (or upmixing) to the device's layout happens in the
+   same pass as the mix. Every output sample adds the buffer channels in
+   order, so the SIMD versions get the same answer as this one. */
+static void mix_float32_matrix_scalar(const ALfloat * restrict matrix, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int channels, const int outchannels)
+{
+    ALsizei i;
+    int j, k;
+
+    for (i = 0; i < mixframes; i++, data += channels, stream += outchannels) {
+        for (j = 0; j < channels; j++) {
+            const float samp = data[j];
+            const ALfloat *gains = matrix + (j * OPENAL_MAX_OUTPUT_CHANNELS);
+            for (k = 0; k < outchannels; k++) {
+                stream[k] += samp * gains[k];
             }
         }
     }
 }
 
-static ALboolean mix_source_buffer(ALCcontext *ctx, ALsource *src, BufferQueueItem *queue, float **stream, int *len)
+#ifdef __SSE__
+SDL_FORCE_INLINE void mix_float32_matrix_sse_layout(const ALfloat * restrict matrix, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int channels, const int outchannels)
 {
-    const ALbuffer *buffer = queue ? queue->buffer : NULL;
-    ALboolean processed = AL_TRUE;
+    const __m128 vzero = _mm_setzero_ps();
+    ALsizei i;
+    int j;
+
+    for (i = 0; i < mixframes; i++, data += channels, stream += outchannels) {
+        __m128 vout1 = (outchannels == 2) ? _mm_loadl_pi(vzero, (const __m64 *) stream) : _mm_loadu_ps(stream);
+        __m128 vout2 = vzero;
+        if (outchannels == 8) {
+            vout2 = _mm_loadu_ps(stream+4);
+        } else if (outchannels == 7) {
+            vout2 = _mm_movelh_ps(_mm_loadl_pi(vzero, (const __m64 *) (stream+4)), _mm_load_ss(stream+6));
+        } else if (outchannels == 6) {
+            vout2 = _mm_loadl_pi(vzero, (const __m64 *) (stream+4));
+        }
 
-    /* you can legally queue or set a NULL buffer. */
-    if (buffer && buffer->data && (buffer->len > 0)) {
-        const float *data = buffer->data + (src->offset / sizeof (float));
-        const int bufferframesize = (int) (buffer->channels * sizeof (float));
-        const int deviceframesize = ctx->device->framesize;
-        const int framesneeded = *len / deviceframesize;
-
-        SDL_assert(src->offset < buffer->len);
-
-        if (src->stream) {  /* resampling? */
-            int mixframes, mixlen, remainingmixframes;
-            while ( (((mixlen = SDL_AudioStreamAvailable(src->stream)) / bufferframesize) < framesneeded) && (src->offset < buffer->len) ) {
-                const int bytesleft = (buffer->len - src->offset);
-                /* workaround in case remains are less than bufferframesize */
-                const int framesput = (bytesleft + (bufferframesize - 1)) / bufferframesize;
-                const int bytesput = SDL_min(SDL_min(framesput, 1024) * bufferframesize, bytesleft);
-                FIXME("dynamically adjust frames here?");  /* we hardcode 1024 samples when opening the audio device, too. */
-                SDL_AudioStreamPut(src->stream, data, bytesput);
-                src->offset += bytesput;
-                /* workaround in case remains are not evenly divided by sizeof (float) */
-                data += (bytesput + (sizeof (float) - 1)) / sizeof (float);
+        for (j = 0; j < channels; j++) {
+            const __m128 vsamp = _mm_set1_ps(data[j]);
+            const ALfloat *gains = matrix + (j * OPENAL_MAX_OUTPUT_CHANNELS);
+            vout1 = _mm_add_ps(vout1, _mm_mul_ps(vsamp, _mm_loadu_ps(gains)));
+            if (outchannels > 4) {
+                vout2 = _mm_add_ps(vout2, _mm_mul_ps(vsamp, _mm_loadu_ps(gains + 4)));
             }
+        }
 
-            mixframes = SDL_min(mixlen / bufferframesize, framesneeded);
-            remainingmixframes = mixframes;
-            while (remainingmixframes > 0) {
-                float mixbuf[256];
-                const int mixbuflen = sizeof (mixbuf);
-                const int mixbufframes = mixbuflen / bufferframesize;
-                const int getframes = SDL_min(remainingmixframes, mixbufframes);
-                SDL_AudioStreamGet(src->stream, mixbuf, getframes * bufferframesize);
-                mix_buffer(src, buffer, src->panning, mixbuf, *stream, getframes);
-                *len -= getframes * deviceframesize;
-                *stream += getframes * ctx->device->channels;
-                remainingmixframes -= getframes;
-            }
+        if (outchannels == 2) {
+            _mm_storel_pi((__m64 *) stream, vout1);
         } else {
-            const int framesavail = (buffer->len - src->offset) / bufferframesize;
-            const int mixframes = SDL_min(framesneeded, framesavail);
-            mix_buffer(src, buffer, src->panning, data, *stream, mixframes);
-            src->offset += mixframes * bufferframesize;
-            *len -= mixframes * deviceframesize;
-            *stream += mixframes * ctx->device->channels;
+            _mm_storeu_ps(stream, vout1);
         }
 
-        SDL_assert(src->offset <= buffer->len);
-
-        processed = src->offset >= buffer->len;
-        if (processed) {
-            FIXME("does the offset have to represent the whole queue or just the current buffer?");
-            src->offset = 0;
+        if (outchannels == 8) {
+            _mm_storeu_ps(stream+4, vout2);
+        } else if (outchannels == 7) {
+            _mm_storel_pi((__m64 *) (stream+4), vout2);
+            _mm_store_ss(stream+6, _mm_movehl_ps(vout2, vout2));
+        } else if (outchannels == 6) {
+            _mm_storel_pi((__m64 *) (stream+4), vout2);
         }
     }
-
-    return processed;
 }
 
-static ALCboolean mix_source_buffer_queue(ALCcontext *ctx, ALsource *src, BufferQueueItem *queue, float *stream, int len)
+static void mix_float32_matrix_sse(const ALfloat * restrict matrix, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int channels, const int outchannels)
 {
-    ALCboolean keep = ALC_TRUE;
-
-    while ((len > 0) && (mix_source_buffer(ctx, src, queue, &stream, &len))) {
-        /* Finished this buffer! */
-        BufferQueueItem *item = queue;
-        BufferQueueItem *next = queue ? (BufferQueueItem*)queue->next : NULL;
-        void *ptr;
+    /* each layout gets its own copy of the loop, with outchannels as a constant. */
+    switch (outchannels) {
+        case 2: mix_float32_matrix_sse_layout(matrix, data, stream, mixframes, channels, 2); break;
+        case 4: mix_float32_matrix_sse_layout(matrix, data, stream, mixframes, channels, 4); break;
+        case 6: mix_float32_matrix_sse_layout(matrix, data, stream, mixframes, channels, 6); break;
+        case 7: mix_float32_matrix_sse_layout(matrix, data, stream, mixframes, channels, 7); break;
+        case 8: mix_float32_matrix_sse_layout(matrix, data, stream, mixframes, channels, 8); break;
+        default: mix_float32_matrix_scalar(matrix, data, stream, mixframes, channels, outchannels); break;
+    }
+}
+#endif
 
-        if (queue) {
-            queue->next = NULL;
-            queue = next;
+#ifdef __ARM_NEON__
+SDL_FORCE_INLINE void mix_float32_matrix_neon_layout(const ALfloat * restrict matrix, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int channels, const int outchannels)
+{
+    const float32x2_t vzero = vdup_n_f32(0.0f);
+    ALsizei i;
+    int j;
+
+    for (i = 0; i < mixframes; i++, data += channels, stream += outchannels) {
+        float32x4_t vout1 = (outchannels == 2) ? vcombine_f32(vld1_f32(stream), vzero) : vld1q_f32(stream);
+        float32x4_t vout2 = vcombine_f32(vzero, vzero);
+        if (outchannels == 8) {
+            vout2 = vld1q_f32(stream+4);
+        } else if (outchannels == 7) {
+            vout2 = vcombine_f32(vld1_f32(stream+4), vset_lane_f32(stream[6], vzero, 0));
+        } else if (outchannels == 6) {
+            vout2 = vcombine_f32(vld1_f32(stream+4), vzero);
         }
 
-        SDL_assert((src->type == AL_STATIC) || (src->type == AL_STREAMING));
-        if (src->type == AL_STREAMING) {  /* mark buffer processed. */
-            SDL_assert(item == src->buffer_queue.head);
-            FIXME("bubble out all these NULL checks");  /* these are only here because we check for looping/stopping in this loop, but we really shouldn't enter this loop at all if queue==NULL. */
-            if (item != NULL) {
-                src->buffer_queue.head = next;
-                if (!next) {
-                    src->buffer_queue.tail = NULL;
-                }
-                SDL_AtomicAdd(&src->buffer_queue.num_items, -1);
-
-                /* Move it to the processed queue for alSourceUnqueueBuffers() to pick up. */
-                do {
-                    ptr = SDL_AtomicGetPtr(&src->buffer_queue_processed.just_queued);
-                    SDL_AtomicSetPtr(&item->next, ptr);
-                } while (!SDL_AtomicCASPtr(&src->buffer_queue_processed.just_queued, ptr, item));
-
-                SDL_AtomicAdd(&src->buffer_queue_processed.num_items, 1);
+        for (j = 0; j < channels; j++) {
+            const float32x4_t vsamp = vdupq_n_f32(data[j]);
+            const ALfloat *gains = matrix + (j * OPENAL_MAX_OUTPUT_CHANNELS);
+            vout1 = vmlaq_f32(vout1, vsamp, vld1q_f32(gains));
+            if (outchannels > 4) {
+                vout2 = vmlaq_f32(vout2, vsamp, vld1q_f32(gains + 4));
             }
         }
 
-        if (queue == NULL) {  /* nothing else to play? */
-            if (src->looping) {
-                FIXME("looping is supposed to move to AL_INITIAL then immediately to AL_PLAYING, but I'm not sure what side effect this is meant to trigger");
-                if (src->type == AL_STREAMING) {
-                    FIXME("what does looping do with the AL_STREAMING state?");
-                }
-            } else {
-                SDL_AtomicSet(&src->state, AL_STOPPED);
-                keep = ALC_FALSE;
-            }
-            break;  /* nothing else to mix here, so stop. */
+        if (outchannels == 2) {
+            vst1_f32(stream, vget_low_f32(vout1));
+        } else {
+            vst1q_f32(stream, vout1);
         }
-    }
 
-    return keep;
+        if (outchannels == 8) {
+            vst1q_f32(stream+4, vout2);
+        } else if (outchannels == 7) {
+            vst1_f32(stream+4, vget_low_f32(vout2));
+            stream[6] = vgetq_lane_f32(vout2, 2);
+        } else if (outchannels == 6) {
+            vst1_f32(stream+4, vget_low_f32(vout2));
+        }
+    }
 }
 
-/* All the 3D math here is way overcommented because I HAVE NO IDEA WHAT I'M
-   DOING and had to research the hell out of what are probably pretty simple
-   concepts. Pay attention in math class, kids. */
-
-/* The scalar versions have explanitory comments and links. The SIMD versions don't. */
-
-/* calculates cross product. https://en.wikipedia.org/wiki/Cross_product
-    Basically takes two vectors and gives you a vector that's perpendicular
-    to both.
-*/
-#if NEED_SCALAR_FALLBACK
-static void xyzzy(ALfloat *v, const ALfloat *a, const ALfloat *b)
+static void mix_float32_matrix_neon(const ALfloat * restrict matrix, const float * restrict data, float * restrict stream, const ALsizei mixframes, const int channels, const int outchannels)
 {
-    v[0] = (a[1] * b[2]) - (a[2] * b[1]);
-    v[1] = (a[2] * b[0]) - (a[0] * b[2]);
-    v[2] = (a[0] * b[1]) - (a[1] * b[0]);
+    /* each layout gets its own copy of the loop, with outchannels as a constant. */
+    switch (outchannels) {
+        case 2: mix_float32_matrix_neon_layout(matrix, data, stream, mixframes, channels, 2); break;
+        case 4: mix_float32_matrix_neon_layout(matrix, data, stream, mixframes, channels, 4); break;
+        case 6: mix_float32_matrix_neon_layout(matrix, data, stream, mixframes, channels, 6); break;
+        case 7: mix_float32_matrix_neon_layout(matrix, data, stream, mixframes, channels, 7); break;
+        case 8: mix_float32_matrix_neon_layout(matrix, data, stream, mixframes, channels, 8); break;
+        default: mix_float32_matrix_scalar(matrix, data, stream, mixframes, channels, outchannels); break;
+    }
 }
+#endif
 
-/* calculate dot product (multiply each element of two vectors, sum them) */
-static ALfloat dotproduct(const ALfloat *a, const ALfloat *b)
+/* The resampling mixers linearly interpolate between sample frames while
+   they mix, moving (step) frames through (data) for each output frame, with
+   both (step) and (*frac) in RESAMPLE_FRAC_BITS fixed point. (*frac) is how
+   far past the first frame of (data) we start. The caller guarantees there
+   is always a frame after the one we're interpolating from, so these never
+   check for the end of the buffer. They return how many whole frames they
+   moved past, and leave the remaining fraction in (*frac). */
+static ALsizei resample_float32_c1_scalar(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
 {
-    return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
-}
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    const float *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
 
-/* calculate distance ("magnitude") in 3D space:
-    https://math.stackexchange.com/questions/42640/calculate-distance-in-3d-space
-    assumes vector starts at (0,0,0). */
-static ALfloat magnitude(const ALfloat *v)
-{
-    /* technically, the inital part on this is just a dot product of itself. */
-    return SDL_sqrtf((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]));
+    for (i = 0; i < mixframes; i++, stream += 2) {
+        const float samp = data[0] + ((data[1] - data[0]) * (((float) frac) * RESAMPLE_FRAC_SCALE));
+        stream[0] += samp * left;
+        stream[1] += samp * right;
+        frac += step;
+        data += frac >> RESAMPLE_FRAC_BITS;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
+
+    *_frac = frac;
+    return (ALsizei) (data - start);
 }
 
-/* https://www.khanacademy.org/computing/computer-programming/programming-natural-simulations/programming-vectors/a/vector-magnitude-normalization */
-static void normalize(ALfloat *v)
+static ALsizei resample_float32_c2_scalar(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
 {
-    const ALfloat mag = magnitude(v);
-    if (mag == 0.0f) {
-        SDL_memset(v, '\0', sizeof (*v) * 3);
-    } else {
-        v[0] /= mag;
-        v[1] /= mag;
-        v[2] /= mag;
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    const float *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
+
+    for (i = 0; i < mixframes; i++, stream += 2) {
+        const float f = ((float) frac) * RESAMPLE_FRAC_SCALE;
+        stream[0] += (data[0] + ((data[2] - data[0]) * f)) * left;
+        stream[1] += (data[1] + ((data[3] - data[1]) * f)) * right;
+        frac += step;
+        data += (frac >> RESAMPLE_FRAC_BITS) * 2;
+        frac &= RESAMPLE_FRAC_MASK;
     }
+
+    *_frac = frac;
+    return (ALsizei) ((data - start) / 2);
 }
-#endif
 
 #ifdef __SSE__
-static __m128 xyzzy_sse(const __m128 a, const __m128 b)
+/* SSE1 doesn't have integer vectors, so the positions are still worked out one at a time here, but the interpolation and mixing aren't. */
+static ALsizei resample_float32_c1_sse(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
 {
-    /* http://fastcpp.blogspot.com/2011/04/vector-cross-product-using-sse-code.html
-        this is the "three shuffle" version in the comments, plus the variables swapped around for handedness in the later comment. */
-    const __m128 v = _mm_sub_ps(
-        _mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1))),
-        _mm_mul_ps(b, _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)))
-    );
-    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1));
-}
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    const int unrolled = mixframes / 4;
+    const int leftover = mixframes % 4;
+    const __m128 vleftright = { left, right, left, right };
+    const __m128 vscale = _mm_set1_ps(RESAMPLE_FRAC_SCALE);
+    const float *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
 
-static ALfloat dotproduct_sse(const __m128 a, const __m128 b)
-{
-    const __m128 prod = _mm_mul_ps(a, b);
-    const __m128 sum1 = _mm_add_ps(prod, _mm_shuffle_ps(prod, prod, _MM_SHUFFLE(1, 0, 3, 2)));
-    const __m128 sum2 = _mm_add_ps(sum1, _mm_shuffle_ps(sum1, sum1, _MM_SHUFFLE(2, 2, 0, 0)));
-    FIXME("this can use _mm_hadd_ps in SSE3, or _mm_dp_ps in SSE4.1");
-    return _mm_cvtss_f32(_mm_shuffle_ps(sum2, sum2, _MM_SHUFFLE(3, 3, 3, 3)));
-}
+    for (i = 0; i < unrolled; i++, stream += 8) {
+        const Uint32 pos0 = frac;
+        const Uint32 pos1 = pos0 + step;
+        const Uint32 pos2 = pos1 + step;
+        const Uint32 pos3 = pos2 + step;
+        const float *data0 = data + (pos0 >> RESAMPLE_FRAC_BITS);
+        const float *data1 = data + (pos1 >> RESAMPLE_FRAC_BITS);
+        const float *data2 = data + (pos2 >> RESAMPLE_FRAC_BITS);
+        const float *data3 = data + (pos3 >> RESAMPLE_FRAC_BITS);
+        const __m128 vsamp1 = _mm_setr_ps(data0[0], data1[0], data2[0], data3[0]);
+        const __m128 vsamp2 = _mm_setr_ps(data0[1], data1[1], data2[1], data3[1]);
+        const __m128 vfrac = _mm_mul_ps(_mm_setr_ps((float) (pos0 & RESAMPLE_FRAC_MASK), (float) (pos1 & RESAMPLE_FRAC_MASK), (float) (pos2 & RESAMPLE_FRAC_MASK), (float) (pos3 & RESAMPLE_FRAC_MASK)), vscale);
+        const __m128 vsamp = _mm_add_ps(vsamp1, _mm_mul_ps(_mm_sub_ps(vsamp2, vsamp1), vfrac));
+        _mm_storeu_ps(stream, _mm_add_ps(_mm_loadu_ps(stream), _mm_mul_ps(_mm_unpacklo_ps(vsamp, vsamp), vleftright)));
+        _mm_storeu_ps(stream+4, _mm_add_ps(_mm_loadu_ps(stream+4), _mm_mul_ps(_mm_unpackhi_ps(vsamp, vsamp), vleftright)));
+        frac = pos3 + step;
+        data += frac >> RESAMPLE_FRAC_BITS;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
 
-static ALfloat magnitude_sse(const __m128 v)
-{
-    return SDL_sqrtf(dotproduct_sse(v, v));
+    *_frac = frac;
+    return ((ALsizei) (data - start)) + resample_float32_c1_scalar(panning, data, stream, leftover, _frac, step);
 }
 
-static __m128 normalize_sse(const __m128 v)
+static ALsizei resample_float32_c2_sse(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
 {
-    const ALfloat mag = magnitude_sse(v);
-    if (mag == 0.0f) {
-        return _mm_setzero_ps();
-    }
-    return _mm_div_ps(v, _mm_set_ps1(mag));
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    const int unrolled = mixframes / 4;
+    const int leftover = mixframes % 4;
+    const __m128 vleftright = { left, right, left, right };
+    const __m128 vscale = _mm_set1_ps(RESAMPLE_FRAC_SCALE);
+    const __m128 vzero = _mm_setzero_ps();
+    const float *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
+
+    for (i = 0; i < unrolled; i++, stream += 8) {
+        const Uint32 pos0 = frac;
+        const Uint32 pos1 = pos0 + step;
+        const Uint32 pos2 = pos1 + step;
+        const Uint32 pos3 = pos2 + step;
+        const float *data0 = data + ((pos0 >> RESAMPLE_FRAC_BITS) * 2);
+        const float *data1 = data + ((pos1 >> RESAMPLE_FRAC_BITS) * 2);
+        const float *data2 = data + ((pos2 >> RESAMPLE_FRAC_BITS) * 2);
+        const float *data3 = data + ((pos3 >> RESAMPLE_FRAC_BITS) * 2);
+        const float frac0 = (float) (pos0 & RESAMPLE_FRAC_MASK);
+        const float frac1 = (float) (pos1 & RESAMPLE_FRAC_MASK);
+        const float frac2 = (float) (pos2 & RESAMPLE_FRAC_MASK);
+        const float frac3 = (float) (pos3 & RESAMPLE_FRAC_MASK);
+        const __m128 vsamp1a = _mm_loadh_pi(_mm_loadl_pi(vzero, (const __m64 *) data0), (const __m64 *) data1);
+        const __m128 vsamp2a = _mm_loadh_pi(_mm_loadl_pi(vzero, (const __m64 *) (data0 + 2)), (const __m64 *) (data1 + 2));
+        const __m128 vsamp1b = _mm_loadh_pi(_mm_loadl_pi(vzero, (const __m64 *) data2), (const __m64 *) data3);
+        const __m128 vsamp2b = _mm_loadh_pi(_mm_loadl_pi(vzero, (const __m64 *) (data2 + 2)), (const __m64 *) (data3 + 2));
+        const __m128 vfraca = _mm_mul_ps(_mm_setr_ps(frac0, frac0, frac1, frac1), vscale);
+        const __m128 vfracb = _mm_mul_ps(_mm_setr_ps(frac2, frac2, frac3, frac3), vscale);
+        const __m128 vsampa = _mm_add_ps(vsamp1a, _mm_mul_ps(_mm_sub_ps(vsamp2a, vsamp1a), vfraca));
+        const __m128 vsampb = _mm_add_ps(vsamp1b, _mm_mul_ps(_mm_sub_ps(vsamp2b, vsamp1b), vfracb));
+        _mm_storeu_ps(stream, _mm_add_ps(_mm_loadu_ps(stream), _mm_mul_ps(vsampa, vleftright)));
+        _mm_storeu_ps(stream+4, _mm_add_ps(_mm_loadu_ps(stream+4), _mm_mul_ps(vsampb, vleftright)));
+        frac = pos3 + step;
+        data += (frac >> RESAMPLE_FRAC_BITS) * 2;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
+
+    *_frac = frac;
+    return ((ALsizei) ((data - start) / 2)) + resample_float32_c2_scalar(panning, data, stream, leftover, _frac, step);
 }
 #endif
 
 #ifdef __ARM_NEON__
-static float32x4_t xyzzy_neon(const float32x4_t a, const float32x4_t b)
+static ALsizei resample_float32_c1_neon(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
 {
-    const float32x4_t shuf_a = { a[1], a[2], a[0], a[3] };
-    const float32x4_t shuf_b = { b[1], b[2], b[0], b[3] };
-    const float32x4_t v = vsubq_f32(vmulq_f32(a, shuf_b), vmulq_f32(b, shuf_a));
-    const float32x4_t retval = { v[1], v[2], v[0], v[3] };
-    FIXME("need a better permute");
-    return retval;
-}
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    const int unrolled = mixframes / 4;
+    const int leftover = mixframes % 4;
+    const float32x4_t vleftright = { left, right, left, right };
+    const float *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
 
-static ALfloat dotproduct_neon(const float32x4_t a, const float32x4_t b)
+    for (i = 0; i < unrolled; i++, stream += 8) {
+        const Uint32 pos0 = frac;
+        const Uint32 pos1 = pos0 + step;
+        const Uint32 pos2 = pos1 + step;
+        const Uint32 pos3 = pos2 + step;
+        const float *data0 = data + (pos0 >> RESAMPLE_FRAC_BITS);
+        const float *data1 = data + (pos1 >> RESAMPLE_FRAC_BITS);
+        const float *data2 = data + (pos2 >> RESAMPLE_FRAC_BITS);
+        const float *data3 = data + (pos3 >> RESAMPLE_FRAC_BITS);
+        const float32x4_t vsamp1 = { data0[0], data1[0], data2[0], data3[0] };
+        const float32x4_t vsamp2 = { data0[1], data1[1], data2[1], data3[1] };
+        const uint32x4_t vpos = { pos0, pos1, pos2, pos3 };
+        const float32x4_t vfrac = vmulq_n_f32(vcvtq_f32_u32(vandq_u32(vpos, vdupq_n_u32(RESAMPLE_FRAC_MASK))), RESAMPLE_FRAC_SCALE);
+        const float32x4_t vsamp = vmlaq_f32(vsamp1, vsubq_f32(vsamp2, vsamp1), vfrac);
+        const float32x4x2_t vzipped = vzipq_f32(vsamp, vsamp);
+        vst1q_f32(stream, vmlaq_f32(vld1q_f32(stream), vzipped.val[0], vleftright));
+        vst1q_f32(stream+4, vmlaq_f32(vld1q_f32(stream+4), vzipped.val[1], vleftright));
+        frac = pos3 + step;
+        data += frac >> RESAMPLE_FRAC_BITS;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
+
+    *_frac = frac;
+    return ((ALsizei) (data - start)) + resample_float32_c1_scalar(panning, data, stream, leftover, _frac, step);
+}
+
+static ALsizei resample_float32_c2_neon(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
 {
-    const float32x4_t prod = vmulq_f32(a, b);
-    const float32x4_t sum1 = vaddq_f32(prod, vrev64q_f32(prod));
-    const float32x4_t sum2 = vaddq_f32(sum1, vcombine_f32(vget_high_f32(sum1), vget_low_f32(sum1)));
-    return sum2[3];
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    const int unrolled = mixframes / 2;
+    const int leftover = mixframes % 2;
+    const float32x4_t vleftright = { left, right, left, right };
+    const float *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
+
+    for (i = 0; i < unrolled; i++, stream += 4) {
+        const Uint32 pos0 = frac;
+        const Uint32 pos1 = pos0 + step;
+        const float *data0 = data + ((pos0 >> RESAMPLE_FRAC_BITS) * 2);
+        const float *data1 = data + ((pos1 >> RESAMPLE_FRAC_BITS) * 2);
+        const float frac0 = ((float) (pos0 & RESAMPLE_FRAC_MASK)) * RESAMPLE_FRAC_SCALE;
+        const float frac1 = ((float) (pos1 & RESAMPLE_FRAC_MASK)) * RESAMPLE_FRAC_SCALE;
+        const float32x4_t vsamp1 = vcombine_f32(vld1_f32(data0), vld1_f32(data1));
+        const float32x4_t vsamp2 = vcombine_f32(vld1_f32(data0 + 2), vld1_f32(data1 + 2));
+        const float32x4_t vfrac = { frac0, frac0, frac1, frac1 };
+        const float32x4_t vsamp = vmlaq_f32(vsamp1, vsubq_f32(vsamp2, vsamp1), vfrac);
+        vst1q_f32(stream, vmlaq_f32(vld1q_f32(stream), vsamp, vleftright));
+        frac = pos1 + step;
+        data += (frac >> RESAMPLE_FRAC_BITS) * 2;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
+
+    *_frac = frac;
+    return ((ALsizei) ((data - start) / 2)) + resample_float32_c2_scalar(panning, data, stream, leftover, _frac, step);
 }
+#endif
 
-static ALfloat magnitude_neon(const float32x4_t v)
-{
-    return SDL_sqrtf(dotproduct_neon(v, v));
+/* ALC_NATIVE_BUFFER_FORMAT_MOJOAL keeps 16-bit buffers as Sint16 instead of
+   converting them to float up front, so these mix them directly, converting
+   to float in-register as they go. SDL converts Sint16 to float by scaling
+   by 1/32768, and since that's a power of two, scaling the panning by it
+   once instead of every sample gets exactly the same answer as mixing the
+   converted buffer would. The interpolation in the resamplers works out the
+   same way, so these match the float32 mixers bit for bit (except the AVX2
+   ones, whose fused multiply-adds round differently in the last bit). */
+#define SINT16_TO_FLOAT32 (1.0f / 32768.0f)
+#define UINT8_TO_FLOAT32 (1.0f / 128.0f)
+
+static void mix_sint16_c1_scalar(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes)
+{
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    ALsizei i;
+
+    for (i = 0; i < mixframes; i++, stream += 2) {
+        const float samp = (float) *(data++);
+        stream[0] += samp * left;
+        stream[1] += samp * right;
+    }
 }
 
-static float32x4_t normalize_neon(const float32x4_t v)
+static void mix_sint16_c2_scalar(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes)
 {
-    const ALfloat mag = magnitude_neon(v);
-    if (mag == 0.0f) {
-        return vdupq_n_f32(0.0f);
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    ALsizei i;
+
+    for (i = 0; i < mixframes; i++, stream += 2, data += 2) {
+        stream[0] += ((float) data[0]) * left;
+        stream[1] += ((float) data[1]) * right;
     }
-    return vmulq_f32(v, vdupq_n_f32(1.0f / mag));
 }
-#endif
 
+static ALsizei resample_sint16_c1_scalar(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
+{
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    const Sint16 *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
 
+    for (i = 0; i < mixframes; i++, stream += 2) {
+        const float samp1 = (float) data[0];
+        const float samp2 = (float) data[1];
+        const float samp = samp1 + ((samp2 - samp1) * (((float) frac) * RESAMPLE_FRAC_SCALE));
+        stream[0] += samp * left;
+        stream[1] += samp * right;
+        frac += step;
+        data += frac >> RESAMPLE_FRAC_BITS;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
 
-/* Get the sin(angle) and cos(angle) at the same time. Ideally, with one
-   instruction, like what is offered on the x86.
-   angle is in radians, not degrees. */
-static void calculate_sincos(const ALfloat angle, ALfloat *_sin, ALfloat *_cos)
-{
-    *_sin = SDL_sinf(angle);
-    *_cos = SDL_cosf(angle);
+    *_frac = frac;
+    return (ALsizei) (data - start);
 }
 
-static ALfloat calculate_distance_attenuation(const ALCcontext *ctx, const ALsource *src, ALfloat distance)
+static ALsizei resample_sint16_c2_scalar(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
 {
-    /* AL SPEC: "With all the distance models, if the formula can not be
-       evaluated then the source will not be attenuated. For example, if a
-       linear model is being used with AL_REFERENCE_DISTANCE equal to
-       AL_MAX_DISTANCE, then the gain equation will have a divide-by-zero
-       error in it. In this case, there is no attenuation for that source." */
-    FIXME("check divisions by zero");
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    const Sint16 *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
 
-    switch (ctx->distance_model) {
-        case AL_INVERSE_DISTANCE_CLAMPED:
-            distance = SDL_min(SDL_max(distance, src->reference_distance), src->max_distance);
-            /* fallthrough */
-        case AL_INVERSE_DISTANCE:
-            /* AL SPEC: "gain = AL_REFERENCE_DISTANCE / (AL_REFERENCE_DISTANCE + AL_ROLLOFF_FACTOR * (distance - AL_REFERENCE_DISTANCE))" */
-            return src->reference_distance / (src->reference_distance + src->rolloff_factor * (distance - src->reference_distance));
+    for (i = 0; i < mixframes; i++, stream += 2) {
+        const float f = ((float) frac) * RESAMPLE_FRAC_SCALE;
+        const float l1 = (float) data[0];
+        const float r1 = (float) data[1];
+        const float l2 = (float) data[2];
+        const float r2 = (float) data[3];
+        stream[0] += (l1 + ((l2 - l1) * f)) * left;
+        stream[1] += (r1 + ((r2 - r1) * f)) * right;
+        frac += step;
+        data += (frac >> RESAMPLE_FRAC_BITS) * 2;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
 
-        case AL_LINEAR_DISTANCE_CLAMPED:
-            distance = SDL_max(distance, src->reference_distance);
-            /* fallthrough */
-        case AL_LINEAR_DISTANCE:
-            /* AL SPEC: "distance = min(distance, AL_MAX_DISTANCE) // avoid negative gain
-                         gain = (1 - AL_ROLLOFF_FACTOR * (distance - AL_REFERENCE_DISTANCE) / (AL_MAX_DISTANCE - AL_REFERENCE_DISTANCE))" */
-            return 1.0f - src->rolloff_factor * (SDL_min(distance, src->max_distance) - src->reference_distance) / (src->max_distance - src->reference_distance);
+    *_frac = frac;
+    return (ALsizei) ((data - start) / 2);
+}
 
-        case AL_EXPONENT_DISTANCE_CLAMPED:
-            distance = SDL_min(SDL_max(distance, src->reference_distance), src->max_distance);
-            /* fallthrough */
-        case AL_EXPONENT_DISTANCE:
-            /* AL SPEC: "gain = (distance / AL_REFERENCE_DISTANCE) ^ (- AL_ROLLOFF_FACTOR)" */
-            return SDL_powf(distance / src->reference_distance, -src->rolloff_factor);
+/* SSE1 can't convert integer vectors, so these need SSE2. x86 builds without it just use the scalar versions. */
+#if defined(__SSE__) && defined(__SSE2__)
+static void mix_sint16_c1_sse2(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes)
+{
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    const int unrolled = mixframes / 8;
+    const int leftover = mixframes % 8;
+    const __m128 vleftright = { left, right, left, right };
+    ALsizei i;
 
-        default: break;
+    for (i = 0; i < unrolled; i++, data += 8, stream += 16) {
+        const __m128i vdata = _mm_loadu_si128((const __m128i *) data);
+        const __m128 vsamp1 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(vdata, vdata), 16));  /* 0 1 2 3 */
+        const __m128 vsamp2 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(vdata, vdata), 16));  /* 4 5 6 7 */
+        _mm_storeu_ps(stream, _mm_add_ps(_mm_loadu_ps(stream), _mm_mul_ps(_mm_unpacklo_ps(vsamp1, vsamp1), vleftright)));
+        _mm_storeu_ps(stream+4, _mm_add_ps(_mm_loadu_ps(stream+4), _mm_mul_ps(_mm_unpackhi_ps(vsamp1, vsamp1), vleftright)));
+        _mm_storeu_ps(stream+8, _mm_add_ps(_mm_loadu_ps(stream+8), _mm_mul_ps(_mm_unpacklo_ps(vsamp2, vsamp2), vleftright)));
+        _mm_storeu_ps(stream+12, _mm_add_ps(_mm_loadu_ps(stream+12), _mm_mul_ps(_mm_unpackhi_ps(vsamp2, vsamp2), vleftright)));
     }
 
-    SDL_assert(!"Unexpected distance model");
-    return 1.0f;
+    mix_sint16_c1_scalar(panning, data, stream, leftover);
 }
 
-static void calculate_channel_gains(const ALCcontext *ctx, const ALsource *src, float *gains)
+static void mix_sint16_c2_sse2(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes)
 {
-    /* rolloff==0.0f makes all distance models result in 1.0f,
-       and we never spatialize non-mono sources, per the AL spec. */
-    const ALboolean spatialize = (ctx->distance_model != AL_NONE) &&
-                                 (src->queue_channels == 1) &&
-                                 (src->rolloff_factor != 0.0f);
-
-    const ALfloat *at = &ctx->listener.orientation[0];
-    const ALfloat *up = &ctx->listener.orientation[4];
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    const int unrolled = mixframes / 4;
+    const int leftover = mixframes % 4;
+    const __m128 vleftright = { left, right, left, right };
+    ALsizei i;
 
-    ALfloat distance;
-    ALfloat gain;
-    ALfloat radians;
+    for (i = 0; i < unrolled; i++, data += 8, stream += 8) {
+        const __m128i vdata = _mm_loadu_si128((const __m128i *) data);
+        const __m128 vsamp1 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(vdata, vdata), 16));
+        const __m128 vsamp2 = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(vdata, vdata), 16));
+        _mm_storeu_ps(stream, _mm_add_ps(_mm_loadu_ps(stream), _mm_mul_ps(vsamp1, vleftright)));
+        _mm_storeu_ps(stream+4, _mm_add_ps(_mm_loadu_ps(stream+4), _mm_mul_ps(vsamp2, vleftright)));
+    }
 
-    #ifdef __SSE__
-    __m128 position_sse;
-    #elif defined(__ARM_NEON__)
-    float32x4_t position_neon = vdupq_n_f32(0.0f);
-    #endif
+    mix_sint16_c2_scalar(panning, data, stream, leftover);
+}
 
-    #if NEED_SCALAR_FALLBACK
-    ALfloat position[3];
-    #endif
+static ALsizei resample_sint16_c1_sse2(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
+{
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    const int unrolled = mixframes / 4;
+    const int leftover = mixframes % 4;
+    const __m128 vleftright = { left, right, left, right };
+    const __m128 vscale = _mm_set1_ps(RESAMPLE_FRAC_SCALE);
+    const __m128i vmask = _mm_set1_epi32(RESAMPLE_FRAC_MASK);
+    const Sint16 *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
 
-    /* this goes through the steps the AL spec dictates for gain and distance attenuation... */
+    for (i = 0; i < unrolled; i++, stream += 8) {
+        const Uint32 pos0 = frac;
+        const Uint32 pos1 = pos0 + step;
+        const Uint32 pos2 = pos1 + step;
+        const Uint32 pos3 = pos2 + step;
+        const Sint16 *data0 = data + (pos0 >> RESAMPLE_FRAC_BITS);
+        const Sint16 *data1 = data + (pos1 >> RESAMPLE_FRAC_BITS);
+        const Sint16 *data2 = data + (pos2 >> RESAMPLE_FRAC_BITS);
+        const Sint16 *data3 = data + (pos3 >> RESAMPLE_FRAC_BITS);
+        const __m128 vsamp1 = _mm_cvtepi32_ps(_mm_setr_epi32(data0[0], data1[0], data2[0], data3[0]));
+        const __m128 vsamp2 = _mm_cvtepi32_ps(_mm_setr_epi32(data0[1], data1[1], data2[1], data3[1]));
+        const __m128 vfrac = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_setr_epi32((int) pos0, (int) pos1, (int) pos2, (int) pos3), vmask)), vscale);
+        const __m128 vsamp = _mm_add_ps(vsamp1, _mm_mul_ps(_mm_sub_ps(vsamp2, vsamp1), vfrac));
+        _mm_storeu_ps(stream, _mm_add_ps(_mm_loadu_ps(stream), _mm_mul_ps(_mm_unpacklo_ps(vsamp, vsamp), vleftright)));
+        _mm_storeu_ps(stream+4, _mm_add_ps(_mm_loadu_ps(stream+4), _mm_mul_ps(_mm_unpackhi_ps(vsamp, vsamp), vleftright)));
+        frac = pos3 + step;
+        data += frac >> RESAMPLE_FRAC_BITS;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
+
+    *_frac = frac;
+    return ((ALsizei) (data - start)) + resample_sint16_c1_scalar(panning, data, stream, leftover, _frac, step);
+}
+
+static ALsizei resample_sint16_c2_sse2(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
+{
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    const int unrolled = mixframes / 4;
+    const int leftover = mixframes % 4;
+    const __m128 vleftright = { left, right, left, right };
+    const __m128 vscale = _mm_set1_ps(RESAMPLE_FRAC_SCALE);
+    const Sint16 *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
 
-    if (!spatialize) {
-        /* simpler path through the same AL spec details if not spatializing. */
-        gain = SDL_min(SDL_max(src->gain, src->min_gain), src->max_gain) * ctx->listener.gain;
-        gains[0] = gains[1] = gain;  /* no spatialization, but AL_GAIN (etc) is still applied. */
-        return;
-    }
+    for (i = 0; i < unrolled; i++, stream += 8) {
+        const Uint32 pos0 = frac;
+        const Uint32 pos1 = pos0 + step;
+        const Uint32 pos2 = pos1 + step;
+        const Uint32 pos3 = pos2 + step;
+        const Sint16 *data0 = data + ((pos0 >> RESAMPLE_FRAC_BITS) * 2);
+        const Sint16 *data1 = data + ((pos1 >> RESAMPLE_FRAC_BITS) * 2);
+        const Sint16 *data2 = data + ((pos2 >> RESAMPLE_FRAC_BITS) * 2);
+        const Sint16 *data3 = data + ((pos3 >> RESAMPLE_FRAC_BITS) * 2);
+        const float frac0 = (float) (pos0 & RESAMPLE_FRAC_MASK);
+        const float frac1 = (float) (pos1 & RESAMPLE_FRAC_MASK);
+        const float frac2 = (float) (pos2 & RESAMPLE_FRAC_MASK);
+        const float frac3 = (float) (pos3 & RESAMPLE_FRAC_MASK);
+        /* each load gets both frames we interpolate between; shuffle so the first frames are in the low half. */
+        const __m128i vdataa = _mm_shuffle_epi32(_mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *) data0), _mm_loadl_epi64((const __m128i *) data1)), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i vdatab = _mm_shuffle_epi32(_mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *) data2), _mm_loadl_epi64((const __m128i *) data3)), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128 vsamp1a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(vdataa, vdataa), 16));
+        const __m128 vsamp2a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(vdataa, vdataa), 16));
+        const __m128 vsamp1b = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(vdatab, vdatab), 16));
+        const __m128 vsamp2b = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(vdatab, vdatab), 16));
+        const __m128 vfraca = _mm_mul_ps(_mm_setr_ps(frac0, frac0, frac1, frac1), vscale);
+        const __m128 vfracb = _mm_mul_ps(_mm_setr_ps(frac2, frac2, frac3, frac3), vscale);
+        const __m128 vsampa = _mm_add_ps(vsamp1a, _mm_mul_ps(_mm_sub_ps(vsamp2a, vsamp1a), vfraca));
+        const __m128 vsampb = _mm_add_ps(vsamp1b, _mm_mul_ps(_mm_sub_ps(vsamp2b, vsamp1b), vfracb));
+        _mm_storeu_ps(stream, _mm_add_ps(_mm_loadu_ps(stream), _mm_mul_ps(vsampa, vleftright)));
+        _mm_storeu_ps(stream+4, _mm_add_ps(_mm_loadu_ps(stream+4), _mm_mul_ps(vsampb, vleftright)));
+        frac = pos3 + step;
+        data += (frac >> RESAMPLE_FRAC_BITS) * 2;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
+
+    *_frac = frac;
+    return ((ALsizei) ((data - start) / 2)) + resample_sint16_c2_scalar(panning, data, stream, leftover, _frac, step);
+}
+#endif
 
-    #ifdef __SSE__
-    if (has_sse) {
-        position_sse = _mm_load_ps(src->position);
-        if (!src->source_relative) {
-            position_sse = _mm_sub_ps(position_sse, _mm_load_ps(ctx->listener.position));
-        }
-        distance = magnitude_sse(position_sse);
-    } else
-    #elif defined(__ARM_NEON__)
-    if (has_neon) {
-        position_neon = vld1q_f32(src->position);
-        if (!src->source_relative) {
-            position_neon = vsubq_f32(position_neon, vld1q_f32(ctx->listener.position));
-        }
-        distance = magnitude_neon(position_neon);
-    } else
-    #endif
+#ifdef __ARM_NEON__
+static void mix_sint16_c1_neon(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes)
+{
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    const int unrolled = mixframes / 8;
+    const int leftover = mixframes % 8;
+    const float32x4_t vleftright = { left, right, left, right };
+    ALsizei i;
 
-    {
-    #if NEED_SCALAR_FALLBACK
-    /* if values aren't source-relative, then convert it to be so. */
-    if (!src->source_relative) {
-        SDL_memcpy(position, src->position, sizeof (position));
-    } else {
-        position[0] = src->position[0] - ctx->listener.position[0];
-        position[1] = src->position[1] - ctx->listener.position[1];
-        position[2] = src->position[2] - ctx->listener.position[2];
-    }
-    distance = magnitude(position);
-    #endif
+    for (i = 0; i < unrolled; i++, data += 8, stream += 16) {
+        const int16x8_t vdata = vld1q_s16(data);
+        const float32x4_t vsamp1 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(vdata)));
+        const float32x4_t vsamp2 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(vdata)));
+        const float32x4x2_t vzipped1 = vzipq_f32(vsamp1, vsamp1);
+        const float32x4x2_t vzipped2 = vzipq_f32(vsamp2, vsamp2);
+        vst1q_f32(stream, vmlaq_f32(vld1q_f32(stream), vzipped1.val[0], vleftright));
+        vst1q_f32(stream+4, vmlaq_f32(vld1q_f32(stream+4), vzipped1.val[1], vleftright));
+        vst1q_f32(stream+8, vmlaq_f32(vld1q_f32(stream+8), vzipped2.val[0], vleftright));
+        vst1q_f32(stream+12, vmlaq_f32(vld1q_f32(stream+12), vzipped2.val[1], vleftright));
     }
 
-    /* AL SPEC: ""1. Distance attenuation is calculated first, including
-       minimum (AL_REFERENCE_DISTANCE) and maximum (AL_MAX_DISTANCE)
-       thresholds." */
-    gain = calculate_distance_attenuation(ctx, src, distance);
+    mix_sint16_c1_scalar(panning, data, stream, leftover);
+}
 
-    /* AL SPEC: "2. The result is then multiplied by source gain (AL_GAIN)." */
-    gain *= src->gain;
+static void mix_sint16_c2_neon(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes)
+{
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    const int unrolled = mixframes / 4;
+    const int leftover = mixframes % 4;
+    const float32x4_t vleftright = { left, right, left, right };
+    ALsizei i;
 
-    /* AL SPEC: "3. If the source is directional (AL_CONE_INNER_ANGLE less
-       than AL_CONE_OUTER_ANGLE), an angle-dependent attenuation is calculated
-       depending on AL_CONE_OUTER_GAIN, and multiplied with the distance
-       dependent attenuation. The resulting attenuation factor for the given
-       angle and distance between listener and source is multiplied with
-       source AL_GAIN." */
-    if (src->cone_inner_angle < src->cone_outer_angle) {
-        FIXME("directional sources");
+    for (i = 0; i < unrolled; i++, data += 8, stream += 8) {
+        const int16x8_t vdata = vld1q_s16(data);
+        const float32x4_t vsamp1 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(vdata)));
+        const float32x4_t vsamp2 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(vdata)));
+        vst1q_f32(stream, vmlaq_f32(vld1q_f32(stream), vsamp1, vleftright));
+        vst1q_f32(stream+4, vmlaq_f32(vld1q_f32(stream+4), vsamp2, vleftright));
     }
 
-    /* AL SPEC: "4. The effective gain computed this way is compared against
-       AL_MIN_GAIN and AL_MAX_GAIN thresholds." */
-    gain = SDL_min(SDL_max(gain, src->min_gain), src->max_gain);
-
-    /* AL SPEC: "5. The result is guaranteed to be clamped to [AL_MIN_GAIN,
-       AL_MAX_GAIN], and subsequently multiplied by listener gain which serves
-       as an overall volume control. The implementation is free to clamp
-       listener gain if necessary due to hardware or implementation
-       constraints." */
-    gain *= ctx->listener.gain;
+    mix_sint16_c2_scalar(panning, data, stream, leftover);
+}
 
-    /* now figure out positioning. Since we're aiming for stereo, we just
-       need a simple panning effect. We're going to do what's called
-       "constant power panning," as explained...
+static ALsizei resample_sint16_c1_neon(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
+{
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    const int unrolled = mixframes / 4;
+    const int leftover = mixframes % 4;
+    const float32x4_t vleftright = { left, right, left, right };
+    const Sint16 *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
 
-       https://dsp.stackexchange.com/questions/21691/algorithm-to-pan-audio
+    for (i = 0; i < unrolled; i++, stream += 8) {
+        const Uint32 pos0 = frac;
+        const Uint32 pos1 = pos0 + step;
+        const Uint32 pos2 = pos1 + step;
+        const Uint32 pos3 = pos2 + step;
+        const Sint16 *data0 = data + (pos0 >> RESAMPLE_FRAC_BITS);
+        const Sint16 *data1 = data + (pos1 >> RESAMPLE_FRAC_BITS);
+        const Sint16 *data2 = data + (pos2 >> RESAMPLE_FRAC_BITS);
+        const Sint16 *data3 = data + (pos3 >> RESAMPLE_FRAC_BITS);
+        const int32x4_t vsamp1i = { data0[0], data1[0], data2[0], data3[0] };
+        const int32x4_t vsamp2i = { data0[1], data1[1], data2[1], data3[1] };
+        const float32x4_t vsamp1 = vcvtq_f32_s32(vsamp1i);
+        const float32x4_t vsamp2 = vcvtq_f32_s32(vsamp2i);
+        const uint32x4_t vpos = { pos0, pos1, pos2, pos3 };
+        const float32x4_t vfrac = vmulq_n_f32(vcvtq_f32_u32(vandq_u32(vpos, vdupq_n_u32(RESAMPLE_FRAC_MASK))), RESAMPLE_FRAC_SCALE);
+        const float32x4_t vsamp = vmlaq_f32(vsamp1, vsubq_f32(vsamp2, vsamp1), vfrac);
+        const float32x4x2_t vzipped = vzipq_f32(vsamp, vsamp);
+        vst1q_f32(stream, vmlaq_f32(vld1q_f32(stream), vzipped.val[0], vleftright));
+        vst1q_f32(stream+4, vmlaq_f32(vld1q_f32(stream+4), vzipped.val[1], vleftright));
+        frac = pos3 + step;
+        data += frac >> RESAMPLE_FRAC_BITS;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
+
+    *_frac = frac;
+    return ((ALsizei) (data - start)) + resample_sint16_c1_scalar(panning, data, stream, leftover, _frac, step);
+}
+
+static ALsizei resample_sint16_c2_neon(const ALfloat * restrict panning, const Sint16 * restrict data, float * restrict stream, const ALsizei mixframes, Uint32 *_frac, const Uint32 step)
+{
+    const ALfloat left = panning[0] * SINT16_TO_FLOAT32;
+    const ALfloat right = panning[1] * SINT16_TO_FLOAT32;
+    const int unrolled = mixframes / 2;
+    const int leftover = mixframes % 2;
+    const float32x4_t vleftright = { left, right, left, right };
+    const Sint16 *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
 
-       XYZZY!! https://en.wikipedia.org/wiki/Cross_product#Mnemonic
-    */
+    for (i = 0; i < unrolled; i++, stream += 4) {
+        const Uint32 pos0 = frac;
+        const Uint32 pos1 = pos0 + step;
+        const Sint16 *data0 = data + ((pos0 >> RESAMPLE_FRAC_BITS) * 2);
+        const Sint16 *data1 = data + ((pos1 >> RESAMPLE_FRAC_BITS) * 2);
+        const float frac0 = ((float) (pos0 & RESAMPLE_FRAC_MASK)) * RESAMPLE_FRAC_SCALE;
+        const float frac1 = ((float) (pos1 & RESAMPLE_FRAC_MASK)) * RESAMPLE_FRAC_SCALE;
+        const int32x4_t vsamp1i = { data0[0], data0[1], data1[0], data1[1] };
+        const int32x4_t vsamp2i = { data0[2], data0[3], data1[2], data1[3] };
+        const float32x4_t vsamp1 = vcvtq_f32_s32(vsamp1i);
+        const float32x4_t vsamp2 = vcvtq_f32_s32(vsamp2i);
+        const float32x4_t vfrac = { frac0, frac0, frac1, frac1 };
+        const float32x4_t vsamp = vmlaq_f32(vsamp1, vsubq_f32(vsamp2, vsamp1), vfrac);
+        vst1q_f32(stream, vmlaq_f32(vld1q_f32(stream), vsamp, vleftright));
+        frac = pos1 + step;
+        data += (frac >> RESAMPLE_FRAC_BITS) * 2;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
+
+    *_frac = frac;
+    return ((ALsizei) ((data - start) / 2)) + resample_sint16_c2_scalar(panning, data, stream, leftover, _frac, step);
+}
+#endif
 
-    #ifdef __SSE__ /* (the math is explained in the scalar version.) */
-    if (has_sse) {
-        const __m128 at_sse = _mm_load_ps(at);
-        const __m128 up_sse = _mm_load_ps(up);
-        __m128 V_sse;
-        __m128 R_sse;
-        ALfloat cosangle;
-        ALfloat mags;
-        ALfloat a;
+/* G.711 mu-law and A-law (AL_EXT_MULAW, AL_EXT_ALAW) buffers stay one byte a
+   sample, and get expanded through one of these tables as they're mixed.
+   The entries are the standard 16-bit expansions, so this sounds exactly like
+   the app expanding to AL_FORMAT_*16 itself. They're floats so the AVX2
+   version can gather straight out of them; without a gather instruction a
+   table lookup is a load per sample anyhow, so SSE and NEON use the scalar one. */
+static const float mulaw_table[256] = {
+    -32124.0f, -31100.0f, -30076.0f, -29052.0f, -28028.0f, -27004.0f, -25980.0f, -24956.0f, -23932.0f, -22908.0f, -21884.0f, -20860.0f,
+    -19836.0f, -18812.0f, -17788.0f, -16764.0f, -15996.0f, -15484.0f, -14972.0f, -14460.0f, -13948.0f, -13436.0f, -12924.0f, -12412.0f,
+    -11900.0f, -11388.0f, -10876.0f, -10364.0f, -9852.0f, -9340.0f, -8828.0f, -8316.0f, -7932.0f, -7676.0f, -7420.0f, -7164.0f,
+    -6908.0f, -6652.0f, -6396.0f, -6140.0f, -5884.0f, -5628.0f, -5372.0f, -5116.0f, -4860.0f, -4604.0f, -4348.0f, -4092.0f,
+    -3900.0f, -3772.0f, -3644.0f, -3516.0f, -3388.0f, -3260.0f, -3132.0f, -3004.0f, -2876.0f, -2748.0f, -2620.0f, -2492.0f,
+    -2364.0f, -2236.0f, -2108.0f, -1980.0f, -1884.0f, -1820.0f, -1756.0f, -1692.0f, -1628.0f, -1564.0f, -1500.0f, -1436.0f,
+    -1372.0f, -1308.0f, -1244.0f, -1180.0f, -1116.0f, -1052.0f, -988.0f, -924.0f, -876.0f, -844.0f, -812.0f, -780.0f,
+    -748.0f, -716.0f, -684.0f, -652.0f, -620.0f, -588.0f, -556.0f, -524.0f, -492.0f, -460.0f, -428.0f, -396.0f,
+    -372.0f, -356.0f, -340.0f, -324.0f, -308.0f, -292.0f, -276.0f, -260.0f, -244.0f, -228.0f, -212.0f, -196.0f,
+    -180.0f, -164.0f, -148.0f, -132.0f, -120.0f, -112.0f, -104.0f, -96.0f, -88.0f, -80.0f, -72.0f, -64.0f,
+    -56.0f, -48.0f, -40.0f, -32.0f, -24.0f, -16.0f, -8.0f, 0.0f, 32124.0f, 31100.0f, 30076.0f, 29052.0f,
+    28028.0f, 27004.0f, 25980.0f, 24956.0f, 23932.0f, 22908.0f, 21884.0f, 20860.0f, 19836.0f, 18812.0f, 17788.0f, 16764.0f,
+    15996.0f, 15484.0f, 14972.0f, 14460.0f, 13948.0f, 13436.0f, 12924.0f, 12412.0f, 11900.0f, 11388.0f, 10876.0f, 10364.0f,
+    9852.0f, 9340.0f, 8828.0f, 8316.0f, 7932.0f, 7676.0f, 7420.0f, 7164.0f, 6908.0f, 6652.0f, 6396.0f, 6140.0f,
+    5884.0f, 5628.0f, 5372.0f, 5116.0f, 4860.0f, 4604.0f, 4348.0f, 4092.0f, 3900.0f, 3772.0f, 3644.0f, 3516.0f,
+    3388.0f, 3260.0f, 3132.0f, 3004.0f, 2876.0f, 2748.0f, 2620.0f, 2492.0f, 2364.0f, 2236.0f, 2108.0f, 1980.0f,
+    1884.0f, 1820.0f, 1756.0f, 1692.0f, 1628.0f, 1564.0f, 1500.0f, 1436.0f, 1372.0f, 1308.0f, 1244.0f, 1180.0f,
+    1116.0f, 1052.0f, 988.0f, 924.0f, 876.0f, 844.0f, 812.0f, 780.0f, 748.0f, 716.0f, 684.0f, 652.0f,
+    620.0f, 588.0f, 556.0f, 524.0f, 492.0f, 460.0f, 428.0f, 396.0f, 372.0f, 356.0f, 340.0f, 324.0f,
+    308.0f, 292.0f, 276.0f, 260.0f, 244.0f, 228.0f, 212.0f, 196.0f, 180.0f, 164.0f, 148.0f, 132.0f,
+    120.0f, 112.0f, 104.0f, 96.0f, 88.0f, 80.0f, 72.0f, 64.0f, 56.0f, 48.0f, 40.0f, 32.0f,
+    24.0f, 16.0f, 8.0f, 0.0f
+};
+static const float alaw_table[256] = {
+    -5504.0f, -5248.0f, -6016.0f, -5760.0f, -4480.0f, -4224.0f, -4992.0f, -4736.0f, -7552.0f, -7296.0f, -8064.0f, -7808.0f,
+    -6528.0f, -6272.0f, -7040.0f, -6784.0f, -2752.0f, -2624.0f, -3008.0f, -2880.0f, -2240.0f, -2112.0f, -2496.0f, -2368.0f,
+    -3776.0f, -3648.0f, -4032.0f, -3904.0f, -3264.0f, -3136.0f, -3520.0f, -3392.0f, -22016.0f, -20992.0f, -24064.0f, -23040.0f,
+    -17920.0f, -16896.0f, -19968.0f, -18944.0f, -30208.0f, -29184.0f, -32256.0f, -31232.0f, -26112.0f, -25088.0f, -28160.0f, -27136.0f,
+    -11008.0f, -10496.0f, -12032.0f, -11520.0f, -8960.0f, -8448.0f, -9984.0f, -9472.0f, -15104.0f, -14592.0f, -16128.0f, -15616.0f,
+    -13056.0f, -12544.0f, -14080.0f, -13568.0f, -344.0f, -328.0f, -376.0f, -360.0f, -280.0f, -264.0f, -312.0f, -296.0f,
+    -472.0f, -456.0f, -504.0f, -488.0f, -408.0f, -392.0f, -440.0f, -424.0f, -88.0f, -72.0f, -120.0f, -104.0f,
+    -24.0f, -8.0f, -56.0f, -40.0f, -216.0f, -200.0f, -248.0f, -232.0f, -152.0f, -136.0f, -184.0f, -168.0f,
+    -1376.0f, -1312.0f, -1504.0f, -1440.0f, -1120.0f, -1056.0f, -1248.0f, -1184.0f, -1888.0f, -1824.0f, -2016.0f, -1952.0f,
+    -1632.0f, -1568.0f, -1760.0f, -1696.0f, -688.0f, -656.0f, -752.0f, -720.0f, -560.0f, -528.0f, -624.0f, -592.0f,
+    -944.0f, -912.0f, -1008.0f, -976.0f, -816.0f, -784.0f, -880.0f, -848.0f, 5504.0f, 5248.0f, 6016.0f, 5760.0f,
+    4480.0f, 4224.0f, 4992.0f, 4736.0f, 7552.0f, 7296.0f, 8064.0f, 7808.0f, 6528.0f, 6272.0f, 7040.0f, 6784.0f,
+    2752.0f, 2624.0f, 3008.0f, 2880.0f, 2240.0f, 2112.0f, 2496.0f, 2368.0f, 3776.0f, 3648.0f, 4032.0f, 3904.0f,
+    3264.0f, 3136.0f, 3520.0f, 3392.0f, 22016.0f, 20992.0f, 24064.0f, 23040.0f, 17920.0f, 16896.0f, 19968.0f, 18944.0f,
+    30208.0f, 29184.0f, 32256.0f, 31232.0f, 26112.0f, 25088.0f, 28160.0f, 27136.0f, 11008.0f, 10496.0f, 12032.0f, 11520.0f,
+    8960.0f, 8448.0f, 9984.0f, 9472.0f, 15104.0f, 14592.0f, 16128.0f, 15616.0f, 13056.0f, 12544.0f, 14080.0f, 13568.0f,
+    344.0f, 328.0f, 376.0f, 360.0f, 280.0f, 264.0f, 312.0f, 296.0f, 472.0f, 456.0f, 504.0f, 488.0f,
+    408.0f, 392.0f, 440.0f, 424.0f, 88.0f, 72.0f, 120.0f, 104.0f, 24.0f, 8.0f, 56.0f, 40.0f,
+    216.0f, 200.0f, 248.0f, 232.0f, 152.0f, 136.0f, 184.0f, 168.0f, 1376.0f, 1312.0f, 1504.0f, 1440.0f,
+    1120.0f, 1056.0f, 1248.0f, 1184.0f, 1888.0f, 1824.0f, 2016.0f, 1952.0f, 1632.0f, 1568.0f, 1760.0f, 1696.0f,
+    688.0f, 656.0f, 752.0f, 720.0f, 560.0f, 528.0f, 624.0f, 592.0f, 944.0f, 912.0f, 1008.0f, 976.0f,
+    816.0f, 784.0f, 880.0f, 848.0f
+};
 
-        a = dotproduct_sse(position_sse, up_sse);
-        V_sse = _mm_sub_ps(position_sse, _mm_mul_ps(_mm_set1_ps(a), up_sse));
+static void expand_table8_scalar(const float * restrict table, const Uint8 * restrict data, float * restrict outdata, const int samples)
+{
+    int i;
+    for (i = 0; i < samples; i++) {
+        outdata[i] = table[data[i]] * SINT16_TO_FLOAT32;
+    }
+}
 
-        mags = magnitude_sse(at_sse) * magnitude_sse(V_sse);
-        if (mags == 0.0f) {
-            radians = 0.0f;
-        } else {
-            cosangle = dotproduct_sse(at_sse, V_sse) / mags;
-            cosangle = SDL_clamp(cosangle, -1.0f, 1.0f);
-            radians = SDL_acosf(cosangle);   
-        }
+#if HAVE_AVX_MIXERS
+/* The AVX versions don't bother with alignment; unaligned loads and stores
+   are basically free on anything that has AVX. */
+AVX_TARGET static void mix_float32_c1_avx(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes)
+{
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    const int unrolled = mixframes / 8;
+    const int leftover = mixframes % 8;
+    const __m256 vleftright = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+    ALsizei i;
 
-        R_sse = xyzzy_sse(at_sse, up_sse);
+    for (i = 0; i < unrolled; i++, data += 8, stream += 16) {
+        const __m256 vdata = _mm256_loadu_ps(data);
+        const __m256 vlo = _mm256_unpacklo_ps(vdata, vdata);  /* 0 0 1 1 | 4 4 5 5 */
+        const __m256 vhi = _mm256_unpackhi_ps(vdata, vdata);  /* 2 2 3 3 | 6 6 7 7 */
+        const __m256 vsamp1 = _mm256_permute2f128_ps(vlo, vhi, 0x20);  /* 0 0 1 1 | 2 2 3 3 */
+        const __m256 vsamp2 = _mm256_permute2f128_ps(vlo, vhi, 0x31);  /* 4 4 5 5 | 6 6 7 7 */
+        _mm256_storeu_ps(stream, _mm256_add_ps(_mm256_loadu_ps(stream), _mm256_mul_ps(vsamp1, vleftright)));
+        _mm256_storeu_ps(stream+8, _mm256_add_ps(_mm256_loadu_ps(stream+8), _mm256_mul_ps(vsamp2, vleftright)));
+    }
 
-        if (dotproduct_sse(R_sse, V_sse) < 0.0f) {
-            radians = -radians;
-        }
-    } else
-    #endif
+    mix_float32_c1_scalar(panning, data, stream, leftover);
+}
 
-    #ifdef __ARM_NEON__  /* (the math is explained in the scalar version.) */
-    if (has_neon) {
-        const float32x4_t at_neon = vld1q_f32(at);
-        const float32x4_t up_neon = vld1q_f32(up);
-        float32x4_t V_neon;
-        float32x4_t R_neon;
-        ALfloat cosangle;
-        ALfloat mags;
-        ALfloat a;
+AVX_TARGET static void mix_float32_c2_avx(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes)
+{
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    const int unrolled = mixframes / 8;
+    const int leftover = mixframes % 8;
+    const __m256 vleftright = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+    ALsizei i;
 
-        a = dotproduct_neon(position_neon, up_neon);
-        V_neon = vsubq_f32(position_neon, vmulq_f32(vdupq_n_f32(a), up_neon));
+    for (i = 0; i < unrolled; i++, data += 16, stream += 16) {
+        const __m256 vdata1 = _mm256_loadu_ps(data);
+        const __m256 vdata2 = _mm256_loadu_ps(data+8);
+        _mm256_storeu_ps(stream, _mm256_add_ps(_mm256_loadu_ps(stream), _mm256_mul_ps(vdata1, vleftright)));
+        _mm256_storeu_ps(stream+8, _mm256_add_ps(_mm256_loadu_ps(stream+8), _mm256_mul_ps(vdata2, vleftright)));
+    }
 
-        mags = magnitude_neon(at_neon) * magnitude_neon(V_neon);
-        if (mags == 0.0f) {
-            radians = 0.0f;
-        } else {
-            cosangle = dotproduct_neon(at_neon, V_neon) / mags;
-            cosangle = SDL_clamp(cosangle, -1.0f, 1.0f);
-            radians = SDL_acosf(cosangle);
-        }
+    mix_float32_c2_scalar(panning, data, stream, leftover);
+}
 
-        R_neon = xyzzy_neon(at_neon, up_neon);
+AVX_TARGET static void accumulate_float32_avx(const float * restrict data, float * restrict stream, const int samples)
+{
+    const int unrolled = samples / 32;
+    const int leftover = samples % 32;
+    int i;
 
-        if (dotproduct_neon(R_neon, V_neon) < 0.0f) {
-            radians = -radians;
-        }
+    for (i = 0; i < unrolled; i++, data += 32, stream += 32) {
+        const __m256 vdata1 = _mm256_loadu_ps(data);
+        const __m256 vdata2 = _mm256_loadu_ps(data+8);
+        const __m256 vdata3 = _mm256_loadu_ps(data+16);
+        const __m256 vdata4 = _mm256_loadu_ps(data+24);
+        _mm256_storeu_ps(stream, _mm256_add_ps(_mm256_loadu_ps(stream), vdata1));
+        _mm256_storeu_ps(stream+8, _mm256_add_ps(_mm256_loadu_ps(stream+8), vdata2));
+        _mm256_storeu_ps(stream+16, _mm256_add_ps(_mm256_loadu_ps(stream+16), vdata3));
+        _mm256_storeu_ps(stream+24, _mm256_add_ps(_mm256_loadu_ps(stream+24), vdata4));
+    }
 
-    } else
-    #endif
+    accumulate_float32_scalar(data, stream, leftover);
+}
 
-    {
-    #if NEED_SCALAR_FALLBACK
-        ALfloat V[3];
-        ALfloat R[3];
-        ALfloat mags;
-        ALfloat cosangle;
-        ALfloat a;
+/* AVX2 doesn't add anything for float math, but every AVX2 chip also has FMA, which does. */
+AVX2_TARGET static void mix_float32_c1_avx2(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes)
+{
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    const int unrolled = mixframes / 8;
+    const int leftover = mixframes % 8;
+    const __m256 vleftright = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+    const __m256i vdupe = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    ALsizei i;
 
-        /* Remove upwards component so it lies completely within the horizontal plane. */
-        a = dotproduct(position, up);
-        V[0] = position[0] - (a * up[0]);
-        V[1] = position[1] - (a * up[1]);
-        V[2] = position[2] - (a * up[2]);
+    for (i = 0; i < unrolled; i++, data += 8, stream += 16) {
+        const __m256 vsamp1 = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(data)), vdupe);
+        const __m256 vsamp2 = _mm256_permutevar8x32_ps(_mm256_castps128_ps256(_mm_loadu_ps(data+4)), vdupe);
+        _mm256_storeu_ps(stream, _mm256_fmadd_ps(vsamp1, vleftright, _mm256_loadu_ps(stream)));
+        _mm256_storeu_ps(stream+8, _mm256_fmadd_ps(vsamp2, vleftright, _mm256_loadu_ps(stream+8)));
+    }
 
-        /* Calculate angle */
-        mags = magnitude(at) * magnitude(V);
-        if (mags == 0.0f) {
-            radians = 0.0f;
-        } else {
-            cosangle = dotproduct(at, V) / mags;
-            cosangle = SDL_clamp(cosangle, -1.0f, 1.0f);
-            radians = SDL_acosf(cosangle);
-        }
+    mix_float32_c1_scalar(panning, data, stream, leftover);
+}
 
-        /* Get "right" vector */
-        xyzzy(R, at, up);
+AVX2_TARGET static void mix_float32_c2_avx2(const ALfloat * restrict panning, const float * restrict data, float * restrict stream, const ALsizei mixframes)
+{
+    const ALfloat left = panning[0];
+    const ALfloat right = panning[1];
+    const int unrolled = mixframes / 8;
+    const int leftover = mixframes % 8;
+    const __m256 vleftright = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+    ALsizei i;
 
-        /* make it negative to the left, positive to the right. */
-        if (dotproduct(R, V) < 0.0f) {
-            radians = -radians;
-        }
-    #endif
+    for (i = 0; i < unrolled; i++, data += 16, stream += 16) {
+        const __m256 vdata1 = _mm256_loadu_ps(data);
+        const __m256 vdata2 = _mm256_loadu_ps(data+8);
+        _mm256_storeu_ps(stream, _mm256_fmadd_ps(vdata1, vleftright, _mm256_loadu_ps(stream)));
+        _mm256_storeu_ps(stream+8, _mm256_fmadd_ps(vdata2, vleftright, _mm256_loadu_ps(stream+8)));
     }
 
-    /* here comes the Constant Power Panning magic... */
-    #define SQRT2_DIV2 0.7071067812f  /* sqrt(2.0) / 2.0 ... */
+    mix_float32_c2_scalar(panning, data, stream, leftover);
+}
 
-    /* this might be a terrible idea, which is totally my own doing here,
-      but here you go: Constant Power Panning only works from -45 to 45
-      degrees in front of the listener. So we split this into 4 quadrants.
-      - from -45 to 45: standard panning.
-      - from 45 to 135: pan full right.
-      - from 135 to 225: flip angle so it works like standard panning.
-      - from 225 to -45: pan full left. */
+AVX2_TARGET static void expand_table8_avx2(const float * restrict table, const Uint8 * restrict data, float * restrict outdata, const int samples)
+{
+    const __m256 vscale = _mm256_set1_ps(SINT16_TO_FLOAT32);
+    const int unrolled = samples / 8;
+    const int leftover = samples % 8;
+    int i;
 
-    #define RADIANS_45_DEGREES 0.7853981634f
-    #define RADIANS_135_DEGREES 2.3561944902f
-    if ((radians >= -RADIANS_45_DEGREES) && (radians <= RADIANS_45_DEGREES)) {
-        ALfloat sine, cosine;
-        calculate_sincos(radians, &sine, &cosine);
-        gains[0] = (SQRT2_DIV2 * (cosine - sine));
-        gains[1] = (SQRT2_DIV2 * (cosine + sine));
-    } else if ((radians >= RADIANS_45_DEGREES) && (radians <= RADIANS_135_DEGREES)) {
-        gains[0] = 0.0f;
-        gains[1] = 1.0f;
-    } else if ((radians >= -RADIANS_135_DEGREES) && (radians <= -RADIANS_45_DEGREES)) {
-        gains[0] = 1.0f;
-        gains[1] = 0.0f;
-    } else if (radians < 0.0f) {  /* back left */
-        ALfloat sine, cosine;
-        calculate_sincos((ALfloat) -(radians + M_PI), &sine, &cosine);
-        gains[0] = (SQRT2_DIV2 * (cosine - sine));
-        gains[1] = (SQRT2_DIV2 * (cosine + sine));
-    } else { /* back right */
-        ALfloat sine, cosine;
-        calculate_sincos((ALfloat) -(radians - M_PI), &sine, &cosine);
-        gains[0] = (SQRT2_DIV2 * (cosine - sine));
-        gains[1] = (SQRT2_DIV2 * (cosine + sine));
+    for (i = 0; i < unrolled; i++, data += 8, outdata += 8) {
+        const __m256i vindices = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) data));
+        _mm256_storeu_ps(outdata, _mm256_mul_ps(_mm256_i32gather_ps(table, vindices, 4), vscale));
     }
 
-    /* apply distance attenuation and gain to positioning. */
-    gains[0] *= gain;
-    gains[1] *= gain;
+    expand_table8_scalar(table, data, outdata, leftover);
 }
+#endif
 
+static const MixerKernels mixer_kernels_scalar = {
+    "scalar", mix_float32_c1_scalar, mix_float32_c2_scalar, resample_float32_c1_scalar, resample_float32_c2_scalar, accumulate_float32_scalar,
+    mix_float32_c1_surround_scalar, mix_float32_c2_surround_scalar, mix_float32_matrix_scalar,
+    mix_sint16_c1_scalar, mix_sint16_c2_scalar, resample_sint16_c1_scalar, resample_sint16_c2_scalar,
+    expand_table8_scalar
+};
+#ifdef __SSE__
+#ifndef __SSE2__
+#define mix_sint16_c1_sse2 mix_sint16_c1_scalar
+#define mix_sint16_c2_sse2 mix_sint16_c2_scalar
+#define resample_sint16_c1_sse2 resample_sint16_c1_scalar
+#define resample_sint16_c2_sse2 resample_sint16_c2_scalar
+#endif
+static const MixerKernels mixer_kernels_sse = {
+    "SSE", mix_float32_c1_sse, mix_float32_c2_sse, resample_float32_c1_sse, resample_float32_c2_sse, accumulate_float32_sse,
+    mix_float32_c1_surround_sse, mix_float32_c2_surround_sse, mix_float32_matrix_sse,
+    mix_sint16_c1_sse2, mix_sint16_c2_sse2, resample_sint16_c1_sse2, resample_sint16_c2_sse2,
+    expand_table8_scalar
+};
+#endif
+#ifdef __ARM_NEON__
+static const MixerKernels mixer_kernels_neon = {
+    "NEON", mix_float32_c1_neon, mix_float32_c2_neon, resample_float32_c1_neon, resample_float32_c2_neon, accumulate_float32_neon,
+    mix_float32_c1_surround_neon, mix_float32_c2_surround_neon, mix_float32_matrix_neon,
+    mix_sint16_c1_neon, mix_sint16_c2_neon, resample_sint16_c1_neon, resample_sint16_c2_neon,
+    expand_table8_scalar
+};
+#endif
+#if HAVE_AVX_MIXERS
+/* the resamplers are bound by working out where to read from, not by the math, and gathers
+   didn't beat the SSE versions when we measured, so the AVX tables just use those. The
+   surround and matrix mixers are one or two registers per frame either way, so they do too, and
+   the Sint16 mixers are bound by the conversion, so they use the SSE2 ones. */
+#ifdef __SSE__
+#define resample_float32_c1_avx resample_float32_c1_sse
+#define resample_float32_c2_avx resample_float32_c2_sse
+#define mix_float32_c1_surround_avx mix_float32_c1_surround_sse
+#define mix_float32_c2_surround_avx mix_float32_c2_surround_sse
+#define mix_float32_matrix_avx mix_float32_matrix_sse
+#define mix_sint16_c1_avx mix_sint16_c1_sse2
+#define mix_sint16_c2_avx mix_sint16_c2_sse2
+#define resample_sint16_c1_avx resample_sint16_c1_sse2
+#define resample_sint16_c2_avx resample_sint16_c2_sse2
+#else
+#define resample_float32_c1_avx resample_float32_c1_scalar
+#define resample_float32_c2_avx resample_float32_c2_scalar
+#define mix_float32_c1_surround_avx mix_float32_c1_surround_scalar
+#define mix_float32_c2_surround_avx mix_float32_c2_surround_scalar
+#define mix_float32_matrix_avx mix_float32_matrix_scalar
+#define mix_sint16_c1_avx mix_sint16_c1_scalar
+#define mix_sint16_c2_avx mix_sint16_c2_scalar
+#define resample_sint16_c1_avx resample_sint16_c1_scalar
+#define resample_sint16_c2_avx resample_sint16_c2_scalar
+#endif
+static const MixerKernels mixer_kernels_avx = {
+    "AVX", mix_float32_c1_avx, mix_float32_c2_avx, resample_float32_c1_avx, resample_float32_c2_avx, accumulate_float32_avx,
+    mix_float32_c1_surround_avx, mix_float32_c2_surround_avx, mix_float32_matrix_avx,
+    mix_sint16_c1_avx, mix_sint16_c2_avx, resample_sint16_c1_avx, resample_sint16_c2_avx,
+    expand_table8_scalar
+};
+static const MixerKernels mixer_kernels_avx2 = {
+    "AVX2+FMA", mix_float32_c1_avx2, mix_float32_c2_avx2, resample_float32_c1_avx, resample_float32_c2_avx, accumulate_float32_avx,
+    mix_float32_c1_surround_avx, mix_float32_c2_surround_avx, mix_float32_matrix_avx,
+    mix_sint16_c1_avx, mix_sint16_c2_avx, resample_sint16_c1_avx, resample_sint16_c2_avx,
+    expand_table8_avx2
+};
+#endif
 
-static ALCboolean mix_source(ALCcontext *ctx, ALsource *src, float *stream, int len, const ALboolean force_recalc)
+static void choose_mixer_kernels(void)
 {
-    ALCboolean keep;
+    #if HAVE_AVX_MIXERS
+    if (SDL_HasAVX2()) {
+        mixer_kernels = mixer_kernels_avx2;
+        return;
+    } else if (SDL_HasAVX()) {
+        mixer_kernels = mixer_kernels_avx;
+        return;
+    }
+    #endif
 
-    keep = (SDL_AtomicGet(&src->state) == AL_PLAYING);
-    if (keep) {
-        SDL_assert(src->allocated);
-        if (src->recalc || force_recalc) {
-            SDL_MemoryBarrierAcquire();
-            src->recalc = AL_FALSE;
-            calculate_channel_gains(ctx, src, src->panning);
-        }
-        if (src->type == AL_STATIC) {
-            BufferQueueItem fakequeue = { src->buffer, NULL };
-            keep = mix_source_buffer_queue(ctx, src, &fakequeue, stream, len);
-        } else if (src->type == AL_STREAMING) {
-            obtain_newly_queued_buffers(&src->buffer_queue);
-            keep = mix_source_buffer_queue(ctx, src, src->buffer_queue.head, stream, len);
-        } else if (src->type == AL_UNDETERMINED) {
-            keep = ALC_FALSE;  /* this has AL_BUFFER set to 0; just dump it. */
-        } else {
-            SDL_assert(!"unknown source type");
-        }
+    #ifdef __SSE__
+    if (has_sse) {
+        mixer_kernels = mixer_kernels_sse;
+        return;
+    }
+    #elif defined(__ARM_NEON__)
+    if (has_neon) {
+        mixer_kernels = mixer_kernels_neon;
+        return;
     }
+    #endif
 
-    return keep;
+    mixer_kernels = mixer_kernels_scalar;
+}
+
+
+/* Fast transcendental math.
+
+   The phase vocoder needs atan2, sin and cos for every bin of every frame,
+   and spatialization needs acos (for cones) and pow (for the exponent
+   distance model) for every source whenever anything moves. The C runtime
+   versions of these are accurate to the last bit, which we don't need, and
+   can't be vectorized, which we do. So we use polynomial approximations that
+   have a scalar, SSE and NEON version each, all computing the same thing so
+   everything sounds the same no matter which path we take.
+
+   Worst-case errors, as measured by tests/testfastmath.c against double
+   precision libm:
+
+     atan2:  4e-7 radians, any input.
+     sincos: 3e-7, for x in [-pi, pi]. No range reduction is done beyond
+             that, so wrap your angles first.
+     acos:   5e-7 radians, for x in [-1, 1].
+     log2:   3e-7 absolute, for positive, normal x.
+     exp2:   3e-7 relative, for x in [-126, 127]; x is clamped to that
+             range, so results never become denormal or infinite.
+     pow:    exp2(y * log2(x)), so 1e-6 relative while |y * log2(x)| < 16,
+             growing to 1e-5 near the clamp. x must be positive.
+
+   These are only used by contexts created with ALC_FAST_MATH_MOJOAL set to
+   ALC_TRUE. By default, the vocoder and spatialization call the C runtime,
+   so existing apps get the same output they always did, at a significant
+   cost; apps that can live with the errors above have to opt in. */
+#define FASTMATH_PI ((float) M_PI)
+#define FASTMATH_SQRT2 1.4142135624f
+#define FASTMATH_ATAN_C2 -0.3333314528f  /* Abramowitz and Stegun 4.4.49; good to about 2e-8 on [-1, 1]. */
+#define FASTMATH_ATAN_C4 0.1999355085f
+#define FASTMATH_ATAN_C6 -0.1420889944f
+#define FASTMATH_ATAN_C8 0.1065626393f
+#define FASTMATH_ATAN_C10 -0.0752896400f
+#define FASTMATH_ATAN_C12 0.0429096138f
+#define FASTMATH_ATAN_C14 -0.0161657367f
+#define FASTMATH_ATAN_C16 0.0028662257f
+#define FASTMATH_SIN_C3 (-1.0f / 6.0f)  /* Taylor series, good to about 6e-8 on [-pi/2, pi/2]. */
+#define FASTMATH_SIN_C5 (1.0f / 120.0f)
+#define FASTMATH_SIN_C7 (-1.0f / 5040.0f)
+#define FASTMATH_SIN_C9 (1.0f / 362880.0f)
+#define FASTMATH_SIN_C11 (-1.0f / 39916800.0f)
+#define FASTMATH_ACOS_C0 1.5707963050f  /* Abramowitz and Stegun 4.4.46; acos(x) = sqrt(1 - x) * poly(x), good to about 2e-8 on [0, 1]. */
+#define FASTMATH_ACOS_C1 -0.2145988016f
+#define FASTMATH_ACOS_C2 0.0889789874f
+#define FASTMATH_ACOS_C3 -0.0501743046f
+#define FASTMATH_ACOS_C4 0.0308918810f
+#define FASTMATH_ACOS_C5 -0.0170881256f
+#define FASTMATH_ACOS_C6 0.0066700901f
+#define FASTMATH_ACOS_C7 -0.0012624911f
+#define FASTMATH_LOG2_C1 2.8853900818f  /* 2/(k*ln(2)): log2(m) = atanh series in t = (m-1)/(m+1), good to about 1e-9 for m in [sqrt(1/2), sqrt(2)). */
+#define FASTMATH_LOG2_C3 0.9617966939f
+#define FASTMATH_LOG2_C5 0.5770780164f
+#define FASTMATH_LOG2_C7 0.4121985831f
+#define FASTMATH_LOG2_C9 0.3205988980f
+#define FASTMATH_EXP2_C1 0.6931471806f  /* ln(2)^k/k!: Taylor series of 2^x, good to about 5e-9 on [-0.5, 0.5]. */
+#define FASTMATH_EXP2_C2 0.2402265070f
+#define FASTMATH_EXP2_C3 0.0555041087f
+#define FASTMATH_EXP2_C4 0.0096181291f
+#define FASTMATH_EXP2_C5 0.0013333558f
+#define FASTMATH_EXP2_C6 0.0001540353f
+#define FASTMATH_EXP2_C7 0.0000152527f
+#define FASTMATH_EXP2_MIN -126.0f
+#define FASTMATH_EXP2_MAX 127.0f
+#define FASTMATH_ROUND_MAGIC 12582912.0f  /* 1.5 * 2^23; adding and subtracting this rounds a float to the nearest integer. */
+
+typedef union FastMathBits
+{
+    float f;
+    Uint32 ui;
+} FastMathBits;
+
+static float fastmath_atan2f(const float y, const float x)
+{
+    const float ax = SDL_fabsf(x);
+    const float ay = SDL_fabsf(y);
+    const float a = SDL_min(ax, ay) / SDL_max(SDL_max(ax, ay), FLT_MIN);
+    const float s = a * a;
+    float r = FASTMATH_ATAN_C16;
+    r = (r * s) + FASTMATH_ATAN_C14;
+    r = (r * s) + FASTMATH_ATAN_C12;
+    r = (r * s) + FASTMATH_ATAN_C10;
+    r = (r * s) + FASTMATH_ATAN_C8;
+    r = (r * s) + FASTMATH_ATAN_C6;
+    r = (r * s) + FASTMATH_ATAN_C4;
+    r = (r * s) + FASTMATH_ATAN_C2;
+    r = ((r * s) * a) + a;
+    if (ay > ax) { r = (FASTMATH_PI * 0.5f) - r; }
+    if (x < 0.0f) { r = FASTMATH_PI - r; }
+    return (y < 0.0f) ? -r : r;
+}
+
+/* sin(x) for x in [-pi/2, pi/2]. */
+static float fastmath_sin_poly(const float x)
+{
+    const float s = x * x;
+    float r = FASTMATH_SIN_C11;
+    r = (r * s) + FASTMATH_SIN_C9;
+    r = (r * s) + FASTMATH_SIN_C7;
+    r = (r * s) + FASTMATH_SIN_C5;
+    r = (r * s) + FASTMATH_SIN_C3;
+    return ((r * s) * x) + x;
+}
+
+/* x in [-pi, pi]: sin(x) == sign(x) * sin(min(|x|, pi-|x|)), cos(x) == sin(pi/2 - |x|) */
+static void fastmath_sincosf(const float x, float *sinval, float *cosval)
+{
+    const float ax = SDL_fabsf(x);
+    const float sinabs = fastmath_sin_poly(SDL_min(ax, FASTMATH_PI - ax));
+    *sinval = (x < 0.0f) ? -sinabs : sinabs;
+    *cosval = fastmath_sin_poly((FASTMATH_PI * 0.5f) - ax);
 }
 
-/* move new play requests over to the mixer thread. */
-static void migrate_playlist_requests(ALCcontext *ctx)
-{
-    SourcePlayTodo *todo;
-    SourcePlayTodo *todoend;
-    SourcePlayTodo *i;
+#if NEED_SCALAR_FALLBACK
+static float fastmath_acosf(const float x)
+{
+    const float ax = SDL_min(SDL_fabsf(x), 1.0f);
+    float r = FASTMATH_ACOS_C7;
+    r = (r * ax) + FASTMATH_ACOS_C6;
+    r = (r * ax) + FASTMATH_ACOS_C5;
+    r = (r * ax) + FASTMATH_ACOS_C4;
+    r = (r * ax) + FASTMATH_ACOS_C3;
+    r = (r * ax) + FASTMATH_ACOS_C2;
+    r = (r * ax) + FASTMATH_ACOS_C1;
+    r = (r * ax) + FASTMATH_ACOS_C0;
+    r *= SDL_sqrtf(1.0f - ax);
+    return (x < 0.0f) ? (FASTMATH_PI - r) : r;  /* acos(-x) == pi - acos(x) */
+}
+
+/* split x into exponent and a mantissa in [sqrt(1/2), sqrt(2)), so t below stays small and the series converges fast. */
+static float fastmath_log2f(const float x)
+{
+    FastMathBits bits;
+    float e, m, t, s, r;
+    bits.f = x;
+    e = (float) (((Sint32) (bits.ui >> 23)) - 127);
+    bits.ui = (bits.ui & 0x007FFFFF) | 0x3F800000;
+    m = bits.f;
+    if (m > FASTMATH_SQRT2) {
+        m *= 0.5f;
+        e += 1.0f;
+    }
+    t = (m - 1.0f) / (m + 1.0f);
+    s = t * t;
+    r = FASTMATH_LOG2_C9;
+    r = (r * s) + FASTMATH_LOG2_C7;
+    r = (r * s) + FASTMATH_LOG2_C5;
+    r = (r * s) + FASTMATH_LOG2_C3;
+    r = (r * s) + FASTMATH_LOG2_C1;
+    return (r * t) + e;
+}
+
+/* 2^x == 2^n * 2^f, with n the nearest integer to x, so f is in [-0.5, 0.5]; 2^n is built directly in the exponent bits. */
+static float fastmath_exp2f(const float x)
+{
+    const float cx = SDL_max(SDL_min(x, FASTMATH_EXP2_MAX), FASTMATH_EXP2_MIN);
+    const float n = SDL_floorf(cx + 0.5f);
+    const float f = cx - n;
+    FastMathBits bits;
+    float r = FASTMATH_EXP2_C7;
+    r = (r * f) + FASTMATH_EXP2_C6;
+    r = (r * f) + FASTMATH_EXP2_C5;
+    r = (r * f) + FASTMATH_EXP2_C4;
+    r = (r * f) + FASTMATH_EXP2_C3;
+    r = (r * f) + FASTMATH_EXP2_C2;
+    r = (r * f) + FASTMATH_EXP2_C1;
+    r = (r * f) + 1.0f;
+    bits.ui = ((Uint32) (((Sint32) n) + 127)) << 23;
+    return r * bits.f;
+}
+
+static float fastmath_powf(const float x, const float y)
+{
+    return fastmath_exp2f(y * fastmath_log2f(x));
+}
+#endif
 
-    do {  /* take the todo list atomically, now we own it. */
-        todo = (SourcePlayTodo *) ctx->playlist_todo;
-    } while (!SDL_AtomicCASPtr(&ctx->playlist_todo, todo, NULL));
+#ifdef __SSE__
+static __m128 fastmath_select_sse(const __m128 mask, const __m128 a, const __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static __m128 fastmath_atan2_sse(const __m128 y, const __m128 x)
+{
+    const __m128 signmask = _mm_set1_ps(-0.0f);
+    const __m128 ax = _mm_andnot_ps(signmask, x);
+    const __m128 ay = _mm_andnot_ps(signmask, y);
+    const __m128 a = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(FLT_MIN)));
+    const __m128 s = _mm_mul_ps(a, a);
+    __m128 r = _mm_set1_ps(FASTMATH_ATAN_C16);
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_ATAN_C14));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_ATAN_C12));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_ATAN_C10));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_ATAN_C8));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_ATAN_C6));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_ATAN_C4));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_ATAN_C2));
+    r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, s), a), a);
+    r = fastmath_select_sse(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(FASTMATH_PI * 0.5f), r), r);
+    r = fastmath_select_sse(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(FASTMATH_PI), r), r);
+    return _mm_xor_ps(r, _mm_and_ps(_mm_cmplt_ps(y, _mm_setzero_ps()), signmask));
+}
+
+static __m128 fastmath_sin_poly_sse(const __m128 x)
+{
+    const __m128 s = _mm_mul_ps(x, x);
+    __m128 r = _mm_set1_ps(FASTMATH_SIN_C11);
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_SIN_C9));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_SIN_C7));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_SIN_C5));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_SIN_C3));
+    return _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, s), x), x);
+}
+
+static void fastmath_sincos_sse(const __m128 x, __m128 *sinval, __m128 *cosval)
+{
+    const __m128 signmask = _mm_set1_ps(-0.0f);
+    const __m128 ax = _mm_andnot_ps(signmask, x);
+    const __m128 sinabs = fastmath_sin_poly_sse(_mm_min_ps(ax, _mm_sub_ps(_mm_set1_ps(FASTMATH_PI), ax)));
+    *sinval = _mm_xor_ps(sinabs, _mm_and_ps(x, signmask));
+    *cosval = fastmath_sin_poly_sse(_mm_sub_ps(_mm_set1_ps(FASTMATH_PI * 0.5f), ax));
+}
+
+static __m128 fastmath_acos_sse(const __m128 x)
+{
+    const __m128 ax = _mm_min_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), x), _mm_set1_ps(1.0f));
+    __m128 r = _mm_set1_ps(FASTMATH_ACOS_C7);
+    r = _mm_add_ps(_mm_mul_ps(r, ax), _mm_set1_ps(FASTMATH_ACOS_C6));
+    r = _mm_add_ps(_mm_mul_ps(r, ax), _mm_set1_ps(FASTMATH_ACOS_C5));
+    r = _mm_add_ps(_mm_mul_ps(r, ax), _mm_set1_ps(FASTMATH_ACOS_C4));
+    r = _mm_add_ps(_mm_mul_ps(r, ax), _mm_set1_ps(FASTMATH_ACOS_C3));
+    r = _mm_add_ps(_mm_mul_ps(r, ax), _mm_set1_ps(FASTMATH_ACOS_C2));
+    r = _mm_add_ps(_mm_mul_ps(r, ax), _mm_set1_ps(FASTMATH_ACOS_C1));
+    r = _mm_add_ps(_mm_mul_ps(r, ax), _mm_set1_ps(FASTMATH_ACOS_C0));
+    r = _mm_mul_ps(r, _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), ax)));
+    return fastmath_select_sse(_mm_cmplt_ps(x, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(FASTMATH_PI), r), r);  /* acos(-x) == pi - acos(x) */
+}
+
+/* log2 and exp2 have to get at the float bits as integers, which needs SSE2. Without it, pow falls back to the C runtime. */
+#ifdef __SSE2__
+static __m128 fastmath_log2_sse(const __m128 x)
+{
+    const __m128i bits = _mm_castps_si128(x);
+    __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+    const __m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(FASTMATH_SQRT2));
+    __m128 t, s, r;
+    m = fastmath_select_sse(big, _mm_mul_ps(m, _mm_set1_ps(0.5f)), m);
+    e = _mm_add_ps(e, _mm_and_ps(big, _mm_set1_ps(1.0f)));
+    t = _mm_div_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_add_ps(m, _mm_set1_ps(1.0f)));
+    s = _mm_mul_ps(t, t);
+    r = _mm_set1_ps(FASTMATH_LOG2_C9);
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_LOG2_C7));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_LOG2_C5));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_LOG2_C3));
+    r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(FASTMATH_LOG2_C1));
+    return _mm_add_ps(_mm_mul_ps(r, t), e);
+}
+
+static __m128 fastmath_exp2_sse(const __m128 x)
+{
+    const __m128 cx = _mm_max_ps(_mm_min_ps(x, _mm_set1_ps(FASTMATH_EXP2_MAX)), _mm_set1_ps(FASTMATH_EXP2_MIN));
+    const __m128 magic = _mm_set1_ps(FASTMATH_ROUND_MAGIC);
+    const __m128 n = _mm_sub_ps(_mm_add_ps(cx, magic), magic);
+    const __m128 f = _mm_sub_ps(cx, n);
+    const __m128i scale = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+    __m128 r = _mm_set1_ps(FASTMATH_EXP2_C7);
+    r = _mm_add_ps(_mm_mul_ps(r, f), _mm_set1_ps(FASTMATH_EXP2_C6));
+    r = _mm_add_ps(_mm_mul_ps(r, f), _mm_set1_ps(FASTMATH_EXP2_C5));
+    r = _mm_add_ps(_mm_mul_ps(r, f), _mm_set1_ps(FASTMATH_EXP2_C4));
+    r = _mm_add_ps(_mm_mul_ps(r, f), _mm_set1_ps(FASTMATH_EXP2_C3));
+    r = _mm_add_ps(_mm_mul_ps(r, f), _mm_set1_ps(FASTMATH_EXP2_C2));
+    r = _mm_add_ps(_mm_mul_ps(r, f), _mm_set1_ps(FASTMATH_EXP2_C1));
+    r = _mm_add_ps(_mm_mul_ps(r, f), _mm_set1_ps(1.0f));
+    return _mm_mul_ps(r, _mm_castsi128_ps(scale));
+}
+
+static __m128 fastmath_pow_sse(const __m128 x, const __m128 y)
+{
+    return fastmath_exp2_sse(_mm_mul_ps(y, fastmath_log2_sse(x)));
+}
+#endif
+#endif
 
-    if (!todo) {
-        return;  /* nothing new. */
-    }
+#ifdef __ARM_NEON__
+/* ARMv7 NEON doesn't have divide or square root, so refine the estimates with a couple Newton-Raphson steps. */
+static float32x4_t fastmath_reciprocal_neon(const float32x4_t x)
+{
+    float32x4_t r = vrecpeq_f32(x);
+    r = vmulq_f32(r, vrecpsq_f32(x, r));
+    return vmulq_f32(r, vrecpsq_f32(x, r));
+}
+
+static float32x4_t fastmath_sqrt_neon(const float32x4_t x)
+{
+    const float32x4_t safex = vmaxq_f32(x, vdupq_n_f32(FLT_MIN));  /* rsqrt(0) is infinity, and 0 * infinity is NaN. */
+    float32x4_t r = vrsqrteq_f32(safex);
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(safex, r), r));
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(safex, r), r));
+    return vmulq_f32(x, r);
+}
+
+static float32x4_t fastmath_atan2_neon(const float32x4_t y, const float32x4_t x)
+{
+    const uint32x4_t signmask = vdupq_n_u32(0x80000000);
+    const float32x4_t ax = vabsq_f32(x);
+    const float32x4_t ay = vabsq_f32(y);
+    const float32x4_t a = vmulq_f32(vminq_f32(ax, ay), fastmath_reciprocal_neon(vmaxq_f32(vmaxq_f32(ax, ay), vdupq_n_f32(FLT_MIN))));
+    const float32x4_t s = vmulq_f32(a, a);
+    float32x4_t r = vdupq_n_f32(FASTMATH_ATAN_C16);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ATAN_C14), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ATAN_C12), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ATAN_C10), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ATAN_C8), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ATAN_C6), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ATAN_C4), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ATAN_C2), r, s);
+    r = vmlaq_f32(a, vmulq_f32(r, s), a);
+    r = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(FASTMATH_PI * 0.5f), r), r);
+    r = vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.0f)), vsubq_f32(vdupq_n_f32(FASTMATH_PI), r), r);
+    return vbslq_f32(vandq_u32(vcltq_f32(y, vdupq_n_f32(0.0f)), signmask), vnegq_f32(r), r);
+}
+
+static float32x4_t fastmath_sin_poly_neon(const float32x4_t x)
+{
+    const float32x4_t s = vmulq_f32(x, x);
+    float32x4_t r = vdupq_n_f32(FASTMATH_SIN_C11);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_SIN_C9), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_SIN_C7), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_SIN_C5), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_SIN_C3), r, s);
+    return vmlaq_f32(x, vmulq_f32(r, s), x);
+}
+
+static void fastmath_sincos_neon(const float32x4_t x, float32x4_t *sinval, float32x4_t *cosval)
+{
+    const float32x4_t ax = vabsq_f32(x);
+    const float32x4_t sinabs = fastmath_sin_poly_neon(vminq_f32(ax, vsubq_f32(vdupq_n_f32(FASTMATH_PI), ax)));
+    *sinval = vbslq_f32(vdupq_n_u32(0x80000000), x, sinabs);  /* copy x's sign over. */
+    *cosval = fastmath_sin_poly_neon(vsubq_f32(vdupq_n_f32(FASTMATH_PI * 0.5f), ax));
+}
+
+static float32x4_t fastmath_acos_neon(const float32x4_t x)
+{
+    const float32x4_t ax = vminq_f32(vabsq_f32(x), vdupq_n_f32(1.0f));
+    float32x4_t r = vdupq_n_f32(FASTMATH_ACOS_C7);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ACOS_C6), r, ax);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ACOS_C5), r, ax);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ACOS_C4), r, ax);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ACOS_C3), r, ax);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ACOS_C2), r, ax);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ACOS_C1), r, ax);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_ACOS_C0), r, ax);
+    r = vmulq_f32(r, fastmath_sqrt_neon(vsubq_f32(vdupq_n_f32(1.0f), ax)));
+    return vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.0f)), vsubq_f32(vdupq_n_f32(FASTMATH_PI), r), r);  /* acos(-x) == pi - acos(x) */
+}
+
+static float32x4_t fastmath_log2_neon(const float32x4_t x)
+{
+    const uint32x4_t bits = vreinterpretq_u32_f32(x);
+    float32x4_t e = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+    float32x4_t m = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)), vdupq_n_u32(0x3F800000)));
+    const uint32x4_t big = vcgtq_f32(m, vdupq_n_f32(FASTMATH_SQRT2));
+    float32x4_t t, s, r;
+    m = vbslq_f32(big, vmulq_f32(m, vdupq_n_f32(0.5f)), m);
+    e = vaddq_f32(e, vreinterpretq_f32_u32(vandq_u32(big, vreinterpretq_u32_f32(vdupq_n_f32(1.0f)))));
+    t = vmulq_f32(vsubq_f32(m, vdupq_n_f32(1.0f)), fastmath_reciprocal_neon(vaddq_f32(m, vdupq_n_f32(1.0f))));
+    s = vmulq_f32(t, t);
+    r = vdupq_n_f32(FASTMATH_LOG2_C9);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_LOG2_C7), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_LOG2_C5), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_LOG2_C3), r, s);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_LOG2_C1), r, s);
+    return vmlaq_f32(e, r, t);
+}
+
+static float32x4_t fastmath_exp2_neon(const float32x4_t x)
+{
+    const float32x4_t cx = vmaxq_f32(vminq_f32(x, vdupq_n_f32(FASTMATH_EXP2_MAX)), vdupq_n_f32(FASTMATH_EXP2_MIN));
+    const float32x4_t magic = vdupq_n_f32(FASTMATH_ROUND_MAGIC);
+    const float32x4_t n = vsubq_f32(vaddq_f32(cx, magic), magic);
+    const float32x4_t f = vsubq_f32(cx, n);
+    const int32x4_t scale = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23);
+    float32x4_t r = vdupq_n_f32(FASTMATH_EXP2_C7);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_EXP2_C6), r, f);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_EXP2_C5), r, f);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_EXP2_C4), r, f);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_EXP2_C3), r, f);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_EXP2_C2), r, f);
+    r = vmlaq_f32(vdupq_n_f32(FASTMATH_EXP2_C1), r, f);
+    r = vmlaq_f32(vdupq_n_f32(1.0f), r, f);
+    return vmulq_f32(r, vreinterpretq_f32_s32(scale));
+}
+
+static float32x4_t fastmath_pow_neon(const float32x4_t x, const float32x4_t y)
+{
+    return fastmath_exp2_neon(vmulq_f32(y, fastmath_log2_neon(x)));
+}
+#endif
 
-    todoend = todo;
 
-    /* ctx->playlist and ALsource->playlist_next are only every touched
-       by the mixer thread, and source pointers live until context destruction. */
-    for (i = todo; i != NULL; i = i->next) {
-        todoend = i;
-        if ((i->source != ctx->playlist_tail) && (!i->source->playlist_next)) {
-            i->source->playlist_next = ctx->playlist;
-            if (!ctx->playlist) {
-                ctx->playlist_tail = i->source;
+/****************************************************************************
+*
+* pitch_fft and pitch_shift are modified versions of code from:
+*
+*    http://blogs.zynaptiq.com/bernsee/pitch-shifting-using-the-ft/
+*
+*   The original code has this copyright/license:
+*
+*****************************************************************************
+*
+* COPYRIGHT 1999-2015 Stephan M. Bernsee <s.bernsee [AT] zynaptiq [DOT] com>
+*
+* 						The Wide Open License (WOL)
+*
+* Permission to use, copy, modify, distribute and sell this software and its
+* documentation for any purpose is hereby granted without fee, provided that
+* the above copyright notice and this license appear in all source copies. 
+* THIS SOFTWARE IS PROVIDED "AS IS" WITHOUT EXPRESS OR IMPLIED WARRANTY OF
+* ANY KIND. See http://www.dspguru.com/wol.htm for more information.
+*
+*****************************************************************************/ 
+
+static void init_pitch_tables(void)
+{
+    const double synthesis_scale = 2.0 / ((double) (pitch_framesize2 * pitch_osamp));
+    ALfloat *twiddles = pitch_tables.twiddles;
+    int i, j, power, quarter;
+
+    for (i = 0; i < pitch_framesize; i++) {
+        const double window = -0.5 * SDL_cos(2.0 * M_PI * ((double) i) / ((double) pitch_framesize)) + 0.5;
+        int digits = i;
+        int reversed = 0;
+        for (j = 0; j < pitch_fft_passes; j++) {
+            reversed = (reversed << 2) | (digits & 3);
+            digits >>= 2;
+        }
+        pitch_tables.window[i] = (ALfloat) window;
+        pitch_tables.synthesis_window[i] = (ALfloat) (window * synthesis_scale);
+        pitch_tables.digitrev[i] = (Uint16) reversed;
+    }
+
+    /* each pass combines four quarter-length transforms, and twiddles the last three of them. */
+    for (quarter = 4; quarter < pitch_framesize; quarter *= 4) {
+        for (power = 1; power <= 3; power++) {
+            for (j = 0; j < quarter; j++) {
+                const double arg = (-2.0 * M_PI * ((double) (power * j))) / ((double) (quarter * 4));
+                twiddles[j] = (ALfloat) SDL_cos(arg);
+                twiddles[quarter + j] = (ALfloat) SDL_sin(arg);
             }
-            ctx->playlist = i->source;
+            twiddles += quarter * 2;
         }
     }
 
-    /* put these objects back in the pool for reuse */
-    do {
-        todoend->next = i = (SourcePlayTodo *) ctx->device->playback.source_todo_pool;
-    } while (!SDL_AtomicCASPtr(&ctx->device->playback.source_todo_pool, i, todo));
+    SDL_assert(twiddles == (pitch_tables.twiddles + SDL_arraysize(pitch_tables.twiddles)));
+    pitch_tables_ready = AL_TRUE;
 }
 
-static void mix_context(ALCcontext *ctx, float *stream, int len)
+#define PITCH_TWO_PI ((float) (2.0 * M_PI))
+#define PITCH_INV_TWO_PI ((float) (1.0 / (2.0 * M_PI)))
+#define PITCH_ROUND_MAGIC FASTMATH_ROUND_MAGIC
+
+/* map a phase into the +/- pi interval. */
+static float pitch_wrap_phase(const float phase)
 {
-    const ALboolean force_recalc = ctx->recalc;
-    ALsource *next = NULL;
-    ALsource *prev = NULL;
-    ALsource *i;
+    return phase - (PITCH_TWO_PI * SDL_floorf((phase * PITCH_INV_TWO_PI) + 0.5f));
+}
 
-    if (force_recalc) {
-        SDL_MemoryBarrierAcquire();
-        ctx->recalc = AL_FALSE;
-    }
+/* analysis for bins [start, end), see pitch_analysis() */
+static void pitch_analysis_scalar(PitchState *state, const int start, const int end, const float freqPerBin)
+{
+    const float expct = PITCH_TWO_PI / pitch_osamp;  /* expected phase difference between frames, per bin. */
+    int k;
+    for (k = start; k < end; k++) {
+        const float real = state->fftreal[k];
+        const float imag = state->fftimag[k];
+        const float phase = state->fast_math ? fastmath_atan2f(imag, real) : SDL_atan2f(imag, real);
 
-    migrate_playlist_requests(ctx);
+        /* compute phase difference, and subtract the expected phase difference */
+        const float tmp = pitch_wrap_phase((phase - state->lastphase[k]) - (((float) k) * expct));
+        state->lastphase[k] = phase;
 
-    for (i = ctx->playlist; i != NULL; i = next) {
-        next = i->playlist_next;  /* save this to a local in case we leave the list. */
+        /* store magnitude and the k-th partial's true frequency */
+        state->fftreal[k] = 2.0f * SDL_sqrtf((real * real) + (imag * imag));
+        state->fftimag[k] = (((float) k) + (tmp * (pitch_osamp * PITCH_INV_TWO_PI))) * freqPerBin;
+    }
+}
 
-        SDL_LockMutex(ctx->source_lock);
-        if (!mix_source(ctx, i, stream, len, force_recalc)) {
-            /* take it out of the playlist. It wasn't actually playing or it just finished. */
-            i->playlist_next = NULL;
-            if (next == NULL) {
-                SDL_assert(i == ctx->playlist_tail);
-                ctx->playlist_tail = prev;
-            }
-            if (prev) {
-                prev->playlist_next = next;
-            } else {
-                SDL_assert(i == ctx->playlist);
-                ctx->playlist = next;
-            }
-            SDL_AtomicSet(&i->mixer_accessible, 0);
+/* synthesis for bins [start, end), see pitch_synthesis() */
+static void pitch_synthesis_scalar(PitchState *state, const int start, const int end, const float freqPerBin)
+{
+    /* the bin's deviation from its mid frequency and the expected phase advance cancel out, leaving just this. */
+    const float phasescale = PITCH_TWO_PI / (pitch_osamp * freqPerBin);
+    int k;
+    for (k = start; k < end; k++) {
+        const float magn = state->synmagn[k];
+        const float phase = pitch_wrap_phase(state->sumphase[k] + (state->synfreq[k] * phasescale));
+        const int index = pitch_tables.digitrev[k];
+        float sinval, cosval;
+        state->sumphase[k] = phase;
+        if (state->fast_math) {
+            fastmath_sincosf(phase, &sinval, &cosval);
         } else {
-            prev = i;
+            sinval = SDL_sinf(phase);
+            cosval = SDL_cosf(phase);
         }
-        SDL_UnlockMutex(ctx->source_lock);
+        state->fftreal[index] = magn * cosval;
+        state->fftimag[index] = -(magn * sinval);  /* conjugated, see pitch_shift(). */
     }
 }
 
-/* Disconnected devices move all PLAYING sources to STOPPED, making their buffer queues processed. */
-static void mix_disconnected_context(ALCcontext *ctx)
-{
-    ALsource *next = NULL;
-    ALsource *i;
+#if NEED_SCALAR_FALLBACK
+static void pitch_fft_scalar(ALfloat * restrict re, ALfloat * restrict im)
+{
+    const ALfloat *twiddles = pitch_tables.twiddles;
+    int quarter, i, j;
+
+    /* the first pass doesn't need any twiddles. */
+    for (i = 0; i < pitch_framesize; i += 4) {
+        const float t0r = re[i] + re[i+2], t0i = im[i] + im[i+2];
+        const float t1r = re[i] - re[i+2], t1i = im[i] - im[i+2];
+        const float t2r = re[i+1] + re[i+3], t2i = im[i+1] + im[i+3];
+        const float t3r = re[i+1] - re[i+3], t3i = im[i+1] - im[i+3];
+        re[i] = t0r + t2r; im[i] = t0i + t2i;
+        re[i+1] = t1r + t3i; im[i+1] = t1i - t3r;
+        re[i+2] = t0r - t2r; im[i+2] = t0i - t2i;
+        re[i+3] = t1r - t3i; im[i+3] = t1i + t3r;
+    }
+
+    for (quarter = 4; quarter < pitch_framesize; quarter *= 4) {
+        for (i = 0; i < pitch_framesize; i += quarter * 4) {
+            ALfloat *r0 = re + i, *r1 = r0 + quarter, *r2 = r1 + quarter, *r3 = r2 + quarter;
+            ALfloat *i0 = im + i, *i1 = i0 + quarter, *i2 = i1 + quarter, *i3 = i2 + quarter;
+            for (j = 0; j < quarter; j++) {
+                const float w1r = twiddles[j], w1i = twiddles[quarter + j];
+                const float w2r = twiddles[(quarter * 2) + j], w2i = twiddles[(quarter * 3) + j];
+                const float w3r = twiddles[(quarter * 4) + j], w3i = twiddles[(quarter * 5) + j];
+                const float br = (r1[j] * w1r) - (i1[j] * w1i), bi = (r1[j] * w1i) + (i1[j] * w1r);
+                const float cr = (r2[j] * w2r) - (i2[j] * w2i), ci = (r2[j] * w2i) + (i2[j] * w2r);
+                const float dr = (r3[j] * w3r) - (i3[j] * w3i), di = (r3[j] * w3i) + (i3[j] * w3r);
+                const float t0r = r0[j] + cr, t0i = i0[j] + ci;
+                const float t1r = r0[j] - cr, t1i = i0[j] - ci;
+                const float t2r = br + dr, t2i = bi + di;
+                const float t3r = br - dr, t3i = bi - di;
+                r0[j] = t0r + t2r; i0[j] = t0i + t2i;
+                r1[j] = t1r + t3i; i1[j] = t1i - t3r;
+                r2[j] = t0r - t2r; i2[j] = t0i - t2i;
+                r3[j] = t1r - t3i; i3[j] = t1i + t3r;
+            }
+        }
+        twiddles += quarter * 6;
+    }
+}
+#endif
 
-    migrate_playlist_requests(ctx);
+#ifdef __SSE__
+static void pitch_fft_sse(ALfloat * restrict re, ALfloat * restrict im)
+{
+    const ALfloat *twiddles = pitch_tables.twiddles;
+    int quarter, i, j;
+
+    /* the first pass doesn't need any twiddles; transpose four butterflies at a time so each vector holds one leg of them. */
+    for (i = 0; i < pitch_framesize; i += 16) {
+        __m128 ar = _mm_load_ps(re+i), br = _mm_load_ps(re+i+4), cr = _mm_load_ps(re+i+8), dr = _mm_load_ps(re+i+12);
+        __m128 ai = _mm_load_ps(im+i), bi = _mm_load_ps(im+i+4), ci = _mm_load_ps(im+i+8), di = _mm_load_ps(im+i+12);
+        _MM_TRANSPOSE4_PS(ar, br, cr, dr);
+        _MM_TRANSPOSE4_PS(ai, bi, ci, di);
+        {
+            const __m128 t0r = _mm_add_ps(ar, cr), t0i = _mm_add_ps(ai, ci);
+            const __m128 t1r = _mm_sub_ps(ar, cr), t1i = _mm_sub_ps(ai, ci);
+            const __m128 t2r = _mm_add_ps(br, dr), t2i = _mm_add_ps(bi, di);
+            const __m128 t3r = _mm_sub_ps(br, dr), t3i = _mm_sub_ps(bi, di);
+            ar = _mm_add_ps(t0r, t2r); ai = _mm_add_ps(t0i, t2i);
+            br = _mm_add_ps(t1r, t3i); bi = _mm_sub_ps(t1i, t3r);
+            cr = _mm_sub_ps(t0r, t2r); ci = _mm_sub_ps(t0i, t2i);
+            dr = _mm_sub_ps(t1r, t3i); di = _mm_add_ps(t1i, t3r);
+        }
+        _MM_TRANSPOSE4_PS(ar, br, cr, dr);
+        _MM_TRANSPOSE4_PS(ai, bi, ci, di);
+        _mm_store_ps(re+i, ar); _mm_store_ps(re+i+4, br); _mm_store_ps(re+i+8, cr); _mm_store_ps(re+i+12, dr);
+        _mm_store_ps(im+i, ai); _mm_store_ps(im+i+4, bi); _mm_store_ps(im+i+8, ci); _mm_store_ps(im+i+12, di);
+    }
+
+    for (quarter = 4; quarter < pitch_framesize; quarter *= 4) {
+        for (i = 0; i < pitch_framesize; i += quarter * 4) {
+            ALfloat *r0 = re + i, *r1 = r0 + quarter, *r2 = r1 + quarter, *r3 = r2 + quarter;
+            ALfloat *i0 = im + i, *i1 = i0 + quarter, *i2 = i1 + quarter, *i3 = i2 + quarter;
+            for (j = 0; j < quarter; j += 4) {
+                const __m128 w1r = _mm_load_ps(twiddles + j), w1i = _mm_load_ps(twiddles + quarter + j);
+                const __m128 w2r = _mm_load_ps(twiddles + (quarter * 2) + j), w2i = _mm_load_ps(twiddles + (quarter * 3) + j);
+                const __m128 w3r = _mm_load_ps(twiddles + (quarter * 4) + j), w3i = _mm_load_ps(twiddles + (quarter * 5) + j);
+                const __m128 ar = _mm_load_ps(r0 + j), ai = _mm_load_ps(i0 + j);
+                const __m128 xbr = _mm_load_ps(r1 + j), xbi = _mm_load_ps(i1 + j);
+                const __m128 xcr = _mm_load_ps(r2 + j), xci = _mm_load_ps(i2 + j);
+                const __m128 xdr = _mm_load_ps(r3 + j), xdi = _mm_load_ps(i3 + j);
+                const __m128 br = _mm_sub_ps(_mm_mul_ps(xbr, w1r), _mm_mul_ps(xbi, w1i)), bi = _mm_add_ps(_mm_mul_ps(xbr, w1i), _mm_mul_ps(xbi, w1r));
+                const __m128 cr = _mm_sub_ps(_mm_mul_ps(xcr, w2r), _mm_mul_ps(xci, w2i)), ci = _mm_add_ps(_mm_mul_ps(xcr, w2i), _mm_mul_ps(xci, w2r));
+                const __m128 dr = _mm_sub_ps(_mm_mul_ps(xdr, w3r), _mm_mul_ps(xdi, w3i)), di = _mm_add_ps(_mm_mul_ps(xdr, w3i), _mm_mul_ps(xdi, w3r));
+                const __m128 t0r = _mm_add_ps(ar, cr), t0i = _mm_add_ps(ai, ci);
+                const __m128 t1r = _mm_sub_ps(ar, cr), t1i = _mm_sub_ps(ai, ci);
+                const __m128 t2r = _mm_add_ps(br, dr), t2i = _mm_add_ps(bi, di);
+                const __m128 t3r = _mm_sub_ps(br, dr), t3i = _mm_sub_ps(bi, di);
+                _mm_store_ps(r0 + j, _mm_add_ps(t0r, t2r)); _mm_store_ps(i0 + j, _mm_add_ps(t0i, t2i));
+                _mm_store_ps(r1 + j, _mm_add_ps(t1r, t3i)); _mm_store_ps(i1 + j, _mm_sub_ps(t1i, t3r));
+                _mm_store_ps(r2 + j, _mm_sub_ps(t0r, t2r)); _mm_store_ps(i2 + j, _mm_sub_ps(t0i, t2i));
+                _mm_store_ps(r3 + j, _mm_sub_ps(t1r, t3i)); _mm_store_ps(i3 + j, _mm_add_ps(t1i, t3r));
+            }
+        }
+        twiddles += quarter * 6;
+    }
+}
 
-    for (i = ctx->playlist; i != NULL; i = next) {
-        next = i->playlist_next;
+static __m128 pitch_wrap_phase_sse(const __m128 phase)
+{
+    const __m128 magic = _mm_set1_ps(PITCH_ROUND_MAGIC);
+    const __m128 turns = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(phase, _mm_set1_ps(PITCH_INV_TWO_PI)), magic), magic);
+    return _mm_sub_ps(phase, _mm_mul_ps(turns, _mm_set1_ps(PITCH_TWO_PI)));
+}
 
-        SDL_LockMutex(ctx->source_lock);
-        /* remove from playlist; all playing things got stopped, paused/initial/stopped shouldn't be listed. */
-        if (SDL_AtomicGet(&i->state) == AL_PLAYING) {
-            SDL_assert(i->allocated);
-            SDL_AtomicSet(&i->state, AL_STOPPED);
-            source_mark_all_buffers_processed(i);
-        }
+static void pitch_analysis_sse(PitchState *state, const float freqPerBin)
+{
+    const __m128 vexpct = _mm_set1_ps(PITCH_TWO_PI / pitch_osamp);
+    const __m128 vdevscale = _mm_set1_ps(pitch_osamp * PITCH_INV_TWO_PI);
+    const __m128 vfreqPerBin = _mm_set1_ps(freqPerBin);
+    const __m128 vtwo = _mm_set1_ps(2.0f);
+    __m128 vk = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    int k;
 
-        i->playlist_next = NULL;
-        SDL_AtomicSet(&i->mixer_accessible, 0);
-        SDL_UnlockMutex(ctx->source_lock);
+    for (k = 0; k < pitch_framesize2; k += 4) {
+        const __m128 real = _mm_load_ps(state->fftreal + k);
+        const __m128 imag = _mm_load_ps(state->fftimag + k);
+        const __m128 phase = fastmath_atan2_sse(imag, real);
+        const __m128 tmp = pitch_wrap_phase_sse(_mm_sub_ps(_mm_sub_ps(phase, _mm_load_ps(state->lastphase + k)), _mm_mul_ps(vk, vexpct)));
+        _mm_store_ps(state->lastphase + k, phase);
+        _mm_store_ps(state->fftreal + k, _mm_mul_ps(vtwo, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(real, real), _mm_mul_ps(imag, imag)))));
+        _mm_store_ps(state->fftimag + k, _mm_mul_ps(_mm_add_ps(vk, _mm_mul_ps(tmp, vdevscale)), vfreqPerBin));
+        vk = _mm_add_ps(vk, _mm_set1_ps(4.0f));
     }
-    ctx->playlist = NULL;
-    ctx->playlist_tail = NULL;
+
+    pitch_analysis_scalar(state, pitch_framesize2, pitch_framesize2 + 1, freqPerBin);
 }
 
-/* We process all unsuspended ALC contexts during this call, mixing their
-   output to (stream). SDL then plays this mixed audio to the hardware. */
-static void SDLCALL playback_device_callback(void *userdata, Uint8 *stream, int len)
+static void pitch_synthesis_sse(PitchState *state, const float freqPerBin)
 {
-    ALCdevice *device = (ALCdevice *) userdata;
-    ALCcontext *ctx;
-    ALCboolean connected = ALC_FALSE;
+    const __m128 signmask = _mm_set1_ps(-0.0f);
+    const __m128 vphasescale = _mm_set1_ps(PITCH_TWO_PI / (pitch_osamp * freqPerBin));
+    float outreal[4];
+    float outimag[4];
+    int k, i;
 
-    SDL_memset(stream, '\0', len);
-
-    if (SDL_AtomicGet(&device->connected)) {
-        if (SDL_GetAudioDeviceStatus(device->sdldevice) == SDL_AUDIO_STOPPED) {
-            SDL_AtomicSet(&device->connected, ALC_FALSE);
-        } else {
-            connected = ALC_TRUE;
+    for (k = 0; k < pitch_framesize2; k += 4) {
+        const __m128 magn = _mm_load_ps(state->synmagn + k);
+        const __m128 phase = pitch_wrap_phase_sse(_mm_add_ps(_mm_load_ps(state->sumphase + k), _mm_mul_ps(_mm_load_ps(state->synfreq + k), vphasescale)));
+        __m128 sinval, cosval;
+        fastmath_sincos_sse(phase, &sinval, &cosval);
+        _mm_store_ps(state->sumphase + k, phase);
+        _mm_storeu_ps(outreal, _mm_mul_ps(magn, cosval));
+        _mm_storeu_ps(outimag, _mm_xor_ps(_mm_mul_ps(magn, sinval), signmask));  /* conjugated, see pitch_shift(). */
+        for (i = 0; i < 4; i++) {
+            const int index = pitch_tables.digitrev[k + i];
+            state->fftreal[index] = outreal[i];
+            state->fftimag[index] = outimag[i];
         }
     }
 
-    for (ctx = device->playback.contexts; ctx != NULL; ctx = ctx->next) {
-        if (SDL_AtomicGet(&ctx->processing)) {
-            if (connected) {
-                mix_context(ctx, (float *) stream, len);
-            } else {
-                mix_disconnected_context(ctx);
+    pitch_synthesis_scalar(state, pitch_framesize2, pitch_framesize2 + 1, freqPerBin);
+}
+#endif
+
+#ifdef __ARM_NEON__
+static void pitch_fft_neon(ALfloat * restrict re, ALfloat * restrict im)
+{
+    const ALfloat *twiddles = pitch_tables.twiddles;
+    int quarter, i, j;
+
+    /* the first pass doesn't need any twiddles; vld4 splits four butterflies at a time so each vector holds one leg of them. */
+    for (i = 0; i < pitch_framesize; i += 16) {
+        float32x4x4_t vr = vld4q_f32(re + i);
+        float32x4x4_t vi = vld4q_f32(im + i);
+        const float32x4_t t0r = vaddq_f32(vr.val[0], vr.val[2]), t0i = vaddq_f32(vi.val[0], vi.val[2]);
+        const float32x4_t t1r = vsubq_f32(vr.val[0], vr.val[2]), t1i = vsubq_f32(vi.val[0], vi.val[2]);
+        const float32x4_t t2r = vaddq_f32(vr.val[1], vr.val[3]), t2i = vaddq_f32(vi.val[1], vi.val[3]);
+        const float32x4_t t3r = vsubq_f32(vr.val[1], vr.val[3]), t3i = vsubq_f32(vi.val[1], vi.val[3]);
+        vr.val[0] = vaddq_f32(t0r, t2r); vi.val[0] = vaddq_f32(t0i, t2i);
+        vr.val[1] = vaddq_f32(t1r, t3i); vi.val[1] = vsubq_f32(t1i, t3r);
+        vr.val[2] = vsubq_f32(t0r, t2r); vi.val[2] = vsubq_f32(t0i, t2i);
+        vr.val[3] = vsubq_f32(t1r, t3i); vi.val[3] = vaddq_f32(t1i, t3r);
+        vst4q_f32(re + i, vr);
+        vst4q_f32(im + i, vi);
+    }
+
+    for (quarter = 4; quarter < pitch_framesize; quarter *= 4) {
+        for (i = 0; i < pitch_framesize; i += quarter * 4) {
+            ALfloat *r0 = re + i, *r1 = r0 + quarter, *r2 = r1 + quarter, *r3 = r2 + quarter;
+            ALfloat *i0 = im + i, *i1 = i0 + quarter, *i2 = i1 + quarter, *i3 = i2 + quarter;
+            for (j = 0; j < quarter; j += 4) {
+                const float32x4_t w1r = vld1q_f32(twiddles + j), w1i = vld1q_f32(twiddles + quarter + j);
+                const float32x4_t w2r = vld1q_f32(twiddles + (quarter * 2) + j), w2i = vld1q_f32(twiddles + (quarter * 3) + j);
+                const float32x4_t w3r = vld1q_f32(twiddles + (quarter * 4) + j), w3i = vld1q_f32(twiddles + (quarter * 5) + j);
+                const float32x4_t ar = vld1q_f32(r0 + j), ai = vld1q_f32(i0 + j);
+                const float32x4_t xbr = vld1q_f32(r1 + j), xbi = vld1q_f32(i1 + j);
+                const float32x4_t xcr = vld1q_f32(r2 + j), xci = vld1q_f32(i2 + j);
+                const float32x4_t xdr = vld1q_f32(r3 + j), xdi = vld1q_f32(i3 + j);
+                const float32x4_t br = vmlsq_f32(vmulq_f32(xbr, w1r), xbi, w1i), bi = vmlaq_f32(vmulq_f32(xbr, w1i), xbi, w1r);
+                const float32x4_t cr = vmlsq_f32(vmulq_f32(xcr, w2r), xci, w2i), ci = vmlaq_f32(vmulq_f32(xcr, w2i), xci, w2r);
+                const float32x4_t dr = vmlsq_f32(vmulq_f32(xdr, w3r), xdi, w3i), di = vmlaq_f32(vmulq_f32(xdr, w3i), xdi, w3r);
+                const float32x4_t t0r = vaddq_f32(ar, cr), t0i = vaddq_f32(ai, ci);
+                const float32x4_t t1r = vsubq_f32(ar, cr), t1i = vsubq_f32(ai, ci);
+                const float32x4_t t2r = vaddq_f32(br, dr), t2i = vaddq_f32(bi, di);
+                const float32x4_t t3r = vsubq_f32(br, dr), t3i = vsubq_f32(bi, di);
+                vst1q_f32(r0 + j, vaddq_f32(t0r, t2r)); vst1q_f32(i0 + j, vaddq_f32(t0i, t2i));
+                vst1q_f32(r1 + j, vaddq_f32(t1r, t3i)); vst1q_f32(i1 + j, vsubq_f32(t1i, t3r));
+                vst1q_f32(r2 + j, vsubq_f32(t0r, t2r)); vst1q_f32(i2 + j, vsubq_f32(t0i, t2i));
+                vst1q_f32(r3 + j, vsubq_f32(t1r, t3i)); vst1q_f32(i3 + j, vaddq_f32(t1i, t3r));
             }
         }
+        twiddles += quarter * 6;
     }
 }
 
-static ALCcontext *_alcCreateContext(ALCdevice *device, const ALCint* attrlist)
+static float32x4_t pitch_wrap_phase_neon(const float32x4_t phase)
 {
-    ALCcontext *retval = NULL;
-    ALCsizei attrcount = 0;
-    ALCint freq = 48000;
-    ALCboolean sync = ALC_FALSE;
-    ALCint refresh = 100;
-    /* we don't care about ALC_MONO_SOURCES or ALC_STEREO_SOURCES as we have no hardware limitation. */
+    const float32x4_t magic = vdupq_n_f32(PITCH_ROUND_MAGIC);
+    const float32x4_t turns = vsubq_f32(vaddq_f32(vmulq_n_f32(phase, PITCH_INV_TWO_PI), magic), magic);
+    return vmlsq_f32(phase, turns, vdupq_n_f32(PITCH_TWO_PI));
+}
 
-    if (!device) {
-        set_alc_error(NULL, ALC_INVALID_DEVICE);
-        return NULL;
-    }
+static void pitch_analysis_neon(PitchState *state, const float freqPerBin)
+{
+    const float32x4_t vexpct = vdupq_n_f32(PITCH_TWO_PI / pitch_osamp);
+    const float32x4_t vdevscale = vdupq_n_f32(pitch_osamp * PITCH_INV_TWO_PI);
+    const float32x4_t vfour = vdupq_n_f32(4.0f);
+    const float32x4_t vinitialk = { 0.0f, 1.0f, 2.0f, 3.0f };
+    float32x4_t vk = vinitialk;
+    int k;
 
-    if (!SDL_AtomicGet(&device->connected)) {
-        set_alc_error(device, ALC_INVALID_DEVICE);
-        return NULL;
+    for (k = 0; k < pitch_framesize2; k += 4) {
+        const float32x4_t real = vld1q_f32(state->fftreal + k);
+        const float32x4_t imag = vld1q_f32(state->fftimag + k);
+        const float32x4_t phase = fastmath_atan2_neon(imag, real);
+        const float32x4_t tmp = pitch_wrap_phase_neon(vmlsq_f32(vsubq_f32(phase, vld1q_f32(state->lastphase + k)), vk, vexpct));
+        vst1q_f32(state->lastphase + k, phase);
+        vst1q_f32(state->fftreal + k, vmulq_n_f32(fastmath_sqrt_neon(vmlaq_f32(vmulq_f32(real, real), imag, imag)), 2.0f));
+        vst1q_f32(state->fftimag + k, vmulq_n_f32(vmlaq_f32(vk, tmp, vdevscale), freqPerBin));
+        vk = vaddq_f32(vk, vfour);
     }
 
-    if (attrlist != NULL) {
-        ALCint attr;
-        while ((attr = attrlist[attrcount++]) != 0) {
-            switch (attr) {
-                case ALC_FREQUENCY: freq = attrlist[attrcount++]; break;
-                case ALC_REFRESH: refresh = attrlist[attrcount++]; break;
-                case ALC_SYNC: sync = (attrlist[attrcount++] ? ALC_TRUE : ALC_FALSE); break;
-                default: FIXME("fail for unknown attributes?"); break;
-            }
+    pitch_analysis_scalar(state, pitch_framesize2, pitch_framesize2 + 1, freqPerBin);
+}
+
+static void pitch_synthesis_neon(PitchState *state, const float freqPerBin)
+{
+    const float32x4_t vphasescale = vdupq_n_f32(PITCH_TWO_PI / (pitch_osamp * freqPerBin));
+    float outreal[4];
+    float outimag[4];
+    int k, i;
+
+    for (k = 0; k < pitch_framesize2; k += 4) {
+        const float32x4_t magn = vld1q_f32(state->synmagn + k);
+        const float32x4_t phase = pitch_wrap_phase_neon(vmlaq_f32(vld1q_f32(state->sumphase + k), vld1q_f32(state->synfreq + k), vphasescale));
+        float32x4_t sinval, cosval;
+        fastmath_sincos_neon(phase, &sinval, &cosval);
+        vst1q_f32(state->sumphase + k, phase);
+        vst1q_f32(outreal, vmulq_f32(magn, cosval));
+        vst1q_f32(outimag, vnegq_f32(vmulq_f32(magn, sinval)));  /* conjugated, see pitch_shift(). */
+        for (i = 0; i < 4; i++) {
+            const int index = pitch_tables.digitrev[k + i];
+            state->fftreal[index] = outreal[i];
+            state->fftimag[index] = outimag[i];
         }
     }
 
-    FIXME("use these variables at some point"); (void) refresh; (void) sync;
+    pitch_synthesis_scalar(state, pitch_framesize2, pitch_framesize2 + 1, freqPerBin);
+}
+#endif
 
-    retval = (ALCcontext *) calloc_simd_aligned(sizeof (ALCcontext));
-    if (!retval) {
-        set_alc_error(device, ALC_OUT_OF_MEMORY);
-        return NULL;
+/* forward FFT, in place, on split real/imaginary arrays that are already in digit-reversed order. */
+static void pitch_fft(ALfloat * restrict re, ALfloat * restrict im)
+{
+    #ifdef __SSE__
+    if (has_sse) {
+        pitch_fft_sse(re, im);
+    } else
+    #elif defined(__ARM_NEON__)
+    if (has_neon) {
+        pitch_fft_neon(re, im);
+    } else
+    #endif
+    {
+    #if NEED_SCALAR_FALLBACK
+        pitch_fft_scalar(re, im);
+    #endif
     }
+}
 
-    /* Make sure everything that wants to use SIMD is aligned for it. */
-    SDL_assert( (((size_t) &retval->listener.position[0]) % 16) == 0 );
-    SDL_assert( (((size_t) &retval->listener.orientation[0]) % 16) == 0 );
-    SDL_assert( (((size_t) &retval->listener.velocity[0]) % 16) == 0 );
-
-    retval->source_lock = SDL_CreateMutex();
-    if (!retval->source_lock) {
-        set_alc_error(device, ALC_OUT_OF_MEMORY);
-        free_simd_aligned(retval);
-        return NULL;
+/* turns FFT output in fftreal/fftimag into magnitudes (in fftreal) and true frequencies (in fftimag). */
+static void pitch_analysis(PitchState *state, const float freqPerBin)
+{
+    #ifdef __SSE__
+    if (has_sse && state->fast_math) {
+        pitch_analysis_sse(state, freqPerBin);
+    } else
+    #elif defined(__ARM_NEON__)
+    if (has_neon && state->fast_math) {
+        pitch_analysis_neon(state, freqPerBin);
+    } else
+    #endif
+    {
+        pitch_analysis_scalar(state, 0, pitch_framesize2 + 1, freqPerBin);
     }
+}
 
-    retval->attributes = (ALCint *) SDL_malloc(attrcount * sizeof (ALCint));
-    if (!retval->attributes) {
-        set_alc_error(device, ALC_OUT_OF_MEMORY);
-        SDL_DestroyMutex(retval->source_lock);
-        free_simd_aligned(retval);
-        return NULL;
+/* turns synmagn/synfreq into bins for the next FFT, already in digit-reversed order. */
+static void pitch_synthesis(PitchState *state, const float freqPerBin)
+{
+    #ifdef __SSE__
+    if (has_sse && state->fast_math) {
+        pitch_synthesis_sse(state, freqPerBin);
+    } else
+    #elif defined(__ARM_NEON__)
+    if (has_neon && state->fast_math) {
+        pitch_synthesis_neon(state, freqPerBin);
+    } else
+    #endif
+    {
+        pitch_synthesis_scalar(state, 0, pitch_framesize2 + 1, freqPerBin);
     }
-    SDL_memcpy(retval->attributes, attrlist, attrcount * sizeof (ALCint));
-    retval->attributes_count = attrcount;
+}
 
-    if (!device->sdldevice) {
-        SDL_AudioSpec desired;
-        const char *devicename = device->name;
+/* window the synthesized frame and add it to the output accumulator. */
+static void pitch_overlap_add(PitchState *state)
+{
+    const ALfloat *window = pitch_tables.synthesis_window;
+    int k = 0;
 
-        if (SDL_strcmp(devicename, DEFAULT_PLAYBACK_DEVICE) == 0) {
-            devicename = NULL;  /* tell SDL we want the best default */
+    #ifdef __SSE__
+    if (has_sse) {
+        for (; k < pitch_framesize; k += 4) {
+            _mm_store_ps(state->outputaccum + k, _mm_add_ps(_mm_load_ps(state->outputaccum + k), _mm_mul_ps(_mm_load_ps(window + k), _mm_load_ps(state->fftreal + k))));
         }
-
-        /* we always want to work in float32, to keep our work simple and
-           let us use SIMD, and we'll let SDL convert when feeding the device. */
-        SDL_zero(desired);
-        desired.freq = freq;
-        desired.format = AUDIO_F32SYS;
-        desired.channels = 2;  FIXME("don't force channels?");
-        desired.samples = 1024;  FIXME("base this on refresh");
-        desired.callback = playback_device_callback;
-        desired.userdata = device;
-        device->sdldevice = SDL_OpenAudioDevice(devicename, 0, &desired, NULL, 0);
-        if (!device->sdldevice) {
-            SDL_DestroyMutex(retval->source_lock);
-            SDL_free(retval->attributes);
-            free_simd_aligned(retval);
-            FIXME("What error do you set for this?");
-            return NULL;
+    }
+    #elif defined(__ARM_NEON__)
+    if (has_neon) {
+        for (; k < pitch_framesize; k += 4) {
+            vst1q_f32(state->outputaccum + k, vmlaq_f32(vld1q_f32(state->outputaccum + k), vld1q_f32(window + k), vld1q_f32(state->fftreal + k)));
         }
-        device->channels = 2;
-        device->frequency = freq;
-        device->framesize = sizeof (float) * device->channels;
-        SDL_PauseAudioDevice(device->sdldevice, 0);
     }
+    #endif
 
-    retval->distance_model = AL_INVERSE_DISTANCE_CLAMPED;
-    retval->doppler_factor = 1.0f;
-    retval->doppler_velocity = 1.0f;
-    retval->speed_of_sound = 343.3f;
-    retval->listener.gain = 1.0f;
-    retval->listener.orientation[2] = -1.0f;
-    retval->listener.orientation[5] = 1.0f;
-    retval->device = device;
-    context_needs_recalc(retval);
-    SDL_AtomicSet(&retval->processing, 1);  /* contexts default to processing */
-
-    SDL_LockAudioDevice(device->sdldevice);
-    if (device->playback.contexts != NULL) {
-        SDL_assert(device->playback.contexts->prev == NULL);
-        device->playback.contexts->prev = retval;
+    for (; k < pitch_framesize; k++) {
+        state->outputaccum[k] += window[k] * state->fftreal[k];
     }
-    retval->next = device->playback.contexts;
-    device->playback.contexts = retval;
-    SDL_UnlockAudioDevice(device->sdldevice);
+}
 
-    return retval;
+static void pitch_shift(ALsource *src, const ALbuffer *buffer, int numSampsToProcess, const float *indata, float *outdata)
+{
+    const float pitchShift = src->mixer_pitch;
+    const float freqPerBin = ((float) buffer->frequency) / ((float) pitch_framesize);
+    const int inFifoLatency = pitch_framesize - pitch_stepsize;
+    PitchState *state = src->pitchstate;
+    int k;
+
+    SDL_assert(state != NULL);
+    SDL_assert(pitch_tables_ready);
+
+    if (state->rover == 0) state->rover = inFifoLatency;
+
+    /* main processing loop */
+    while (numSampsToProcess > 0) {
+        /* As long as we have not yet collected enough data just read in */
+        const int cpy = SDL_min(numSampsToProcess, pitch_framesize - state->rover);
+        SDL_memcpy(state->infifo + state->rover, indata, cpy * sizeof (float));
+        SDL_memcpy(outdata, state->outfifo + (state->rover - inFifoLatency), cpy * sizeof (float));
+        state->rover += cpy;
+        indata += cpy;
+        outdata += cpy;
+        numSampsToProcess -= cpy;
+
+        /* now we have enough data for processing */
+        if (state->rover >= pitch_framesize) {
+            state->rover = inFifoLatency;
+
+            /* do windowing, and put everything where the FFT wants it. */
+            for (k = 0; k < pitch_framesize; k++) {
+                state->fftreal[pitch_tables.digitrev[k]] = state->infifo[k] * pitch_tables.window[k];
+            }
+            SDL_memset(state->fftimag, '\0', sizeof (state->fftimag));
+
+            /* ***************** ANALYSIS ******************* */
+            pitch_fft(state->fftreal, state->fftimag);
+            pitch_analysis(state, freqPerBin);
+
+            /* ***************** PROCESSING ******************* */
+            /* this does the actual pitch shifting */
+            SDL_memset(state->synmagn, '\0', sizeof (state->synmagn));
+            for (k = 0; k <= pitch_framesize2; k++) {
+                const int index = (int) (k*pitchShift);
+                if (index <= pitch_framesize2) {
+                    state->synmagn[index] += state->fftreal[k];
+                    state->synfreq[index] = state->fftimag[k] * pitchShift;
+                }
+            }
+
+            /* ***************** SYNTHESIS ******************* */
+            /* negative frequencies stay zeroed. We only need the real part
+               of the inverse FFT, which is the same as the real part of a
+               forward FFT of the conjugate, so pitch_synthesis() conjugates
+               and we only need the one FFT. */
+            SDL_memset(state->fftreal, '\0', sizeof (state->fftreal));
+            SDL_memset(state->fftimag, '\0', sizeof (state->fftimag));
+            pitch_synthesis(state, freqPerBin);
+            pitch_fft(state->fftreal, state->fftimag);
+            pitch_overlap_add(state);
+
+            SDL_memcpy(state->outfifo, state->outputaccum, pitch_stepsize * sizeof (float));
+
+            /* shift accumulator */
+            SDL_memmove(state->outputaccum, state->outputaccum + pitch_stepsize, pitch_framesize * sizeof (float));
+
+            /* move input FIFO */
+            SDL_memmove(state->infifo, state->infifo + pitch_stepsize, inFifoLatency * sizeof (float));
+        }
+    }
 }
-ENTRYPOINT(ALCcontext *,alcCreateContext,(ALCdevice *device, const ALCint* attrlist),(device,attrlist))
 
+static ALboolean init_mix_scratch(MixScratch *scratch, const ALsizei frames)
+{
+    /* the most we need at once is mono or stereo buffer data, decoded (if compressed), resampled and then pitch-shifted. */
+    const ALsizei capacity = frames * 2 * 3;
+    scratch->buffer = (float *) calloc_simd_aligned(capacity * sizeof (float));
+    scratch->capacity = scratch->buffer ? capacity : 0;
+    scratch->used = 0;
+    return scratch->buffer ? AL_TRUE : AL_FALSE;
+}
 
-static SDL_INLINE ALCcontext *get_current_context(void)
+static void free_mix_scratch(MixScratch *scratch)
 {
-    return (ALCcontext *) SDL_AtomicGetPtr(&current_context);
+    free_simd_aligned(scratch->buffer);
+    SDL_zerop(scratch);
 }
 
-/* no api lock; it just sets an atomic pointer at the moment */
-ALCboolean alcMakeContextCurrent(ALCcontext *ctx)
+/* how many frames of (channels) floats are still available. Callers mix in
+   smaller pieces if this comes up short, but the arena is sized so it won't. */
+static ALsizei mix_scratch_frames(const MixScratch *scratch, const int channels)
 {
-    SDL_AtomicSetPtr(&current_context, ctx);
-    FIXME("any reason this might return ALC_FALSE?");
-    return ALC_TRUE;
+    return (scratch->capacity - scratch->used) / channels;
 }
 
-static void _alcProcessContext(ALCcontext *ctx)
+/* give it back by resetting scratch->used to what it was before you called this. */
+static float *mix_scratch_alloc(MixScratch *scratch, const ALsizei frames, const int channels)
 {
-    if (!ctx) {
-        set_alc_error(NULL, ALC_INVALID_CONTEXT);
-        return;
-    }
+    float *retval = scratch->buffer + scratch->used;
+    SDL_assert((frames * channels) <= (scratch->capacity - scratch->used));
+    scratch->used += frames * channels;
+    return retval;
+}
 
-    SDL_assert(!ctx->device->iscapture);
-    SDL_AtomicSet(&ctx->processing, 1);
+/* AL_PITCH normally just changes the playback rate, as the spec says, but
+   AL_MOJOAL_phase_vocoder_pitch sources run through the (expensive!) pitch
+   shifter instead, so they change pitch without changing speed. */
+static ALboolean source_uses_vocoder(const ALsource *src)
+{
+    return (src->vocoder_pitch && (src->mixer_pitch != 1.0f) && (src->pitchstate != NULL)) ? AL_TRUE : AL_FALSE;
 }
-ENTRYPOINTVOID(alcProcessContext,(ALCcontext *ctx),(ctx))
 
-static void _alcSuspendContext(ALCcontext *ctx)
+static ALboolean panning_is_silent(const ALfloat *panning, const int outchannels)
 {
-    if (!ctx) {
-        set_alc_error(NULL, ALC_INVALID_CONTEXT);
-    } else {
-        SDL_assert(!ctx->device->iscapture);
-        SDL_AtomicSet(&ctx->processing, 0);
+    int i;
+    for (i = 0; i < outchannels; i++) {
+        if (panning[i] != 0.0f) {
+            return AL_FALSE;
+        }
     }
+    return AL_TRUE;
 }
-ENTRYPOINTVOID(alcSuspendContext,(ALCcontext *ctx),(ctx))
 
-static void _alcDestroyContext(ALCcontext *ctx)
+/* converts (frames) sample frames of buffer data in (format) to float32, the same way SDL_ConvertAudio would have at alBufferData time. */
+static void convert_to_float32(const SDL_AudioFormat format, const int channels, const void * restrict data, float * restrict outdata, const ALsizei frames)
 {
-    ALsizei blocki;
+    const int samples = frames * channels;
+    int i;
 
-    FIXME("Should NULL context be an error?");
-    if (!ctx) return;
+    switch (format) {
+        case AUDIO_S16SYS: {
+            const Sint16 *src = (const Sint16 *) data;
+            for (i = 0; i < samples; i++) {
+                outdata[i] = ((float) src[i]) * SINT16_TO_FLOAT32;
+            }
+            break;
+        }
 
-    /* The spec says it's illegal to delete the current context. */
-    if (get_current_context() == ctx) {
-        set_alc_error(ctx->device, ALC_INVALID_CONTEXT);
-        return;
+        case AUDIO_U8: {
+            const Uint8 *src = (const Uint8 *) data;
+            for (i = 0; i < samples; i++) {
+                outdata[i] = (((float) src[i]) * UINT8_TO_FLOAT32) - 1.0f;
+            }
+            break;
+        }
+
+        case MOJOAL_AUDIO_MULAW:
+            mixer_kernels.expand_table8(mulaw_table, (const Uint8 *) data, outdata, samples);
+            break;
+
+        case MOJOAL_AUDIO_ALAW:
+            mixer_kernels.expand_table8(alaw_table, (const Uint8 *) data, outdata, samples);
+            break;
+
+        default:
+            SDL_assert(format == AUDIO_F32SYS);
+            SDL_memcpy(outdata, data, samples * sizeof (float));
+            break;
     }
+}
 
-    /* do this first in case the mixer is running _right now_. */
-    SDL_AtomicSet(&ctx->processing, 0);
+/* standard IMA ADPCM tables. */
+static const Sint16 ima4_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
 
-    SDL_LockAudioDevice(ctx->device->sdldevice);
-    if (ctx->prev) {
-        ctx->prev->next = ctx->next;
-    } else {
-        SDL_assert(ctx == ctx->device->playback.contexts);
-        ctx->device->playback.contexts = ctx->next;
+static const Sint8 ima4_index_table[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+/* each channel starts with a 4 byte header (first sample, step index, padding),
+   then every 8 frames has 4 bytes per channel, low nibble first. */
+static void decode_ima4_frame(CompressedDecoder *decoder, const Uint8 *block, const int channels)
+{
+    const ALsizei i = decoder->frame;
+    int ch;
+
+    for (ch = 0; ch < channels; ch++) {
+        if (i == 0) {
+            const Uint8 *header = block + (4 * ch);
+            decoder->sample1[ch] = (int) (Sint16) (header[0] | (header[1] << 8));
+            decoder->step[ch] = SDL_min((int) header[2], 88);
+        } else {
+            const Uint8 *bytes = block + (4 * channels) + ((((i - 1) / 8) * channels) + ch) * 4;
+            const int j = (i - 1) % 8;
+            const int nibble = (bytes[j / 2] >> ((j % 2) * 4)) & 0xF;
+            const int step = ima4_step_table[decoder->step[ch]];
+            int diff = step >> 3;
+            if (nibble & 1) { diff += step >> 2; }
+            if (nibble & 2) { diff += step >> 1; }
+            if (nibble & 4) { diff += step; }
+            decoder->sample1[ch] = SDL_clamp(decoder->sample1[ch] + ((nibble & 8) ? -diff : diff), -32768, 32767);
+            decoder->step[ch] = SDL_clamp(decoder->step[ch] + ima4_index_table[nibble], 0, 88);
+        }
+        decoder->recent[0][ch] = ((float) decoder->sample1[ch]) * SINT16_TO_FLOAT32;
+    }
+    decoder->frame++;
+}
+
+/* standard Microsoft ADPCM tables. */
+static const Sint16 msadpcm_coef1[7] = { 256, 512, 0, 192, 240, 460, 392 };
+static const Sint16 msadpcm_coef2[7] = { 0, -256, 0, 64, 0, -208, -232 };
+static const Sint16 msadpcm_adaptation[16] = { 230, 230, 230, 230, 307, 409, 512, 614, 768, 614, 512, 409, 307, 230, 230, 230 };
+
+/* the header has each channel's predictor, delta and two starting samples
+   (played oldest first), then the rest are interleaved 4 bits a sample, high nibble first. */
+static void decode_msadpcm_frame(CompressedDecoder *decoder, const Uint8 *block, const int channels)
+{
+    const ALsizei i = decoder->frame;
+    int ch;
+
+    for (ch = 0; ch < channels; ch++) {
+        int sample;
+        if (i == 0) {
+            const int predictor = SDL_min((int) block[ch], 6);
+            decoder->coef1[ch] = msadpcm_coef1[predictor];
+            decoder->coef2[ch] = msadpcm_coef2[predictor];
+            decoder->step[ch] = (int) (Uint16) (block[channels + (ch * 2)] | (block[channels + (ch * 2) + 1] << 8));
+            decoder->sample1[ch] = (int) (Sint16) (block[(channels * 3) + (ch * 2)] | (block[(channels * 3) + (ch * 2) + 1] << 8));
+            decoder->sample2[ch] = (int) (Sint16) (block[(channels * 5) + (ch * 2)] | (block[(channels * 5) + (ch * 2) + 1] << 8));
+            sample = decoder->sample2[ch];
+        } else if (i == 1) {
+            sample = decoder->sample1[ch];
+        } else {
+            const int n = ((i - 2) * channels) + ch;
+            const int nibble = (block[(7 * channels) + (n / 2)] >> ((n % 2) ? 0 : 4)) & 0xF;
+            sample = ((decoder->sample1[ch] * decoder->coef1[ch]) + (decoder->sample2[ch] * decoder->coef2[ch])) / 256;
+            sample += ((nibble & 8) ? (nibble - 16) : nibble) * decoder->step[ch];
+            sample = SDL_clamp(sample, -32768, 32767);
+            decoder->sample2[ch] = decoder->sample1[ch];
+            decoder->sample1[ch] = sample;
+            decoder->step[ch] = (int) (Uint16) SDL_max((msadpcm_adaptation[nibble] * decoder->step[ch]) / 256, 16);  /* SDL_LoadWAV keeps this 16 bits, too. */
+        }
+        decoder->recent[0][ch] = ((float) sample) * SINT16_TO_FLOAT32;
     }
-    if (ctx->next) {
-        ctx->next->prev = ctx->prev;
+    decoder->frame++;
+}
+
+#ifndef COUNT_DECODED_FRAMES
+#define COUNT_DECODED_FRAMES(decoder)  /* benchmix counts these, to catch us decoding anything twice. */
+#endif
+
+/* decode (frames) sample frames of a compressed buffer to float32, starting
+   at (frame). Every block starts over from its header, so that's how we seek,
+   but (decoder) remembers where the last call stopped, so playing straight
+   through a buffer only decodes each frame once. A resampled mix stops
+   somewhere between the last two frames it decoded and picks up from there
+   next time, so (decoder) keeps those two around, even across a block boundary. */
+static void decode_buffer_frames(CompressedDecoder *decoder, const ALbuffer *buffer, ALsizei frame, float *outdata, ALsizei frames)
+{
+    const int channels = buffer->channels;
+
+    if (decoder->buffer == buffer) {
+        const ALsizei decoded = (decoder->block * buffer->block_frames) + decoder->frame;
+        while ((frames > 0) && (frame < decoded) && (frame >= (decoded - decoder->cached))) {
+            SDL_memcpy(outdata, decoder->recent[decoded - frame - 1], channels * sizeof (float));
+            outdata += channels;
+            frame++;
+            frames--;
+        }
     }
-    SDL_UnlockAudioDevice(ctx->device->sdldevice);
 
-    for (blocki = 0; blocki < ctx->num_source_blocks; blocki++) {
-        SourceBlock *sb = ctx->source_blocks[blocki];
-        if (sb->used > 0) {
-            ALsizei i;
-            for (i = 0; i < SDL_arraysize(sb->sources); i++) {
-                ALsource *src = &sb->sources[i];
-                if (!src->allocated) {
-                    continue;
-                }
+    while (frames > 0) {
+        const ALsizei blockidx = frame / buffer->block_frames;
+        const Uint8 *block = ((const Uint8 *) buffer->data) + (blockidx * buffer->block_bytes);
+        const ALsizei first = frame % buffer->block_frames;
+        const ALsizei count = SDL_min(frames, buffer->block_frames - first);
+        ALsizei i;
 
-                SDL_FreeAudioStream(src->stream);
-                source_release_buffer_queue(ctx, src);
-                if (--sb->used == 0) {
-                    break;
-                }
+        if ((decoder->buffer != buffer) || (decoder->block != blockidx) || (decoder->frame > first)) {
+            /* start this block over from its header. What we decoded before is only still next to (frame) if we're carrying straight on from the last block. */
+            if ((decoder->buffer != buffer) || (frame != ((decoder->block * buffer->block_frames) + decoder->frame))) {
+                decoder->cached = 0;
             }
+            decoder->buffer = buffer;
+            decoder->block = blockidx;
+            decoder->frame = 0;
         }
-        free_simd_aligned(sb);
-    }
 
-    SDL_DestroyMutex(ctx->source_lock);
-    SDL_free(ctx->source_blocks);
-    SDL_free(ctx->attributes);
-    free_simd_aligned(ctx);
+        for (i = 0; i < count; i++) {
+            do {  /* skips ahead to (first) if we aren't there yet. */
+                SDL_memcpy(decoder->recent[1], decoder->recent[0], sizeof (decoder->recent[0]));
+                if (buffer->format == MOJOAL_AUDIO_IMA4) {
+                    decode_ima4_frame(decoder, block, channels);
+                } else {
+                    SDL_assert(buffer->format == MOJOAL_AUDIO_MSADPCM);
+                    decode_msadpcm_frame(decoder, block, channels);
+                }
+                decoder->cached = SDL_min(decoder->cached + 1, (int) SDL_arraysize(decoder->recent));
+                COUNT_DECODED_FRAMES(decoder);
+            } while (decoder->frame <= (first + i));
+            SDL_memcpy(outdata + (i * channels), decoder->recent[0], channels * sizeof (float));
+        }
+
+        outdata += count * channels;
+        frame += count;
+        frames -= count;
+    }
 }
-ENTRYPOINTVOID(alcDestroyContext,(ALCcontext *ctx),(ctx))
 
-/* no api lock; atomic. */
-ALCcontext *alcGetCurrentContext(void)
+/* the mixers can read float32 for any output, and mono or stereo Sint16 for stereo output. Anything else gets converted in the scratch arena first. */
+static ALboolean mixer_reads_format(const SDL_AudioFormat format, const int channels, const int outchannels)
 {
-    return get_current_context();
+    return ((format == AUDIO_F32SYS) || ((format == AUDIO_S16SYS) && (channels <= 2) && (outchannels == 2))) ? AL_TRUE : AL_FALSE;
 }
 
-/* no api lock; immutable. */
-ALCdevice *alcGetContextsDevice(ALCcontext *context)
+static void mix_buffer_kernel(const ALsource *src, const ALbuffer *buffer, const ALfloat * restrict panning, const void * restrict data, const SDL_AudioFormat format, float * restrict stream, const ALsizei mixframes, const int outchannels)
 {
-    return context ? context->device : NULL;
+    SDL_assert(mixer_reads_format(format, buffer->channels, outchannels));
+
+    if (panning_is_silent(panning, outchannels)) {
+        return;  /* don't bother mixing in silence. */
+    } else if (buffer->channels > 2) {
+        mixer_kernels.mix_float32_matrix(src->channel_matrix, (const float *) data, stream, mixframes, buffer->channels, outchannels);
+    } else if (format == AUDIO_S16SYS) {
+        if (buffer->channels == 1) {
+            mixer_kernels.mix_sint16_c1(panning, (const Sint16 *) data, stream, mixframes);
+        } else {
+            SDL_assert(buffer->channels == 2);
+            mixer_kernels.mix_sint16_c2(panning, (const Sint16 *) data, stream, mixframes);
+        }
+    } else if (outchannels != 2) {
+        if (buffer->channels == 1) {
+            mixer_kernels.mix_float32_c1_surround(panning, (const float *) data, stream, mixframes, outchannels);
+        } else {
+            SDL_assert(buffer->channels == 2);
+            mixer_kernels.mix_float32_c2_surround(panning, (const float *) data, stream, mixframes, outchannels);
+        }
+    } else if (buffer->channels == 1) {
+        mixer_kernels.mix_float32_c1(panning, (const float *) data, stream, mixframes);
+    } else {
+        SDL_assert(buffer->channels == 2);
+        mixer_kernels.mix_float32_c2(panning, (const float *) data, stream, mixframes);
+    }
+}
+
+/* (data) is in (format), which is the buffer's own format, unless we're mixing something that was already resampled into float32. */
+static void mix_buffer(MixScratch *scratch, ALsource *src, const ALbuffer *buffer, const ALfloat * restrict panning, const void * restrict data, const SDL_AudioFormat format, float * restrict stream, ALsizei mixframes, const int outchannels)
+{
+    const ALboolean vocoder = source_uses_vocoder(src);
+    const ALboolean convert = (!mixer_reads_format(format, buffer->channels, outchannels) || (vocoder && (format != AUDIO_F32SYS))) ? AL_TRUE : AL_FALSE;
+
+    if (vocoder || (convert && !panning_is_silent(panning, outchannels))) {
+        const int channels = buffer->channels;
+        const int framesize = channels * (SDL_AUDIO_BITSIZE(format) / 8);
+        const int floats_per_frame = channels * ((convert ? 1 : 0) + (vocoder ? 1 : 0));
+        const ALsizei used = scratch->used;
+        while (mixframes > 0) {
+            const ALsizei frames = SDL_min(mixframes, mix_scratch_frames(scratch, floats_per_frame));
+            const float *floatdata = (const float *) data;
+            SDL_assert(frames > 0);
+            if (convert) {
+                float *converted = mix_scratch_alloc(scratch, frames, channels);
+                convert_to_float32(format, channels, data, converted, frames);
+                floatdata = converted;
+            }
+            if (vocoder) {
+                float *pitched = mix_scratch_alloc(scratch, frames, channels);
+                pitch_shift(src, buffer, frames * channels, floatdata, pitched);
+                floatdata = pitched;
+            }
+            mix_buffer_kernel(src, buffer, panning, floatdata, AUDIO_F32SYS, stream, frames, outchannels);
+            scratch->used = used;
+            data = ((const Uint8 *) data) + (frames * framesize);
+            stream += frames * outchannels;
+            mixframes -= frames;
+        }
+    } else if (!convert) {
+        mix_buffer_kernel(src, buffer, panning, data, format, stream, mixframes, outchannels);
+    }
 }
 
-static ALCenum _alcGetError(ALCdevice *device)
+/* AL_PITCH is just a change in playback rate, and so is the Doppler effect, so they're folded into the resampling step here, too. */
+static Uint32 calculate_resample_step(const ALsizei srcfreq, const ALsizei dstfreq, const ALfloat pitch)
 {
-    ALCenum *perr = device ? &device->error : &null_device_error;
-    const ALCenum retval = *perr;
-    *perr = ALC_NO_ERROR;
-    return retval;
+    const double step = ((((double) srcfreq) * ((double) pitch)) / ((double) dstfreq)) * ((double) RESAMPLE_FRAC_ONE);
+    if (step >= (double) RESAMPLE_MAX_STEP) {
+        return RESAMPLE_MAX_STEP;
+    } else if (step < 1.0) {
+        return 1;
+    }
+    return (Uint32) (step + 0.5);
 }
-ENTRYPOINT(ALCenum,alcGetError,(ALCdevice *device),(device))
 
-/* no api lock; immutable */
-ALCboolean alcIsExtensionPresent(ALCdevice *device, const ALCchar *extname)
+/* how fast the mixer steps through (buffer) for (src) at AL_PITCH (pitch):
+   the phase vocoder does the pitch itself, and Doppler speeds it up or slows it down. */
+static Uint32 source_resample_step(const ALCcontext *ctx, const ALsource *src, const ALbuffer *buffer, const ALfloat pitch)
 {
-    #define ALC_EXTENSION_ITEM(ext) if (SDL_strcasecmp(extname, #ext) == 0) { return ALC_TRUE; }
-    ALC_EXTENSION_ITEMS
-    #undef ALC_EXTENSION_ITEM
-    return ALC_FALSE;
+    return calculate_resample_step(buffer->frequency, ctx->device->frequency, (src->vocoder_pitch ? 1.0f : pitch) * src->doppler_pitch);
 }
 
-/* no api lock; immutable */
-void *alcGetProcAddress(ALCdevice *device, const ALCchar *funcname)
+/* like the resample mixers, but just writes out unpanned frames, for the pitch shifter to chew on. */
+static ALsizei resample_float32(const int channels, const float * restrict data, float * restrict outdata, const ALsizei frames, Uint32 *_frac, const Uint32 step)
 {
-    if (!funcname) {
-        set_alc_error(device, ALC_INVALID_VALUE);
-        return NULL;
-    }
+    const float *start = data;
+    Uint32 frac = *_frac;
+    ALsizei i;
+    int j;
 
-    #define FN_TEST(fn) if (SDL_strcmp(funcname, #fn) == 0) return (void *) fn
-    FN_TEST(alcCreateContext);
-    FN_TEST(alcMakeContextCurrent);
-    FN_TEST(alcProcessContext);
-    FN_TEST(alcSuspendContext);
-    FN_TEST(alcDestroyContext);
-    FN_TEST(alcGetCurrentContext);
-    FN_TEST(alcGetContextsDevice);
-    FN_TEST(alcOpenDevice);
-    FN_TEST(alcCloseDevice);
-    FN_TEST(alcGetError);
-    FN_TEST(alcIsExtensionPresent);
-    FN_TEST(alcGetProcAddress);
-    FN_TEST(alcGetEnumValue);
-    FN_TEST(alcGetString);
-    FN_TEST(alcGetIntegerv);
-    FN_TEST(alcCaptureOpenDevice);
-    FN_TEST(alcCaptureCloseDevice);
-    FN_TEST(alcCaptureStart);
-    FN_TEST(alcCaptureStop);
-    FN_TEST(alcCaptureSamples);
-    #undef FN_TEST
+    for (i = 0; i < frames; i++) {
+        const float f = ((float) frac) * RESAMPLE_FRAC_SCALE;
+        for (j = 0; j < channels; j++) {
+            *(outdata++) = data[j] + ((data[j + channels] - data[j]) * f);
+        }
+        frac += step;
+        data += (frac >> RESAMPLE_FRAC_BITS) * channels;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
 
-    set_alc_error(device, ALC_INVALID_VALUE);
-    return NULL;
+    *_frac = frac;
+    return (ALsizei) ((data - start) / channels);
 }
 
-/* no api lock; immutable */
-ALCenum alcGetEnumValue(ALCdevice *device, const ALCchar *enumname)
+/* same as resample_float32(), but for buffers that aren't float32, which get converted a frame pair at a time. */
+static ALsizei resample_to_float32(const SDL_AudioFormat format, const int channels, const void * restrict data, float * restrict outdata, const ALsizei frames, Uint32 *_frac, const Uint32 step)
 {
-    if (!enumname) {
-        set_alc_error(device, ALC_INVALID_VALUE);
-        return (ALCenum) AL_NONE;
+    const int framesize = channels * (SDL_AUDIO_BITSIZE(format) / 8);
+    const Uint8 *start = (const Uint8 *) data;
+    const Uint8 *ptr = start;
+    Uint32 frac = *_frac;
+    float pair[OPENAL_MAX_BUFFER_CHANNELS * 2];
+    ALsizei i;
+    int j;
+
+    if (format == AUDIO_F32SYS) {
+        return resample_float32(channels, (const float *) data, outdata, frames, _frac, step);
     }
 
-    #define ENUM_TEST(en) if (SDL_strcmp(enumname, #en) == 0) return en
-    ENUM_TEST(ALC_FALSE);
-    ENUM_TEST(ALC_TRUE);
-    ENUM_TEST(ALC_FREQUENCY);
-    ENUM_TEST(ALC_REFRESH);
-    ENUM_TEST(ALC_SYNC);
-    ENUM_TEST(ALC_MONO_SOURCES);
-    ENUM_TEST(ALC_STEREO_SOURCES);
-    ENUM_TEST(ALC_NO_ERROR);
-    ENUM_TEST(ALC_INVALID_DEVICE);
-    ENUM_TEST(ALC_INVALID_CONTEXT);
-    ENUM_TEST(ALC_INVALID_ENUM);
-    ENUM_TEST(ALC_INVALID_VALUE);
-    ENUM_TEST(ALC_OUT_OF_MEMORY);
-    ENUM_TEST(ALC_MAJOR_VERSION);
-    ENUM_TEST(ALC_MINOR_VERSION);
-    ENUM_TEST(ALC_ATTRIBUTES_SIZE);
-    ENUM_TEST(ALC_ALL_ATTRIBUTES);
-    ENUM_TEST(ALC_DEFAULT_DEVICE_SPECIFIER);
-    ENUM_TEST(ALC_DEVICE_SPECIFIER);
-    ENUM_TEST(ALC_EXTENSIONS);
-    ENUM_TEST(ALC_CAPTURE_DEVICE_SPECIFIER);
-    ENUM_TEST(ALC_CAPTURE_DEFAULT_DEVICE_SPECIFIER);
-    ENUM_TEST(ALC_CAPTURE_SAMPLES);
-    ENUM_TEST(ALC_DEFAULT_ALL_DEVICES_SPECIFIER);
-    ENUM_TEST(ALC_ALL_DEVICES_SPECIFIER);
-    ENUM_TEST(ALC_CONNECTED);
-    #undef ENUM_TEST
+    SDL_assert(channels <= OPENAL_MAX_BUFFER_CHANNELS);
+    for (i = 0; i < frames; i++) {
+        const float f = ((float) frac) * RESAMPLE_FRAC_SCALE;
+        convert_to_float32(format, channels, ptr, pair, 2);
+        for (j = 0; j < channels; j++) {
+            *(outdata++) = pair[j] + ((pair[j + channels] - pair[j]) * f);
+        }
+        frac += step;
+        ptr += (frac >> RESAMPLE_FRAC_BITS) * framesize;
+        frac &= RESAMPLE_FRAC_MASK;
+    }
+
+    *_frac = frac;
+    return (ALsizei) ((ptr - start) / framesize);
+}
+
+/* resample and mix (mixframes) of output, returns how many whole frames of (data) we moved past. */
+static ALsizei mix_resampled_buffer(MixScratch *scratch, ALsource *src, const ALbuffer *buffer, const ALfloat * restrict panning, const void * restrict data, const SDL_AudioFormat format, float * restrict stream, ALsizei mixframes, const Uint32 step, const int outchannels)
+{
+    const int channels = buffer->channels;
+    const int framesize = channels * (SDL_AUDIO_BITSIZE(format) / 8);
+    const ALboolean resampler_reads_format = ((outchannels == 2) && (channels <= 2) && mixer_reads_format(format, channels, outchannels)) ? AL_TRUE : AL_FALSE;
+    ALsizei retval = 0;
+
+    if (source_uses_vocoder(src) || (!resampler_reads_format && !panning_is_silent(panning, outchannels))) {
+        /* the pitch shifter needs the resampled data on its own, and there
+           aren't resampling mixers for surround output (or 8-bit or multichannel data), so
+           these go through the scratch arena, leaving room for mix_buffer()
+           to pitch-shift it. */
+        const ALsizei used = scratch->used;
+        while (mixframes > 0) {
+            const ALsizei frames = SDL_min(mixframes, mix_scratch_frames(scratch, channels * 2));
+            float *resampled = mix_scratch_alloc(scratch, frames, channels);
+            const ALsizei moved = resample_to_float32(format, channels, data, resampled, frames, &src->offset_frac, step);
+            SDL_assert(frames > 0);
+            mix_buffer(scratch, src, buffer, panning, resampled, AUDIO_F32SYS, stream, frames, outchannels);
+            scratch->used = used;
+            data = ((const Uint8 *) data) + (moved * framesize);
+            stream += frames * outchannels;
+            mixframes -= frames;
+            retval += moved;
+        }
+    } else if (panning_is_silent(panning, outchannels)) {  /* don't bother mixing in silence, just move along. */
+        const Uint64 pos = ((Uint64) src->offset_frac) + (((Uint64) step) * ((Uint64) mixframes));
+        src->offset_frac = (Uint32) (pos & RESAMPLE_FRAC_MASK);
+        retval = (ALsizei) (pos >> RESAMPLE_FRAC_BITS);
+    } else if (format == AUDIO_S16SYS) {
+        if (channels == 1) {
+            retval = mixer_kernels.resample_sint16_c1(panning, (const Sint16 *) data, stream, mixframes, &src->offset_frac, step);
+        } else {
+            SDL_assert(channels == 2);
+            retval = mixer_kernels.resample_sint16_c2(panning, (const Sint16 *) data, stream, mixframes, &src->offset_frac, step);
+        }
+    } else if (channels == 1) {
+        retval = mixer_kernels.resample_float32_c1(panning, (const float *) data, stream, mixframes, &src->offset_frac, step);
+    } else {
+        SDL_assert(channels == 2);
+        retval = mixer_kernels.resample_float32_c2(panning, (const float *) data, stream, mixframes, &src->offset_frac, step);
+    }
 
-    set_alc_error(device, ALC_INVALID_VALUE);
-    return (ALCenum) AL_NONE;
+    return retval;
 }
 
-static const ALCchar *calculate_sdl_device_list(const int iscapture)
+static ALsizei buffer_frames(const ALbuffer *buffer)
 {
-    /* alcGetString() has to return a const string that is not freed and might
-       continue to live even if we update this list in a later query, so we
-       just make a big static buffer and hope it's large enough and that other
-       race conditions don't bite us. The enumeration extension shouldn't have
-       reused entry points, or done this silly null-delimited string list.
-       Oh well. */
-    #define DEVICE_LIST_BUFFER_SIZE 512
-    static ALCchar playback_list[DEVICE_LIST_BUFFER_SIZE];
-    static ALCchar capture_list[DEVICE_LIST_BUFFER_SIZE];
-    ALCchar *final_list = iscapture ? capture_list : playback_list;
-    ALCchar *ptr = final_list;
-    int numdevs;
-    size_t avail = DEVICE_LIST_BUFFER_SIZE;
-    size_t cpy;
-    int i;
+    if (buffer->block_frames) {
+        return (buffer->len / buffer->block_bytes) * buffer->block_frames;
+    }
+    return buffer->framesize ? (buffer->len / buffer->framesize) : 0;
+}
 
-    /* default device is always available. */
-    cpy = SDL_strlcpy(ptr, iscapture ? DEFAULT_CAPTURE_DEVICE : DEFAULT_PLAYBACK_DEVICE, avail);
-    SDL_assert((cpy+1) < avail);
-    ptr += cpy + 1;  /* skip past null char. */
-    avail -= cpy + 1;
+static const void *buffer_frame_data(const ALbuffer *buffer, const ALsizei frame)
+{
+    return ((const Uint8 *) buffer->data) + (frame * buffer->framesize);
+}
 
-    if (SDL_InitSubSystem(SDL_INIT_AUDIO) == -1) {
-        return NULL;
+/* one sample frame of a buffer as float32, however it's stored. */
+static void get_buffer_frame(const ALbuffer *buffer, const ALsizei frame, float *outdata)
+{
+    if (buffer->block_frames) {
+        CompressedDecoder decoder;  /* just peeking at one frame; don't disturb what the source is decoding. */
+        SDL_zero(decoder);
+        decode_buffer_frames(&decoder, buffer, frame, outdata, 1);
+    } else {
+        convert_to_float32(buffer->format, buffer->channels, buffer_frame_data(buffer, frame), outdata, 1);
     }
+}
 
-    if (!init_api_lock()) {
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
-        return NULL;
+/* the last frame of a buffer interpolates toward whatever is going to play after it. */
+static void get_next_source_frame(const ALsource *src, const BufferQueueItem *queue, float *frame)
+{
+    const ALbuffer *buffer = queue->buffer;
+    const BufferQueueItem *next = (const BufferQueueItem *) queue->next;
+    const ALbuffer *nextbuffer = next ? next->buffer : NULL;
+    const int channels = buffer->channels;
+
+    if (nextbuffer && nextbuffer->data && (buffer_frames(nextbuffer) > 0) && (nextbuffer->channels == channels)) {
+        get_buffer_frame(nextbuffer, 0, frame);
+    } else if (!next && src->looping) {
+        get_buffer_frame(buffer, 0, frame);
+    } else {  /* nothing coming up, just hold the last frame. */
+        get_buffer_frame(buffer, buffer_frames(buffer) - 1, frame);
     }
+}
 
-    grab_api_lock();
+/* compressed buffers can't be mixed in place, so this decodes a stretch of
+   them into the scratch arena and mixes that as float32. The decoded frames
+   are the same floats an Sint16 buffer would give, so this sounds exactly
+   like the uncompressed path would. */
+static void mix_compressed_buffer(MixScratch *scratch, ALsource *src, const BufferQueueItem *queue, float **stream, int *framesneeded, const Uint32 step, const int outchannels)
+{
+    const ALbuffer *buffer = queue->buffer;
+    const int channels = buffer->channels;
+    const ALsizei bufferframes = buffer_frames(buffer);
+    const ALboolean resampling = ((step != RESAMPLE_FRAC_ONE) || (src->offset_frac != 0)) ? AL_TRUE : AL_FALSE;
+    const ALsizei used = scratch->used;
 
-    numdevs = SDL_GetNumAudioDevices(iscapture);
+    while ((*framesneeded > 0) && (src->offset < bufferframes)) {
+        const ALsizei room = mix_scratch_frames(scratch, channels * 3) - 1;  /* leave the rest for the resampler and pitch shifter. */
+        ALsizei decodeframes = bufferframes - src->offset;
+        float *decoded;
+        int mixframes;
 
-    for (i = 0; i < numdevs; i++) {
-        const char *devname = SDL_GetAudioDeviceName(i, iscapture);
-        const size_t devnamelen = SDL_strlen(devname);
-        /* if we're out of space, we just have to drop devices we can't cram in the buffer. */
-        if (avail > (devnamelen + 2)) {
-            cpy = SDL_strlcpy(ptr, devname, avail);
-            SDL_assert(cpy == devnamelen);
-            SDL_assert((cpy+1) < avail);
-            ptr += cpy + 1;  /* skip past null char. */
-            avail -= cpy + 1;
+        SDL_assert(room > 0);
+
+        if (resampling) {
+            /* decode what this mix reaches, plus the frame after it to interpolate toward. */
+            const Uint64 reach = ((((Uint64) src->offset_frac) + (((Uint64) step) * ((Uint64) (*framesneeded - 1)))) >> RESAMPLE_FRAC_BITS) + 1;
+            const ALsizei window = (ALsizei) SDL_min((Uint64) SDL_min(decodeframes, room), reach);
+            const Uint64 span = (((Uint64) window) << RESAMPLE_FRAC_BITS) - src->offset_frac;
+            decodeframes = SDL_min(window + 1, decodeframes);
+            decoded = mix_scratch_alloc(scratch, window + 1, channels);
+            decode_buffer_frames(&src->decoder, buffer, src->offset, decoded, decodeframes);
+            if (decodeframes == window) {
+                get_next_source_frame(src, queue, decoded + (window * channels));
+            }
+            mixframes = (int) SDL_min((span + (step - 1)) / step, (Uint64) *framesneeded);
+            src->offset += mix_resampled_buffer(scratch, src, buffer, src->panning, decoded, AUDIO_F32SYS, *stream, mixframes, step, outchannels);
+        } else {
+            mixframes = SDL_min(SDL_min(decodeframes, room), (ALsizei) *framesneeded);
+            decoded = mix_scratch_alloc(scratch, mixframes, channels);
+            decode_buffer_frames(&src->decoder, buffer, src->offset, decoded, mixframes);
+            mix_buffer(scratch, src, buffer, src->panning, decoded, AUDIO_F32SYS, *stream, mixframes, outchannels);
+            src->offset += mixframes;
         }
-    }
 
-    SDL_assert(avail >= 1);
-    *ptr = '\0';
+        scratch->used = used;
+        *framesneeded -= mixframes;
+        *stream += mixframes * outchannels;
+    }
+}
 
-    ungrab_api_lock();
+static ALboolean mix_source_buffer(ALCcontext *ctx, MixScratch *scratch, ALsource *src, BufferQueueItem *queue, float **stream, int *len)
+{
+    const ALbuffer *buffer = queue ? queue->buffer : NULL;
+    ALboolean processed = AL_TRUE;
 
-    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    /* you can legally queue or set a NULL buffer. */
+    if (buffer && buffer->data && (buffer->len > 0)) {
+        const int channels = buffer->channels;
+        const ALsizei bufferframes = buffer_frames(buffer);
+        const int deviceframesize = ctx->device->framesize;
+        const int outchannels = ctx->device->channels;
+        const Uint32 step = source_resample_step(ctx, src, buffer, src->mixer_pitch);
+        int framesneeded = *len / deviceframesize;
+
+        if (buffer->block_frames) {  /* compressed, decode as we go. */
+            const int before = framesneeded;
+            mix_compressed_buffer(scratch, src, queue, stream, &framesneeded, step, outchannels);
+            *len -= (before - framesneeded) * deviceframesize;
+        } else if ((step == RESAMPLE_FRAC_ONE) && (src->offset_frac == 0)) {  /* no resampling needed, mix straight from the buffer. */
+            if (src->offset < bufferframes) {
+                const int mixframes = SDL_min(framesneeded, bufferframes - src->offset);
+                mix_buffer(scratch, src, buffer, src->panning, buffer_frame_data(buffer, src->offset), buffer->format, *stream, mixframes, outchannels);
+                src->offset += mixframes;
+                *len -= mixframes * deviceframesize;
+                *stream += mixframes * outchannels;
+            }
+        } else {
+            while ((framesneeded > 0) && (src->offset < bufferframes)) {
+                int mixframes;
+                if (src->offset < (bufferframes - 1)) {
+                    /* everything until we'd need the frame past the end of this buffer can resample in place. */
+                    const Uint64 room = (((Uint64) ((bufferframes - 1) - src->offset)) << RESAMPLE_FRAC_BITS) - src->offset_frac;
+                    mixframes = (int) SDL_min((room + (step - 1)) / step, (Uint64) framesneeded);
+                    src->offset += mix_resampled_buffer(scratch, src, buffer, src->panning, buffer_frame_data(buffer, src->offset), buffer->format, *stream, mixframes, step, outchannels);
+                } else {
+                    float edge[OPENAL_MAX_BUFFER_CHANNELS * 2];
+                    SDL_assert(channels <= OPENAL_MAX_BUFFER_CHANNELS);
+                    convert_to_float32(buffer->format, channels, buffer_frame_data(buffer, src->offset), edge, 1);
+                    get_next_source_frame(src, queue, edge + channels);
+                    mixframes = (int) SDL_min(((RESAMPLE_FRAC_ONE - src->offset_frac) + (step - 1)) / step, (Uint32) framesneeded);
+                    src->offset += mix_resampled_buffer(scratch, src, buffer, src->panning, edge, AUDIO_F32SYS, *stream, mixframes, step, outchannels);
+                }
+                framesneeded -= mixframes;
+                *len -= mixframes * deviceframesize;
+                *stream += mixframes * outchannels;
+            }
+        }
 
-    return final_list;
+        processed = src->offset >= bufferframes;
+        if (processed) {
+            FIXME("does the offset have to represent the whole queue or just the current buffer?");
+            src->offset -= bufferframes;  /* carry anything we resampled past the end into the next buffer. */
+        }
+    }
 
-    #undef DEVICE_LIST_BUFFER_SIZE
+    return processed;
 }
 
-/* no api lock; immutable (unless it isn't, then we manually lock). */
-const ALCchar *alcGetString(ALCdevice *device, ALCenum param)
+static ALCboolean mix_source_buffer_queue(ALCcontext *ctx, MixScratch *scratch, ALsource *src, BufferQueueItem *queue, float *stream, int len)
 {
-    switch (param) {
-        case ALC_EXTENSIONS: {
-            #define ALC_EXTENSION_ITEM(ext) " " #ext
-            static ALCchar alc_extensions_string[] = ALC_EXTENSION_ITEMS;
-            #undef ALC_EXTENSION_ITEM
-            return alc_extensions_string + 1;  /* skip that first space char */
-        }
+    ALCboolean keep = ALC_TRUE;
 
-        /* You open the default SDL device with a NULL device name, but that is how OpenAL
-           reports an error here, so we give it a magic identifier here instead. */
-        case ALC_DEFAULT_DEVICE_SPECIFIER:
-            return DEFAULT_PLAYBACK_DEVICE;
+    while ((len > 0) && (mix_source_buffer(ctx, scratch, src, queue, &stream, &len))) {
+        /* Finished this buffer! */
+        BufferQueueItem *item = queue;
+        BufferQueueItem *next = queue ? (BufferQueueItem*)queue->next : NULL;
+        void *ptr;
 
-        case ALC_CAPTURE_DEFAULT_DEVICE_SPECIFIER:
-            return DEFAULT_CAPTURE_DEVICE;
+        if (queue) {
+            queue->next = NULL;
+            queue = next;
+        }
 
-        case ALC_DEVICE_SPECIFIER:
-            FIXME("should return NULL if device->iscapture?");
-            return device ? device->name : calculate_sdl_device_list(0);
+        SDL_assert((src->type == AL_STATIC) || (src->type == AL_STREAMING));
+        if (src->type == AL_STREAMING) {  /* mark buffer processed. */
+            SDL_assert(item == src->buffer_queue.head);
+            FIXME("bubble out all these NULL checks");  /* these are only here because we check for looping/stopping in this loop, but we really shouldn't enter this loop at all if queue==NULL. */
+            if (item != NULL) {
+                src->buffer_queue.head = next;
+                if (!next) {
+                    src->buffer_queue.tail = NULL;
+                }
+                SDL_AtomicAdd(&src->buffer_queue.num_items, -1);
 
-        case ALC_CAPTURE_DEVICE_SPECIFIER:
-            FIXME("should return NULL if !device->iscapture?");
-            return device ? device->name : calculate_sdl_device_list(1);
+                /* Move it to the processed queue for alSourceUnqueueBuffers() to pick up. */
+                do {
+                    ptr = SDL_AtomicGetPtr(&src->buffer_queue_processed.just_queued);
+                    SDL_AtomicSetPtr(&item->next, ptr);
+                } while (!SDL_AtomicCASPtr(&src->buffer_queue_processed.just_queued, ptr, item));
 
-        case ALC_NO_ERROR: return "ALC_NO_ERROR";
-        case ALC_INVALID_DEVICE: return "ALC_INVALID_DEVICE";
-        case ALC_INVALID_CONTEXT:return "ALC_INVALID_CONTEXT";
-        case ALC_INVALID_ENUM: return "ALC_INVALID_ENUM";
-        case ALC_INVALID_VALUE: return "ALC_INVALID_VALUE";
-        case ALC_OUT_OF_MEMORY: return "ALC_OUT_OF_MEMORY";
+                SDL_AtomicAdd(&src->buffer_queue_processed.num_items, 1);
+            }
+        }
 
-        default: break;
+        if (queue == NULL) {  /* nothing else to play? */
+            if (src->looping) {
+                FIXME("looping is supposed to move to AL_INITIAL then immediately to AL_PLAYING, but I'm not sure what side effect this is meant to trigger");
+                if (src->type == AL_STREAMING) {
+                    FIXME("what does looping do with the AL_STREAMING state?");
+                }
+            } else {
+                SDL_AtomicSet(&src->state, AL_STOPPED);
+                keep = ALC_FALSE;
+            }
+            break;  /* nothing else to mix here, so stop. */
+        }
     }
 
-    FIXME("other enums that should report as strings?");
-    set_alc_error(device, ALC_INVALID_ENUM);
-    return NULL;
+    return keep;
 }
 
-static void _alcGetIntegerv(ALCdevice *device, const ALCenum param, const ALCsizei size, ALCint *values)
+/* drop what the mixer already moved past in callback_data and ask the app for
+   enough to cover (wanted) more frames past the current offset. */
+static void pull_callback_data(ALsource *src, const ALbuffer *buffer, const ALsizei wanted)
 {
-    ALCcontext *ctx = NULL;
+    const int framesize = buffer->framesize;
+    ALsizei kept = 0;
+    ALsizei request;
 
-    if (!size || !values) {
-        return;  /* "A NULL destination or a zero size parameter will cause ALC to ignore the query." */
+    if (src->offset < src->callback_frames) {
+        kept = src->callback_frames - src->offset;
+        if (src->offset > 0) {
+            SDL_memmove(src->callback_data, src->callback_data + (src->offset * framesize), kept * framesize);
+        }
+        src->callback_played += (Uint64) src->offset;
+        src->offset = 0;
+    } else {  /* the resampler stepped past everything we had; skip that much of what comes next. */
+        src->callback_played += (Uint64) src->callback_frames;
+        src->offset -= src->callback_frames;
+    }
+    src->callback_frames = kept;
+
+    request = SDL_min(OPENAL_CALLBACK_BUFFER_FRAMES, src->offset + wanted) - kept;
+    if (request > 0) {
+        const ALsizei bytes = request * framesize;
+        const ALsizei got = buffer->callback(buffer->callback_userptr, src->callback_data + (kept * framesize), bytes);
+        src->callback_frames += (got > 0) ? (SDL_min(got, bytes) / framesize) : 0;
+        if (got < bytes) {
+            src->callback_ended = AL_TRUE;  /* a short read means the stream is over. */
+        }
     }
+}
 
-    switch (param) {
-        case ALC_CAPTURE_SAMPLES:
-            if (!device || !device->iscapture) {
-                set_alc_error(device, ALC_INVALID_DEVICE);
-                return;
-            }
+/* AL_SOFT_callback_buffer: pull frames from the app as the mixer needs them. There's no looping here; the app decides when it ends. */
+static ALCboolean mix_callback_buffer(ALCcontext *ctx, MixScratch *scratch, ALsource *src, const ALbuffer *buffer, float *stream, int len)
+{
+    const int channels = buffer->channels;
+    const int framesize = buffer->framesize;
+    const int deviceframesize = ctx->device->framesize;
+    const int outchannels = ctx->device->channels;
+    const Uint32 step = source_resample_step(ctx, src, buffer, src->mixer_pitch);
+    const ALboolean resampling = ((step != RESAMPLE_FRAC_ONE) || (src->offset_frac != 0)) ? AL_TRUE : AL_FALSE;
+    int framesneeded = len / deviceframesize;
 
-            FIXME("make ring buffer atomic?");
-            SDL_LockAudioDevice(device->sdldevice);
-            *values = (ALCint) (device->capture.ring.used / device->framesize);
-            SDL_UnlockAudioDevice(device->sdldevice);
-            return;
+    SDL_assert(src->callback_data != NULL);
 
-        case ALC_CONNECTED:
-            if (device) {
-                *values = SDL_AtomicGet(&device->connected) ? ALC_TRUE : ALC_FALSE;
-            } else {
-                *values = ALC_FALSE;
-                set_alc_error(device, ALC_INVALID_DEVICE);
-            }
-            return;
+    while (framesneeded > 0) {
+        ALsizei available = (src->offset < src->callback_frames) ? (src->callback_frames - src->offset) : 0;
+        int mixframes;
 
-        case ALC_ATTRIBUTES_SIZE:
-        case ALC_ALL_ATTRIBUTES:
-            if (!device || device->iscapture) {
-                *values = 0;
-                set_alc_error(device, ALC_INVALID_DEVICE);
-                return;
-            }
+        if (!src->callback_ended && (available < (resampling ? 2 : 1))) {
+            /* ask for exactly what this mix will read, resampling needs the frame after the last one, too. */
+            const Uint64 wanted = resampling ? (((((Uint64) src->offset_frac) + (((Uint64) step) * ((Uint64) (framesneeded - 1)))) >> RESAMPLE_FRAC_BITS) + 2) : (Uint64) framesneeded;
+            pull_callback_data(src, buffer, (ALsizei) SDL_min(wanted, (Uint64) OPENAL_CALLBACK_BUFFER_FRAMES));
+            continue;
+        }
 
-            ctx = get_current_context();
+        if (available == 0) {  /* the app is done and we played everything it gave us. */
+            SDL_assert(src->callback_ended);
+            src->offset = 0;  /* stopped sources report an offset of zero, like mix_source_buffer() leaves static ones. */
+            src->callback_frames = 0;
+            src->callback_played = 0;
+            SDL_AtomicSet(&src->state, AL_STOPPED);
+            return ALC_FALSE;
+        }
 
-            FIXME("wants 'current context of specified device', but there isn't a current context per-device...");
-            if ((!ctx) || (ctx->device != device)) {
-                *values = 0;
-                set_alc_error(device, ALC_INVALID_CONTEXT);
-                return;
-            }
+        if (!resampling) {
+            mixframes = SDL_min(framesneeded, available);
+            mix_buffer(scratch, src, buffer, src->panning, src->callback_data + (src->offset * framesize), buffer->format, stream, mixframes, outchannels);
+            src->offset += mixframes;
+        } else if (available >= 2) {
+            const Uint64 room = (((Uint64) (available - 1)) << RESAMPLE_FRAC_BITS) - src->offset_frac;
+            mixframes = (int) SDL_min((room + (step - 1)) / step, (Uint64) framesneeded);
+            src->offset += mix_resampled_buffer(scratch, src, buffer, src->panning, src->callback_data + (src->offset * framesize), buffer->format, stream, mixframes, step, outchannels);
+        } else {  /* the app is done and this is the last frame, so just hold it. */
+            float edge[OPENAL_MAX_BUFFER_CHANNELS * 2];
+            SDL_assert(src->callback_ended);
+            SDL_assert(channels <= OPENAL_MAX_BUFFER_CHANNELS);
+            convert_to_float32(buffer->format, channels, src->callback_data + (src->offset * framesize), edge, 1);
+            SDL_memcpy(edge + channels, edge, channels * sizeof (float));
+            mixframes = (int) SDL_min(((RESAMPLE_FRAC_ONE - src->offset_frac) + (step - 1)) / step, (Uint32) framesneeded);
+            src->offset += mix_resampled_buffer(scratch, src, buffer, src->panning, edge, AUDIO_F32SYS, stream, mixframes, step, outchannels);
+        }
 
-            if (param == ALC_ALL_ATTRIBUTES) {
-                if (size < ctx->attributes_count) {
-                    *values = 0;
-                    set_alc_error(device, ALC_INVALID_VALUE);
-                    return;
-                }
-                SDL_memcpy(values, ctx->attributes, ctx->attributes_count * sizeof (ALCint));
-            } else {
-                *values = (ALCint) ctx->attributes_count;
-            }
-            return;
+        framesneeded -= mixframes;
+        stream += mixframes * outchannels;
+    }
 
-        case ALC_MAJOR_VERSION:
-            *values = OPENAL_VERSION_MAJOR;
-            return;
+    return ALC_TRUE;
+}
 
-        case ALC_MINOR_VERSION:
-            *values = OPENAL_VERSION_MINOR;
-            return;
+/* All the 3D math here is way overcommented because I HAVE NO IDEA WHAT I'M
+   DOING and had to research the hell out of what are probably pretty simple
+   concepts. Pay attention in math class, kids. */
 
-        case ALC_FREQUENCY:
-            if (!device) {
-                *values = 0;
-                set_alc_error(device, ALC_INVALID_DEVICE);
-                return;
-            }
+/* The scalar versions have explanitory comments and links. The SIMD versions don't. */
 
-            *values = device->frequency;
-            return;
+/* calculates cross product. https://en.wikipedia.org/wiki/Cross_product
+    Basically takes two vectors and gives you a vector that's perpendicular
+    to both.
+*/
+#if NEED_SCALAR_FALLBACK
+static void xyzzy(ALfloat *v, const ALfloat *a, const ALfloat *b)
+{
+    v[0] = (a[1] * b[2]) - (a[2] * b[1]);
+    v[1] = (a[2] * b[0]) - (a[0] * b[2]);
+    v[2] = (a[0] * b[1]) - (a[1] * b[0]);
+}
 
-        default: break;
-    }
+/* calculate dot product (multiply each element of two vectors, sum them) */
+static ALfloat dotproduct(const ALfloat *a, const ALfloat *b)
+{
+    return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+}
 
-    set_alc_error(device, ALC_INVALID_ENUM);
-    *values = 0;
+/* calculate distance ("magnitude") in 3D space:
+    https://math.stackexchange.com/questions/42640/calculate-distance-in-3d-space
+    assumes vector starts at (0,0,0). */
+static ALfloat magnitude(const ALfloat *v)
+{
+    /* technically, the inital part on this is just a dot product of itself. */
+    return SDL_sqrtf((v[0] * v[0]) + (v[1] * v[1]) + (v[2] * v[2]));
 }
-ENTRYPOINTVOID(alcGetIntegerv,(ALCdevice *device, ALCenum param, ALCsizei size, ALCint *values),(device,param,size,values))
+#endif
 
+#ifdef __SSE__
+static __m128 xyzzy_sse(const __m128 a, const __m128 b)
+{
+    /* http://fastcpp.blogspot.com/2011/04/vector-cross-product-using-sse-code.html
+        this is the "three shuffle" version in the comments, plus the variables swapped around for handedness in the later comment. */
+    const __m128 v = _mm_sub_ps(
+        _mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1))),
+        _mm_mul_ps(b, _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)))
+    );
+    return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1));
+}
 
-/* audio callback for capture devices just needs to move data into our
-   ringbuffer for later recovery by the app in alcCaptureSamples(). SDL
-   should have handled resampling and conversion for us to the expected
-   audio format. */
-static void SDLCALL capture_device_callback(void *userdata, Uint8 *stream, int len)
+static ALfloat dotproduct_sse(const __m128 a, const __m128 b)
 {
-    ALCdevice *device = (ALCdevice *) userdata;
-    ALCboolean connected = ALC_FALSE;
-    SDL_assert(device->iscapture);
+    const __m128 prod = _mm_mul_ps(a, b);
+    const __m128 sum1 = _mm_add_ps(prod, _mm_shuffle_ps(prod, prod, _MM_SHUFFLE(1, 0, 3, 2)));
+    const __m128 sum2 = _mm_add_ps(sum1, _mm_shuffle_ps(sum1, sum1, _MM_SHUFFLE(2, 2, 0, 0)));
+    FIXME("this can use _mm_hadd_ps in SSE3, or _mm_dp_ps in SSE4.1");
+    return _mm_cvtss_f32(_mm_shuffle_ps(sum2, sum2, _MM_SHUFFLE(3, 3, 3, 3)));
+}
 
-    if (SDL_AtomicGet(&device->connected)) {
-        if (SDL_GetAudioDeviceStatus(device->sdldevice) == SDL_AUDIO_STOPPED) {
-            SDL_AtomicSet(&device->connected, ALC_FALSE);
-        } else {
-            connected = ALC_TRUE;
-        }
-    }
+static ALfloat magnitude_sse(const __m128 v)
+{
+    return SDL_sqrtf(dotproduct_sse(v, v));
+}
+#endif
 
-    if (connected) {
-        ring_buffer_put(&device->capture.ring, stream, (ALCsizei) len);
-    }
+#ifdef __ARM_NEON__
+static float32x4_t xyzzy_neon(const float32x4_t a, const float32x4_t b)
+{
+    const float32x4_t shuf_a = { a[1], a[2], a[0], a[3] };
+    const float32x4_t shuf_b = { b[1], b[2], b[0], b[3] };
+    const float32x4_t v = vsubq_f32(vmulq_f32(a, shuf_b), vmulq_f32(b, shuf_a));
+    const float32x4_t retval = { v[1], v[2], v[0], v[3] };
+    FIXME("need a better permute");
+    return retval;
 }
 
-/* no api lock; this creates it and otherwise doesn't have any state that can race */
-ALCdevice *alcCaptureOpenDevice(const ALCchar *devicename, ALCuint frequency, ALCenum format, ALCsizei buffersize)
+static ALfloat dotproduct_neon(const float32x4_t a, const float32x4_t b)
 {
-    SDL_AudioSpec desired;
-    ALCsizei framesize = 0;
-    const char *sdldevname = NULL;
-    ALCdevice *device = NULL;
-    ALCubyte *ringbuf = NULL;
+    const float32x4_t prod = vmulq_f32(a, b);
+    const float32x4_t sum1 = vaddq_f32(prod, vrev64q_f32(prod));
+    const float32x4_t sum2 = vaddq_f32(sum1, vcombine_f32(vget_high_f32(sum1), vget_low_f32(sum1)));
+    return sum2[3];
+}
 
-    SDL_zero(desired);
-    if (!alcfmt_to_sdlfmt(format, &desired.format, &desired.channels, &framesize)) {
-        return NULL;
-    }
+static ALfloat magnitude_neon(const float32x4_t v)
+{
+    return SDL_sqrtf(dotproduct_neon(v, v));
+}
+#endif
 
-    if (!devicename) {
-        devicename = DEFAULT_CAPTURE_DEVICE;  /* so ALC_CAPTURE_DEVICE_SPECIFIER is meaningful */
-    }
 
-    desired.freq = frequency;
-    desired.samples = 1024;  FIXME("is this a reasonable value?");
-    desired.callback = capture_device_callback;
 
-    if (SDL_strcmp(devicename, DEFAULT_CAPTURE_DEVICE) != 0) {
-        sdldevname = devicename;  /* we want NULL for the best SDL default unless app is explicit. */
-    }
+/* Where the speakers are for each surround layout, as (output channel,
+   degrees clockwise from straight ahead), in order around the listener. The
+   channels are in SDL's order, which is also ALC_SOFT_loopback's. The LFE
+   channel doesn't get anything positional, so it isn't listed. */
+typedef struct SpeakerPosition
+{
+    Uint8 channel;
+    ALfloat degrees;
+} SpeakerPosition;
 
-    device = prep_alc_device(devicename, ALC_TRUE);
-    if (!device) {
-        return NULL;
+static const SpeakerPosition speakers_quad[] = { { 2, -135.0f }, { 0, -45.0f }, { 1, 45.0f }, { 3, 135.0f } };
+static const SpeakerPosition speakers_5_1[] = { { 4, -110.0f }, { 0, -30.0f }, { 2, 0.0f }, { 1, 30.0f }, { 5, 110.0f } };
+static const SpeakerPosition speakers_6_1[] = { { 5, -90.0f }, { 0, -30.0f }, { 2, 0.0f }, { 1, 30.0f }, { 6, 90.0f }, { 4, 180.0f } };
+static const SpeakerPosition speakers_7_1[] = { { 4, -150.0f }, { 6, -90.0f }, { 0, -30.0f }, { 2, 0.0f }, { 1, 30.0f }, { 7, 90.0f }, { 5, 150.0f } };
+
+/* the speakers for a layout with (channels) channels, or NULL for stereo (or anything else we don't know). */
+static const SpeakerPosition *get_speaker_positions(const int channels, int *num_positions)
+{
+    switch (channels) {
+        case 4: *num_positions = (int) SDL_arraysize(speakers_quad); return speakers_quad;
+        case 6: *num_positions = (int) SDL_arraysize(speakers_5_1); return speakers_5_1;
+        case 7: *num_positions = (int) SDL_arraysize(speakers_6_1); return speakers_6_1;
+        case 8: *num_positions = (int) SDL_arraysize(speakers_7_1); return speakers_7_1;
+        default: break;
     }
+    *num_positions = 0;
+    return NULL;
+}
 
-    device->frequency = frequency;
-    device->framesize = framesize;
-    device->capture.ring.size = framesize * buffersize;
+static void init_speaker_panning(SpeakerPanning *speakers, const int channels)
+{
+    int num_positions;
+    const SpeakerPosition *positions = get_speaker_positions(channels, &num_positions);
+    int i;
 
-    if (device->capture.ring.size >= buffersize) {
-        ringbuf = (ALCubyte *) SDL_malloc(device->capture.ring.size);
+    SDL_zerop(speakers);
+
+    if (!positions) {
+        return;  /* stereo doesn't use this. */
+    }
+
+    /* every adjacent pair, wrapping around behind the listener. None of the
+       layouts have a gap of 180 degrees or more between neighbors, so all of
+       these matrices can be inverted. */
+    for (i = 0; i < num_positions; i++) {
+        const SpeakerPosition *a = &positions[i];
+        const SpeakerPosition *b = &positions[(i + 1) % num_positions];
+        const double x1 = SDL_sin(a->degrees * (M_PI / 180.0));
+        const double y1 = SDL_cos(a->degrees * (M_PI / 180.0));
+        const double x2 = SDL_sin(b->degrees * (M_PI / 180.0));
+        const double y2 = SDL_cos(b->degrees * (M_PI / 180.0));
+        const double det = (x1 * y2) - (x2 * y1);
+        speakers->gain1_x[i] = (ALfloat) (y2 / det);
+        speakers->gain1_y[i] = (ALfloat) (-x2 / det);
+        speakers->gain2_x[i] = (ALfloat) (-y1 / det);
+        speakers->gain2_y[i] = (ALfloat) (x1 / det);
+        speakers->channel1[i] = a->channel;
+        speakers->channel2[i] = b->channel;
+    }
+    speakers->num_pairs = num_positions;
+}
+
+/* (x, y) is the source's direction in the listener's horizontal plane, as a
+   unit vector: x is to the right, y is straight ahead, like spatialize_batch()
+   works out. (gains) has to be zeroed already; this only sets the two
+   speakers it uses. */
+static void calculate_vbap_gains(const SpeakerPanning *speakers, const ALfloat x, const ALfloat y, const ALfloat gain, ALfloat *gains)
+{
+    ALfloat pair_gain1[OPENAL_MAX_OUTPUT_CHANNELS];
+    ALfloat pair_gain2[OPENAL_MAX_OUTPUT_CHANNELS];
+    ALfloat best = 0.0f;
+    ALfloat gain1, gain2, power;
+    int bestpair = 0;
+    int i;
+
+    #ifdef __SSE__
+    if (has_sse) {
+        const __m128 vx = _mm_set1_ps(x);
+        const __m128 vy = _mm_set1_ps(y);
+        for (i = 0; i < speakers->num_pairs; i += 4) {
+            _mm_storeu_ps(&pair_gain1[i], _mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&speakers->gain1_x[i])), _mm_mul_ps(vy, _mm_loadu_ps(&speakers->gain1_y[i]))));
+            _mm_storeu_ps(&pair_gain2[i], _mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&speakers->gain2_x[i])), _mm_mul_ps(vy, _mm_loadu_ps(&speakers->gain2_y[i]))));
+        }
+    } else
+    #elif defined(__ARM_NEON__)
+    if (has_neon) {
+        const float32x4_t vx = vdupq_n_f32(x);
+        const float32x4_t vy = vdupq_n_f32(y);
+        for (i = 0; i < speakers->num_pairs; i += 4) {
+            vst1q_f32(&pair_gain1[i], vmlaq_f32(vmulq_f32(vx, vld1q_f32(&speakers->gain1_x[i])), vy, vld1q_f32(&speakers->gain1_y[i])));
+            vst1q_f32(&pair_gain2[i], vmlaq_f32(vmulq_f32(vx, vld1q_f32(&speakers->gain2_x[i])), vy, vld1q_f32(&speakers->gain2_y[i])));
+        }
+    } else
+    #endif
+
+    {
+    #if NEED_SCALAR_FALLBACK
+        for (i = 0; i < speakers->num_pairs; i++) {
+            pair_gain1[i] = (x * speakers->gain1_x[i]) + (y * speakers->gain1_y[i]);
+            pair_gain2[i] = (x * speakers->gain2_x[i]) + (y * speakers->gain2_y[i]);
+        }
+    #endif
     }
 
-    if (!ringbuf) {
-        SDL_free(device->name);
-        SDL_free(device);
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
-        return NULL;
+    /* the pair that surrounds the source has no negative gain. Take the
+       least negative, in case rounding puts a source right on a speaker a
+       hair outside both of the pairs that speaker is in. */
+    for (i = 0; i < speakers->num_pairs; i++) {
+        const ALfloat lowest = SDL_min(pair_gain1[i], pair_gain2[i]);
+        if ((i == 0) || (lowest > best)) {
+            best = lowest;
+            bestpair = i;
+        }
     }
 
-    device->capture.ring.buffer = ringbuf;
+    /* scale to constant power, like the stereo panning does. */
+    gain1 = SDL_max(pair_gain1[bestpair], 0.0f);
+    gain2 = SDL_max(pair_gain2[bestpair], 0.0f);
+    power = (gain1 * gain1) + (gain2 * gain2);
+    if (power > 0.0f) {
+        const ALfloat scale = gain / SDL_sqrtf(power);
+        gains[speakers->channel1[bestpair]] = gain1 * scale;
+        gains[speakers->channel2[bestpair]] = gain2 * scale;
+    }
+}
 
-    desired.userdata = device;
+/* AL_EXT_MCFORMATS buffers aren't spatialized, but every channel plays from
+   where its speaker would be, using the speaker layouts above, since those
+   are the same for buffers as for output. A channel whose speaker the device
+   has goes straight to it. Anything else gets panned between the nearest two
+   speakers, or, for stereo output, folded into its side the usual way (3dB
+   down if it's not in front). The LFE channel (always channel 3) goes to the
+   device's LFE channel, or is dropped if there isn't one. */
+static void calculate_channel_matrix(const ALCdevice *device, const int channels, const ALfloat gain, ALfloat *matrix)
+{
+    const ALfloat minus_3db = 0.70710678f;
+    int num_inputs, num_outputs;
+    const SpeakerPosition *inputs = get_speaker_positions(channels, &num_inputs);
+    const SpeakerPosition *outputs = get_speaker_positions(device->channels, &num_outputs);
+    int i, j;
 
-    device->sdldevice = SDL_OpenAudioDevice(sdldevname, 1, &desired, NULL, 0);
-    if (!device->sdldevice) {
-        SDL_free(ringbuf);
-        SDL_free(device->name);
-        SDL_free(device);
-        SDL_QuitSubSystem(SDL_INIT_AUDIO);
-        return NULL;
+    SDL_memset(matrix, '\0', sizeof (ALfloat) * OPENAL_MAX_BUFFER_CHANNELS * OPENAL_MAX_OUTPUT_CHANNELS);
+
+    SDL_assert(inputs != NULL);
+    if ((channels >= 6) && (device->channels >= 6)) {
+        matrix[(3 * OPENAL_MAX_OUTPUT_CHANNELS) + 3] = gain;
     }
 
-    return device;
+    for (i = 0; i < num_inputs; i++) {
+        const ALfloat degrees = inputs[i].degrees;
+        ALfloat *gains = matrix + (inputs[i].channel * OPENAL_MAX_OUTPUT_CHANNELS);
+
+        for (j = 0; j < num_outputs; j++) {
+            if (outputs[j].degrees == degrees) {
+                break;
+            }
+        }
+
+        if (j < num_outputs) {
+            gains[outputs[j].channel] = gain;
+        } else if (outputs) {
+            const double radians = degrees * (M_PI / 180.0);
+            calculate_vbap_gains(&device->speakers, (ALfloat) SDL_sin(radians), (ALfloat) SDL_cos(radians), gain, gains);
+        } else if ((degrees == 0.0f) || (degrees == 180.0f)) {  /* centered, split it between both sides. */
+            gains[0] = gains[1] = gain * ((degrees == 0.0f) ? minus_3db : 0.5f);
+        } else {
+            gains[(degrees < 0.0f) ? 0 : 1] = (SDL_fabsf(degrees) < 90.0f) ? gain : (gain * minus_3db);
+        }
+    }
 }
 
-/* no api lock; this requires you to not destroy a device that's still in use */
-ALCboolean alcCaptureCloseDevice(ALCdevice *device)
+/* The parts of the listener and context that every source in a spatialize batch shares. */
+typedef struct SpatializeListener
 {
-    if (!device || !device->iscapture) {
-        return ALC_FALSE;
+    ALfloat at[4];  /* these are 4 elements, with the last always zero, so SIMD can load and store them directly. */
+    ALfloat up[4];
+    ALfloat right[4];
+    ALfloat velocity[4];
+    ALfloat at_magnitude;
+    ALfloat gain;
+    ALenum distance_formula;  /* AL_INVERSE_DISTANCE, AL_LINEAR_DISTANCE, AL_EXPONENT_DISTANCE, or AL_NONE. */
+    ALboolean distance_clamped;  /* the _CLAMPED version of distance_formula. */
+    ALfloat speed_of_sound;
+    ALfloat doppler_factor;  /* 0.0f if the Doppler effect is off. */
+    ALboolean fast_math;  /* use fastmath_* instead of the C runtime, see ALC_FAST_MATH_MOJOAL. */
+} SpatializeListener;
+
+#define SQRT2_DIV2 0.7071067812f  /* sqrt(2.0) / 2.0 ... */
+#define DOPPLER_MAX_PITCH ((ALfloat) (RESAMPLE_MAX_STEP >> RESAMPLE_FRAC_BITS))  /* the resampler can only go so fast anyhow. */
+
+#if NEED_SCALAR_FALLBACK
+static ALfloat calculate_distance_attenuation(const SpatializeListener *listener, ALfloat distance, const ALfloat reference_distance, const ALfloat max_distance, const ALfloat rolloff_factor)
+{
+    /* AL SPEC: "With all the distance models, if the formula can not be
+       evaluated then the source will not be attenuated. For example, if a
+       linear model is being used with AL_REFERENCE_DISTANCE equal to
+       AL_MAX_DISTANCE, then the gain equation will have a divide-by-zero
+       error in it. In this case, there is no attenuation for that source." */
+
+    if (listener->distance_clamped) {
+        distance = SDL_max(distance, reference_distance);
     }
 
-    if (device->sdldevice) {
-        SDL_CloseAudioDevice(device->sdldevice);
+    /* the linear model always does this: "distance = min(distance, AL_MAX_DISTANCE) // avoid negative gain" */
+    if (listener->distance_clamped || (listener->distance_formula == AL_LINEAR_DISTANCE)) {
+        distance = SDL_min(distance, max_distance);
     }
 
-    SDL_free(device->capture.ring.buffer);
-    SDL_free(device->name);
-    SDL_free(device);
-    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    switch (listener->distance_formula) {
+        case AL_INVERSE_DISTANCE: {
+            /* AL SPEC: "gain = AL_REFERENCE_DISTANCE / (AL_REFERENCE_DISTANCE + AL_ROLLOFF_FACTOR * (distance - AL_REFERENCE_DISTANCE))" */
+            const ALfloat denominator = reference_distance + rolloff_factor * (distance - reference_distance);
+            return (denominator == 0.0f) ? 1.0f : (reference_distance / denominator);
+        }
 
-    return ALC_TRUE;
-}
+        case AL_LINEAR_DISTANCE: {
+            /* AL SPEC: "gain = (1 - AL_ROLLOFF_FACTOR * (distance - AL_REFERENCE_DISTANCE) / (AL_MAX_DISTANCE - AL_REFERENCE_DISTANCE))" */
+            const ALfloat denominator = max_distance - reference_distance;
+            return (denominator == 0.0f) ? 1.0f : (1.0f - rolloff_factor * (distance - reference_distance) / denominator);
+        }
 
-static void _alcCaptureStart(ALCdevice *device)
-{
-    if (device && device->iscapture) {
-        /* alcCaptureStart() drops any previously-buffered data. */
-        FIXME("does this clear the ring buffer if the device is already started?");
-        SDL_LockAudioDevice(device->sdldevice);
-        device->capture.ring.read = 0;
-        device->capture.ring.write = 0;
-        device->capture.ring.used = 0;
-        SDL_UnlockAudioDevice(device->sdldevice);
-        SDL_PauseAudioDevice(device->sdldevice, 0);
+        case AL_EXPONENT_DISTANCE:
+            /* AL SPEC: "gain = (distance / AL_REFERENCE_DISTANCE) ^ (- AL_ROLLOFF_FACTOR)" */
+            if (reference_distance == 0.0f) {
+                return 1.0f;
+            }
+            return listener->fast_math ? fastmath_powf(distance / reference_distance, -rolloff_factor) : SDL_powf(distance / reference_distance, -rolloff_factor);
+
+        default: break;
     }
+
+    return 1.0f;  /* AL_NONE */
 }
-ENTRYPOINTVOID(alcCaptureStart,(ALCdevice *device),(device))
 
-static void _alcCaptureStop(ALCdevice *device)
+static void spatialize_batch_scalar(const SpatializeListener *listener, SpatializeBatch *batch)
 {
-    if (device && device->iscapture) {
-        SDL_PauseAudioDevice(device->sdldevice, 1);
+    int i;
+
+    for (i = 0; i < batch->count; i++) {
+        ALfloat position[3];
+        ALfloat direction[3];
+        ALfloat velocity[3];
+        ALfloat V[3];
+        ALfloat distance;
+        ALfloat gain;
+        ALfloat mags;
+        ALfloat sine, cosine;
+        ALfloat left, right;
+        ALfloat a;
+
+        position[0] = batch->position_x[i];
+        position[1] = batch->position_y[i];
+        position[2] = batch->position_z[i];
+        direction[0] = batch->direction_x[i];
+        direction[1] = batch->direction_y[i];
+        direction[2] = batch->direction_z[i];
+        velocity[0] = batch->velocity_x[i];
+        velocity[1] = batch->velocity_y[i];
+        velocity[2] = batch->velocity_z[i];
+
+        distance = magnitude(position);
+
+        /* this goes through the steps the AL spec dictates for gain and distance attenuation... */
+
+        /* AL SPEC: ""1. Distance attenuation is calculated first, including
+           minimum (AL_REFERENCE_DISTANCE) and maximum (AL_MAX_DISTANCE)
+           thresholds." */
+        gain = calculate_distance_attenuation(listener, distance, batch->reference_distance[i], batch->max_distance[i], batch->rolloff_factor[i]);
+
+        /* AL SPEC: "2. The result is then multiplied by source gain (AL_GAIN)." */
+        gain *= batch->gain[i];
+
+        /* AL SPEC: "3. If the source is directional (AL_CONE_INNER_ANGLE less
+           than AL_CONE_OUTER_ANGLE), an angle-dependent attenuation is calculated
+           depending on AL_CONE_OUTER_GAIN, and multiplied with the distance
+           dependent attenuation. The resulting attenuation factor for the given
+           angle and distance between listener and source is multiplied with
+           source AL_GAIN."
+
+           The angle is between the source's direction and the line from the
+           source to the listener. The cone angles are the whole width of the
+           cone, so we double it to compare. Inside the inner cone is full
+           volume, outside the outer cone is AL_CONE_OUTER_GAIN, and it fades
+           between the two. A source without a direction isn't directional. */
+        mags = distance * magnitude(direction);
+        if ((batch->cone_inner_angle[i] < batch->cone_outer_angle[i]) && (mags > 0.0f)) {
+            const ALfloat cosangle = SDL_clamp(-dotproduct(position, direction) / mags, -1.0f, 1.0f);
+            const ALfloat degrees = (listener->fast_math ? fastmath_acosf(cosangle) : SDL_acosf(cosangle)) * ((ALfloat) (360.0 / M_PI));
+            const ALfloat t = SDL_clamp((degrees - batch->cone_inner_angle[i]) / (batch->cone_outer_angle[i] - batch->cone_inner_angle[i]), 0.0f, 1.0f);
+            gain *= 1.0f + ((batch->cone_outer_gain[i] - 1.0f) * t);
+        }
+
+        /* AL SPEC: "4. The effective gain computed this way is compared against
+           AL_MIN_GAIN and AL_MAX_GAIN thresholds." */
+        gain = SDL_min(SDL_max(gain, batch->min_gain[i]), batch->max_gain[i]);
+
+        /* AL SPEC: "5. The result is guaranteed to be clamped to [AL_MIN_GAIN,
+           AL_MAX_GAIN], and subsequently multiplied by listener gain which serves
+           as an overall volume control. The implementation is free to clamp
+           listener gain if necessary due to hardware or implementation
+           constraints." */
+        gain *= listener->gain;
+        batch->gain[i] = gain;
+
+        /* now figure out positioning. We want the direction to the source in
+           the listener's horizontal plane, as the sine and cosine of its angle
+           from straight ahead (which is also x and y of a unit vector pointing
+           that way). For stereo, we just need a simple panning effect (surround
+           output uses calculate_vbap_gains() instead, from the same direction).
+           We're going to do what's called "constant power panning," as
+           explained...
+
+           https://dsp.stackexchange.com/questions/21691/algorithm-to-pan-audio */
+
+        /* Remove upwards component so it lies completely within the horizontal plane. */
+        a = dotproduct(position, listener->up);
+        V[0] = position[0] - (a * listener->up[0]);
+        V[1] = position[1] - (a * listener->up[1]);
+        V[2] = position[2] - (a * listener->up[2]);
+
+        /* Calculate angle. We never need the angle itself, just its sine and cosine. */
+        mags = listener->at_magnitude * magnitude(V);
+        if (mags == 0.0f) {
+            cosine = 1.0f;  /* right on top of us, or directly above or below; call it straight ahead. */
+            sine = 0.0f;
+        } else {
+            cosine = SDL_clamp(dotproduct(listener->at, V) / mags, -1.0f, 1.0f);
+            sine = SDL_sqrtf(1.0f - (cosine * cosine));
+            /* make it negative to the left, positive to the right. */
+            if (dotproduct(listener->right, V) < 0.0f) {
+                sine = -sine;
+            }
+        }
+
+        batch->pan_x[i] = sine;
+        batch->pan_y[i] = cosine;
+
+        /* here comes the Constant Power Panning magic...
+
+          this might be a terrible idea, which is totally my own doing here,
+          but here you go: Constant Power Panning only works from -45 to 45
+          degrees in front of the listener. So we split this into 4 quadrants.
+          - from -45 to 45: standard panning.
+          - from 45 to 135: pan full right.
+          - from 135 to 225: flip angle so it works like standard panning.
+          - from 225 to -45: pan full left.
+          Flipping the angle behind the listener just negates the cosine, so
+          both of those quadrants use its absolute value. */
+        if (SDL_fabsf(cosine) >= SQRT2_DIV2) {
+            left = SQRT2_DIV2 * (SDL_fabsf(cosine) - sine);
+            right = SQRT2_DIV2 * (SDL_fabsf(cosine) + sine);
+        } else if (sine > 0.0f) {
+            left = 0.0f;
+            right = 1.0f;
+        } else {
+            left = 1.0f;
+            right = 0.0f;
+        }
+
+        /* apply distance attenuation and gain to positioning. */
+        batch->stereo_left[i] = left * gain;
+        batch->stereo_right[i] = right * gain;
+
+        /* The Doppler effect. The position is relative to the listener, so it's the negated source to listener vector.
+           AL SPEC: "SL = source to listener vector
+                     vls = DotProduct(SL, LV) / Mag(SL)
+                     vss = DotProduct(SL, SV) / Mag(SL)
+                     vss = Min(vss, SS/DF)
+                     vls = Min(vls, SS/DF)
+                     f' = f * (SS - DF*vls) / (SS - DF*vss)" */
+        if ((listener->doppler_factor == 0.0f) || (distance == 0.0f)) {
+            batch->doppler_pitch[i] = 1.0f;  /* disabled, or no direction to move in. */
+        } else {
+            const ALfloat max_speed = listener->speed_of_sound / listener->doppler_factor;
+            const ALfloat vls = (-dotproduct(position, listener->velocity) * batch->listener_velocity_scale[i]) / distance;
+            const ALfloat vss = -dotproduct(position, velocity) / distance;
+            const ALfloat numerator = listener->speed_of_sound - (listener->doppler_factor * SDL_min(vls, max_speed));
+            const ALfloat denominator = listener->speed_of_sound - (listener->doppler_factor * SDL_min(vss, max_speed));
+            /* a source coming at you at the speed of sound divides by zero. */
+            if (denominator <= 0.0f) {
+                batch->doppler_pitch[i] = (numerator > 0.0f) ? DOPPLER_MAX_PITCH : 1.0f;
+            } else {
+                batch->doppler_pitch[i] = numerator / denominator;
+            }
+        }
     }
 }
-ENTRYPOINTVOID(alcCaptureStop,(ALCdevice *device),(device))
+#endif
 
-static void _alcCaptureSamples(ALCdevice *device, ALCvoid *buffer, const ALCsizei samples)
-{
-    ALCsizei requested_bytes;
-    if (!device || !device->iscapture) {
-        return;
-    }
+#ifdef __SSE__
+#define DOT3_SSE(ax, ay, az, bx, by, bz) _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz))
+
+static void spatialize_batch_sse(const SpatializeListener *listener, SpatializeBatch *batch)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 negone = _mm_set1_ps(-1.0f);
+    const __m128 signmask = _mm_set1_ps(-0.0f);
+    const __m128 sqrt2_div2 = _mm_set1_ps(SQRT2_DIV2);
+    const __m128 at_x = _mm_set1_ps(listener->at[0]);
+    const __m128 at_y = _mm_set1_ps(listener->at[1]);
+    const __m128 at_z = _mm_set1_ps(listener->at[2]);
+    const __m128 up_x = _mm_set1_ps(listener->up[0]);
+    const __m128 up_y = _mm_set1_ps(listener->up[1]);
+    const __m128 up_z = _mm_set1_ps(listener->up[2]);
+    const __m128 right_x = _mm_set1_ps(listener->right[0]);
+    const __m128 right_y = _mm_set1_ps(listener->right[1]);
+    const __m128 right_z = _mm_set1_ps(listener->right[2]);
+    const __m128 at_magnitude = _mm_set1_ps(listener->at_magnitude);
+    const __m128 listener_gain = _mm_set1_ps(listener->gain);
+    int i;
 
-    requested_bytes = samples * device->framesize;
+    for (i = 0; i < batch->count; i += 4) {  /* (the math is explained in the scalar version.) */
+        const __m128 px = _mm_load_ps(&batch->position_x[i]);
+        const __m128 py = _mm_load_ps(&batch->position_y[i]);
+        const __m128 pz = _mm_load_ps(&batch->position_z[i]);
+        const __m128 reference_distance = _mm_load_ps(&batch->reference_distance[i]);
+        const __m128 max_distance = _mm_load_ps(&batch->max_distance[i]);
+        const __m128 rolloff_factor = _mm_load_ps(&batch->rolloff_factor[i]);
+        const __m128 distance = _mm_sqrt_ps(DOT3_SSE(px, py, pz, px, py, pz));
+        __m128 d = distance;
+        __m128 gain;
+
+        if (listener->distance_clamped) {
+            d = _mm_max_ps(d, reference_distance);
+        }
+        if (listener->distance_clamped || (listener->distance_formula == AL_LINEAR_DISTANCE)) {
+            d = _mm_min_ps(d, max_distance);
+        }
 
-    SDL_LockAudioDevice(device->sdldevice);
-    if (requested_bytes > device->capture.ring.used) {
-        SDL_UnlockAudioDevice(device->sdldevice);
-        FIXME("set error state?");
-        return;  /* this is an error state, according to the spec. */
-    }
+        /* divisions by zero here make infinity or NaN in that lane, but we throw it out. */
+        switch (listener->distance_formula) {
+            case AL_INVERSE_DISTANCE: {
+                const __m128 denominator = _mm_add_ps(reference_distance, _mm_mul_ps(rolloff_factor, _mm_sub_ps(d, reference_distance)));
+                gain = fastmath_select_sse(_mm_cmpeq_ps(denominator, zero), one, _mm_div_ps(reference_distance, denominator));
+                break;
+            }
 
-    ring_buffer_get(&device->capture.ring, buffer, requested_bytes);
-    SDL_UnlockAudioDevice(device->sdldevice);
+            case AL_LINEAR_DISTANCE: {
+                const __m128 denominator = _mm_sub_ps(max_distance, reference_distance);
+                gain = _mm_sub_ps(one, _mm_div_ps(_mm_mul_ps(rolloff_factor, _mm_sub_ps(d, reference_distance)), denominator));
+                gain = fastmath_select_sse(_mm_cmpeq_ps(denominator, zero), one, gain);
+                break;
+            }
+
+            case AL_EXPONENT_DISTANCE: {
+                const __m128 ratio = _mm_div_ps(d, reference_distance);
+                #ifdef __SSE2__
+                if (listener->fast_math) {
+                    gain = fastmath_pow_sse(ratio, _mm_xor_ps(rolloff_factor, signmask));
+                } else
+                #endif
+                {  /* the C runtime doesn't have a SIMD pow(), but this is the least popular distance model. */
+                    ALfloat lanes[4];
+                    int j;
+                    _mm_storeu_ps(lanes, ratio);
+                    for (j = 0; j < 4; j++) {
+                        lanes[j] = SDL_powf(lanes[j], -batch->rolloff_factor[i + j]);
+                    }
+                    gain = _mm_loadu_ps(lanes);
+                }
+                gain = fastmath_select_sse(_mm_cmpeq_ps(reference_distance, zero), one, gain);
+                break;
+            }
+
+            default:
+                gain = one;
+                break;
+        }
+
+        gain = _mm_mul_ps(gain, _mm_load_ps(&batch->gain[i]));
+
+        {  /* directional sources. */
+            const __m128 dx = _mm_load_ps(&batch->direction_x[i]);
+            const __m128 dy = _mm_load_ps(&batch->direction_y[i]);
+            const __m128 dz = _mm_load_ps(&batch->direction_z[i]);
+            const __m128 inner = _mm_load_ps(&batch->cone_inner_angle[i]);
+            const __m128 outer = _mm_load_ps(&batch->cone_outer_angle[i]);
+            const __m128 mags = _mm_mul_ps(distance, _mm_sqrt_ps(DOT3_SSE(dx, dy, dz, dx, dy, dz)));
+            const __m128 directional = _mm_and_ps(_mm_cmplt_ps(inner, outer), _mm_cmpgt_ps(mags, zero));
+            const __m128 cosangle = _mm_max_ps(_mm_min_ps(_mm_div_ps(_mm_xor_ps(DOT3_SSE(px, py, pz, dx, dy, dz), signmask), mags), one), negone);
+            __m128 angle, degrees, t, cone;
+            if (listener->fast_math) {
+                angle = fastmath_acos_sse(cosangle);
+            } else {
+                ALfloat lanes[4];
+                int j;
+                _mm_storeu_ps(lanes, cosangle);
+                for (j = 0; j < 4; j++) {
+                    lanes[j] = SDL_acosf(lanes[j]);
+                }
+                angle = _mm_loadu_ps(lanes);
+            }
+            degrees = _mm_mul_ps(angle, _mm_set1_ps((ALfloat) (360.0 / M_PI)));
+            t = _mm_max_ps(_mm_min_ps(_mm_div_ps(_mm_sub_ps(degrees, inner), _mm_sub_ps(outer, inner)), one), zero);
+            cone = _mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&batch->cone_outer_gain[i]), one), t));
+            gain = _mm_mul_ps(gain, fastmath_select_sse(directional, cone, one));
+        }
+
+        gain = _mm_min_ps(_mm_max_ps(gain, _mm_load_ps(&batch->min_gain[i])), _mm_load_ps(&batch->max_gain[i]));
+        gain = _mm_mul_ps(gain, listener_gain);
+        _mm_store_ps(&batch->gain[i], gain);
+
+        {  /* panning. */
+            const __m128 a = DOT3_SSE(px, py, pz, up_x, up_y, up_z);
+            const __m128 vx = _mm_sub_ps(px, _mm_mul_ps(a, up_x));
+            const __m128 vy = _mm_sub_ps(py, _mm_mul_ps(a, up_y));
+            const __m128 vz = _mm_sub_ps(pz, _mm_mul_ps(a, up_z));
+            const __m128 mags = _mm_mul_ps(at_magnitude, _mm_sqrt_ps(DOT3_SSE(vx, vy, vz, vx, vy, vz)));
+            const __m128 valid = _mm_cmpgt_ps(mags, zero);
+            const __m128 cosangle = _mm_max_ps(_mm_min_ps(_mm_div_ps(DOT3_SSE(at_x, at_y, at_z, vx, vy, vz), mags), one), negone);
+            const __m128 sinangle = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosangle, cosangle)), zero));
+            const __m128 toleft = _mm_cmplt_ps(DOT3_SSE(right_x, right_y, right_z, vx, vy, vz), zero);
+            const __m128 cosine = fastmath_select_sse(valid, cosangle, one);
+            const __m128 sine = _mm_and_ps(valid, _mm_xor_ps(sinangle, _mm_and_ps(toleft, signmask)));
+            const __m128 abscos = _mm_andnot_ps(signmask, cosine);
+            const __m128 front_or_back = _mm_cmpge_ps(abscos, sqrt2_div2);
+            const __m128 toright = _mm_cmpgt_ps(sine, zero);
+            const __m128 left = fastmath_select_sse(front_or_back, _mm_mul_ps(sqrt2_div2, _mm_sub_ps(abscos, sine)), _mm_andnot_ps(toright, one));
+            const __m128 right = fastmath_select_sse(front_or_back, _mm_mul_ps(sqrt2_div2, _mm_add_ps(abscos, sine)), _mm_and_ps(toright, one));
+            _mm_store_ps(&batch->pan_x[i], sine);
+            _mm_store_ps(&batch->pan_y[i], cosine);
+            _mm_store_ps(&batch->stereo_left[i], _mm_mul_ps(left, gain));
+            _mm_store_ps(&batch->stereo_right[i], _mm_mul_ps(right, gain));
+        }
+
+        if (listener->doppler_factor == 0.0f) {
+            _mm_store_ps(&batch->doppler_pitch[i], one);
+        } else {
+            const __m128 speed_of_sound = _mm_set1_ps(listener->speed_of_sound);
+            const __m128 doppler_factor = _mm_set1_ps(listener->doppler_factor);
+            const __m128 max_speed = _mm_set1_ps(listener->speed_of_sound / listener->doppler_factor);
+            const __m128 lvx = _mm_set1_ps(listener->velocity[0]);
+            const __m128 lvy = _mm_set1_ps(listener->velocity[1]);
+            const __m128 lvz = _mm_set1_ps(listener->velocity[2]);
+            const __m128 svx = _mm_load_ps(&batch->velocity_x[i]);
+            const __m128 svy = _mm_load_ps(&batch->velocity_y[i]);
+            const __m128 svz = _mm_load_ps(&batch->velocity_z[i]);
+            const __m128 vls = _mm_div_ps(_mm_mul_ps(_mm_xor_ps(DOT3_SSE(px, py, pz, lvx, lvy, lvz), signmask), _mm_load_ps(&batch->listener_velocity_scale[i])), distance);
+            const __m128 vss = _mm_div_ps(_mm_xor_ps(DOT3_SSE(px, py, pz, svx, svy, svz), signmask), distance);
+            const __m128 numerator = _mm_sub_ps(speed_of_sound, _mm_mul_ps(doppler_factor, _mm_min_ps(vls, max_speed)));
+            const __m128 denominator = _mm_sub_ps(speed_of_sound, _mm_mul_ps(doppler_factor, _mm_min_ps(vss, max_speed)));
+            __m128 pitch = fastmath_select_sse(_mm_cmpgt_ps(numerator, zero), _mm_set1_ps(DOPPLER_MAX_PITCH), one);
+            pitch = fastmath_select_sse(_mm_cmpgt_ps(denominator, zero), _mm_div_ps(numerator, denominator), pitch);
+            _mm_store_ps(&batch->doppler_pitch[i], fastmath_select_sse(_mm_cmpgt_ps(distance, zero), pitch, one));
+        }
+    }
 }
-ENTRYPOINTVOID(alcCaptureSamples,(ALCdevice *device, ALCvoid *buffer, ALCsizei samples),(device,buffer,samples))
+#undef DOT3_SSE
+#endif
+
+#ifdef __ARM_NEON__
+#define DOT3_NEON(ax, ay, az, bx, by, bz) vmlaq_f32(vmlaq_f32(vmulq_f32(ax, bx), ay, by), az, bz)
+
+static void spatialize_batch_neon(const SpatializeListener *listener, SpatializeBatch *batch)
+{
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t negone = vdupq_n_f32(-1.0f);
+    const float32x4_t sqrt2_div2 = vdupq_n_f32(SQRT2_DIV2);
+    const float32x4_t at_x = vdupq_n_f32(listener->at[0]);
+    const float32x4_t at_y = vdupq_n_f32(listener->at[1]);
+    const float32x4_t at_z = vdupq_n_f32(listener->at[2]);
+    const float32x4_t up_x = vdupq_n_f32(listener->up[0]);
+    const float32x4_t up_y = vdupq_n_f32(listener->up[1]);
+    const float32x4_t up_z = vdupq_n_f32(listener->up[2]);
+    const float32x4_t right_x = vdupq_n_f32(listener->right[0]);
+    const float32x4_t right_y = vdupq_n_f32(listener->right[1]);
+    const float32x4_t right_z = vdupq_n_f32(listener->right[2]);
+    const float32x4_t at_magnitude = vdupq_n_f32(listener->at_magnitude);
+    const float32x4_t listener_gain = vdupq_n_f32(listener->gain);
+    int i;
 
+    for (i = 0; i < batch->count; i += 4) {  /* (the math is explained in the scalar version.) */
+        const float32x4_t px = vld1q_f32(&batch->position_x[i]);
+        const float32x4_t py = vld1q_f32(&batch->position_y[i]);
+        const float32x4_t pz = vld1q_f32(&batch->position_z[i]);
+        const float32x4_t reference_distance = vld1q_f32(&batch->reference_distance[i]);
+        const float32x4_t max_distance = vld1q_f32(&batch->max_distance[i]);
+        const float32x4_t rolloff_factor = vld1q_f32(&batch->rolloff_factor[i]);
+        const float32x4_t distance = fastmath_sqrt_neon(DOT3_NEON(px, py, pz, px, py, pz));
+        float32x4_t d = distance;
+        float32x4_t gain;
+
+        if (listener->distance_clamped) {
+            d = vmaxq_f32(d, reference_distance);
+        }
+        if (listener->distance_clamped || (listener->distance_formula == AL_LINEAR_DISTANCE)) {
+            d = vminq_f32(d, max_distance);
+        }
 
-/* AL implementation... */
+        /* divisions by zero here make infinity or NaN in that lane, but we throw it out. */
+        switch (listener->distance_formula) {
+            case AL_INVERSE_DISTANCE: {
+                const float32x4_t denominator = vmlaq_f32(reference_distance, rolloff_factor, vsubq_f32(d, reference_distance));
+                gain = vbslq_f32(vceqq_f32(denominator, zero), one, vmulq_f32(reference_distance, fastmath_reciprocal_neon(denominator)));
+                break;
+            }
 
-static ALenum null_context_error = AL_NO_ERROR;
+            case AL_LINEAR_DISTANCE: {
+                const float32x4_t denominator = vsubq_f32(max_distance, reference_distance);
+                gain = vmlsq_f32(one, vmulq_f32(rolloff_factor, vsubq_f32(d, reference_distance)), fastmath_reciprocal_neon(denominator));
+                gain = vbslq_f32(vceqq_f32(denominator, zero), one, gain);
+                break;
+            }
 
-static void set_al_error(ALCcontext *ctx, const ALenum error)
-{
-    ALenum *perr = ctx ? &ctx->error : &null_context_error;
-    /* can't set a new error when the previous hasn't been cleared yet. */
-    if (*perr == AL_NO_ERROR) {
-        *perr = error;
+            case AL_EXPONENT_DISTANCE: {
+                const float32x4_t ratio = vmulq_f32(d, fastmath_reciprocal_neon(reference_distance));
+                if (listener->fast_math) {
+                    gain = fastmath_pow_neon(ratio, vnegq_f32(rolloff_factor));
+                } else {  /* the C runtime doesn't have a SIMD pow(), but this is the least popular distance model. */
+                    ALfloat lanes[4];
+                    int j;
+                    vst1q_f32(lanes, ratio);
+                    for (j = 0; j < 4; j++) {
+                        lanes[j] = SDL_powf(lanes[j], -batch->rolloff_factor[i + j]);
+                    }
+                    gain = vld1q_f32(lanes);
+                }
+                gain = vbslq_f32(vceqq_f32(reference_distance, zero), one, gain);
+                break;
+            }
+
+            default:
+                gain = one;
+                break;
+        }
+
+        gain = vmulq_f32(gain, vld1q_f32(&batch->gain[i]));
+
+        {  /* directional sources. */
+            const float32x4_t dx = vld1q_f32(&batch->direction_x[i]);
+            const float32x4_t dy = vld1q_f32(&batch->direction_y[i]);
+            const float32x4_t dz = vld1q_f32(&batch->direction_z[i]);
+            const float32x4_t inner = vld1q_f32(&batch->cone_inner_angle[i]);
+            const float32x4_t outer = vld1q_f32(&batch->cone_outer_angle[i]);
+            const float32x4_t mags = vmulq_f32(distance, fastmath_sqrt_neon(DOT3_NEON(dx, dy, dz, dx, dy, dz)));
+            const uint32x4_t directional = vandq_u32(vcltq_f32(inner, outer), vcgtq_f32(mags, zero));
+            const float32x4_t cosangle = vmaxq_f32(vminq_f32(vmulq_f32(vnegq_f32(DOT3_NEON(px, py, pz, dx, dy, dz)), fastmath_reciprocal_neon(mags)), one), negone);
+            float32x4_t angle, degrees, t, cone;
+            if (listener->fast_math) {
+                angle = fastmath_acos_neon(cosangle);
+            } else {
+                ALfloat lanes[4];
+                int j;
+                vst1q_f32(lanes, cosangle);
+                for (j = 0; j < 4; j++) {
+                    lanes[j] = SDL_acosf(lanes[j]);
+                }
+                angle = vld1q_f32(lanes);
+            }
+            degrees = vmulq_n_f32(angle, (ALfloat) (360.0 / M_PI));
+            t = vmaxq_f32(vminq_f32(vmulq_f32(vsubq_f32(degrees, inner), fastmath_reciprocal_neon(vsubq_f32(outer, inner))), one), zero);
+            cone = vmlaq_f32(one, vsubq_f32(vld1q_f32(&batch->cone_outer_gain[i]), one), t);
+            gain = vmulq_f32(gain, vbslq_f32(directional, cone, one));
+        }
+
+        gain = vminq_f32(vmaxq_f32(gain, vld1q_f32(&batch->min_gain[i])), vld1q_f32(&batch->max_gain[i]));
+        gain = vmulq_f32(gain, listener_gain);
+        vst1q_f32(&batch->gain[i], gain);
+
+        {  /* panning. */
+            const float32x4_t a = DOT3_NEON(px, py, pz, up_x, up_y, up_z);
+            const float32x4_t vx = vmlsq_f32(px, a, up_x);
+            const float32x4_t vy = vmlsq_f32(py, a, up_y);
+            const float32x4_t vz = vmlsq_f32(pz, a, up_z);
+            const float32x4_t mags = vmulq_f32(at_magnitude, fastmath_sqrt_neon(DOT3_NEON(vx, vy, vz, vx, vy, vz)));
+            const uint32x4_t valid = vcgtq_f32(mags, zero);
+            const float32x4_t cosangle = vmaxq_f32(vminq_f32(vmulq_f32(DOT3_NEON(at_x, at_y, at_z, vx, vy, vz), fastmath_reciprocal_neon(mags)), one), negone);
+            const float32x4_t sinangle = fastmath_sqrt_neon(vmaxq_f32(vmlsq_f32(one, cosangle, cosangle), zero));
+            const uint32x4_t toleft = vcltq_f32(DOT3_NEON(right_x, right_y, right_z, vx, vy, vz), zero);
+            const float32x4_t cosine = vbslq_f32(valid, cosangle, one);
+            const float32x4_t sine = vbslq_f32(valid, vbslq_f32(toleft, vnegq_f32(sinangle), sinangle), zero);
+            const float32x4_t abscos = vabsq_f32(cosine);
+            const uint32x4_t front_or_back = vcgeq_f32(abscos, sqrt2_div2);
+            const uint32x4_t toright = vcgtq_f32(sine, zero);
+            const float32x4_t left = vbslq_f32(front_or_back, vmulq_f32(sqrt2_div2, vsubq_f32(abscos, sine)), vbslq_f32(toright, zero, one));
+            const float32x4_t right = vbslq_f32(front_or_back, vmulq_f32(sqrt2_div2, vaddq_f32(abscos, sine)), vbslq_f32(toright, one, zero));
+            vst1q_f32(&batch->pan_x[i], sine);
+            vst1q_f32(&batch->pan_y[i], cosine);
+            vst1q_f32(&batch->stereo_left[i], vmulq_f32(left, gain));
+            vst1q_f32(&batch->stereo_right[i], vmulq_f32(right, gain));
+        }
+
+        if (listener->doppler_factor == 0.0f) {
+            vst1q_f32(&batch->doppler_pitch[i], one);
+        } else {
+            const float32x4_t speed_of_sound = vdupq_n_f32(listener->speed_of_sound);
+            const float32x4_t doppler_factor = vdupq_n_f32(listener->doppler_factor);
+            const float32x4_t max_speed = vdupq_n_f32(listener->speed_of_sound / listener->doppler_factor);
+            const float32x4_t lvx = vdupq_n_f32(listener->velocity[0]);
+            const float32x4_t lvy = vdupq_n_f32(listener->velocity[1]);
+            const float32x4_t lvz = vdupq_n_f32(listener->velocity[2]);
+            const float32x4_t svx = vld1q_f32(&batch->velocity_x[i]);
+            const float32x4_t svy = vld1q_f32(&batch->velocity_y[i]);
+            const float32x4_t svz = vld1q_f32(&batch->velocity_z[i]);
+            const float32x4_t recip_distance = fastmath_reciprocal_neon(distance);
+            const float32x4_t vls = vmulq_f32(vmulq_f32(vnegq_f32(DOT3_NEON(px, py, pz, lvx, lvy, lvz)), vld1q_f32(&batch->listener_velocity_scale[i])), recip_distance);
+            const float32x4_t vss = vmulq_f32(vnegq_f32(DOT3_NEON(px, py, pz, svx, svy, svz)), recip_distance);
+            const float32x4_t numerator = vmlsq_f32(speed_of_sound, doppler_factor, vminq_f32(vls, max_speed));
+            const float32x4_t denominator = vmlsq_f32(speed_of_sound, doppler_factor, vminq_f32(vss, max_speed));
+            float32x4_t pitch = vbslq_f32(vcgtq_f32(numerator, zero), vdupq_n_f32(DOPPLER_MAX_PITCH), one);
+            pitch = vbslq_f32(vcgtq_f32(denominator, zero), vmulq_f32(numerator, fastmath_reciprocal_neon(denominator)), pitch);
+            vst1q_f32(&batch->doppler_pitch[i], vbslq_f32(vcgtq_f32(distance, zero), pitch, one));
+        }
     }
 }
+#undef DOT3_NEON
+#endif
 
-/* !!! FIXME: buffers and sources use almost identical code for blocks */
-static ALsource *get_source(ALCcontext *ctx, const ALuint name, SourceBlock **_block)
+static void init_spatialize_listener(const ALCcontext *ctx, SpatializeListener *listener)
 {
-    const ALsizei blockidx = (((ALsizei) name) - 1) / OPENAL_SOURCE_BLOCK_SIZE;
-    const ALsizei block_offset = (((ALsizei) name) - 1) % OPENAL_SOURCE_BLOCK_SIZE;
-    ALsource *source;
-    SourceBlock *block;
+    const ALfloat *at = &ctx->listener.orientation[0];
+    const ALfloat *up = &ctx->listener.orientation[4];
+    /* AL_DOPPLER_VELOCITY is deprecated, but 1.0 scaled the speed of sound with it, and it's harmless at the default of 1.0. */
+    const ALfloat speed_of_sound = ctx->speed_of_sound * ctx->doppler_velocity;
 
-    /*printf("get_source(%d): blockidx=%d, block_offset=%d\n", (int) name, (int) blockidx, (int) block_offset);*/
+    SDL_memcpy(listener->at, at, sizeof (listener->at));
+    SDL_memcpy(listener->up, up, sizeof (listener->up));
+    SDL_memcpy(listener->velocity, ctx->listener.velocity, sizeof (listener->velocity));
+    listener->gain = ctx->listener.gain;
 
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        if (_block) *_block = NULL;
-        return NULL;
-    } else if ((name == 0) || (blockidx < 0) || (blockidx >= ctx->num_source_blocks)) {
-        set_al_error(ctx, AL_INVALID_NAME);
-        if (_block) *_block = NULL;
-        return NULL;
+    /* Get "right" vector. XYZZY!! https://en.wikipedia.org/wiki/Cross_product#Mnemonic */
+    #ifdef __SSE__
+    if (has_sse) {
+        _mm_storeu_ps(listener->right, xyzzy_sse(_mm_load_ps(at), _mm_load_ps(up)));
+        listener->at_magnitude = magnitude_sse(_mm_load_ps(at));
+    } else
+    #elif defined(__ARM_NEON__)
+    if (has_neon) {
+        vst1q_f32(listener->right, xyzzy_neon(vld1q_f32(at), vld1q_f32(up)));
+        listener->at_magnitude = magnitude_neon(vld1q_f32(at));
+    } else
+    #endif
+
+    {
+    #if NEED_SCALAR_FALLBACK
+        xyzzy(listener->right, at, up);
+        listener->right[3] = 0.0f;
+        listener->at_magnitude = magnitude(at);
+    #endif
     }
 
-    block = ctx->source_blocks[blockidx];
-    source = &block->sources[block_offset];
-    if (source->allocated) {
-        if (_block) *_block = block;
-        return source;
+    listener->distance_clamped = AL_FALSE;
+    switch (ctx->distance_model) {
+        case AL_INVERSE_DISTANCE_CLAMPED: listener->distance_clamped = AL_TRUE;  /* fallthrough */
+        case AL_INVERSE_DISTANCE: listener->distance_formula = AL_INVERSE_DISTANCE; break;
+        case AL_LINEAR_DISTANCE_CLAMPED: listener->distance_clamped = AL_TRUE;  /* fallthrough */
+        case AL_LINEAR_DISTANCE: listener->distance_formula = AL_LINEAR_DISTANCE; break;
+        case AL_EXPONENT_DISTANCE_CLAMPED: listener->distance_clamped = AL_TRUE;  /* fallthrough */
+        case AL_EXPONENT_DISTANCE: listener->distance_formula = AL_EXPONENT_DISTANCE; break;
+        default: listener->distance_formula = AL_NONE; break;
     }
 
-    if (_block) *_block = NULL;
-    set_al_error(ctx, AL_INVALID_NAME);
-    return NULL;
+    listener->speed_of_sound = speed_of_sound;
+    /* "A value of zero (AL_DOPPLER_FACTOR) disables the Doppler effect." */
+    listener->doppler_factor = ((ctx->doppler_factor <= 0.0f) || (speed_of_sound <= 0.0f)) ? 0.0f : ctx->doppler_factor;
+    listener->fast_math = ctx->fast_math ? AL_TRUE : AL_FALSE;
 }
 
-/* !!! FIXME: buffers and sources use almost identical code for blocks */
-static ALbuffer *get_buffer(ALCcontext *ctx, const ALuint name, BufferBlock **_block)
+static void spatialize_add_source(const ALCcontext *ctx, SpatializeBatch *batch, ALsource *src)
 {
-    const ALsizei blockidx = (((ALsizei) name) - 1) / OPENAL_BUFFER_BLOCK_SIZE;
-    const ALsizei block_offset = (((ALsizei) name) - 1) % OPENAL_BUFFER_BLOCK_SIZE;
-    ALbuffer *buffer;
-    BufferBlock *block;
+    const int i = batch->count++;
 
-    /*printf("get_buffer(%d): blockidx=%d, block_offset=%d\n", (int) name, (int) blockidx, (int) block_offset);*/
+    SDL_assert(i < OPENAL_SPATIALIZE_BATCH_SIZE);
 
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        if (_block) *_block = NULL;
-        return NULL;
-    } else if ((name == 0) || (blockidx < 0) || (blockidx >= ctx->device->playback.num_buffer_blocks)) {
-        set_al_error(ctx, AL_INVALID_NAME);
-        if (_block) *_block = NULL;
-        return NULL;
-    }
-
-    block = ctx->device->playback.buffer_blocks[blockidx];
-    buffer = &block->buffers[block_offset];
-    if (buffer->allocated) {
-        if (_block) *_block = block;
-        return buffer;
-    }
+    /* if values aren't source-relative, then convert it to be so. */
+    if (src->source_relative) {
+        batch->position_x[i] = src->position[0];
+        batch->position_y[i] = src->position[1];
+        batch->position_z[i] = src->position[2];
+        batch->listener_velocity_scale[i] = 0.0f;
+    } else {
+        batch->position_x[i] = src->position[0] - ctx->listener.position[0];
+        batch->position_y[i] = src->position[1] - ctx->listener.position[1];
+        batch->position_z[i] = src->position[2] - ctx->listener.position[2];
+        batch->listener_velocity_scale[i] = 1.0f;
+    }
+
+    batch->velocity_x[i] = src->velocity[0];
+    batch->velocity_y[i] = src->velocity[1];
+    batch->velocity_z[i] = src->velocity[2];
+    batch->direction_x[i] = src->direction[0];
+    batch->direction_y[i] = src->direction[1];
+    batch->direction_z[i] = src->direction[2];
+    batch->gain[i] = src->gain;
+    batch->min_gain[i] = src->min_gain;
+    batch->max_gain[i] = src->max_gain;
+    batch->reference_distance[i] = src->reference_distance;
+    batch->max_distance[i] = src->max_distance;
+    batch->rolloff_factor[i] = src->rolloff_factor;
+    batch->cone_inner_angle[i] = src->cone_inner_angle;
+    batch->cone_outer_angle[i] = src->cone_outer_angle;
+    batch->cone_outer_gain[i] = src->cone_outer_gain;
+    batch->sources[i] = src;
 
-    if (_block) *_block = NULL;
-    set_al_error(ctx, AL_INVALID_NAME);
-    return NULL;
+    /* rolloff==0.0f makes all distance models result in 1.0f,
+       and we never spatialize non-mono sources, per the AL spec. */
+    batch->spatialize[i] = (ctx->distance_model != AL_NONE) &&
+                           (src->queue_channels == 1) &&
+                           (src->rolloff_factor != 0.0f);
 }
 
-static void _alDopplerFactor(const ALfloat value)
+static void spatialize_batch(const ALCcontext *ctx, const SpatializeListener *listener, SpatializeBatch *batch)
 {
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-    } else if (value < 0.0f) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-    } else {
-        ctx->doppler_factor = value;
-        context_needs_recalc(ctx);
-    }
-}
-ENTRYPOINTVOID(alDopplerFactor,(ALfloat value),(value))
+    int i;
 
-static void _alDopplerVelocity(const ALfloat value)
-{
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-    } else if (value < 0.0f) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-    } else {
-        ctx->doppler_velocity = value;
-        context_needs_recalc(ctx);
+    /* pad out to whole SIMD vectors with copies of the last source; it just gets the same results more than once. */
+    while (batch->count % 4) {
+        spatialize_add_source(ctx, batch, batch->sources[batch->count - 1]);
     }
-}
-ENTRYPOINTVOID(alDopplerVelocity,(ALfloat value),(value))
 
-static void _alSpeedOfSound(const ALfloat value)
-{
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-    } else if (value < 0.0f) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-    } else {
-        ctx->speed_of_sound = value;
-        context_needs_recalc(ctx);
-    }
-}
-ENTRYPOINTVOID(alSpeedOfSound,(ALfloat value),(value))
+    #ifdef __SSE__
+    if (has_sse) {
+        spatialize_batch_sse(listener, batch);
+    } else
+    #elif defined(__ARM_NEON__)
+    if (has_neon) {
+        spatialize_batch_neon(listener, batch);
+    } else
+    #endif
 
-static void _alDistanceModel(const ALenum model)
-{
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
+    {
+    #if NEED_SCALAR_FALLBACK
+        spatialize_batch_scalar(listener, batch);
+    #endif
     }
 
-    switch (model) {
-        case AL_NONE:
-        case AL_INVERSE_DISTANCE:
-        case AL_INVERSE_DISTANCE_CLAMPED:
-        case AL_LINEAR_DISTANCE:
-        case AL_LINEAR_DISTANCE_CLAMPED:
-        case AL_EXPONENT_DISTANCE:
-        case AL_EXPONENT_DISTANCE_CLAMPED:
-            ctx->distance_model = model;
-            context_needs_recalc(ctx);
-            return;
-        default: break;
-    }
-    set_al_error(ctx, AL_INVALID_ENUM);
-}
-ENTRYPOINTVOID(alDistanceModel,(ALenum model),(model))
+    for (i = 0; i < batch->count; i++) {
+        ALsource *src = batch->sources[i];
+        ALfloat *gains = src->panning;
 
+        SDL_memset(gains, '\0', sizeof (src->panning));  /* surround output has channels that might not get anything. */
 
-static void _alEnable(const ALenum capability)
-{
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
-}
-ENTRYPOINTVOID(alEnable,(ALenum capability),(capability))
+        if (!batch->spatialize[i]) {
+            /* no spatialization, but AL_GAIN (etc) is still applied. Surround output plays these on the front left and right speakers. */
+            gains[0] = gains[1] = SDL_min(SDL_max(src->gain, src->min_gain), src->max_gain) * ctx->listener.gain;
+            if (src->queue_channels > 2) {  /* AL_EXT_MCFORMATS buffers play each channel on its own speaker instead. */
+                calculate_channel_matrix(ctx->device, src->queue_channels, gains[0], src->channel_matrix);
+            }
+        } else if (ctx->device->channels != 2) {
+            calculate_vbap_gains(&ctx->device->speakers, batch->pan_x[i], batch->pan_y[i], batch->gain[i], gains);
+        } else {
+            gains[0] = batch->stereo_left[i];
+            gains[1] = batch->stereo_right[i];
+        }
 
+        /* The Doppler effect is a change in playback rate, so the mixer applies this
+           through the resampler, along with AL_PITCH. Even phase vocoder sources get
+           it that way, since a moving source really does change speed. */
+        src->doppler_pitch = batch->doppler_pitch[i];
+        src->mixer_pitch = src->pitch;
+    }
 
-static void _alDisable(const ALenum capability)
-{
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
+    batch->count = 0;
 }
-ENTRYPOINTVOID(alDisable,(ALenum capability),(capability))
-
 
-static ALboolean _alIsEnabled(const ALenum capability)
+/* work out panning and Doppler pitch for every playing source that needs it, in batches.
+   Call this with source_lock held. While updates are deferred, the API thread
+   might be halfway through changing things, so we only touch sources that
+   just started playing and need _something_; everything else keeps what it
+   has until alProcessUpdatesSOFT(), when all the changes arrive at once. */
+static void spatialize_playlist(ALCcontext *ctx)
 {
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
-    return AL_FALSE;
-}
-ENTRYPOINT(ALboolean,alIsEnabled,(ALenum capability),(capability))
+    SpatializeBatch *batch = &ctx->spatialize;
+    const ALboolean deferring = ctx->deferring;
+    ALboolean force_recalc = AL_FALSE;
+    SpatializeListener listener;
+    ALsource *src;
 
-static const ALchar *_alGetString(const ALenum param)
-{
-    switch (param) {
-        case AL_EXTENSIONS: {
-            #define AL_EXTENSION_ITEM(ext) " " #ext
-            static ALchar al_extensions_string[] = AL_EXTENSION_ITEMS;
-            #undef AL_EXTENSION_ITEM
-            return al_extensions_string + 1;  /* skip that first space char */
-        }
+    if (!deferring && ctx->recalc) {
+        SDL_MemoryBarrierAcquire();
+        ctx->recalc = AL_FALSE;
+        force_recalc = AL_TRUE;
+    }
 
-        case AL_VERSION: return OPENAL_VERSION_STRING;
-        case AL_RENDERER: return OPENAL_RENDERER_STRING;
-        case AL_VENDOR: return OPENAL_VENDOR_STRING;
-        case AL_NO_ERROR: return "AL_NO_ERROR";
-        case AL_INVALID_NAME: return "AL_INVALID_NAME";
-        case AL_INVALID_ENUM: return "AL_INVALID_ENUM";
-        case AL_INVALID_VALUE: return "AL_INVALID_VALUE";
-        case AL_INVALID_OPERATION: return "AL_INVALID_OPERATION";
-        case AL_OUT_OF_MEMORY: return "AL_OUT_OF_MEMORY";
+    init_spatialize_listener(ctx, &listener);
 
-        default: break;
+    batch->count = 0;
+    for (src = ctx->playlist; src != NULL; src = src->playlist_next) {
+        const ALboolean needs_recalc = src->just_played || (!deferring && (src->recalc || force_recalc));
+        if (needs_recalc && (SDL_AtomicGet(&src->state) == AL_PLAYING)) {
+            SDL_MemoryBarrierAcquire();
+            src->just_played = AL_FALSE;
+            if (!deferring) {
+                src->recalc = AL_FALSE;  /* if we're deferring, leave this set so we catch up when updates are processed. */
+            }
+            spatialize_add_source(ctx, batch, src);
+            if (batch->count == OPENAL_SPATIALIZE_BATCH_SIZE) {
+                spatialize_batch(ctx, &listener, batch);
+            }
+        }
     }
 
-    FIXME("other enums that should report as strings?");
-    set_al_error(get_current_context(), AL_INVALID_ENUM);
-
-    return NULL;
+    if (batch->count > 0) {
+        spatialize_batch(ctx, &listener, batch);
+    }
 }
-ENTRYPOINT(const ALchar *,alGetString,(ALenum param),(param))
 
-static void _alGetBooleanv(const ALenum param, ALboolean *values)
+static ALCboolean mix_source(ALCcontext *ctx, MixScratch *scratch, ALsource *src, float *stream, int len)
 {
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
-    }
+    ALCboolean keep;
 
-    if (!values) return;  /* legal no-op */
+    keep = (SDL_AtomicGet(&src->state) == AL_PLAYING);
+    if (keep) {
+        SDL_assert(src->allocated);
+        if ((src->type == AL_STATIC) && src->buffer->callback) {
+            keep = mix_callback_buffer(ctx, scratch, src, src->buffer, stream, len);
+        } else if (src->type == AL_STATIC) {
+            BufferQueueItem fakequeue = { src->buffer, NULL };
+            keep = mix_source_buffer_queue(ctx, scratch, src, &fakequeue, stream, len);
+        } else if (src->type == AL_STREAMING) {
+            obtain_newly_queued_buffers(&src->buffer_queue);
+            keep = mix_source_buffer_queue(ctx, scratch, src, src->buffer_queue.head, stream, len);
+        } else if (src->type == AL_UNDETERMINED) {
+            keep = ALC_FALSE;  /* this has AL_BUFFER set to 0; just dump it. */
+        } else {
+            SDL_assert(!"unknown source type");
+        }
 
-    /* nothing in core OpenAL 1.1 uses this */
-    set_al_error(ctx, AL_INVALID_ENUM);
+        /* let AL_SOFT_source_latency queries see where we got to without taking source_lock. */
+        seqlock_write_begin(&src->mixed_offset_seq);
+        src->mixed_offset = source_calculate_offset(src);
+        src->mixed_clock = ctx->device->clock_frames_after_mix;
+        seqlock_write_end(&src->mixed_offset_seq);
+    }
+
+    return keep;
 }
-ENTRYPOINTVOID(alGetBooleanv,(ALenum param, ALboolean *values),(param,values))
 
-static void _alGetIntegerv(const ALenum param, ALint *values)
+/* move new play requests over to the mixer thread. */
+static void migrate_playlist_requests(ALCcontext *ctx)
 {
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
+    SourcePlayTodo *todo;
+    SourcePlayTodo *todoend;
+    SourcePlayTodo *i;
+
+    do {  /* take the todo list atomically, now we own it. */
+        todo = (SourcePlayTodo *) ctx->playlist_todo;
+    } while (!SDL_AtomicCASPtr(&ctx->playlist_todo, todo, NULL));
+
+    if (!todo) {
+        return;  /* nothing new. */
     }
 
-    if (!values) return;  /* legal no-op */
+    todoend = todo;
 
-    switch (param) {
-        case AL_DISTANCE_MODEL: *values = (ALint) ctx->distance_model; break;
-        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    /* ctx->playlist and ALsource->playlist_next are only every touched
+       by the mixer thread, and source pointers live until context destruction. */
+    for (i = todo; i != NULL; i = i->next) {
+        todoend = i;
+        i->source->just_played = AL_TRUE;
+        if ((i->source != ctx->playlist_tail) && (!i->source->playlist_next)) {
+            i->source->playlist_next = ctx->playlist;
+            if (!ctx->playlist) {
+                ctx->playlist_tail = i->source;
+            }
+            ctx->playlist = i->source;
+        }
     }
+
+    /* put these objects back in the pool for reuse */
+    do {
+        todoend->next = i = (SourcePlayTodo *) ctx->device->playback.source_todo_pool;
+    } while (!SDL_AtomicCASPtr(&ctx->device->playback.source_todo_pool, i, todo));
 }
-ENTRYPOINTVOID(alGetIntegerv,(ALenum param, ALint *values),(param,values))
 
-static void _alGetFloatv(const ALenum param, ALfloat *values)
+/* mix every (stride)th source in the playlist, starting with the (first)th one. Keep/remove results go in each source's mixer_keep field. */
+static void mix_playlist_share(ALCcontext *ctx, MixScratch *scratch, float *stream, const int len, const int first, const int stride)
 {
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
-    }
+    ALsource *i = ctx->playlist;
+    int skip;
 
-    if (!values) return;  /* legal no-op */
+    for (skip = first; i && (skip > 0); skip--) {
+        i = i->playlist_next;
+    }
 
-    switch (param) {
-        case AL_DOPPLER_FACTOR: *values = ctx->doppler_factor; break;
-        case AL_DOPPLER_VELOCITY: *values = ctx->doppler_velocity; break;
-        case AL_SPEED_OF_SOUND: *values = ctx->speed_of_sound; break;
-        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    while (i != NULL) {
+        i->mixer_keep = mix_source(ctx, scratch, i, stream, len);
+        for (skip = stride; i && (skip > 0); skip--) {
+            i = i->playlist_next;
+        }
     }
 }
-ENTRYPOINTVOID(alGetFloatv,(ALenum param, ALfloat *values),(param,values))
 
-static void _alGetDoublev(const ALenum param, ALdouble *values)
+static int SDLCALL mixer_worker_thread(void *data)
 {
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
-    }
+    MixerWorker *worker = (MixerWorker *) data;
+    ALCcontext *ctx = worker->ctx;
 
-    if (!values) return;  /* legal no-op */
+    while (AL_TRUE) {
+        SDL_SemWait(worker->wake);
+        if (SDL_AtomicGet(&ctx->mixer_workers_quit)) {
+            break;
+        }
 
-    /* nothing in core OpenAL 1.1 uses this */
-    set_al_error(ctx, AL_INVALID_ENUM);
-}
-ENTRYPOINTVOID(alGetDoublev,(ALenum param, ALdouble *values),(param,values))
+        SDL_memset(worker->mixbuf, '\0', ctx->mixer_work_len);
+        worker->scratch.used = 0;
+        mix_playlist_share(ctx, &worker->scratch, worker->mixbuf, ctx->mixer_work_len, worker->index, ctx->num_mixer_threads);
+        SDL_SemPost(ctx->mixer_workers_done);
+    }
 
-/* no api lock; just passes through to the real api */
-ALboolean alGetBoolean(ALenum param)
-{
-    ALboolean retval = AL_FALSE;
-    alGetBooleanv(param, &retval);
-    return retval;
+    return 0;
 }
 
-/* no api lock; just passes through to the real api */
-ALint alGetInteger(ALenum param)
+static void mix_context_parallel(ALCcontext *ctx, float *stream, int len)
 {
-    ALint retval = 0;
-    alGetIntegerv(param, &retval);
-    return retval;
-}
+    const int num_workers = ctx->num_mixer_threads - 1;
+    const int chunklen = OPENAL_MIXER_THREAD_CHUNK_FRAMES * ctx->device->framesize;
+    ALsource *next = NULL;
+    ALsource *prev = NULL;
+    ALsource *i;
+    int w;
 
-/* no api lock; just passes through to the real api */
-ALfloat alGetFloat(ALenum param)
-{
-    ALfloat retval = 0.0f;
-    alGetFloatv(param, &retval);
-    return retval;
-}
+    /* The workers mix on our behalf, so we hold this for all of them. */
+    SDL_LockMutex(ctx->source_lock);
 
-/* no api lock; just passes through to the real api */
-ALdouble alGetDouble(ALenum param)
+    while (len > 0) {
+        const int mixlen = SDL_min(len, chunklen);
+
+        ctx->mixer_work_len = mixlen;
+        for (w = 0; w < num_workers; w++) {
+            SDL_SemPost(ctx->mixer_workers[w].wake);
+        }
+
+        /* this thread takes the first share, straight into the stream. */
+        mix_playlist_share(ctx, &ctx->scratch, stream, mixlen, 0, ctx->num_mixer_threads);
+
+        for (w = 0; w < num_workers; w++) {
+            SDL_SemWait(ctx->mixer_workers_done);
+        }
+
+        /* always sum in the same order, so the output is deterministic. */
+        for (w = 0; w < num_workers; w++) {
+            mixer_kernels.accumulate_float32(ctx->mixer_workers[w].mixbuf, stream, mixlen / sizeof (float));
+        }
+
+        stream += mixlen / sizeof (float);
+        len -= mixlen;
+    }
+
+    /* now take finished sources out of the playlist, like mix_context() does. */
+    for (i = ctx->playlist; i != NULL; i = next) {
+        next = i->playlist_next;
+        if (!i->mixer_keep) {
+            i->playlist_next = NULL;
+            if (next == NULL) {
+                SDL_assert(i == ctx->playlist_tail);
+                ctx->playlist_tail = prev;
+            }
+            if (prev) {
+                prev->playlist_next = next;
+            } else {
+                SDL_assert(i == ctx->playlist);
+                ctx->playlist = next;
+            }
+            SDL_AtomicSet(&i->mixer_accessible, 0);
+        } else {
+            prev = i;
+        }
+    }
+
+    SDL_UnlockMutex(ctx->source_lock);
+}
+
+static void mix_context(ALCcontext *ctx, float *stream, int len)
 {
-    ALdouble retval = 0.0f;
-    alGetDoublev(param, &retval);
-    return retval;
+    ALsource *next = NULL;
+    ALsource *prev = NULL;
+    ALsource *i;
+
+    migrate_playlist_requests(ctx);
+
+    ctx->scratch.used = 0;  /* nothing from the last callback is still using this. */
+
+    /* do all the spatialization up front, so it can work on lots of sources at once. */
+    SDL_LockMutex(ctx->source_lock);
+    spatialize_playlist(ctx);
+    SDL_UnlockMutex(ctx->source_lock);
+
+    if ((ctx->num_mixer_threads > 1) && (ctx->playlist != NULL)) {
+        mix_context_parallel(ctx, stream, len);
+        return;
+    }
+
+    for (i = ctx->playlist; i != NULL; i = next) {
+        next = i->playlist_next;  /* save this to a local in case we leave the list. */
+
+        SDL_LockMutex(ctx->source_lock);
+        if (!mix_source(ctx, &ctx->scratch, i, stream, len)) {
+            /* take it out of the playlist. It wasn't actually playing or it just finished. */
+            i->playlist_next = NULL;
+            if (next == NULL) {
+                SDL_assert(i == ctx->playlist_tail);
+                ctx->playlist_tail = prev;
+            }
+            if (prev) {
+                prev->playlist_next = next;
+            } else {
+                SDL_assert(i == ctx->playlist);
+                ctx->playlist = next;
+            }
+            SDL_AtomicSet(&i->mixer_accessible, 0);
+        } else {
+            prev = i;
+        }
+        SDL_UnlockMutex(ctx->source_lock);
+    }
 }
 
-static ALenum _alGetError(void)
+/* Disconnected devices move all PLAYING sources to STOPPED, making their buffer queues processed. */
+static void mix_disconnected_context(ALCcontext *ctx)
 {
-    ALCcontext *ctx = get_current_context();
-    ALenum *perr = ctx ? &ctx->error : &null_context_error;
-    const ALenum retval = *perr;
-    *perr = AL_NO_ERROR;
+    ALsource *next = NULL;
+    ALsource *i;
+
+    migrate_playlist_requests(ctx);
+
+    for (i = ctx->playlist; i != NULL; i = next) {
+        next = i->playlist_next;
+
+        SDL_LockMutex(ctx->source_lock);
+        /* remove from playlist; all playing things got stopped, paused/initial/stopped shouldn't be listed. */
+        if (SDL_AtomicGet(&i->state) == AL_PLAYING) {
+            SDL_assert(i->allocated);
+            SDL_AtomicSet(&i->state, AL_STOPPED);
+            source_mark_all_buffers_processed(i);
+        }
+
+        i->playlist_next = NULL;
+        SDL_AtomicSet(&i->mixer_accessible, 0);
+        SDL_UnlockMutex(ctx->source_lock);
+    }
+    ctx->playlist = NULL;
+    ctx->playlist_tail = NULL;
+}
+
+/* We process all unsuspended ALC contexts during this call, mixing their
+   output to (stream). */
+static void mix_device(ALCdevice *device, float *stream, int len, const ALCboolean connected)
+{
+    const Uint64 frames = (Uint64) (len / device->framesize);
+    ALCcontext *ctx;
+
+    device->clock_frames_after_mix = device->clock_frames + frames;
+
+    SDL_memset(stream, '\0', len);
+
+    for (ctx = device->playback.contexts; ctx != NULL; ctx = ctx->next) {
+        if (SDL_AtomicGet(&ctx->processing)) {
+            if (connected) {
+                mix_context(ctx, stream, len);
+            } else {
+                mix_disconnected_context(ctx);
+            }
+        }
+    }
+
+    /* the clock keeps running when disconnected, since the app might be waiting on it. */
+    seqlock_write_begin(&device->clock_seq);
+    device->clock_frames = device->clock_frames_after_mix;
+    seqlock_write_end(&device->clock_seq);
+}
+
+static Uint64 device_get_clock_frames(ALCdevice *device)
+{
+    Uint64 retval;
+    int seq;
+    do {
+        seq = seqlock_read_begin(&device->clock_seq);
+        retval = device->clock_frames;
+    } while (seqlock_read_retry(&device->clock_seq, seq));
     return retval;
 }
-ENTRYPOINT(ALenum,alGetError,(void),())
 
-/* no api lock; immutable (unless we start having contexts with different extensions) */
-ALboolean alIsExtensionPresent(const ALchar *extname)
+static Sint64 device_frames_to_ns(const ALCdevice *device, const Uint64 frames)
 {
-    #define AL_EXTENSION_ITEM(ext) if (SDL_strcasecmp(extname, #ext) == 0) { return AL_TRUE; }
-    AL_EXTENSION_ITEMS
-    #undef AL_EXTENSION_ITEM
-    return AL_FALSE;
+    const Uint64 freq = (Uint64) device->frequency;
+    if (!freq) {
+        return 0;
+    }
+    /* split this up so it doesn't overflow after a few days of uptime. */
+    return (Sint64) (((frames / freq) * 1000000000) + (((frames % freq) * 1000000000) / freq));
 }
 
-static void *_alGetProcAddress(const ALchar *funcname)
+/* How long until something we mix now is heard, in nanoseconds. SDL2 can't
+   tell us about buffering past its own, so this is just the period it's
+   holding on to. Loopback devices hand the mix straight to the app. */
+static Sint64 device_latency_ns(const ALCdevice *device)
 {
-    ALCcontext *ctx = get_current_context();
-    FIXME("fail if ctx == NULL?");
-    if (!funcname) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-        return NULL;
+    if (device->isloopback) {
+        return 0;
     }
+    return device_frames_to_ns(device, (Uint64) device->period_frames);
+}
 
-    #define FN_TEST(fn) if (SDL_strcmp(funcname, #fn) == 0) return (void *) fn
-    FN_TEST(alDopplerFactor);
-    FN_TEST(alDopplerVelocity);
-    FN_TEST(alSpeedOfSound);
-    FN_TEST(alDistanceModel);
-    FN_TEST(alEnable);
-    FN_TEST(alDisable);
-    FN_TEST(alIsEnabled);
-    FN_TEST(alGetString);
-    FN_TEST(alGetBooleanv);
-    FN_TEST(alGetIntegerv);
-    FN_TEST(alGetFloatv);
-    FN_TEST(alGetDoublev);
-    FN_TEST(alGetBoolean);
-    FN_TEST(alGetInteger);
-    FN_TEST(alGetFloat);
-    FN_TEST(alGetDouble);
-    FN_TEST(alGetError);
-    FN_TEST(alIsExtensionPresent);
-    FN_TEST(alGetProcAddress);
-    FN_TEST(alGetEnumValue);
-    FN_TEST(alListenerf);
-    FN_TEST(alListener3f);
-    FN_TEST(alListenerfv);
-    FN_TEST(alListeneri);
-    FN_TEST(alListener3i);
-    FN_TEST(alListeneriv);
-    FN_TEST(alGetListenerf);
-    FN_TEST(alGetListener3f);
-    FN_TEST(alGetListenerfv);
-    FN_TEST(alGetListeneri);
-    FN_TEST(alGetListener3i);
-    FN_TEST(alGetListeneriv);
-    FN_TEST(alGenSources);
-    FN_TEST(alDeleteSources);
-    FN_TEST(alIsSource);
-    FN_TEST(alSourcef);
-    FN_TEST(alSource3f);
-    FN_TEST(alSourcefv);
-    FN_TEST(alSourcei);
-    FN_TEST(alSource3i);
-    FN_TEST(alSourceiv);
-    FN_TEST(alGetSourcef);
-    FN_TEST(alGetSource3f);
-    FN_TEST(alGetSourcefv);
-    FN_TEST(alGetSourcei);
-    FN_TEST(alGetSource3i);
-    FN_TEST(alGetSourceiv);
-    FN_TEST(alSourcePlayv);
-    FN_TEST(alSourceStopv);
-    FN_TEST(alSourceRewindv);
-    FN_TEST(alSourcePausev);
-    FN_TEST(alSourcePlay);
-    FN_TEST(alSourceStop);
-    FN_TEST(alSourceRewind);
-    FN_TEST(alSourcePause);
-    FN_TEST(alSourceQueueBuffers);
-    FN_TEST(alSourceUnqueueBuffers);
-    FN_TEST(alGenBuffers);
-    FN_TEST(alDeleteBuffers);
-    FN_TEST(alIsBuffer);
-    FN_TEST(alBufferData);
-    FN_TEST(alBufferf);
-    FN_TEST(alBuffer3f);
-    FN_TEST(alBufferfv);
-    FN_TEST(alBufferi);
-    FN_TEST(alBuffer3i);
-    FN_TEST(alBufferiv);
-    FN_TEST(alGetBufferf);
-    FN_TEST(alGetBuffer3f);
-    FN_TEST(alGetBufferfv);
-    FN_TEST(alGetBufferi);
-    FN_TEST(alGetBuffer3i);
-    FN_TEST(alGetBufferiv);
-    #undef FN_TEST
+/* SDL plays the mixed audio to the hardware after this returns. */
+static void SDLCALL playback_device_callback(void *userdata, Uint8 *stream, int len)
+{
+    ALCdevice *device = (ALCdevice *) userdata;
+    ALCboolean connected = ALC_FALSE;
 
-    set_al_error(ctx, ALC_INVALID_VALUE);
-    return NULL;
+    if (SDL_AtomicGet(&device->connected)) {
+        if (SDL_GetAudioDeviceStatus(device->sdldevice) == SDL_AUDIO_STOPPED) {
+            SDL_AtomicSet(&device->connected, ALC_FALSE);
+        } else {
+            connected = ALC_TRUE;
+        }
+    }
+
+    mix_device(device, (float *) stream, len, connected);
+}
+
+static ALCboolean alcloopbackfmt_to_sdlfmt(const ALCenum type, SDL_AudioFormat *sdlfmt)
+{
+    switch (type) {
+        case ALC_BYTE_SOFT: *sdlfmt = AUDIO_S8; break;
+        case ALC_UNSIGNED_BYTE_SOFT: *sdlfmt = AUDIO_U8; break;
+        case ALC_SHORT_SOFT: *sdlfmt = AUDIO_S16SYS; break;
+        case ALC_UNSIGNED_SHORT_SOFT: *sdlfmt = AUDIO_U16SYS; break;
+        case ALC_INT_SOFT: *sdlfmt = AUDIO_S32SYS; break;
+        case ALC_FLOAT_SOFT: *sdlfmt = AUDIO_F32SYS; break;
+        default: return ALC_FALSE;  /* SDL doesn't do ALC_UNSIGNED_INT_SOFT. */
+    }
+    return ALC_TRUE;
+}
+
+static ALCboolean alcloopbackchannels_to_sdlchannels(const ALCenum channels, Uint8 *sdlchannels)
+{
+    switch (channels) {
+        case ALC_MONO_SOFT: *sdlchannels = 1; break;
+        case ALC_STEREO_SOFT: *sdlchannels = 2; break;
+        case ALC_QUAD_SOFT: *sdlchannels = 4; break;
+        case ALC_5POINT1_SOFT: *sdlchannels = 6; break;
+        case ALC_6POINT1_SOFT: *sdlchannels = 7; break;
+        case ALC_7POINT1_SOFT: *sdlchannels = 8; break;
+        default: return ALC_FALSE;
+    }
+    return ALC_TRUE;
+}
+
+/* How many channels we mix for an ALC_OUTPUT_MODE_SOFT value, or a loopback
+   device's ALC_FORMAT_CHANNELS_SOFT (the surround layouts use the same enums).
+   There's no mono mixer; mono gets mixed as stereo, and SDL downmixes it. */
+static ALCint output_mode_channels(const ALCenum mode)
+{
+    switch (mode) {
+        case ALC_QUAD_SOFT: return 4;
+        case ALC_SURROUND_5_1_SOFT: return 6;
+        case ALC_SURROUND_6_1_SOFT: return 7;
+        case ALC_SURROUND_7_1_SOFT: return 8;
+        default: break;
+    }
+    return 2;  /* ALC_ANY_SOFT, mono, all the stereo modes, and anything we don't know. */
+}
+
+static ALCenum channels_output_mode(const ALCint channels)
+{
+    switch (channels) {
+        case 4: return ALC_QUAD_SOFT;
+        case 6: return ALC_SURROUND_5_1_SOFT;
+        case 7: return ALC_SURROUND_6_1_SOFT;
+        case 8: return ALC_SURROUND_7_1_SOFT;
+        default: break;
+    }
+    return ALC_STEREO_BASIC_SOFT;
+}
+
+/* the mixer always works in float32, in the app's channel layout if it can; this figures out how to get from there to what the app wants. */
+static ALCboolean build_loopback_cvt(SDL_AudioCVT *cvt, const ALCsizei freq, const ALCenum channels, const ALCenum type, ALCsizei *framesize)
+{
+    SDL_AudioFormat sdlfmt;
+    Uint8 sdlchannels;
+
+    if (freq <= 0) {
+        return ALC_FALSE;
+    } else if (!alcloopbackfmt_to_sdlfmt(type, &sdlfmt)) {
+        return ALC_FALSE;
+    } else if (!alcloopbackchannels_to_sdlchannels(channels, &sdlchannels)) {
+        return ALC_FALSE;
+    }
+
+    SDL_zerop(cvt);
+    if (SDL_BuildAudioCVT(cvt, AUDIO_F32SYS, (Uint8) output_mode_channels(channels), (int) freq, sdlfmt, sdlchannels, (int) freq) == -1) {
+        return ALC_FALSE;
+    }
+
+    if (framesize) {
+        *framesize = (ALCsizei) ((SDL_AUDIO_BITSIZE(sdlfmt) / 8) * sdlchannels);
+    }
+
+    return ALC_TRUE;
+}
+
+static void stop_mixer_workers(ALCcontext *ctx)
+{
+    int i;
+
+    if (!ctx->mixer_workers) {
+        return;
+    }
+
+    SDL_AtomicSet(&ctx->mixer_workers_quit, 1);
+    for (i = 0; i < ctx->num_mixer_threads - 1; i++) {
+        SDL_SemPost(ctx->mixer_workers[i].wake);
+    }
+
+    for (i = 0; i < ctx->num_mixer_threads - 1; i++) {
+        MixerWorker *worker = &ctx->mixer_workers[i];
+        SDL_WaitThread(worker->thread, NULL);
+        SDL_DestroySemaphore(worker->wake);
+        free_mix_scratch(&worker->scratch);
+        free_simd_aligned(worker->mixbuf);
+    }
+
+    SDL_DestroySemaphore(ctx->mixer_workers_done);
+    SDL_free(ctx->mixer_workers);
+    ctx->mixer_workers = NULL;
+    ctx->mixer_workers_done = NULL;
+    ctx->num_mixer_threads = 1;
+}
+
+/* This isn't an error if it fails, we'll just mix with however many threads we managed to start. */
+static void start_mixer_workers(ALCcontext *ctx, const int num_threads)
+{
+    const size_t mixbuflen = OPENAL_MIXER_THREAD_CHUNK_FRAMES * ctx->device->framesize;
+    int i;
+
+    ctx->num_mixer_threads = 1;
+    if (num_threads <= 1) {
+        return;
+    }
+
+    ctx->mixer_workers = (MixerWorker *) SDL_calloc(num_threads - 1, sizeof (MixerWorker));
+    ctx->mixer_workers_done = SDL_CreateSemaphore(0);
+    if (!ctx->mixer_workers || !ctx->mixer_workers_done) {
+        SDL_DestroySemaphore(ctx->mixer_workers_done);
+        SDL_free(ctx->mixer_workers);
+        ctx->mixer_workers = NULL;
+        ctx->mixer_workers_done = NULL;
+        return;
+    }
+
+    /* num_mixer_threads is read by the workers, but they don't wake up until the mixer thread sees this context. */
+    for (i = 0; i < num_threads - 1; i++) {
+        MixerWorker *worker = &ctx->mixer_workers[ctx->num_mixer_threads - 1];
+        worker->ctx = ctx;
+        worker->index = ctx->num_mixer_threads;
+        worker->mixbuf = (float *) calloc_simd_aligned(mixbuflen);
+        worker->wake = (worker->mixbuf && init_mix_scratch(&worker->scratch, OPENAL_MIXER_THREAD_CHUNK_FRAMES)) ? SDL_CreateSemaphore(0) : NULL;
+        worker->thread = worker->wake ? SDL_CreateThread(mixer_worker_thread, "MojoAL mixer", worker) : NULL;
+        if (!worker->thread) {
+            SDL_DestroySemaphore(worker->wake);
+            free_mix_scratch(&worker->scratch);
+            free_simd_aligned(worker->mixbuf);
+            SDL_zerop(worker);
+            break;
+        }
+        ctx->num_mixer_threads++;
+    }
+
+    if (ctx->num_mixer_threads == 1) {
+        stop_mixer_workers(ctx);  /* didn't get any threads at all; clean up. */
+    }
+}
+
+/* The first context on a device picks its period. An explicit
+   ALC_PERIOD_FRAMES_MOJOAL is rounded up to a power of two (SDL wants one),
+   otherwise ALC_REFRESH (mixes per second) picks the closest one. */
+static ALCint choose_period_frames(const ALCint freq, const ALCint refresh, const ALCint period_frames)
+{
+    ALCint wanted = OPENAL_DEFAULT_PERIOD_FRAMES;
+    ALCint retval = OPENAL_MIN_PERIOD_FRAMES;
+
+    if (period_frames > 0) {
+        wanted = SDL_clamp(period_frames, OPENAL_MIN_PERIOD_FRAMES, OPENAL_MAX_PERIOD_FRAMES);
+        while (retval < wanted) {
+            retval *= 2;
+        }
+    } else {
+        if ((refresh > 0) && (freq > 0)) {
+            wanted = freq / refresh;
+        }
+        wanted = SDL_clamp(wanted, OPENAL_MIN_PERIOD_FRAMES, OPENAL_MAX_PERIOD_FRAMES);
+        while ((retval * 2) <= wanted) {
+            retval *= 2;
+        }
+        if ((wanted - retval) > ((retval * 2) - wanted)) {
+            retval *= 2;  /* closer to the next one up. */
+        }
+    }
+
+    return retval;
+}
+
+static ALCcontext *_alcCreateContext(ALCdevice *device, const ALCint* attrlist)
+{
+    ALCcontext *retval = NULL;
+    ALCsizei attrcount = 0;
+    ALCint freq = 48000;
+    ALCboolean sync = ALC_FALSE;
+    ALCint refresh = 0;
+    ALCint period_frames = 0;
+    ALCenum loopback_channels = 0;
+    ALCenum loopback_type = 0;
+    ALCenum output_mode = ALC_ANY_SOFT;
+    ALCint mixer_threads = 1;
+    ALCboolean fast_math = ALC_FALSE;  /* apps have to ask for ALC_FAST_MATH_MOJOAL; by default we sound like we always did. */
+    ALCboolean native_buffer_format = ALC_FALSE;
+    /* we don't care about ALC_MONO_SOURCES or ALC_STEREO_SOURCES as we have no hardware limitation. */
+
+    if (!device) {
+        set_alc_error(NULL, ALC_INVALID_DEVICE);
+        return NULL;
+    }
+
+    if (!SDL_AtomicGet(&device->connected)) {
+        set_alc_error(device, ALC_INVALID_DEVICE);
+        return NULL;
+    }
+
+    if (attrlist != NULL) {
+        ALCint attr;
+        while ((attr = attrlist[attrcount++]) != 0) {
+            switch (attr) {
+                case ALC_FREQUENCY: freq = attrlist[attrcount++]; break;
+                case ALC_REFRESH: refresh = attrlist[attrcount++]; break;
+                case ALC_SYNC: sync = (attrlist[attrcount++] ? ALC_TRUE : ALC_FALSE); break;
+                case ALC_FORMAT_CHANNELS_SOFT: loopback_channels = (ALCenum) attrlist[attrcount++]; break;
+                case ALC_FORMAT_TYPE_SOFT: loopback_type = (ALCenum) attrlist[attrcount++]; break;
+                case ALC_MIXER_THREADS_MOJOAL: mixer_threads = attrlist[attrcount++]; break;
+                case ALC_PERIOD_FRAMES_MOJOAL: period_frames = attrlist[attrcount++]; break;
+                case ALC_FAST_MATH_MOJOAL: fast_math = (attrlist[attrcount++] ? ALC_TRUE : ALC_FALSE); break;
+                case ALC_NATIVE_BUFFER_FORMAT_MOJOAL: native_buffer_format = (attrlist[attrcount++] ? ALC_TRUE : ALC_FALSE); break;
+                case ALC_OUTPUT_MODE_SOFT: output_mode = (ALCenum) attrlist[attrcount++]; break;
+                default: FIXME("fail for unknown attributes?"); break;
+            }
+        }
+    }
+
+    FIXME("use this variable at some point"); (void) sync;
+
+    retval = (ALCcontext *) calloc_simd_aligned(sizeof (ALCcontext));
+    if (!retval) {
+        set_alc_error(device, ALC_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    /* Make sure everything that wants to use SIMD is aligned for it. */
+    SDL_assert( (((size_t) &retval->listener.position[0]) % 16) == 0 );
+    SDL_assert( (((size_t) &retval->listener.orientation[0]) % 16) == 0 );
+    SDL_assert( (((size_t) &retval->listener.velocity[0]) % 16) == 0 );
+
+    retval->source_lock = SDL_CreateMutex();
+    if (!retval->source_lock) {
+        set_alc_error(device, ALC_OUT_OF_MEMORY);
+        free_simd_aligned(retval);
+        return NULL;
+    }
+
+    retval->attributes = (ALCint *) SDL_malloc(attrcount * sizeof (ALCint));
+    if (!retval->attributes) {
+        set_alc_error(device, ALC_OUT_OF_MEMORY);
+        SDL_DestroyMutex(retval->source_lock);
+        free_simd_aligned(retval);
+        return NULL;
+    }
+    SDL_memcpy(retval->attributes, attrlist, attrcount * sizeof (ALCint));
+    retval->attributes_count = attrcount;
+
+    if (device->isloopback) {
+        /* the first context decides the loopback format, just like the first context opens the SDL device. */
+        if (!device->framesize) {
+            SDL_AudioCVT *cvt = &device->playback.loopback.cvt;
+            ALCsizei framesize = 0;
+            if (!build_loopback_cvt(cvt, freq, loopback_channels, loopback_type, &framesize)) {
+                SDL_DestroyMutex(retval->source_lock);
+                SDL_free(retval->attributes);
+                free_simd_aligned(retval);
+                set_alc_error(device, ALC_INVALID_VALUE);  /* the spec says loopback contexts _must_ specify a supported format. */
+                return NULL;
+            }
+
+            if (cvt->needed) {
+                const int mixbuflen = OPENAL_LOOPBACK_PERIOD_FRAMES * sizeof (float) * output_mode_channels(loopback_channels);
+                device->playback.loopback.mixbuf = (float *) calloc_simd_aligned(mixbuflen * SDL_max(cvt->len_mult, 1));
+                if (!device->playback.loopback.mixbuf) {
+                    SDL_DestroyMutex(retval->source_lock);
+                    SDL_free(retval->attributes);
+                    free_simd_aligned(retval);
+                    set_alc_error(device, ALC_OUT_OF_MEMORY);
+                    return NULL;
+                }
+            }
+
+            device->playback.loopback.framesize = framesize;
+            device->period_frames = OPENAL_LOOPBACK_PERIOD_FRAMES;
+            device->channels = output_mode_channels(loopback_channels);
+            device->frequency = freq;
+            device->framesize = sizeof (float) * device->channels;
+            device->output_mode = (loopback_channels == ALC_MONO_SOFT) ? ALC_MONO_SOFT : channels_output_mode(device->channels);
+            init_speaker_panning(&device->speakers, device->channels);
+        }
+    } else if (!device->sdldevice) {
+        SDL_AudioSpec desired, obtained;
+        const char *devicename = device->name;
+
+        if (SDL_strcmp(devicename, DEFAULT_PLAYBACK_DEVICE) == 0) {
+            devicename = NULL;  /* tell SDL we want the best default */
+        }
+
+        /* we always want to work in float32, to keep our work simple and
+           let us use SIMD, and we'll let SDL convert when feeding the device.
+           We mix in the speaker layout the app asked for; if the hardware
+           has something else, SDL converts that, too. */
+        SDL_zero(desired);
+        desired.freq = freq;
+        desired.format = AUDIO_F32SYS;
+        desired.channels = (Uint8) output_mode_channels(output_mode);
+        desired.samples = (Uint16) choose_period_frames(freq, refresh, period_frames);
+        desired.callback = playback_device_callback;
+        desired.userdata = device;
+        /* SDL still converts format, rate and channels for us, but letting it
+           change the period means we can mix straight into the hardware's
+           buffer, without SDL adding another period of latency to cover the
+           difference. */
+        device->sdldevice = SDL_OpenAudioDevice(devicename, 0, &desired, &obtained, SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+        if (!device->sdldevice) {
+            SDL_DestroyMutex(retval->source_lock);
+            SDL_free(retval->attributes);
+            free_simd_aligned(retval);
+            FIXME("What error do you set for this?");
+            return NULL;
+        }
+        device->channels = desired.channels;
+        device->frequency = freq;
+        device->framesize = sizeof (float) * device->channels;
+        device->output_mode = channels_output_mode(device->channels);
+        init_speaker_panning(&device->speakers, device->channels);
+        device->period_frames = obtained.samples ? obtained.samples : desired.samples;  /* we get exactly this much per callback. */
+        SDL_PauseAudioDevice(device->sdldevice, 0);
+    }
+
+    if (!init_mix_scratch(&retval->scratch, device->period_frames)) {
+        SDL_DestroyMutex(retval->source_lock);
+        SDL_free(retval->attributes);
+        free_simd_aligned(retval);
+        set_alc_error(device, ALC_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    retval->distance_model = AL_INVERSE_DISTANCE_CLAMPED;
+    retval->doppler_factor = 1.0f;
+    retval->doppler_velocity = 1.0f;
+    retval->speed_of_sound = 343.3f;
+    retval->fast_math = fast_math;
+    retval->native_buffer_format = native_buffer_format;
+    retval->listener.gain = 1.0f;
+    retval->listener.orientation[2] = -1.0f;
+    retval->listener.orientation[5] = 1.0f;
+    retval->device = device;
+    context_needs_recalc(retval);
+    SDL_AtomicSet(&retval->processing, 1);  /* contexts default to processing */
+
+    if (mixer_threads == 0) {
+        mixer_threads = SDL_GetCPUCount();  /* zero means "use every core." */
+    }
+    start_mixer_workers(retval, SDL_clamp(mixer_threads, 1, OPENAL_MAX_MIXER_THREADS));
+
+    lock_mixer(device);
+    if (device->playback.contexts != NULL) {
+        SDL_assert(device->playback.contexts->prev == NULL);
+        device->playback.contexts->prev = retval;
+    }
+    retval->next = device->playback.contexts;
+    device->playback.contexts = retval;
+    unlock_mixer(device);
+
+    return retval;
+}
+ENTRYPOINT(ALCcontext *,alcCreateContext,(ALCdevice *device, const ALCint* attrlist),(device,attrlist))
+
+
+static SDL_INLINE ALCcontext *get_current_context(void)
+{
+    return (ALCcontext *) SDL_AtomicGetPtr(&current_context);
+}
+
+/* no api lock; it just sets an atomic pointer at the moment */
+ALCboolean alcMakeContextCurrent(ALCcontext *ctx)
+{
+    SDL_AtomicSetPtr(&current_context, ctx);
+    FIXME("any reason this might return ALC_FALSE?");
+    return ALC_TRUE;
+}
+
+/* AL_SOFT_deferred_updates. Property changes still land in the context and
+   its sources right away, so the app can query them back, but the mixer
+   ignores them while we're deferring. Taking source_lock here means the
+   mixer is never in the middle of spatializing when this changes, so when
+   updates are processed, everything changed since they were deferred is
+   picked up together on the next mix. */
+static void context_defer_updates(ALCcontext *ctx, const ALboolean defer)
+{
+    SDL_LockMutex(ctx->source_lock);
+    ctx->deferring = defer;
+    SDL_UnlockMutex(ctx->source_lock);
+}
+
+/* OpenAL Soft treats suspending a context as deferring its updates instead
+   of halting it, and apps use it that way to batch changes, so we do too. */
+static void _alcProcessContext(ALCcontext *ctx)
+{
+    if (!ctx) {
+        set_alc_error(NULL, ALC_INVALID_CONTEXT);
+        return;
+    }
+
+    SDL_assert(!ctx->device->iscapture);
+    context_defer_updates(ctx, AL_FALSE);
+}
+ENTRYPOINTVOID(alcProcessContext,(ALCcontext *ctx),(ctx))
+
+static void _alcSuspendContext(ALCcontext *ctx)
+{
+    if (!ctx) {
+        set_alc_error(NULL, ALC_INVALID_CONTEXT);
+    } else {
+        SDL_assert(!ctx->device->iscapture);
+        context_defer_updates(ctx, AL_TRUE);
+    }
+}
+ENTRYPOINTVOID(alcSuspendContext,(ALCcontext *ctx),(ctx))
+
+static void _alcDestroyContext(ALCcontext *ctx)
+{
+    ALsizei blocki;
+
+    FIXME("Should NULL context be an error?");
+    if (!ctx) return;
+
+    /* The spec says it's illegal to delete the current context. */
+    if (get_current_context() == ctx) {
+        set_alc_error(ctx->device, ALC_INVALID_CONTEXT);
+        return;
+    }
+
+    /* do this first in case the mixer is running _right now_. */
+    SDL_AtomicSet(&ctx->processing, 0);
+
+    lock_mixer(ctx->device);
+    if (ctx->prev) {
+        ctx->prev->next = ctx->next;
+    } else {
+        SDL_assert(ctx == ctx->device->playback.contexts);
+        ctx->device->playback.contexts = ctx->next;
+    }
+    if (ctx->next) {
+        ctx->next->prev = ctx->prev;
+    }
+    unlock_mixer(ctx->device);
+
+    stop_mixer_workers(ctx);
+
+    for (blocki = 0; blocki < ctx->num_source_blocks; blocki++) {
+        SourceBlock *sb = ctx->source_blocks[blocki];
+        if (sb->used > 0) {
+            ALsizei i;
+            for (i = 0; i < SDL_arraysize(sb->sources); i++) {
+                ALsource *src = &sb->sources[i];
+                if (!src->allocated) {
+                    continue;
+                }
+
+                source_release_buffer_queue(ctx, src);
+                free_simd_aligned(src->pitchstate);
+                free_simd_aligned(src->callback_data);
+                if (--sb->used == 0) {
+                    break;
+                }
+            }
+        }
+        free_simd_aligned(sb);
+    }
+
+    SDL_DestroyMutex(ctx->source_lock);
+    free_mix_scratch(&ctx->scratch);
+    SDL_free(ctx->source_blocks);
+    SDL_free(ctx->attributes);
+    free_simd_aligned(ctx);
+}
+ENTRYPOINTVOID(alcDestroyContext,(ALCcontext *ctx),(ctx))
+
+/* no api lock; atomic. */
+ALCcontext *alcGetCurrentContext(void)
+{
+    return get_current_context();
+}
+
+/* no api lock; immutable. */
+ALCdevice *alcGetContextsDevice(ALCcontext *context)
+{
+    return context ? context->device : NULL;
+}
+
+static ALCenum _alcGetError(ALCdevice *device)
+{
+    ALCenum *perr = device ? &device->error : &null_device_error;
+    const ALCenum retval = *perr;
+    *perr = ALC_NO_ERROR;
+    return retval;
+}
+ENTRYPOINT(ALCenum,alcGetError,(ALCdevice *device),(device))
+
+/* no api lock; immutable */
+ALCboolean alcIsExtensionPresent(ALCdevice *device, const ALCchar *extname)
+{
+    #define ALC_EXTENSION_ITEM(ext) if (SDL_strcasecmp(extname, #ext) == 0) { return ALC_TRUE; }
+    ALC_EXTENSION_ITEMS
+    #undef ALC_EXTENSION_ITEM
+    return ALC_FALSE;
+}
+
+/* no api lock; immutable */
+void *alcGetProcAddress(ALCdevice *device, const ALCchar *funcname)
+{
+    if (!funcname) {
+        set_alc_error(device, ALC_INVALID_VALUE);
+        return NULL;
+    }
+
+    #define FN_TEST(fn) if (SDL_strcmp(funcname, #fn) == 0) return (void *) fn
+    FN_TEST(alcCreateContext);
+    FN_TEST(alcMakeContextCurrent);
+    FN_TEST(alcProcessContext);
+    FN_TEST(alcSuspendContext);
+    FN_TEST(alcDestroyContext);
+    FN_TEST(alcGetCurrentContext);
+    FN_TEST(alcGetContextsDevice);
+    FN_TEST(alcOpenDevice);
+    FN_TEST(alcCloseDevice);
+    FN_TEST(alcGetError);
+    FN_TEST(alcIsExtensionPresent);
+    FN_TEST(alcGetProcAddress);
+    FN_TEST(alcGetEnumValue);
+    FN_TEST(alcGetString);
+    FN_TEST(alcGetIntegerv);
+    FN_TEST(alcCaptureOpenDevice);
+    FN_TEST(alcCaptureCloseDevice);
+    FN_TEST(alcCaptureStart);
+    FN_TEST(alcCaptureStop);
+    FN_TEST(alcCaptureSamples);
+    FN_TEST(alcLoopbackOpenDeviceSOFT);
+    FN_TEST(alcIsRenderFormatSupportedSOFT);
+    FN_TEST(alcRenderSamplesSOFT);
+    FN_TEST(alcGetInteger64vSOFT);
+    #undef FN_TEST
+
+    set_alc_error(device, ALC_INVALID_VALUE);
+    return NULL;
+}
+
+/* no api lock; immutable */
+ALCenum alcGetEnumValue(ALCdevice *device, const ALCchar *enumname)
+{
+    if (!enumname) {
+        set_alc_error(device, ALC_INVALID_VALUE);
+        return (ALCenum) AL_NONE;
+    }
+
+    #define ENUM_TEST(en) if (SDL_strcmp(enumname, #en) == 0) return en
+    ENUM_TEST(ALC_FALSE);
+    ENUM_TEST(ALC_TRUE);
+    ENUM_TEST(ALC_FREQUENCY);
+    ENUM_TEST(ALC_REFRESH);
+    ENUM_TEST(ALC_SYNC);
+    ENUM_TEST(ALC_MONO_SOURCES);
+    ENUM_TEST(ALC_STEREO_SOURCES);
+    ENUM_TEST(ALC_NO_ERROR);
+    ENUM_TEST(ALC_INVALID_DEVICE);
+    ENUM_TEST(ALC_INVALID_CONTEXT);
+    ENUM_TEST(ALC_INVALID_ENUM);
+    ENUM_TEST(ALC_INVALID_VALUE);
+    ENUM_TEST(ALC_OUT_OF_MEMORY);
+    ENUM_TEST(ALC_MAJOR_VERSION);
+    ENUM_TEST(ALC_MINOR_VERSION);
+    ENUM_TEST(ALC_ATTRIBUTES_SIZE);
+    ENUM_TEST(ALC_ALL_ATTRIBUTES);
+    ENUM_TEST(ALC_DEFAULT_DEVICE_SPECIFIER);
+    ENUM_TEST(ALC_DEVICE_SPECIFIER);
+    ENUM_TEST(ALC_EXTENSIONS);
+    ENUM_TEST(ALC_CAPTURE_DEVICE_SPECIFIER);
+    ENUM_TEST(ALC_CAPTURE_DEFAULT_DEVICE_SPECIFIER);
+    ENUM_TEST(ALC_CAPTURE_SAMPLES);
+    ENUM_TEST(ALC_DEFAULT_ALL_DEVICES_SPECIFIER);
+    ENUM_TEST(ALC_ALL_DEVICES_SPECIFIER);
+    ENUM_TEST(ALC_CONNECTED);
+    ENUM_TEST(ALC_FORMAT_CHANNELS_SOFT);
+    ENUM_TEST(ALC_FORMAT_TYPE_SOFT);
+    ENUM_TEST(ALC_MIXER_THREADS_MOJOAL);
+    ENUM_TEST(ALC_PERIOD_FRAMES_MOJOAL);
+    ENUM_TEST(ALC_FAST_MATH_MOJOAL);
+    ENUM_TEST(ALC_NATIVE_BUFFER_FORMAT_MOJOAL);
+    ENUM_TEST(ALC_DEVICE_CLOCK_SOFT);
+    ENUM_TEST(ALC_DEVICE_LATENCY_SOFT);
+    ENUM_TEST(ALC_DEVICE_CLOCK_LATENCY_SOFT);
+    ENUM_TEST(ALC_OUTPUT_MODE_SOFT);
+    ENUM_TEST(ALC_ANY_SOFT);
+    ENUM_TEST(ALC_STEREO_BASIC_SOFT);
+    ENUM_TEST(ALC_STEREO_UHJ_SOFT);
+    ENUM_TEST(ALC_STEREO_HRTF_SOFT);
+    ENUM_TEST(ALC_SURROUND_5_1_SOFT);
+    ENUM_TEST(ALC_SURROUND_6_1_SOFT);
+    ENUM_TEST(ALC_SURROUND_7_1_SOFT);
+    ENUM_TEST(ALC_BYTE_SOFT);
+    ENUM_TEST(ALC_UNSIGNED_BYTE_SOFT);
+    ENUM_TEST(ALC_SHORT_SOFT);
+    ENUM_TEST(ALC_UNSIGNED_SHORT_SOFT);
+    ENUM_TEST(ALC_INT_SOFT);
+    ENUM_TEST(ALC_UNSIGNED_INT_SOFT);
+    ENUM_TEST(ALC_FLOAT_SOFT);
+    ENUM_TEST(ALC_MONO_SOFT);
+    ENUM_TEST(ALC_STEREO_SOFT);
+    ENUM_TEST(ALC_QUAD_SOFT);
+    ENUM_TEST(ALC_5POINT1_SOFT);
+    ENUM_TEST(ALC_6POINT1_SOFT);
+    ENUM_TEST(ALC_7POINT1_SOFT);
+    #undef ENUM_TEST
+
+    set_alc_error(device, ALC_INVALID_VALUE);
+    return (ALCenum) AL_NONE;
+}
+
+static const ALCchar *calculate_sdl_device_list(const int iscapture)
+{
+    /* alcGetString() has to return a const string that is not freed and might
+       continue to live even if we update this list in a later query, so we
+       just make a big static buffer and hope it's large enough and that other
+       race conditions don't bite us. The enumeration extension shouldn't have
+       reused entry points, or done this silly null-delimited string list.
+       Oh well. */
+    #define DEVICE_LIST_BUFFER_SIZE 512
+    static ALCchar playback_list[DEVICE_LIST_BUFFER_SIZE];
+    static ALCchar capture_list[DEVICE_LIST_BUFFER_SIZE];
+    ALCchar *final_list = iscapture ? capture_list : playback_list;
+    ALCchar *ptr = final_list;
+    int numdevs;
+    size_t avail = DEVICE_LIST_BUFFER_SIZE;
+    size_t cpy;
+    int i;
+
+    /* default device is always available. */
+    cpy = SDL_strlcpy(ptr, iscapture ? DEFAULT_CAPTURE_DEVICE : DEFAULT_PLAYBACK_DEVICE, avail);
+    SDL_assert((cpy+1) < avail);
+    ptr += cpy + 1;  /* skip past null char. */
+    avail -= cpy + 1;
+
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) == -1) {
+        return NULL;
+    }
+
+    if (!init_api_lock()) {
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return NULL;
+    }
+
+    grab_api_lock();
+
+    numdevs = SDL_GetNumAudioDevices(iscapture);
+
+    for (i = 0; i < numdevs; i++) {
+        const char *devname = SDL_GetAudioDeviceName(i, iscapture);
+        const size_t devnamelen = SDL_strlen(devname);
+        /* if we're out of space, we just have to drop devices we can't cram in the buffer. */
+        if (avail > (devnamelen + 2)) {
+            cpy = SDL_strlcpy(ptr, devname, avail);
+            SDL_assert(cpy == devnamelen);
+            SDL_assert((cpy+1) < avail);
+            ptr += cpy + 1;  /* skip past null char. */
+            avail -= cpy + 1;
+        }
+    }
+
+    SDL_assert(avail >= 1);
+    *ptr = '\0';
+
+    ungrab_api_lock();
+
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+
+    return final_list;
+
+    #undef DEVICE_LIST_BUFFER_SIZE
+}
+
+/* no api lock; immutable (unless it isn't, then we manually lock). */
+const ALCchar *alcGetString(ALCdevice *device, ALCenum param)
+{
+    switch (param) {
+        case ALC_EXTENSIONS: {
+            #define ALC_EXTENSION_ITEM(ext) " " #ext
+            static ALCchar alc_extensions_string[] = ALC_EXTENSION_ITEMS;
+            #undef ALC_EXTENSION_ITEM
+            return alc_extensions_string + 1;  /* skip that first space char */
+        }
+
+        /* You open the default SDL device with a NULL device name, but that is how OpenAL
+           reports an error here, so we give it a magic identifier here instead. */
+        case ALC_DEFAULT_DEVICE_SPECIFIER:
+            return DEFAULT_PLAYBACK_DEVICE;
+
+        case ALC_CAPTURE_DEFAULT_DEVICE_SPECIFIER:
+            return DEFAULT_CAPTURE_DEVICE;
+
+        case ALC_DEVICE_SPECIFIER:
+            FIXME("should return NULL if device->iscapture?");
+            return device ? device->name : calculate_sdl_device_list(0);
+
+        case ALC_CAPTURE_DEVICE_SPECIFIER:
+            FIXME("should return NULL if !device->iscapture?");
+            return device ? device->name : calculate_sdl_device_list(1);
+
+        case ALC_NO_ERROR: return "ALC_NO_ERROR";
+        case ALC_INVALID_DEVICE: return "ALC_INVALID_DEVICE";
+        case ALC_INVALID_CONTEXT:return "ALC_INVALID_CONTEXT";
+        case ALC_INVALID_ENUM: return "ALC_INVALID_ENUM";
+        case ALC_INVALID_VALUE: return "ALC_INVALID_VALUE";
+        case ALC_OUT_OF_MEMORY: return "ALC_OUT_OF_MEMORY";
+
+        default: break;
+    }
+
+    FIXME("other enums that should report as strings?");
+    set_alc_error(device, ALC_INVALID_ENUM);
+    return NULL;
+}
+
+static void _alcGetIntegerv(ALCdevice *device, const ALCenum param, const ALCsizei size, ALCint *values)
+{
+    ALCcontext *ctx = NULL;
+
+    if (!size || !values) {
+        return;  /* "A NULL destination or a zero size parameter will cause ALC to ignore the query." */
+    }
+
+    switch (param) {
+        case ALC_CAPTURE_SAMPLES:
+            if (!device || !device->iscapture) {
+                set_alc_error(device, ALC_INVALID_DEVICE);
+                return;
+            }
+
+            FIXME("make ring buffer atomic?");
+            SDL_LockAudioDevice(device->sdldevice);
+            *values = (ALCint) (device->capture.ring.used / device->framesize);
+            SDL_UnlockAudioDevice(device->sdldevice);
+            return;
+
+        case ALC_CONNECTED:
+            if (device) {
+                *values = SDL_AtomicGet(&device->connected) ? ALC_TRUE : ALC_FALSE;
+            } else {
+                *values = ALC_FALSE;
+                set_alc_error(device, ALC_INVALID_DEVICE);
+            }
+            return;
+
+        case ALC_ATTRIBUTES_SIZE:
+        case ALC_ALL_ATTRIBUTES:
+            if (!device || device->iscapture) {
+                *values = 0;
+                set_alc_error(device, ALC_INVALID_DEVICE);
+                return;
+            }
+
+            ctx = get_current_context();
+
+            FIXME("wants 'current context of specified device', but there isn't a current context per-device...");
+            if ((!ctx) || (ctx->device != device)) {
+                *values = 0;
+                set_alc_error(device, ALC_INVALID_CONTEXT);
+                return;
+            }
+
+            if (param == ALC_ALL_ATTRIBUTES) {
+                if (size < ctx->attributes_count) {
+                    *values = 0;
+                    set_alc_error(device, ALC_INVALID_VALUE);
+                    return;
+                }
+                SDL_memcpy(values, ctx->attributes, ctx->attributes_count * sizeof (ALCint));
+            } else {
+                *values = (ALCint) ctx->attributes_count;
+            }
+            return;
+
+        case ALC_MAJOR_VERSION:
+            *values = OPENAL_VERSION_MAJOR;
+            return;
+
+        case ALC_MINOR_VERSION:
+            *values = OPENAL_VERSION_MINOR;
+            return;
+
+        case ALC_FREQUENCY:
+            if (!device) {
+                *values = 0;
+                set_alc_error(device, ALC_INVALID_DEVICE);
+                return;
+            }
+
+            *values = device->frequency;
+            return;
+
+        case ALC_REFRESH:
+        case ALC_PERIOD_FRAMES_MOJOAL:
+            if (!device || device->iscapture) {
+                *values = 0;
+                set_alc_error(device, ALC_INVALID_DEVICE);
+                return;
+            }
+
+            /* this is zero until the first context sets up the device. */
+            if (param == ALC_PERIOD_FRAMES_MOJOAL) {
+                *values = device->period_frames;
+            } else {
+                *values = device->period_frames ? (device->frequency / device->period_frames) : 0;
+            }
+            return;
+
+        case ALC_OUTPUT_MODE_SOFT:
+            if (!device || device->iscapture) {
+                *values = 0;
+                set_alc_error(device, ALC_INVALID_DEVICE);
+                return;
+            }
+
+            /* the first context picks this, too. */
+            *values = device->output_mode ? device->output_mode : ALC_ANY_SOFT;
+            return;
+
+        default: break;
+    }
+
+    set_alc_error(device, ALC_INVALID_ENUM);
+    *values = 0;
+}
+ENTRYPOINTVOID(alcGetIntegerv,(ALCdevice *device, ALCenum param, ALCsizei size, ALCint *values),(device,param,size,values))
+
+/* no api lock for the clock queries; the mixer publishes the clock through a seqlock so any thread can poll it cheaply. */
+void alcGetInteger64vSOFT(ALCdevice *device, ALCenum param, ALCsizei size, ALCint64SOFT *values)
+{
+    if (!size || !values) {
+        return;  /* "A NULL destination or a zero size parameter will cause ALC to ignore the query." */
+    } else if (size < 0) {
+        set_alc_error(device, ALC_INVALID_VALUE);
+        return;
+    }
+
+    switch (param) {
+        case ALC_DEVICE_CLOCK_SOFT:
+        case ALC_DEVICE_LATENCY_SOFT:
+        case ALC_DEVICE_CLOCK_LATENCY_SOFT:
+            if (!device || device->iscapture) {
+                *values = 0;
+                set_alc_error(device, ALC_INVALID_DEVICE);
+            } else if ((param == ALC_DEVICE_CLOCK_LATENCY_SOFT) && (size < 2)) {
+                *values = 0;
+                set_alc_error(device, ALC_INVALID_VALUE);
+            } else if (param == ALC_DEVICE_CLOCK_SOFT) {
+                values[0] = (ALCint64SOFT) device_frames_to_ns(device, device_get_clock_frames(device));
+            } else if (param == ALC_DEVICE_LATENCY_SOFT) {
+                values[0] = (ALCint64SOFT) device_latency_ns(device);
+            } else {
+                values[0] = (ALCint64SOFT) device_frames_to_ns(device, device_get_clock_frames(device));
+                values[1] = (ALCint64SOFT) device_latency_ns(device);
+            }
+            return;
+
+        default: {  /* everything else is just alcGetIntegerv with bigger ints. */
+            ALCint staticbuf[16];
+            ALCint *intvalues = (size <= (ALCsizei) SDL_arraysize(staticbuf)) ? staticbuf : (ALCint *) SDL_malloc(size * sizeof (ALCint));
+            ALCsizei i;
+            if (!intvalues) {
+                set_alc_error(device, ALC_OUT_OF_MEMORY);
+                return;
+            }
+            SDL_memset(intvalues, '\0', size * sizeof (ALCint));
+            alcGetIntegerv(device, param, size, intvalues);
+            for (i = 0; i < size; i++) {
+                values[i] = (ALCint64SOFT) intvalues[i];
+            }
+            if (intvalues != staticbuf) {
+                SDL_free(intvalues);
+            }
+            return;
+        }
+    }
+}
+
+
+/* audio callback for capture devices just needs to move data into our
+   ringbuffer for later recovery by the app in alcCaptureSamples(). SDL
+   should have handled resampling and conversion for us to the expected
+   audio format. */
+static void SDLCALL capture_device_callback(void *userdata, Uint8 *stream, int len)
+{
+    ALCdevice *device = (ALCdevice *) userdata;
+    ALCboolean connected = ALC_FALSE;
+    SDL_assert(device->iscapture);
+
+    if (SDL_AtomicGet(&device->connected)) {
+        if (SDL_GetAudioDeviceStatus(device->sdldevice) == SDL_AUDIO_STOPPED) {
+            SDL_AtomicSet(&device->connected, ALC_FALSE);
+        } else {
+            connected = ALC_TRUE;
+        }
+    }
+
+    if (connected) {
+        ring_buffer_put(&device->capture.ring, stream, (ALCsizei) len);
+    }
+}
+
+/* no api lock; this creates it and otherwise doesn't have any state that can race */
+ALCdevice *alcCaptureOpenDevice(const ALCchar *devicename, ALCuint frequency, ALCenum format, ALCsizei buffersize)
+{
+    SDL_AudioSpec desired;
+    ALCsizei framesize = 0;
+    const char *sdldevname = NULL;
+    ALCdevice *device = NULL;
+    ALCubyte *ringbuf = NULL;
+
+    SDL_zero(desired);
+    if (!alcfmt_to_sdlfmt(format, &desired.format, &desired.channels, &framesize)) {
+        return NULL;
+    }
+
+    if (!devicename) {
+        devicename = DEFAULT_CAPTURE_DEVICE;  /* so ALC_CAPTURE_DEVICE_SPECIFIER is meaningful */
+    }
+
+    desired.freq = frequency;
+    desired.samples = 1024;  FIXME("is this a reasonable value?");
+    desired.callback = capture_device_callback;
+
+    if (SDL_strcmp(devicename, DEFAULT_CAPTURE_DEVICE) != 0) {
+        sdldevname = devicename;  /* we want NULL for the best SDL default unless app is explicit. */
+    }
+
+    device = prep_alc_device(devicename, ALC_TRUE, ALC_FALSE);
+    if (!device) {
+        return NULL;
+    }
+
+    device->frequency = frequency;
+    device->framesize = framesize;
+    device->capture.ring.size = framesize * buffersize;
+
+    if (device->capture.ring.size >= buffersize) {
+        ringbuf = (ALCubyte *) SDL_malloc(device->capture.ring.size);
+    }
+
+    if (!ringbuf) {
+        SDL_free(device->name);
+        SDL_free(device);
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return NULL;
+    }
+
+    device->capture.ring.buffer = ringbuf;
+
+    desired.userdata = device;
+
+    device->sdldevice = SDL_OpenAudioDevice(sdldevname, 1, &desired, NULL, 0);
+    if (!device->sdldevice) {
+        SDL_free(ringbuf);
+        SDL_free(device->name);
+        SDL_free(device);
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return NULL;
+    }
+
+    return device;
+}
+
+/* no api lock; this requires you to not destroy a device that's still in use */
+ALCboolean alcCaptureCloseDevice(ALCdevice *device)
+{
+    if (!device || !device->iscapture) {
+        return ALC_FALSE;
+    }
+
+    if (device->sdldevice) {
+        SDL_CloseAudioDevice(device->sdldevice);
+    }
+
+    SDL_free(device->capture.ring.buffer);
+    SDL_free(device->name);
+    SDL_free(device);
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+
+    return ALC_TRUE;
+}
+
+static void _alcCaptureStart(ALCdevice *device)
+{
+    if (device && device->iscapture) {
+        /* alcCaptureStart() drops any previously-buffered data. */
+        FIXME("does this clear the ring buffer if the device is already started?");
+        SDL_LockAudioDevice(device->sdldevice);
+        device->capture.ring.read = 0;
+        device->capture.ring.write = 0;
+        device->capture.ring.used = 0;
+        SDL_UnlockAudioDevice(device->sdldevice);
+        SDL_PauseAudioDevice(device->sdldevice, 0);
+    }
+}
+ENTRYPOINTVOID(alcCaptureStart,(ALCdevice *device),(device))
+
+static void _alcCaptureStop(ALCdevice *device)
+{
+    if (device && device->iscapture) {
+        SDL_PauseAudioDevice(device->sdldevice, 1);
+    }
+}
+ENTRYPOINTVOID(alcCaptureStop,(ALCdevice *device),(device))
+
+static void _alcCaptureSamples(ALCdevice *device, ALCvoid *buffer, const ALCsizei samples)
+{
+    ALCsizei requested_bytes;
+    if (!device || !device->iscapture) {
+        return;
+    }
+
+    requested_bytes = samples * device->framesize;
+
+    SDL_LockAudioDevice(device->sdldevice);
+    if (requested_bytes > device->capture.ring.used) {
+        SDL_UnlockAudioDevice(device->sdldevice);
+        FIXME("set error state?");
+        return;  /* this is an error state, according to the spec. */
+    }
+
+    ring_buffer_get(&device->capture.ring, buffer, requested_bytes);
+    SDL_UnlockAudioDevice(device->sdldevice);
+}
+ENTRYPOINTVOID(alcCaptureSamples,(ALCdevice *device, ALCvoid *buffer, ALCsizei samples),(device,buffer,samples))
+
+
+/* ALC_SOFT_loopback implementation... */
+
+/* no api lock; this creates it and otherwise doesn't have any state that can race */
+ALCdevice *alcLoopbackOpenDeviceSOFT(const ALCchar *devicename)
+{
+    /* the spec says devicename is reserved and should be NULL, but we'll use it as ALC_DEVICE_SPECIFIER if you insist. */
+    if (!devicename) {
+        devicename = DEFAULT_LOOPBACK_DEVICE;
+    }
+
+    return prep_alc_device(devicename, ALC_FALSE, ALC_TRUE);
+
+    /* the mixing format isn't known until the first context is created. */
+}
+
+/* no api lock; immutable */
+ALCboolean alcIsRenderFormatSupportedSOFT(ALCdevice *device, ALCsizei freq, ALCenum channels, ALCenum type)
+{
+    SDL_AudioCVT cvt;
+
+    if (!device || !device->isloopback) {
+        set_alc_error(device, ALC_INVALID_DEVICE);
+        return ALC_FALSE;
+    }
+
+    return build_loopback_cvt(&cvt, freq, channels, type, NULL);
+}
+
+/* no api lock; the calling thread _is_ the mixer thread for loopback devices, so this behaves like SDL's audio callback. */
+void alcRenderSamplesSOFT(ALCdevice *device, ALCvoid *buffer, ALCsizei samples)
+{
+    Uint8 *dst = (Uint8 *) buffer;
+
+    if (!device || !device->isloopback) {
+        set_alc_error(device, ALC_INVALID_DEVICE);
+        return;
+    } else if ((samples < 0) || ((samples > 0) && !buffer)) {
+        set_alc_error(device, ALC_INVALID_VALUE);
+        return;
+    } else if (!device->framesize) {
+        set_alc_error(device, ALC_INVALID_DEVICE);  /* no context has been created yet, so we don't know the format. */
+        return;
+    }
+
+    lock_mixer(device);
+    while (samples > 0) {
+        const int frames = SDL_min(samples, OPENAL_LOOPBACK_PERIOD_FRAMES);
+        const int len = frames * device->framesize;
+        float *mixbuf = device->playback.loopback.mixbuf;
+
+        if (!mixbuf) {  /* app wants float32 in the layout we mix, just mix right into their buffer. */
+            mix_device(device, (float *) dst, len, ALC_TRUE);
+        } else {
+            SDL_AudioCVT *cvt = &device->playback.loopback.cvt;
+            mix_device(device, mixbuf, len, ALC_TRUE);
+            cvt->buf = (Uint8 *) mixbuf;
+            cvt->len = len;
+            SDL_ConvertAudio(cvt);
+            SDL_assert(cvt->len_cvt == (frames * device->playback.loopback.framesize));
+            SDL_memcpy(dst, mixbuf, cvt->len_cvt);
+        }
+
+        dst += frames * device->playback.loopback.framesize;
+        samples -= frames;
+    }
+    unlock_mixer(device);
+}
+
+
+/* AL implementation... */
+
+static ALenum null_context_error = AL_NO_ERROR;
+
+static void set_al_error(ALCcontext *ctx, const ALenum error)
+{
+    ALenum *perr = ctx ? &ctx->error : &null_context_error;
+    /* can't set a new error when the previous hasn't been cleared yet. */
+    if (*perr == AL_NO_ERROR) {
+        *perr = error;
+    }
+}
+
+/* !!! FIXME: buffers and sources use almost identical code for blocks */
+static ALsource *get_source(ALCcontext *ctx, const ALuint name, SourceBlock **_block)
+{
+    const ALsizei blockidx = (((ALsizei) name) - 1) / OPENAL_SOURCE_BLOCK_SIZE;
+    const ALsizei block_offset = (((ALsizei) name) - 1) % OPENAL_SOURCE_BLOCK_SIZE;
+    ALsource *source;
+    SourceBlock *block;
+
+    /*printf("get_source(%d): blockidx=%d, block_offset=%d\n", (int) name, (int) blockidx, (int) block_offset);*/
+
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        if (_block) *_block = NULL;
+        return NULL;
+    } else if ((name == 0) || (blockidx < 0) || (blockidx >= ctx->num_source_blocks)) {
+        set_al_error(ctx, AL_INVALID_NAME);
+        if (_block) *_block = NULL;
+        return NULL;
+    }
+
+    block = ctx->source_blocks[blockidx];
+    source = &block->sources[block_offset];
+    if (source->allocated) {
+        if (_block) *_block = block;
+        return source;
+    }
+
+    if (_block) *_block = NULL;
+    set_al_error(ctx, AL_INVALID_NAME);
+    return NULL;
+}
+
+/* !!! FIXME: buffers and sources use almost identical code for blocks */
+static ALbuffer *get_buffer(ALCcontext *ctx, const ALuint name, BufferBlock **_block)
+{
+    const ALsizei blockidx = (((ALsizei) name) - 1) / OPENAL_BUFFER_BLOCK_SIZE;
+    const ALsizei block_offset = (((ALsizei) name) - 1) % OPENAL_BUFFER_BLOCK_SIZE;
+    ALbuffer *buffer;
+    BufferBlock *block;
+
+    /*printf("get_buffer(%d): blockidx=%d, block_offset=%d\n", (int) name, (int) blockidx, (int) block_offset);*/
+
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        if (_block) *_block = NULL;
+        return NULL;
+    } else if ((name == 0) || (blockidx < 0) || (blockidx >= ctx->device->playback.num_buffer_blocks)) {
+        set_al_error(ctx, AL_INVALID_NAME);
+        if (_block) *_block = NULL;
+        return NULL;
+    }
+
+    block = ctx->device->playback.buffer_blocks[blockidx];
+    buffer = &block->buffers[block_offset];
+    if (buffer->allocated) {
+        if (_block) *_block = block;
+        return buffer;
+    }
+
+    if (_block) *_block = NULL;
+    set_al_error(ctx, AL_INVALID_NAME);
+    return NULL;
+}
+
+static void _alDopplerFactor(const ALfloat value)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+    } else if (value < 0.0f) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+    } else {
+        ctx->doppler_factor = value;
+        context_needs_recalc(ctx);
+    }
+}
+ENTRYPOINTVOID(alDopplerFactor,(ALfloat value),(value))
+
+static void _alDopplerVelocity(const ALfloat value)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+    } else if (value < 0.0f) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+    } else {
+        ctx->doppler_velocity = value;
+        context_needs_recalc(ctx);
+    }
+}
+ENTRYPOINTVOID(alDopplerVelocity,(ALfloat value),(value))
+
+static void _alSpeedOfSound(const ALfloat value)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+    } else if (value < 0.0f) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+    } else {
+        ctx->speed_of_sound = value;
+        context_needs_recalc(ctx);
+    }
+}
+ENTRYPOINTVOID(alSpeedOfSound,(ALfloat value),(value))
+
+static void _alDistanceModel(const ALenum model)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    switch (model) {
+        case AL_NONE:
+        case AL_INVERSE_DISTANCE:
+        case AL_INVERSE_DISTANCE_CLAMPED:
+        case AL_LINEAR_DISTANCE:
+        case AL_LINEAR_DISTANCE_CLAMPED:
+        case AL_EXPONENT_DISTANCE:
+        case AL_EXPONENT_DISTANCE_CLAMPED:
+            ctx->distance_model = model;
+            context_needs_recalc(ctx);
+            return;
+        default: break;
+    }
+    set_al_error(ctx, AL_INVALID_ENUM);
+}
+ENTRYPOINTVOID(alDistanceModel,(ALenum model),(model))
+
+static void _alDeferUpdatesSOFT(void)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+    } else {
+        context_defer_updates(ctx, AL_TRUE);
+    }
+}
+ENTRYPOINTVOID(alDeferUpdatesSOFT,(void),())
+
+static void _alProcessUpdatesSOFT(void)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+    } else {
+        context_defer_updates(ctx, AL_FALSE);
+    }
+}
+ENTRYPOINTVOID(alProcessUpdatesSOFT,(void),())
+
+
+static void _alEnable(const ALenum capability)
+{
+    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
+}
+ENTRYPOINTVOID(alEnable,(ALenum capability),(capability))
+
+
+static void _alDisable(const ALenum capability)
+{
+    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
+}
+ENTRYPOINTVOID(alDisable,(ALenum capability),(capability))
+
+
+static ALboolean _alIsEnabled(const ALenum capability)
+{
+    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
+    return AL_FALSE;
+}
+ENTRYPOINT(ALboolean,alIsEnabled,(ALenum capability),(capability))
+
+static const ALchar *_alGetString(const ALenum param)
+{
+    switch (param) {
+        case AL_EXTENSIONS: {
+            #define AL_EXTENSION_ITEM(ext) " " #ext
+            static ALchar al_extensions_string[] = AL_EXTENSION_ITEMS;
+            #undef AL_EXTENSION_ITEM
+            return al_extensions_string + 1;  /* skip that first space char */
+        }
+
+        case AL_VERSION: return OPENAL_VERSION_STRING;
+        case AL_RENDERER: return OPENAL_RENDERER_STRING;
+        case AL_VENDOR: return OPENAL_VENDOR_STRING;
+        case AL_NO_ERROR: return "AL_NO_ERROR";
+        case AL_INVALID_NAME: return "AL_INVALID_NAME";
+        case AL_INVALID_ENUM: return "AL_INVALID_ENUM";
+        case AL_INVALID_VALUE: return "AL_INVALID_VALUE";
+        case AL_INVALID_OPERATION: return "AL_INVALID_OPERATION";
+        case AL_OUT_OF_MEMORY: return "AL_OUT_OF_MEMORY";
+
+        default: break;
+    }
+
+    FIXME("other enums that should report as strings?");
+    set_al_error(get_current_context(), AL_INVALID_ENUM);
+
+    return NULL;
+}
+ENTRYPOINT(const ALchar *,alGetString,(ALenum param),(param))
+
+static void _alGetBooleanv(const ALenum param, ALboolean *values)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    if (!values) return;  /* legal no-op */
+
+    switch (param) {
+        case AL_DEFERRED_UPDATES_SOFT: *values = ctx->deferring; break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetBooleanv,(ALenum param, ALboolean *values),(param,values))
+
+static void _alGetIntegerv(const ALenum param, ALint *values)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    if (!values) return;  /* legal no-op */
+
+    switch (param) {
+        case AL_DISTANCE_MODEL: *values = (ALint) ctx->distance_model; break;
+        case AL_DEFERRED_UPDATES_SOFT: *values = (ALint) ctx->deferring; break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetIntegerv,(ALenum param, ALint *values),(param,values))
+
+static void _alGetFloatv(const ALenum param, ALfloat *values)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    if (!values) return;  /* legal no-op */
+
+    switch (param) {
+        case AL_DOPPLER_FACTOR: *values = ctx->doppler_factor; break;
+        case AL_DOPPLER_VELOCITY: *values = ctx->doppler_velocity; break;
+        case AL_SPEED_OF_SOUND: *values = ctx->speed_of_sound; break;
+        case AL_DEFERRED_UPDATES_SOFT: *values = ctx->deferring ? 1.0f : 0.0f; break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetFloatv,(ALenum param, ALfloat *values),(param,values))
+
+static void _alGetDoublev(const ALenum param, ALdouble *values)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    if (!values) return;  /* legal no-op */
+
+    switch (param) {
+        case AL_DEFERRED_UPDATES_SOFT: *values = ctx->deferring ? 1.0 : 0.0; break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetDoublev,(ALenum param, ALdouble *values),(param,values))
+
+/* no api lock; just passes through to the real api */
+ALboolean alGetBoolean(ALenum param)
+{
+    ALboolean retval = AL_FALSE;
+    alGetBooleanv(param, &retval);
+    return retval;
+}
+
+/* no api lock; just passes through to the real api */
+ALint alGetInteger(ALenum param)
+{
+    ALint retval = 0;
+    alGetIntegerv(param, &retval);
+    return retval;
+}
+
+/* no api lock; just passes through to the real api */
+ALfloat alGetFloat(ALenum param)
+{
+    ALfloat retval = 0.0f;
+    alGetFloatv(param, &retval);
+    return retval;
+}
+
+/* no api lock; just passes through to the real api */
+ALdouble alGetDouble(ALenum param)
+{
+    ALdouble retval = 0.0f;
+    alGetDoublev(param, &retval);
+    return retval;
+}
+
+static ALenum _alGetError(void)
+{
+    ALCcontext *ctx = get_current_context();
+    ALenum *perr = ctx ? &ctx->error : &null_context_error;
+    const ALenum retval = *perr;
+    *perr = AL_NO_ERROR;
+    return retval;
+}
+ENTRYPOINT(ALenum,alGetError,(void),())
+
+/* no api lock; immutable (unless we start having contexts with different extensions) */
+ALboolean alIsExtensionPresent(const ALchar *extname)
+{
+    #define AL_EXTENSION_ITEM(ext) if (SDL_strcasecmp(extname, #ext) == 0) { return AL_TRUE; }
+    AL_EXTENSION_ITEMS
+    #undef AL_EXTENSION_ITEM
+    return AL_FALSE;
+}
+
+static void *_alGetProcAddress(const ALchar *funcname)
+{
+    ALCcontext *ctx = get_current_context();
+    FIXME("fail if ctx == NULL?");
+    if (!funcname) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return NULL;
+    }
+
+    #define FN_TEST(fn) if (SDL_strcmp(funcname, #fn) == 0) return (void *) fn
+    FN_TEST(alDopplerFactor);
+    FN_TEST(alDopplerVelocity);
+    FN_TEST(alSpeedOfSound);
+    FN_TEST(alDistanceModel);
+    FN_TEST(alEnable);
+    FN_TEST(alDisable);
+    FN_TEST(alIsEnabled);
+    FN_TEST(alGetString);
+    FN_TEST(alGetBooleanv);
+    FN_TEST(alGetIntegerv);
+    FN_TEST(alGetFloatv);
+    FN_TEST(alGetDoublev);
+    FN_TEST(alGetBoolean);
+    FN_TEST(alGetInteger);
+    FN_TEST(alGetFloat);
+    FN_TEST(alGetDouble);
+    FN_TEST(alGetError);
+    FN_TEST(alIsExtensionPresent);
+    FN_TEST(alGetProcAddress);
+    FN_TEST(alGetEnumValue);
+    FN_TEST(alListenerf);
+    FN_TEST(alListener3f);
+    FN_TEST(alListenerfv);
+    FN_TEST(alListeneri);
+    FN_TEST(alListener3i);
+    FN_TEST(alListeneriv);
+    FN_TEST(alGetListenerf);
+    FN_TEST(alGetListener3f);
+    FN_TEST(alGetListenerfv);
+    FN_TEST(alGetListeneri);
+    FN_TEST(alGetListener3i);
+    FN_TEST(alGetListeneriv);
+    FN_TEST(alGenSources);
+    FN_TEST(alDeleteSources);
+    FN_TEST(alIsSource);
+    FN_TEST(alSourcef);
+    FN_TEST(alSource3f);
+    FN_TEST(alSourcefv);
+    FN_TEST(alSourcei);
+    FN_TEST(alSource3i);
+    FN_TEST(alSourceiv);
+    FN_TEST(alGetSourcef);
+    FN_TEST(alGetSource3f);
+    FN_TEST(alGetSourcefv);
+    FN_TEST(alGetSourcei);
+    FN_TEST(alGetSource3i);
+    FN_TEST(alGetSourceiv);
+    FN_TEST(alSourcePlayv);
+    FN_TEST(alSourceStopv);
+    FN_TEST(alSourceRewindv);
+    FN_TEST(alSourcePausev);
+    FN_TEST(alSourcePlay);
+    FN_TEST(alSourceStop);
+    FN_TEST(alSourceRewind);
+    FN_TEST(alSourcePause);
+    FN_TEST(alSourceQueueBuffers);
+    FN_TEST(alSourceUnqueueBuffers);
+    FN_TEST(alSourcedSOFT);
+    FN_TEST(alSource3dSOFT);
+    FN_TEST(alSourcedvSOFT);
+    FN_TEST(alGetSourcedSOFT);
+    FN_TEST(alGetSource3dSOFT);
+    FN_TEST(alGetSourcedvSOFT);
+    FN_TEST(alSourcei64SOFT);
+    FN_TEST(alSource3i64SOFT);
+    FN_TEST(alSourcei64vSOFT);
+    FN_TEST(alGetSourcei64SOFT);
+    FN_TEST(alGetSource3i64SOFT);
+    FN_TEST(alGetSourcei64vSOFT);
+    FN_TEST(alDeferUpdatesSOFT);
+    FN_TEST(alProcessUpdatesSOFT);
+    FN_TEST(alSourcefvBatchMOJOAL);
+    FN_TEST(alSourceivBatchMOJOAL);
+    FN_TEST(alBufferCallbackSOFT);
+    FN_TEST(alGetBufferPtrSOFT);
+    FN_TEST(alGetBuffer3PtrSOFT);
+    FN_TEST(alGetBufferPtrvSOFT);
+    FN_TEST(alBufferSubDataSOFT);
+    FN_TEST(alBufferStorageSOFT);
+    FN_TEST(alMapBufferSOFT);
+    FN_TEST(alUnmapBufferSOFT);
+    FN_TEST(alFlushMappedBufferSOFT);
+    FN_TEST(alBufferDataStatic);
+    FN_TEST(alBufferFileMOJOAL);
+    FN_TEST(alBufferFileDescriptorMOJOAL);
+    FN_TEST(alGenBuffers);
+    FN_TEST(alDeleteBuffers);
+    FN_TEST(alIsBuffer);
+    FN_TEST(alBufferData);
+    FN_TEST(alBufferf);
+    FN_TEST(alBuffer3f);
+    FN_TEST(alBufferfv);
+    FN_TEST(alBufferi);
+    FN_TEST(alBuffer3i);
+    FN_TEST(alBufferiv);
+    FN_TEST(alGetBufferf);
+    FN_TEST(alGetBuffer3f);
+    FN_TEST(alGetBufferfv);
+    FN_TEST(alGetBufferi);
+    FN_TEST(alGetBuffer3i);
+    FN_TEST(alGetBufferiv);
+    #undef FN_TEST
+
+    set_al_error(ctx, ALC_INVALID_VALUE);
+    return NULL;
+}
+ENTRYPOINT(void *,alGetProcAddress,(const ALchar *funcname),(funcname))
+
+static ALenum _alGetEnumValue(const ALchar *enumname)
+{
+    ALCcontext *ctx = get_current_context();
+    FIXME("fail if ctx == NULL?");
+    if (!enumname) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return AL_NONE;
+    }
+
+    #define ENUM_TEST(en) if (SDL_strcmp(enumname, #en) == 0) return en
+    ENUM_TEST(AL_NONE);
+    ENUM_TEST(AL_FALSE);
+    ENUM_TEST(AL_TRUE);
+    ENUM_TEST(AL_SOURCE_RELATIVE);
+    ENUM_TEST(AL_CONE_INNER_ANGLE);
+    ENUM_TEST(AL_CONE_OUTER_ANGLE);
+    ENUM_TEST(AL_PITCH);
+    ENUM_TEST(AL_POSITION);
+    ENUM_TEST(AL_DIRECTION);
+    ENUM_TEST(AL_VELOCITY);
+    ENUM_TEST(AL_LOOPING);
+    ENUM_TEST(AL_BUFFER);
+    ENUM_TEST(AL_GAIN);
+    ENUM_TEST(AL_MIN_GAIN);
+    ENUM_TEST(AL_MAX_GAIN);
+    ENUM_TEST(AL_ORIENTATION);
+    ENUM_TEST(AL_SOURCE_STATE);
+    ENUM_TEST(AL_INITIAL);
+    ENUM_TEST(AL_PLAYING);
+    ENUM_TEST(AL_PAUSED);
+    ENUM_TEST(AL_STOPPED);
+    ENUM_TEST(AL_BUFFERS_QUEUED);
+    ENUM_TEST(AL_BUFFERS_PROCESSED);
+    ENUM_TEST(AL_REFERENCE_DISTANCE);
+    ENUM_TEST(AL_ROLLOFF_FACTOR);
+    ENUM_TEST(AL_CONE_OUTER_GAIN);
+    ENUM_TEST(AL_MAX_DISTANCE);
+    ENUM_TEST(AL_SEC_OFFSET);
+    ENUM_TEST(AL_SAMPLE_OFFSET);
+    ENUM_TEST(AL_BYTE_OFFSET);
+    ENUM_TEST(AL_SOURCE_TYPE);
+    ENUM_TEST(AL_STATIC);
+    ENUM_TEST(AL_STREAMING);
+    ENUM_TEST(AL_UNDETERMINED);
+    ENUM_TEST(AL_FORMAT_MONO8);
+    ENUM_TEST(AL_FORMAT_MONO16);
+    ENUM_TEST(AL_FORMAT_STEREO8);
+    ENUM_TEST(AL_FORMAT_STEREO16);
+    ENUM_TEST(AL_FREQUENCY);
+    ENUM_TEST(AL_BITS);
+    ENUM_TEST(AL_CHANNELS);
+    ENUM_TEST(AL_SIZE);
+    ENUM_TEST(AL_UNUSED);
+    ENUM_TEST(AL_PENDING);
+    ENUM_TEST(AL_PROCESSED);
+    ENUM_TEST(AL_NO_ERROR);
+    ENUM_TEST(AL_INVALID_NAME);
+    ENUM_TEST(AL_INVALID_ENUM);
+    ENUM_TEST(AL_INVALID_VALUE);
+    ENUM_TEST(AL_INVALID_OPERATION);
+    ENUM_TEST(AL_OUT_OF_MEMORY);
+    ENUM_TEST(AL_VENDOR);
+    ENUM_TEST(AL_VERSION);
+    ENUM_TEST(AL_RENDERER);
+    ENUM_TEST(AL_EXTENSIONS);
+    ENUM_TEST(AL_DOPPLER_FACTOR);
+    ENUM_TEST(AL_DOPPLER_VELOCITY);
+    ENUM_TEST(AL_SPEED_OF_SOUND);
+    ENUM_TEST(AL_DISTANCE_MODEL);
+    ENUM_TEST(AL_INVERSE_DISTANCE);
+    ENUM_TEST(AL_INVERSE_DISTANCE_CLAMPED);
+    ENUM_TEST(AL_LINEAR_DISTANCE);
+    ENUM_TEST(AL_LINEAR_DISTANCE_CLAMPED);
+    ENUM_TEST(AL_EXPONENT_DISTANCE);
+    ENUM_TEST(AL_EXPONENT_DISTANCE_CLAMPED);
+    ENUM_TEST(AL_FORMAT_MONO_FLOAT32);
+    ENUM_TEST(AL_FORMAT_STEREO_FLOAT32);
+    ENUM_TEST(AL_PHASE_VOCODER_PITCH_MOJOAL);
+    ENUM_TEST(AL_SAMPLE_OFFSET_LATENCY_SOFT);
+    ENUM_TEST(AL_SEC_OFFSET_LATENCY_SOFT);
+    ENUM_TEST(AL_SAMPLE_OFFSET_CLOCK_SOFT);
+    ENUM_TEST(AL_SEC_OFFSET_CLOCK_SOFT);
+    ENUM_TEST(AL_DEFERRED_UPDATES_SOFT);
+    ENUM_TEST(AL_BUFFER_CALLBACK_FUNCTION_SOFT);
+    ENUM_TEST(AL_BUFFER_CALLBACK_USER_PARAM_SOFT);
+    ENUM_TEST(AL_BYTE_RW_OFFSETS_SOFT);
+    ENUM_TEST(AL_SAMPLE_RW_OFFSETS_SOFT);
+    ENUM_TEST(AL_MAP_READ_BIT_SOFT);
+    ENUM_TEST(AL_MAP_WRITE_BIT_SOFT);
+    ENUM_TEST(AL_MAP_PERSISTENT_BIT_SOFT);
+    ENUM_TEST(AL_PRESERVE_DATA_BIT_SOFT);
+    ENUM_TEST(AL_FORMAT_MONO_IMA4);
+    ENUM_TEST(AL_FORMAT_STEREO_IMA4);
+    ENUM_TEST(AL_FORMAT_MONO_MSADPCM_SOFT);
+    ENUM_TEST(AL_FORMAT_STEREO_MSADPCM_SOFT);
+    ENUM_TEST(AL_FORMAT_QUAD8);
+    ENUM_TEST(AL_FORMAT_QUAD16);
+    ENUM_TEST(AL_FORMAT_QUAD32);
+    ENUM_TEST(AL_FORMAT_51CHN8);
+    ENUM_TEST(AL_FORMAT_51CHN16);
+    ENUM_TEST(AL_FORMAT_51CHN32);
+    ENUM_TEST(AL_FORMAT_61CHN8);
+    ENUM_TEST(AL_FORMAT_61CHN16);
+    ENUM_TEST(AL_FORMAT_61CHN32);
+    ENUM_TEST(AL_FORMAT_71CHN8);
+    ENUM_TEST(AL_FORMAT_71CHN16);
+    ENUM_TEST(AL_FORMAT_71CHN32);
+    ENUM_TEST(AL_FORMAT_MONO_MULAW_EXT);
+    ENUM_TEST(AL_FORMAT_STEREO_MULAW_EXT);
+    ENUM_TEST(AL_FORMAT_MONO_ALAW_EXT);
+    ENUM_TEST(AL_FORMAT_STEREO_ALAW_EXT);
+    ENUM_TEST(AL_UNPACK_BLOCK_ALIGNMENT_SOFT);
+    ENUM_TEST(AL_PACK_BLOCK_ALIGNMENT_SOFT);
+    #undef ENUM_TEST
+
+    set_al_error(ctx, AL_INVALID_VALUE);
+    return AL_NONE;
+}
+ENTRYPOINT(ALenum,alGetEnumValue,(const ALchar *enumname),(enumname))
+
+static void _alListenerfv(const ALenum param, const ALfloat *values)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+    } else if (!values) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+    } else {
+        ALboolean recalc = AL_TRUE;
+        switch (param) {
+            case AL_GAIN:
+                ctx->listener.gain = *values;
+                break;
+
+            case AL_POSITION:
+                SDL_memcpy(ctx->listener.position, values, sizeof (*values) * 3);
+                break;
+
+            case AL_VELOCITY:
+                SDL_memcpy(ctx->listener.velocity, values, sizeof (*values) * 3);
+                break;
+
+            case AL_ORIENTATION:
+                SDL_memcpy(&ctx->listener.orientation[0], &values[0], sizeof (*values) * 3);
+                SDL_memcpy(&ctx->listener.orientation[4], &values[3], sizeof (*values) * 3);
+                break;
+
+            default:
+                recalc = AL_FALSE;
+                set_al_error(ctx, AL_INVALID_ENUM);
+                break;
+        }
+
+        if (recalc) {
+            context_needs_recalc(ctx);
+        }
+    }
+}
+ENTRYPOINTVOID(alListenerfv,(ALenum param, const ALfloat *values),(param,values))
+
+static void _alListenerf(const ALenum param, const ALfloat value)
+{
+    switch (param) {
+        case AL_GAIN: _alListenerfv(param, &value); break;
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alListenerf,(ALenum param, ALfloat value),(param,value))
+
+static void _alListener3f(const ALenum param, const ALfloat value1, const ALfloat value2, const ALfloat value3)
+{
+    switch (param) {
+        case AL_POSITION:
+        case AL_VELOCITY: {
+            const ALfloat values[3] = { value1, value2, value3 };
+            _alListenerfv(param, values);
+            break;
+        }
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alListener3f,(ALenum param, ALfloat value1, ALfloat value2, ALfloat value3),(param,value1,value2,value3))
+
+static void _alListeneriv(const ALenum param, const ALint *values)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+    } else if (!values) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+    } else {
+        ALboolean recalc = AL_TRUE;
+        FIXME("Not atomic vs the mixer thread");  /* maybe have a latching system? */
+        switch (param) {
+            case AL_POSITION:
+                ctx->listener.position[0] = (ALfloat) values[0];
+                ctx->listener.position[1] = (ALfloat) values[1];
+                ctx->listener.position[2] = (ALfloat) values[2];
+                break;
+
+            case AL_VELOCITY:
+                ctx->listener.velocity[0] = (ALfloat) values[0];
+                ctx->listener.velocity[1] = (ALfloat) values[1];
+                ctx->listener.velocity[2] = (ALfloat) values[2];
+                break;
+
+            case AL_ORIENTATION:
+                ctx->listener.orientation[0] = (ALfloat) values[0];
+                ctx->listener.orientation[1] = (ALfloat) values[1];
+                ctx->listener.orientation[2] = (ALfloat) values[2];
+                ctx->listener.orientation[4] = (ALfloat) values[3];
+                ctx->listener.orientation[5] = (ALfloat) values[4];
+                ctx->listener.orientation[6] = (ALfloat) values[5];
+                break;
+
+            default:
+                recalc = AL_FALSE;
+                set_al_error(ctx, AL_INVALID_ENUM);
+                break;
+        }
+
+        if (recalc) {
+            context_needs_recalc(ctx);
+        }
+    }
+}
+ENTRYPOINTVOID(alListeneriv,(ALenum param, const ALint *values),(param,values))
+
+static void _alListeneri(const ALenum param, const ALint value)
+{
+    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in AL 1.1 uses this */
+}
+ENTRYPOINTVOID(alListeneri,(ALenum param, ALint value),(param,value))
+
+static void _alListener3i(const ALenum param, const ALint value1, const ALint value2, const ALint value3)
+{
+    switch (param) {
+        case AL_POSITION:
+        case AL_VELOCITY: {
+            const ALint values[3] = { value1, value2, value3 };
+            _alListeneriv(param, values);
+            break;
+        }
+        default:
+            set_al_error(get_current_context(), AL_INVALID_ENUM);
+            break;
+    }
+}
+ENTRYPOINTVOID(alListener3i,(ALenum param, ALint value1, ALint value2, ALint value3),(param,value1,value2,value3))
+
+static void _alGetListenerfv(const ALenum param, ALfloat *values)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    if (!values) return;  /* legal no-op */
+
+    switch (param) {
+        case AL_GAIN:
+            *values = ctx->listener.gain;
+            break;
+
+        case AL_POSITION:
+            SDL_memcpy(values, ctx->listener.position, sizeof (ALfloat) * 3);
+            break;
+
+        case AL_VELOCITY:
+            SDL_memcpy(values, ctx->listener.velocity, sizeof (ALfloat) * 3);
+            break;
+
+        case AL_ORIENTATION:
+            SDL_memcpy(&values[0], &ctx->listener.orientation[0], sizeof (ALfloat) * 3);
+            SDL_memcpy(&values[3], &ctx->listener.orientation[4], sizeof (ALfloat) * 3);
+            break;
+
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetListenerfv,(ALenum param, ALfloat *values),(param,values))
+
+static void _alGetListenerf(const ALenum param, ALfloat *value)
+{
+    switch (param) {
+        case AL_GAIN: _alGetListenerfv(param, value); break;
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetListenerf,(ALenum param, ALfloat *value),(param,value))
+
+
+static void _alGetListener3f(const ALenum param, ALfloat *value1, ALfloat *value2, ALfloat *value3)
+{
+    ALfloat values[3];
+    switch (param) {
+        case AL_POSITION:
+        case AL_VELOCITY:
+            _alGetListenerfv(param, values);
+            if (value1) *value1 = values[0];
+            if (value2) *value2 = values[1];
+            if (value3) *value3 = values[2];
+            break;
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetListener3f,(ALenum param, ALfloat *value1, ALfloat *value2, ALfloat *value3),(param,value1,value2,value3))
+
+
+static void _alGetListeneri(const ALenum param, ALint *value)
+{
+    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in AL 1.1 uses this */
+}
+ENTRYPOINTVOID(alGetListeneri,(ALenum param, ALint *value),(param,value))
+
+
+static void _alGetListeneriv(const ALenum param, ALint *values)
+{
+    ALCcontext *ctx = get_current_context();
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    if (!values) return;  /* legal no-op */
+
+    switch (param) {
+        case AL_POSITION:
+            values[0] = (ALint) ctx->listener.position[0];
+            values[1] = (ALint) ctx->listener.position[1];
+            values[2] = (ALint) ctx->listener.position[2];
+            break;
+
+        case AL_VELOCITY:
+            values[0] = (ALint) ctx->listener.velocity[0];
+            values[1] = (ALint) ctx->listener.velocity[1];
+            values[2] = (ALint) ctx->listener.velocity[2];
+            break;
+
+        case AL_ORIENTATION:
+            values[0] = (ALint) ctx->listener.orientation[0];
+            values[1] = (ALint) ctx->listener.orientation[1];
+            values[2] = (ALint) ctx->listener.orientation[2];
+            values[3] = (ALint) ctx->listener.orientation[4];
+            values[4] = (ALint) ctx->listener.orientation[5];
+            values[5] = (ALint) ctx->listener.orientation[6];
+            break;
+
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetListeneriv,(ALenum param, ALint *values),(param,values))
+
+static void _alGetListener3i(const ALenum param, ALint *value1, ALint *value2, ALint *value3)
+{
+    ALint values[3];
+    switch (param) {
+        case AL_POSITION:
+        case AL_VELOCITY:
+            _alGetListeneriv(param, values);
+            if (value1) *value1 = values[0];
+            if (value2) *value2 = values[1];
+            if (value3) *value3 = values[2];
+            break;
+
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetListener3i,(ALenum param, ALint *value1, ALint *value2, ALint *value3),(param,value1,value2,value3))
+
+/* !!! FIXME: buffers and sources use almost identical code for blocks */
+static void _alGenSources(const ALsizei n, ALuint *names)
+{
+    ALCcontext *ctx = get_current_context();
+    ALboolean out_of_memory = AL_FALSE;
+    ALsizei totalblocks;
+    ALsource *stackobjs[16];
+    ALsource **objects = stackobjs;
+    ALsizei found = 0;
+    ALsizei block_offset = 0;
+    ALsizei blocki;
+    ALsizei i;
+
+    if (n < 0) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    } else if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    } else if (n == 0) {
+        return;  /* not an error, but nothing to do. */
+    }
+
+    if (n <= SDL_arraysize(stackobjs)) {
+        SDL_memset(stackobjs, '\0', sizeof (ALsource *) * n);
+    } else {
+        objects = (ALsource **) SDL_calloc(n, sizeof (ALsource *));
+        if (!objects) {
+            set_al_error(ctx, AL_OUT_OF_MEMORY);
+            return;
+        }
+    }
+
+    totalblocks = ctx->num_source_blocks;
+    for (blocki = 0; blocki < totalblocks; blocki++) {
+        SourceBlock *block = ctx->source_blocks[blocki];
+        block->tmp = 0;
+        if (block->used < SDL_arraysize(block->sources)) {  /* skip if full */
+            for (i = 0; i < SDL_arraysize(block->sources); i++) {
+                /* if a playing source was deleted, it will still be marked mixer_accessible
+                    until the mixer thread shuffles it out. Until then, the source isn't
+                    available for reuse. */
+                if (!block->sources[i].allocated && !SDL_AtomicGet(&block->sources[i].mixer_accessible)) {
+                    block->tmp++;
+                    objects[found] = &block->sources[i];
+                    names[found++] = (i + block_offset) + 1;  /* +1 so it isn't zero. */
+                    if (found == n) {
+                        break;
+                    }
+                }
+            }
+
+            if (found == n) {
+                break;
+            }
+        }
+
+        block_offset += SDL_arraysize(block->sources);
+    }
+
+    while (found < n) {  /* out of blocks? Add new ones. */
+        /* ctx->source_blocks is only accessed on the API thread under a mutex, so it's safe to realloc. */
+        void *ptr = SDL_realloc(ctx->source_blocks, sizeof (SourceBlock *) * (totalblocks + 1));
+        SourceBlock *block;
+
+        if (!ptr) {
+            out_of_memory = AL_TRUE;
+            break;
+        }
+        ctx->source_blocks = (SourceBlock **) ptr;
+
+        block = (SourceBlock *) calloc_simd_aligned(sizeof (SourceBlock));
+        if (!block) {
+            out_of_memory = AL_TRUE;
+            break;
+        }
+        ctx->source_blocks[totalblocks] = block;
+        totalblocks++;
+        ctx->num_source_blocks++;
+
+        for (i = 0; i < SDL_arraysize(block->sources); i++) {
+            block->tmp++;
+            objects[found] = &block->sources[i];
+            names[found++] = (i + block_offset) + 1;  /* +1 so it isn't zero. */
+            if (found == n) {
+                break;
+            }
+        }
+        block_offset += SDL_arraysize(block->sources);
+    }
+
+    if (out_of_memory) {
+        if (objects != stackobjs) SDL_free(objects);
+        SDL_memset(names, '\0', sizeof (*names) * n);
+        set_al_error(ctx, AL_OUT_OF_MEMORY);
+        return;
+    }
+
+    SDL_assert(found == n);  /* we should have either gotten space or bailed on alloc failure */
+
+    /* update the "used" field in blocks with items we are taking now. */
+    found = 0;
+    for (blocki = 0; found < n; blocki++) {
+        SourceBlock *block = ctx->source_blocks[blocki];
+        SDL_assert(blocki < totalblocks);
+        const int foundhere = block->tmp;
+        if (foundhere) {
+            block->used += foundhere;
+            found += foundhere;
+            block->tmp = 0;
+        }
+    }
+
+    SDL_assert(found == n);
+
+    for (i = 0; i < n; i++) {
+        ALsource *src = objects[i];
+
+        /*printf("Generated source %u\n", (unsigned int) names[i]);*/
+
+        SDL_assert(!src->allocated);
+
+        /* Make sure everything that wants to use SIMD is aligned for it. */
+        SDL_assert( (((size_t) &src->position[0]) % 16) == 0 );
+        SDL_assert( (((size_t) &src->velocity[0]) % 16) == 0 );
+        SDL_assert( (((size_t) &src->direction[0]) % 16) == 0 );
+
+        SDL_zerop(src);
+        SDL_AtomicSet(&src->state, AL_INITIAL);
+        SDL_AtomicSet(&src->total_queued_buffers, 0);
+        src->name = names[i];
+        src->type = AL_UNDETERMINED;
+        src->recalc = AL_TRUE;
+        src->gain = 1.0f;
+        src->max_gain = 1.0f;
+        src->reference_distance = 1.0f;
+        src->max_distance = FLT_MAX;
+        src->rolloff_factor = 1.0f;
+        src->pitch = 1.0f;
+        src->mixer_pitch = 1.0f;
+        src->doppler_pitch = 1.0f;
+        src->cone_inner_angle = 360.0f;
+        src->cone_outer_angle = 360.0f;
+        source_needs_recalc(src);
+        src->allocated = AL_TRUE;   /* we officially own it. */
+    }
+
+    if (objects != stackobjs) SDL_free(objects);
+}
+ENTRYPOINTVOID(alGenSources,(ALsizei n, ALuint *names),(n,names))
+
+
+static void _alDeleteSources(const ALsizei n, const ALuint *names)
+{
+    ALCcontext *ctx = get_current_context();
+    ALsizei i;
+
+    if (n < 0) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    } else if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    for (i = 0; i < n; i++) {
+        const ALuint name = names[i];
+        if (name == 0) {
+            /* ignore it. */ FIXME("Spec says alDeleteBuffers() can have a zero name as a legal no-op, but this text isn't included in alDeleteSources...");
+        } else {
+            ALsource *source = get_source(ctx, name, NULL);
+            if (!source) {
+                /* "If one or more of the specified names is not valid, an AL_INVALID_NAME error will be recorded, and no objects will be deleted." */
+                set_al_error(ctx, AL_INVALID_NAME);
+                return;
+            }
+        }
+    }
+
+    for (i = 0; i < n; i++) {
+        const ALuint name = names[i];
+        if (name != 0) {
+            SourceBlock *block;
+            ALsource *source = get_source(ctx, name, &block);
+            SDL_assert(source != NULL);
+
+            /* "A playing source can be deleted--the source will be stopped automatically and then deleted." */
+            if (!SDL_AtomicGet(&source->mixer_accessible)) {
+                SDL_AtomicSet(&source->state, AL_STOPPED);
+            } else {
+                SDL_LockMutex(ctx->source_lock);
+                SDL_AtomicSet(&source->state, AL_STOPPED);  /* mixer will drop from playlist next time it sees this. */
+                SDL_UnlockMutex(ctx->source_lock);
+            }
+            source->allocated = AL_FALSE;
+            source_release_buffer_queue(ctx, source);
+            if (source->buffer) {
+                SDL_assert(source->type == AL_STATIC);
+                (void) SDL_AtomicDecRef(&source->buffer->refcount);
+                source->buffer = NULL;
+            }
+            free_simd_aligned(source->pitchstate);
+            source->pitchstate = NULL;
+            free_simd_aligned(source->callback_data);
+            source->callback_data = NULL;
+            block->used--;
+        }
+    }
 }
-ENTRYPOINT(void *,alGetProcAddress,(const ALchar *funcname),(funcname))
+ENTRYPOINTVOID(alDeleteSources,(ALsizei n, const ALuint *names),(n,names))
 
-static ALenum _alGetEnumValue(const ALchar *enumname)
+static ALboolean _alIsSource(const ALuint name)
 {
     ALCcontext *ctx = get_current_context();
-    FIXME("fail if ctx == NULL?");
-    if (!enumname) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-        return AL_NONE;
+    return (ctx && (get_source(ctx, name, NULL) != NULL)) ? AL_TRUE : AL_FALSE;
+}
+ENTRYPOINT(ALboolean,alIsSource,(ALuint name),(name))
+
+/* only allocate pitchstate if a vocoder source's pitch ever changes, because
+   it's a lot of RAM and we leave it allocated to the source until it's deleted. */
+static ALboolean source_prep_vocoder(ALCcontext *ctx, ALsource *src, const ALboolean vocoder_pitch, const ALfloat pitch)
+{
+    if (vocoder_pitch && (pitch != 1.0f) && (src->pitchstate == NULL)) {
+        if (!pitch_tables_ready) {
+            init_pitch_tables();  /* we're holding the api lock, and the mixer can't get here until there's a pitchstate. */
+        }
+        src->pitchstate = (PitchState *) calloc_simd_aligned(sizeof (PitchState));
+        if (src->pitchstate == NULL) {
+            set_al_error(ctx, AL_OUT_OF_MEMORY);
+            return AL_FALSE;
+        }
+        src->pitchstate->fast_math = ctx->fast_math ? AL_TRUE : AL_FALSE;
     }
+    return AL_TRUE;
+}
 
-    #define ENUM_TEST(en) if (SDL_strcmp(enumname, #en) == 0) return en
-    ENUM_TEST(AL_NONE);
-    ENUM_TEST(AL_FALSE);
-    ENUM_TEST(AL_TRUE);
-    ENUM_TEST(AL_SOURCE_RELATIVE);
-    ENUM_TEST(AL_CONE_INNER_ANGLE);
-    ENUM_TEST(AL_CONE_OUTER_ANGLE);
-    ENUM_TEST(AL_PITCH);
-    ENUM_TEST(AL_POSITION);
-    ENUM_TEST(AL_DIRECTION);
-    ENUM_TEST(AL_VELOCITY);
-    ENUM_TEST(AL_LOOPING);
-    ENUM_TEST(AL_BUFFER);
-    ENUM_TEST(AL_GAIN);
-    ENUM_TEST(AL_MIN_GAIN);
-    ENUM_TEST(AL_MAX_GAIN);
-    ENUM_TEST(AL_ORIENTATION);
-    ENUM_TEST(AL_SOURCE_STATE);
-    ENUM_TEST(AL_INITIAL);
-    ENUM_TEST(AL_PLAYING);
-    ENUM_TEST(AL_PAUSED);
-    ENUM_TEST(AL_STOPPED);
-    ENUM_TEST(AL_BUFFERS_QUEUED);
-    ENUM_TEST(AL_BUFFERS_PROCESSED);
-    ENUM_TEST(AL_REFERENCE_DISTANCE);
-    ENUM_TEST(AL_ROLLOFF_FACTOR);
-    ENUM_TEST(AL_CONE_OUTER_GAIN);
-    ENUM_TEST(AL_MAX_DISTANCE);
-    ENUM_TEST(AL_SEC_OFFSET);
-    ENUM_TEST(AL_SAMPLE_OFFSET);
-    ENUM_TEST(AL_BYTE_OFFSET);
-    ENUM_TEST(AL_SOURCE_TYPE);
-    ENUM_TEST(AL_STATIC);
-    ENUM_TEST(AL_STREAMING);
-    ENUM_TEST(AL_UNDETERMINED);
-    ENUM_TEST(AL_FORMAT_MONO8);
-    ENUM_TEST(AL_FORMAT_MONO16);
-    ENUM_TEST(AL_FORMAT_STEREO8);
-    ENUM_TEST(AL_FORMAT_STEREO16);
-    ENUM_TEST(AL_FREQUENCY);
-    ENUM_TEST(AL_BITS);
-    ENUM_TEST(AL_CHANNELS);
-    ENUM_TEST(AL_SIZE);
-    ENUM_TEST(AL_UNUSED);
-    ENUM_TEST(AL_PENDING);
-    ENUM_TEST(AL_PROCESSED);
-    ENUM_TEST(AL_NO_ERROR);
-    ENUM_TEST(AL_INVALID_NAME);
-    ENUM_TEST(AL_INVALID_ENUM);
-    ENUM_TEST(AL_INVALID_VALUE);
-    ENUM_TEST(AL_INVALID_OPERATION);
-    ENUM_TEST(AL_OUT_OF_MEMORY);
-    ENUM_TEST(AL_VENDOR);
-    ENUM_TEST(AL_VERSION);
-    ENUM_TEST(AL_RENDERER);
-    ENUM_TEST(AL_EXTENSIONS);
-    ENUM_TEST(AL_DOPPLER_FACTOR);
-    ENUM_TEST(AL_DOPPLER_VELOCITY);
-    ENUM_TEST(AL_SPEED_OF_SOUND);
-    ENUM_TEST(AL_DISTANCE_MODEL);
-    ENUM_TEST(AL_INVERSE_DISTANCE);
-    ENUM_TEST(AL_INVERSE_DISTANCE_CLAMPED);
-    ENUM_TEST(AL_LINEAR_DISTANCE);
-    ENUM_TEST(AL_LINEAR_DISTANCE_CLAMPED);
-    ENUM_TEST(AL_EXPONENT_DISTANCE);
-    ENUM_TEST(AL_EXPONENT_DISTANCE_CLAMPED);
-    ENUM_TEST(AL_FORMAT_MONO_FLOAT32);
-    ENUM_TEST(AL_FORMAT_STEREO_FLOAT32);
-    #undef ENUM_TEST
+static void source_set_pitch(ALCcontext *ctx, ALsource *src, const ALfloat pitch)
+{
+    if (pitch <= 0.0f) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+    } else if (source_prep_vocoder(ctx, src, src->vocoder_pitch, pitch)) {
+        src->pitch = pitch;
+    }
+}
 
-    set_al_error(ctx, AL_INVALID_VALUE);
-    return AL_NONE;
+static void source_set_vocoder_pitch(ALCcontext *ctx, ALsource *src, const ALboolean vocoder_pitch)
+{
+    if (source_prep_vocoder(ctx, src, vocoder_pitch, src->pitch)) {
+        src->vocoder_pitch = vocoder_pitch;
+    }
 }
-ENTRYPOINT(ALenum,alGetEnumValue,(const ALchar *enumname),(enumname))
 
-static void _alListenerfv(const ALenum param, const ALfloat *values)
+static void source_setfv(ALCcontext *ctx, ALsource *src, const ALenum param, const ALfloat *values)
 {
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-    } else if (!values) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-    } else {
-        ALboolean recalc = AL_TRUE;
-        switch (param) {
-            case AL_GAIN:
-                ctx->listener.gain = *values;
-                break;
+    switch (param) {
+        case AL_GAIN: src->gain = *values; break;
+        case AL_POSITION: SDL_memcpy(src->position, values, sizeof (ALfloat) * 3); break;
+        case AL_VELOCITY: SDL_memcpy(src->velocity, values, sizeof (ALfloat) * 3); break;
+        case AL_DIRECTION: SDL_memcpy(src->direction, values, sizeof (ALfloat) * 3); break;
+        case AL_MIN_GAIN: src->min_gain = *values; break;
+        case AL_MAX_GAIN: src->max_gain = *values; break;
+        case AL_REFERENCE_DISTANCE: src->reference_distance = *values; break;
+        case AL_ROLLOFF_FACTOR: src->rolloff_factor = *values; break;
+        case AL_MAX_DISTANCE: src->max_distance = *values; break;
+        case AL_PITCH: source_set_pitch(ctx, src, *values); break;
+        case AL_CONE_INNER_ANGLE: src->cone_inner_angle = *values; break;
+        case AL_CONE_OUTER_ANGLE: src->cone_outer_angle = *values; break;
+        case AL_CONE_OUTER_GAIN: src->cone_outer_gain = *values; break;
 
-            case AL_POSITION:
-                SDL_memcpy(ctx->listener.position, values, sizeof (*values) * 3);
-                break;
+        case AL_SEC_OFFSET:
+        case AL_SAMPLE_OFFSET:
+        case AL_BYTE_OFFSET:
+            source_set_offset(src, param, *values);
+            break;
 
-            case AL_VELOCITY:
-                SDL_memcpy(ctx->listener.velocity, values, sizeof (*values) * 3);
-                break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); return;
 
-            case AL_ORIENTATION:
-                SDL_memcpy(&ctx->listener.orientation[0], &values[0], sizeof (*values) * 3);
-                SDL_memcpy(&ctx->listener.orientation[4], &values[3], sizeof (*values) * 3);
-                break;
+    }
 
-            default:
-                recalc = AL_FALSE;
-                set_al_error(ctx, AL_INVALID_ENUM);
-                break;
-        }
+    source_needs_recalc(src);
+}
 
-        if (recalc) {
-            context_needs_recalc(ctx);
-        }
+static void _alSourcefv(const ALuint name, const ALenum param, const ALfloat *values)
+{
+    ALCcontext *ctx = get_current_context();
+    ALsource *src = get_source(ctx, name, NULL);
+    if (src) {
+        source_setfv(ctx, src, param, values);
     }
 }
-ENTRYPOINTVOID(alListenerfv,(ALenum param, const ALfloat *values),(param,values))
+ENTRYPOINTVOID(alSourcefv,(ALuint name, ALenum param, const ALfloat *values),(name,param,values))
 
-static void _alListenerf(const ALenum param, const ALfloat value)
+static void _alSourcef(const ALuint name, const ALenum param, const ALfloat value)
 {
     switch (param) {
-        case AL_GAIN: _alListenerfv(param, &value); break;
+        case AL_GAIN:
+        case AL_MIN_GAIN:
+        case AL_MAX_GAIN:
+        case AL_REFERENCE_DISTANCE:
+        case AL_ROLLOFF_FACTOR:
+        case AL_MAX_DISTANCE:
+        case AL_PITCH:
+        case AL_CONE_INNER_ANGLE:
+        case AL_CONE_OUTER_ANGLE:
+        case AL_CONE_OUTER_GAIN:
+        case AL_SEC_OFFSET:
+        case AL_SAMPLE_OFFSET:
+        case AL_BYTE_OFFSET:
+            _alSourcefv(name, param, &value);
+            break;
+
         default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
     }
 }
-ENTRYPOINTVOID(alListenerf,(ALenum param, ALfloat value),(param,value))
+ENTRYPOINTVOID(alSourcef,(ALuint name, ALenum param, ALfloat value),(name,param,value))
 
-static void _alListener3f(const ALenum param, const ALfloat value1, const ALfloat value2, const ALfloat value3)
+static void _alSource3f(const ALuint name, const ALenum param, const ALfloat value1, const ALfloat value2, const ALfloat value3)
 {
     switch (param) {
         case AL_POSITION:
-        case AL_VELOCITY: {
+        case AL_VELOCITY:
+        case AL_DIRECTION: {
             const ALfloat values[3] = { value1, value2, value3 };
-            _alListenerfv(param, values);
+            _alSourcefv(name, param, values);
             break;
         }
         default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
     }
 }
-ENTRYPOINTVOID(alListener3f,(ALenum param, ALfloat value1, ALfloat value2, ALfloat value3),(param,value1,value2,value3))
+ENTRYPOINTVOID(alSource3f,(ALuint name, ALenum param, ALfloat value1, ALfloat value2, ALfloat value3),(name,param,value1,value2,value3))
 
-static void _alListeneriv(const ALenum param, const ALint *values)
+static void set_source_static_buffer(ALCcontext *ctx, ALsource *src, const ALuint bufname)
 {
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-    } else if (!values) {
-        set_al_error(ctx, AL_INVALID_VALUE);
+    const ALenum state = (const ALenum) SDL_AtomicGet(&src->state);
+    if ((state == AL_PLAYING) || (state == AL_PAUSED)) {
+        set_al_error(ctx, AL_INVALID_OPERATION);  /* can't change buffer on playing/paused sources */
     } else {
-        ALboolean recalc = AL_TRUE;
-        FIXME("Not atomic vs the mixer thread");  /* maybe have a latching system? */
-        switch (param) {
-            case AL_POSITION:
-                ctx->listener.position[0] = (ALfloat) values[0];
-                ctx->listener.position[1] = (ALfloat) values[1];
-                ctx->listener.position[2] = (ALfloat) values[2];
-                break;
-
-            case AL_VELOCITY:
-                ctx->listener.velocity[0] = (ALfloat) values[0];
-                ctx->listener.velocity[1] = (ALfloat) values[1];
-                ctx->listener.velocity[2] = (ALfloat) values[2];
-                break;
-
-            case AL_ORIENTATION:
-                ctx->listener.orientation[0] = (ALfloat) values[0];
-                ctx->listener.orientation[1] = (ALfloat) values[1];
-                ctx->listener.orientation[2] = (ALfloat) values[2];
-                ctx->listener.orientation[4] = (ALfloat) values[3];
-                ctx->listener.orientation[5] = (ALfloat) values[4];
-                ctx->listener.orientation[6] = (ALfloat) values[5];
-                break;
+        ALbuffer *buffer = NULL;
+        if (bufname && ((buffer = get_buffer(ctx, bufname, NULL)) == NULL)) {
+            set_al_error(ctx, AL_INVALID_VALUE);
+        } else if (buffer && buffer->mapped_access && !(buffer->mapped_access & AL_MAP_PERSISTENT_BIT_SOFT)) {
+            set_al_error(ctx, AL_INVALID_OPERATION);  /* AL_SOFT_map_buffer: only persistent mappings can play. */
+        } else if (buffer && buffer->callback && !src->callback_data && ((src->callback_data = (Uint8 *) calloc_simd_aligned(OPENAL_CALLBACK_BUFFER_FRAMES * OPENAL_CALLBACK_MAX_FRAMESIZE)) == NULL)) {
+            set_al_error(ctx, AL_OUT_OF_MEMORY);  /* allocate here so the mixer thread never has to. */
+        } else {
+            const ALboolean must_lock = SDL_AtomicGet(&src->mixer_accessible) ? AL_TRUE : AL_FALSE;
+            /* this can happen if you alSource(AL_BUFFER) while the exact source is in the middle of mixing */
+            FIXME("Double-check this lock; we shouldn't be able to reach this if the source is playing.");
+            if (must_lock) {
+                SDL_LockMutex(ctx->source_lock);
+            }
 
-            default:
-                recalc = AL_FALSE;
-                set_al_error(ctx, AL_INVALID_ENUM);
-                break;
-        }
+            if (src->buffer != buffer) {
+                if (src->buffer) {
+                    (void) SDL_AtomicDecRef(&src->buffer->refcount);
+                }
+                if (buffer) {
+                    SDL_AtomicIncRef(&buffer->refcount);
+                }
+                src->buffer = buffer;
+            }
 
-        if (recalc) {
-            context_needs_recalc(ctx);
-        }
-    }
-}
-ENTRYPOINTVOID(alListeneriv,(ALenum param, const ALint *values),(param,values))
+            src->type = buffer ? AL_STATIC : AL_UNDETERMINED;
+            src->queue_channels = buffer ? buffer->channels : 0;
+            src->queue_frequency = 0;
 
-static void _alListeneri(const ALenum param, const ALint value)
-{
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in AL 1.1 uses this */
-}
-ENTRYPOINTVOID(alListeneri,(ALenum param, ALint value),(param,value))
+            source_release_buffer_queue(ctx, src);
 
-static void _alListener3i(const ALenum param, const ALint value1, const ALint value2, const ALint value3)
-{
-    switch (param) {
-        case AL_POSITION:
-        case AL_VELOCITY: {
-            const ALint values[3] = { value1, value2, value3 };
-            _alListeneriv(param, values);
-            break;
+            if (must_lock) {
+                SDL_UnlockMutex(ctx->source_lock);
+            }
         }
-        default:
-            set_al_error(get_current_context(), AL_INVALID_ENUM);
-            break;
     }
 }
-ENTRYPOINTVOID(alListener3i,(ALenum param, ALint value1, ALint value2, ALint value3),(param,value1,value2,value3))
 
-static void _alGetListenerfv(const ALenum param, ALfloat *values)
+static void source_setiv(ALCcontext *ctx, ALsource *src, const ALenum param, const ALint *values)
 {
-    ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
-    }
-
-    if (!values) return;  /* legal no-op */
-
     switch (param) {
-        case AL_GAIN:
-            *values = ctx->listener.gain;
-            break;
+        case AL_BUFFER: set_source_static_buffer(ctx, src, (ALuint) *values); break;
+        case AL_SOURCE_RELATIVE: src->source_relative = *values ? AL_TRUE : AL_FALSE; break;
+        case AL_LOOPING: src->looping = *values ? AL_TRUE : AL_FALSE; break;
+        case AL_PHASE_VOCODER_PITCH_MOJOAL: source_set_vocoder_pitch(ctx, src, *values ? AL_TRUE : AL_FALSE); break;
+        case AL_REFERENCE_DISTANCE: src->reference_distance = (ALfloat) *values; break;
+        case AL_ROLLOFF_FACTOR: src->rolloff_factor = (ALfloat) *values; break;
+        case AL_MAX_DISTANCE: src->max_distance = (ALfloat) *values; break;
+        case AL_CONE_INNER_ANGLE: src->cone_inner_angle = (ALfloat) *values; break;
+        case AL_CONE_OUTER_ANGLE: src->cone_outer_angle = (ALfloat) *values; break;
 
         case AL_POSITION:
-            SDL_memcpy(values, ctx->listener.position, sizeof (ALfloat) * 3);
+            src->position[0] = (ALfloat) values[0];
+            src->position[1] = (ALfloat) values[1];
+            src->position[2] = (ALfloat) values[2];
             break;
 
         case AL_VELOCITY:
-            SDL_memcpy(values, ctx->listener.velocity, sizeof (ALfloat) * 3);
+            src->velocity[0] = (ALfloat) values[0];
+            src->velocity[1] = (ALfloat) values[1];
+            src->velocity[2] = (ALfloat) values[2];
             break;
 
-        case AL_ORIENTATION:
-            SDL_memcpy(&values[0], &ctx->listener.orientation[0], sizeof (ALfloat) * 3);
-            SDL_memcpy(&values[3], &ctx->listener.orientation[4], sizeof (ALfloat) * 3);
+        case AL_DIRECTION:
+            src->direction[0] = (ALfloat) values[0];
+            src->direction[1] = (ALfloat) values[1];
+            src->direction[2] = (ALfloat) values[2];
             break;
 
-        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+        case AL_SEC_OFFSET:
+        case AL_SAMPLE_OFFSET:
+        case AL_BYTE_OFFSET:
+            source_set_offset(src, param, (ALfloat)*values);
+            break;
+
+        default: set_al_error(ctx, AL_INVALID_ENUM); return;
     }
+
+    source_needs_recalc(src);
 }
-ENTRYPOINTVOID(alGetListenerfv,(ALenum param, ALfloat *values),(param,values))
 
-static void _alGetListenerf(const ALenum param, ALfloat *value)
+static void _alSourceiv(const ALuint name, const ALenum param, const ALint *values)
+{
+    ALCcontext *ctx = get_current_context();
+    ALsource *src = get_source(ctx, name, NULL);
+    if (src) {
+        source_setiv(ctx, src, param, values);
+    }
+}
+ENTRYPOINTVOID(alSourceiv,(ALuint name, ALenum param, const ALint *values),(name,param,values))
+
+static void _alSourcei(const ALuint name, const ALenum param, const ALint value)
 {
     switch (param) {
-        case AL_GAIN: _alGetListenerfv(param, value); break;
+        case AL_SOURCE_RELATIVE:
+        case AL_LOOPING:
+        case AL_PHASE_VOCODER_PITCH_MOJOAL:
+        case AL_BUFFER:
+        case AL_REFERENCE_DISTANCE:
+        case AL_ROLLOFF_FACTOR:
+        case AL_MAX_DISTANCE:
+        case AL_CONE_INNER_ANGLE:
+        case AL_CONE_OUTER_ANGLE:
+        case AL_SEC_OFFSET:
+        case AL_SAMPLE_OFFSET:
+        case AL_BYTE_OFFSET:
+            _alSourceiv(name, param, &value);
+            break;
         default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
     }
 }
-ENTRYPOINTVOID(alGetListenerf,(ALenum param, ALfloat *value),(param,value))
-
+ENTRYPOINTVOID(alSourcei,(ALuint name, ALenum param, ALint value),(name,param,value))
 
-static void _alGetListener3f(const ALenum param, ALfloat *value1, ALfloat *value2, ALfloat *value3)
+static void _alSource3i(const ALuint name, const ALenum param, const ALint value1, const ALint value2, const ALint value3)
 {
-    ALfloat values[3];
     switch (param) {
         case AL_POSITION:
         case AL_VELOCITY:
-            _alGetListenerfv(param, values);
-            if (value1) *value1 = values[0];
-            if (value2) *value2 = values[1];
-            if (value3) *value3 = values[2];
+        case AL_DIRECTION: {
+            const ALint values[3] = { (ALint) value1, (ALint) value2, (ALint) value3 };
+            _alSourceiv(name, param, values);
             break;
+        }
         default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
     }
 }
-ENTRYPOINTVOID(alGetListener3f,(ALenum param, ALfloat *value1, ALfloat *value2, ALfloat *value3),(param,value1,value2,value3))
-
+ENTRYPOINTVOID(alSource3i,(ALuint name, ALenum param, ALint value1, ALint value2, ALint value3),(name,param,value1,value2,value3))
 
-static void _alGetListeneri(const ALenum param, ALint *value)
+/* AL_MOJOAL_source_batch: set one property on a whole array of sources with
+   a single trip through the api lock. (values) holds one value (or three,
+   for vector properties) per source, back to back. Every name is looked up
+   before anything changes, so a bad name leaves all the sources alone. A bad
+   value (an unknown buffer name, a buffer change on a playing source, etc)
+   is only caught when we reach that source, though: the sources before it
+   keep their new value and the rest of the batch is skipped. */
+static int source_param_components(const ALenum param)
 {
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in AL 1.1 uses this */
+    switch (param) {
+        case AL_POSITION:
+        case AL_VELOCITY:
+        case AL_DIRECTION:
+            return 3;
+        default: break;
+    }
+    return 1;
 }
-ENTRYPOINTVOID(alGetListeneri,(ALenum param, ALint *value),(param,value))
-
 
-static void _alGetListeneriv(const ALenum param, ALint *values)
+/* returns NULL if there's nothing to do, otherwise the sources named in
+   (names), in (stackobjs) if they fit. Free it if it isn't (stackobjs). */
+static ALsource **source_batch_lookup(ALCcontext *ctx, const ALsizei n, const ALuint *names, const void *values, ALsource **stackobjs, const ALsizei stacklen)
 {
-    ALCcontext *ctx = get_current_context();
+    ALsource **objects = stackobjs;
+    ALsizei i;
+
     if (!ctx) {
         set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
+        return NULL;
+    } else if (n < 0) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return NULL;
+    } else if (n == 0) {
+        return NULL;  /* not an error, but nothing to do. */
+    } else if (!names || !values) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return NULL;
     }
 
-    if (!values) return;  /* legal no-op */
-
-    switch (param) {
-        case AL_POSITION:
-            values[0] = (ALint) ctx->listener.position[0];
-            values[1] = (ALint) ctx->listener.position[1];
-            values[2] = (ALint) ctx->listener.position[2];
-            break;
-
-        case AL_VELOCITY:
-            values[0] = (ALint) ctx->listener.velocity[0];
-            values[1] = (ALint) ctx->listener.velocity[1];
-            values[2] = (ALint) ctx->listener.velocity[2];
-            break;
-
-        case AL_ORIENTATION:
-            values[0] = (ALint) ctx->listener.orientation[0];
-            values[1] = (ALint) ctx->listener.orientation[1];
-            values[2] = (ALint) ctx->listener.orientation[2];
-            values[3] = (ALint) ctx->listener.orientation[4];
-            values[4] = (ALint) ctx->listener.orientation[5];
-            values[5] = (ALint) ctx->listener.orientation[6];
-            break;
+    if (n > stacklen) {
+        objects = (ALsource **) SDL_malloc(sizeof (ALsource *) * n);
+        if (!objects) {
+            set_al_error(ctx, AL_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
 
-        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    for (i = 0; i < n; i++) {
+        objects[i] = get_source(ctx, names[i], NULL);
+        if (objects[i] == NULL) {  /* get_source() set the error. */
+            if (objects != stackobjs) SDL_free(objects);
+            return NULL;
+        }
     }
+
+    return objects;
 }
-ENTRYPOINTVOID(alGetListeneriv,(ALenum param, ALint *values),(param,values))
 
-static void _alGetListener3i(const ALenum param, ALint *value1, ALint *value2, ALint *value3)
+static void _alSourcefvBatchMOJOAL(const ALsizei n, const ALuint *names, const ALenum param, const ALfloat *values)
 {
-    ALint values[3];
-    switch (param) {
-        case AL_POSITION:
-        case AL_VELOCITY:
-            _alGetListeneriv(param, values);
-            if (value1) *value1 = values[0];
-            if (value2) *value2 = values[1];
-            if (value3) *value3 = values[2];
-            break;
+    ALCcontext *ctx = get_current_context();
+    const int components = source_param_components(param);
+    ALsource *stackobjs[16];
+    ALsource **objects = source_batch_lookup(ctx, n, names, values, stackobjs, SDL_arraysize(stackobjs));
+    ALsizei i;
 
-        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    if (objects) {
+        /* park any error the app hasn't read yet, so we can tell when a
+           value fails partway through; the older error wins again after. */
+        const ALenum pending_error = ctx->error;
+        ctx->error = AL_NO_ERROR;
+        for (i = 0; (i < n) && (ctx->error == AL_NO_ERROR); i++) {
+            source_setfv(ctx, objects[i], param, values + (i * components));
+        }
+        if (pending_error != AL_NO_ERROR) {
+            ctx->error = pending_error;
+        }
+        if (objects != stackobjs) SDL_free(objects);
     }
 }
-ENTRYPOINTVOID(alGetListener3i,(ALenum param, ALint *value1, ALint *value2, ALint *value3),(param,value1,value2,value3))
+ENTRYPOINTVOID(alSourcefvBatchMOJOAL,(ALsizei n, const ALuint *names, ALenum param, const ALfloat *values),(n,names,param,values))
 
-/* !!! FIXME: buffers and sources use almost identical code for blocks */
-static void _alGenSources(const ALsizei n, ALuint *names)
+static void _alSourceivBatchMOJOAL(const ALsizei n, const ALuint *names, const ALenum param, const ALint *values)
 {
     ALCcontext *ctx = get_current_context();
-    ALboolean out_of_memory = AL_FALSE;
-    ALsizei totalblocks;
+    const int components = source_param_components(param);
     ALsource *stackobjs[16];
-    ALsource **objects = stackobjs;
-    ALsizei found = 0;
-    ALsizei block_offset = 0;
-    ALsizei blocki;
+    ALsource **objects = source_batch_lookup(ctx, n, names, values, stackobjs, SDL_arraysize(stackobjs));
     ALsizei i;
 
-    if (n < 0) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-        return;
-    } else if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
-    } else if (n == 0) {
-        return;  /* not an error, but nothing to do. */
-    }
-
-    if (n <= SDL_arraysize(stackobjs)) {
-        SDL_memset(stackobjs, '\0', sizeof (ALsource *) * n);
-    } else {
-        objects = (ALsource **) SDL_calloc(n, sizeof (ALsource *));
-        if (!objects) {
-            set_al_error(ctx, AL_OUT_OF_MEMORY);
-            return;
+    if (objects) {
+        /* park any error the app hasn't read yet, so we can tell when a
+           value fails partway through; the older error wins again after. */
+        const ALenum pending_error = ctx->error;
+        ctx->error = AL_NO_ERROR;
+        for (i = 0; (i < n) && (ctx->error == AL_NO_ERROR); i++) {
+            source_setiv(ctx, objects[i], param, values + (i * components));
+        }
+        if (pending_error != AL_NO_ERROR) {
+            ctx->error = pending_error;
         }
+        if (objects != stackobjs) SDL_free(objects);
     }
+}
+ENTRYPOINTVOID(alSourceivBatchMOJOAL,(ALsizei n, const ALuint *names, ALenum param, const ALint *values),(n,names,param,values))
 
-    totalblocks = ctx->num_source_blocks;
-    for (blocki = 0; blocki < totalblocks; blocki++) {
-        SourceBlock *block = ctx->source_blocks[blocki];
-        block->tmp = 0;
-        if (block->used < SDL_arraysize(block->sources)) {  /* skip if full */
-            for (i = 0; i < SDL_arraysize(block->sources); i++) {
-                /* if a playing source was deleted, it will still be marked mixer_accessible
-                    until the mixer thread shuffles it out. Until then, the source isn't
-                    available for reuse. */
-                if (!block->sources[i].allocated && !SDL_AtomicGet(&block->sources[i].mixer_accessible)) {
-                    block->tmp++;
-                    objects[found] = &block->sources[i];
-                    names[found++] = (i + block_offset) + 1;  /* +1 so it isn't zero. */
-                    if (found == n) {
-                        break;
-                    }
-                }
-            }
+static void _alGetSourcefv(const ALuint name, const ALenum param, ALfloat *values)
+{
+    ALCcontext *ctx = get_current_context();
+    ALsource *src = get_source(ctx, name, NULL);
+    if (!src) return;
+
+    switch (param) {
+        case AL_GAIN: *values = src->gain; break;
+        case AL_POSITION: SDL_memcpy(values, src->position, sizeof (ALfloat) * 3); break;
+        case AL_VELOCITY: SDL_memcpy(values, src->velocity, sizeof (ALfloat) * 3); break;
+        case AL_DIRECTION: SDL_memcpy(values, src->direction, sizeof (ALfloat) * 3); break;
+        case AL_MIN_GAIN: *values = src->min_gain; break;
+        case AL_MAX_GAIN: *values = src->max_gain; break;
+        case AL_REFERENCE_DISTANCE: *values = src->reference_distance; break;
+        case AL_ROLLOFF_FACTOR: *values = src->rolloff_factor; break;
+        case AL_MAX_DISTANCE: *values = src->max_distance; break;
+        case AL_PITCH: *values = src->pitch; break;
+        case AL_CONE_INNER_ANGLE: *values = src->cone_inner_angle; break;
+        case AL_CONE_OUTER_ANGLE: *values = src->cone_outer_angle; break;
+        case AL_CONE_OUTER_GAIN:  *values = src->cone_outer_gain; break;
 
-            if (found == n) {
-                break;
-            }
-        }
+        case AL_SEC_OFFSET:
+        case AL_SAMPLE_OFFSET:
+        case AL_BYTE_OFFSET:
+            *values = source_get_offset(src, param);
+            break;
 
-        block_offset += SDL_arraysize(block->sources);
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;
     }
+}
+ENTRYPOINTVOID(alGetSourcefv,(ALuint name, ALenum param, ALfloat *values),(name,param,values))
 
-    while (found < n) {  /* out of blocks? Add new ones. */
-        /* ctx->source_blocks is only accessed on the API thread under a mutex, so it's safe to realloc. */
-        void *ptr = SDL_realloc(ctx->source_blocks, sizeof (SourceBlock *) * (totalblocks + 1));
-        SourceBlock *block;
-
-        if (!ptr) {
-            out_of_memory = AL_TRUE;
+static void _alGetSourcef(const ALuint name, const ALenum param, ALfloat *value)
+{
+    switch (param) {
+        case AL_GAIN:
+        case AL_MIN_GAIN:
+        case AL_MAX_GAIN:
+        case AL_REFERENCE_DISTANCE:
+        case AL_ROLLOFF_FACTOR:
+        case AL_MAX_DISTANCE:
+        case AL_PITCH:
+        case AL_CONE_INNER_ANGLE:
+        case AL_CONE_OUTER_ANGLE:
+        case AL_CONE_OUTER_GAIN:
+        case AL_SEC_OFFSET:
+        case AL_SAMPLE_OFFSET:
+        case AL_BYTE_OFFSET:
+            _alGetSourcefv(name, param, value);
             break;
-        }
-        ctx->source_blocks = (SourceBlock **) ptr;
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetSourcef,(ALuint name, ALenum param, ALfloat *value),(name,param,value))
 
-        block = (SourceBlock *) calloc_simd_aligned(sizeof (SourceBlock));
-        if (!block) {
-            out_of_memory = AL_TRUE;
+static void _alGetSource3f(const ALuint name, const ALenum param, ALfloat *value1, ALfloat *value2, ALfloat *value3)
+{
+    switch (param) {
+        case AL_POSITION:
+        case AL_VELOCITY:
+        case AL_DIRECTION: {
+            ALfloat values[3];
+            _alGetSourcefv(name, param, values);
+            if (value1) *value1 = values[0];
+            if (value2) *value2 = values[1];
+            if (value3) *value3 = values[2];
             break;
         }
-        ctx->source_blocks[totalblocks] = block;
-        totalblocks++;
-        ctx->num_source_blocks++;
-
-        for (i = 0; i < SDL_arraysize(block->sources); i++) {
-            block->tmp++;
-            objects[found] = &block->sources[i];
-            names[found++] = (i + block_offset) + 1;  /* +1 so it isn't zero. */
-            if (found == n) {
-                break;
-            }
-        }
-        block_offset += SDL_arraysize(block->sources);
-    }
-
-    if (out_of_memory) {
-        if (objects != stackobjs) SDL_free(objects);
-        SDL_memset(names, '\0', sizeof (*names) * n);
-        set_al_error(ctx, AL_OUT_OF_MEMORY);
-        return;
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
     }
+}
+ENTRYPOINTVOID(alGetSource3f,(ALuint name, ALenum param, ALfloat *value1, ALfloat *value2, ALfloat *value3),(name,param,value1,value2,value3))
 
-    SDL_assert(found == n);  /* we should have either gotten space or bailed on alloc failure */
-
-    /* update the "used" field in blocks with items we are taking now. */
-    found = 0;
-    for (blocki = 0; found < n; blocki++) {
-        SourceBlock *block = ctx->source_blocks[blocki];
-        SDL_assert(blocki < totalblocks);
-        const int foundhere = block->tmp;
-        if (foundhere) {
-            block->used += foundhere;
-            found += foundhere;
-            block->tmp = 0;
-        }
-    }
+static void _alGetSourceiv(const ALuint name, const ALenum param, ALint *values)
+{
+    ALCcontext *ctx = get_current_context();
+    ALsource *src = get_source(ctx, name, NULL);
+    if (!src) return;
 
-    SDL_assert(found == n);
+    switch (param) {
+        case AL_SOURCE_STATE: *values = (ALint) SDL_AtomicGet(&src->state); break;
+        case AL_SOURCE_TYPE: *values = (ALint) src->type; break;
+        case AL_BUFFER: *values = (ALint) (src->buffer ? src->buffer->name : 0); break;
+        case AL_BUFFERS_QUEUED: *values = (ALint) SDL_AtomicGet(&src->total_queued_buffers); break;
+        case AL_BUFFERS_PROCESSED: *values = (ALint) SDL_AtomicGet(&src->buffer_queue_processed.num_items); break;
+        case AL_SOURCE_RELATIVE: *values = (ALint) src->source_relative; break;
+        case AL_LOOPING: *values = (ALint) src->looping; break;
+        case AL_PHASE_VOCODER_PITCH_MOJOAL: *values = (ALint) src->vocoder_pitch; break;
+        case AL_REFERENCE_DISTANCE: *values = (ALint) src->reference_distance; break;
+        case AL_ROLLOFF_FACTOR: *values = (ALint) src->rolloff_factor; break;
+        case AL_MAX_DISTANCE: *values = (ALint) src->max_distance; break;
+        case AL_CONE_INNER_ANGLE: *values = (ALint) src->cone_inner_angle; break;
+        case AL_CONE_OUTER_ANGLE: *values = (ALint) src->cone_outer_angle; break;
+        case AL_POSITION:
+            values[0] = (ALint) src->position[0];
+            values[1] = (ALint) src->position[1];
+            values[2] = (ALint) src->position[2];
+            break;
 
-    for (i = 0; i < n; i++) {
-        ALsource *src = objects[i];
+        case AL_VELOCITY:
+            values[0] = (ALint) src->velocity[0];
+            values[1] = (ALint) src->velocity[1];
+            values[2] = (ALint) src->velocity[2];
+            break;
 
-        /*printf("Generated source %u\n", (unsigned int) names[i]);*/
+        case AL_DIRECTION:
+            values[0] = (ALint) src->direction[0];
+            values[1] = (ALint) src->direction[1];
+            values[2] = (ALint) src->direction[2];
+            break;
 
-        SDL_assert(!src->allocated);
+        case AL_SEC_OFFSET:
+        case AL_SAMPLE_OFFSET:
+        case AL_BYTE_OFFSET:
+            *values = (ALint) source_get_offset(src, param);
+            break;
 
-        /* Make sure everything that wants to use SIMD is aligned for it. */
-        SDL_assert( (((size_t) &src->position[0]) % 16) == 0 );
-        SDL_assert( (((size_t) &src->velocity[0]) % 16) == 0 );
-        SDL_assert( (((size_t) &src->direction[0]) % 16) == 0 );
+        case AL_SAMPLE_RW_OFFSETS_SOFT:
+        case AL_BYTE_RW_OFFSETS_SOFT:
+            source_get_rw_offsets(ctx, src, param, values);
+            break;
 
-        SDL_zerop(src);
-        SDL_AtomicSet(&src->state, AL_INITIAL);
-        SDL_AtomicSet(&src->total_queued_buffers, 0);
-        src->name = names[i];
-        src->type = AL_UNDETERMINED;
-        src->recalc = AL_TRUE;
-        src->gain = 1.0f;
-        src->max_gain = 1.0f;
-        src->reference_distance = 1.0f;
-        src->max_distance = FLT_MAX;
-        src->rolloff_factor = 1.0f;
-        src->pitch = 1.0f;
-        src->cone_inner_angle = 360.0f;
-        src->cone_outer_angle = 360.0f;
-        source_needs_recalc(src);
-        src->allocated = AL_TRUE;   /* we officially own it. */
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;
     }
-
-    if (objects != stackobjs) SDL_free(objects);
 }
-ENTRYPOINTVOID(alGenSources,(ALsizei n, ALuint *names),(n,names))
-
+ENTRYPOINTVOID(alGetSourceiv,(ALuint name, ALenum param, ALint *values),(name,param,values))
 
-static void _alDeleteSources(const ALsizei n, const ALuint *names)
+static void _alGetSourcei(const ALuint name, const ALenum param, ALint *value)
 {
-    ALCcontext *ctx = get_current_context();
-    ALsizei i;
-
-    if (n < 0) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-        return;
-    } else if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
+    switch (param) {
+        case AL_SOURCE_STATE:
+        case AL_SOURCE_RELATIVE:
+        case AL_LOOPING:
+        case AL_PHASE_VOCODER_PITCH_MOJOAL:
+        case AL_BUFFER:
+        case AL_BUFFERS_QUEUED:
+        case AL_BUFFERS_PROCESSED:
+        case AL_SOURCE_TYPE:
+        case AL_REFERENCE_DISTANCE:
+        case AL_ROLLOFF_FACTOR:
+        case AL_MAX_DISTANCE:
+        case AL_CONE_INNER_ANGLE:
+        case AL_CONE_OUTER_ANGLE:
+        case AL_SEC_OFFSET:
+        case AL_SAMPLE_OFFSET:
+        case AL_BYTE_OFFSET:
+            _alGetSourceiv(name, param, value);
+            break;
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
     }
+}
+ENTRYPOINTVOID(alGetSourcei,(ALuint name, ALenum param, ALint *value),(name,param,value))
 
-    for (i = 0; i < n; i++) {
-        const ALuint name = names[i];
-        if (name == 0) {
-            /* ignore it. */ FIXME("Spec says alDeleteBuffers() can have a zero name as a legal no-op, but this text isn't included in alDeleteSources...");
-        } else {
-            ALsource *source = get_source(ctx, name, NULL);
-            if (!source) {
-                /* "If one or more of the specified names is not valid, an AL_INVALID_NAME error will be recorded, and no objects will be deleted." */
-                set_al_error(ctx, AL_INVALID_NAME);
-                return;
-            }
+static void _alGetSource3i(const ALuint name, const ALenum param, ALint *value1, ALint *value2, ALint *value3)
+{
+    switch (param) {
+        case AL_POSITION:
+        case AL_VELOCITY:
+        case AL_DIRECTION: {
+            ALint values[3];
+            _alGetSourceiv(name, param, values);
+            if (value1) *value1 = values[0];
+            if (value2) *value2 = values[1];
+            if (value3) *value3 = values[2];
+            break;
         }
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
     }
+}
+ENTRYPOINTVOID(alGetSource3i,(ALuint name, ALenum param, ALint *value1, ALint *value2, ALint *value3),(name,param,value1,value2,value3))
 
-    for (i = 0; i < n; i++) {
-        const ALuint name = names[i];
-        if (name != 0) {
-            SourceBlock *block;
-            ALsource *source = get_source(ctx, name, &block);
-            SDL_assert(source != NULL);
+/* AL_SOFT_source_latency. Other than the new offset queries, these just convert and pass through to the usual functions. */
+static void _alSourcedSOFT(const ALuint name, const ALenum param, const ALdouble value)
+{
+    _alSourcef(name, param, (ALfloat) value);
+}
+ENTRYPOINTVOID(alSourcedSOFT,(ALuint name, ALenum param, ALdouble value),(name,param,value))
 
-            /* "A playing source can be deleted--the source will be stopped automatically and then deleted." */
-            if (!SDL_AtomicGet(&source->mixer_accessible)) {
-                SDL_AtomicSet(&source->state, AL_STOPPED);
-            } else {
-                SDL_LockMutex(ctx->source_lock);
-                SDL_AtomicSet(&source->state, AL_STOPPED);  /* mixer will drop from playlist next time it sees this. */
-                SDL_UnlockMutex(ctx->source_lock);
-            }
-            source->allocated = AL_FALSE;
-            source_release_buffer_queue(ctx, source);
-            if (source->buffer) {
-                SDL_assert(source->type == AL_STATIC);
-                (void) SDL_AtomicDecRef(&source->buffer->refcount);
-                source->buffer = NULL;
-            }
-            if (source->stream) {
-                SDL_FreeAudioStream(source->stream);
-                source->stream = NULL;
-            }
-            block->used--;
-        }
-    }
+static void _alSource3dSOFT(const ALuint name, const ALenum param, const ALdouble value1, const ALdouble value2, const ALdouble value3)
+{
+    _alSource3f(name, param, (ALfloat) value1, (ALfloat) value2, (ALfloat) value3);
 }
-ENTRYPOINTVOID(alDeleteSources,(ALsizei n, const ALuint *names),(n,names))
+ENTRYPOINTVOID(alSource3dSOFT,(ALuint name, ALenum param, ALdouble value1, ALdouble value2, ALdouble value3),(name,param,value1,value2,value3))
 
-static ALboolean _alIsSource(const ALuint name)
+static void _alSourcedvSOFT(const ALuint name, const ALenum param, const ALdouble *values)
 {
-    ALCcontext *ctx = get_current_context();
-    return (ctx && (get_source(ctx, name, NULL) != NULL)) ? AL_TRUE : AL_FALSE;
+    switch (param) {
+        case AL_POSITION:
+        case AL_VELOCITY:
+        case AL_DIRECTION:
+            _alSource3dSOFT(name, param, values[0], values[1], values[2]);
+            break;
+        default:
+            _alSourcedSOFT(name, param, *values);
+            break;
+    }
 }
-ENTRYPOINT(ALboolean,alIsSource,(ALuint name),(name))
+ENTRYPOINTVOID(alSourcedvSOFT,(ALuint name, ALenum param, const ALdouble *values),(name,param,values))
 
-static void source_set_pitch(ALCcontext *ctx, ALsource *src, const ALfloat pitch)
+static void _alGetSourcedSOFT(const ALuint name, const ALenum param, ALdouble *value)
 {
-    /* only allocate pitchstate if the pitch every changes, because it's a lot of
-       RAM and we leave it allocated to the source until forever once needed */
-    if ((pitch != 1.0f) && (src->pitchstate == NULL)) {
-        src->pitchstate = (PitchState *) SDL_calloc(1, sizeof (PitchState));
-        if (src->pitchstate == NULL) {
-            set_al_error(ctx, AL_OUT_OF_MEMORY);
+    if (param == AL_SEC_OFFSET) {  /* we can do better than a float here. */
+        ALCcontext *ctx = get_current_context();
+        ALsource *src = get_source(ctx, name, NULL);
+        if (src) {
+            const ALbuffer *buffer = source_offset_buffer(src);
+            *value = buffer ? ((((ALdouble) source_calculate_offset(src)) / 4294967296.0) / ((ALdouble) buffer->frequency)) : 0.0;
         }
+    } else {
+        ALfloat f = 0.0f;
+        _alGetSourcef(name, param, &f);
+        *value = (ALdouble) f;
     }
-    src->pitch = pitch;
 }
+ENTRYPOINTVOID(alGetSourcedSOFT,(ALuint name, ALenum param, ALdouble *value),(name,param,value))
 
-static void _alSourcefv(const ALuint name, const ALenum param, const ALfloat *values)
+static void _alGetSource3dSOFT(const ALuint name, const ALenum param, ALdouble *value1, ALdouble *value2, ALdouble *value3)
 {
-    ALCcontext *ctx = get_current_context();
-    ALsource *src = get_source(ctx, name, NULL);
-    if (!src) return;
+    ALfloat values[3] = { 0.0f, 0.0f, 0.0f };
+    _alGetSource3f(name, param, &values[0], &values[1], &values[2]);
+    if (value1) *value1 = (ALdouble) values[0];
+    if (value2) *value2 = (ALdouble) values[1];
+    if (value3) *value3 = (ALdouble) values[2];
+}
+ENTRYPOINTVOID(alGetSource3dSOFT,(ALuint name, ALenum param, ALdouble *value1, ALdouble *value2, ALdouble *value3),(name,param,value1,value2,value3))
 
+static void _alGetSourcedvSOFT(const ALuint name, const ALenum param, ALdouble *values)
+{
     switch (param) {
-        case AL_GAIN: src->gain = *values; break;
-        case AL_POSITION: SDL_memcpy(src->position, values, sizeof (ALfloat) * 3); break;
-        case AL_VELOCITY: SDL_memcpy(src->velocity, values, sizeof (ALfloat) * 3); break;
-        case AL_DIRECTION: SDL_memcpy(src->direction, values, sizeof (ALfloat) * 3); break;
-        case AL_MIN_GAIN: src->min_gain = *values; break;
-        case AL_MAX_GAIN: src->max_gain = *values; break;
-        case AL_REFERENCE_DISTANCE: src->reference_distance = *values; break;
-        case AL_ROLLOFF_FACTOR: src->rolloff_factor = *values; break;
-        case AL_MAX_DISTANCE: src->max_distance = *values; break;
-        case AL_PITCH: source_set_pitch(ctx, src, *values); break;
-        case AL_CONE_INNER_ANGLE: src->cone_inner_angle = *values; break;
-        case AL_CONE_OUTER_ANGLE: src->cone_outer_angle = *values; break;
-        case AL_CONE_OUTER_GAIN: src->cone_outer_gain = *values; break;
+        case AL_SEC_OFFSET_LATENCY_SOFT:
+        case AL_SEC_OFFSET_CLOCK_SOFT: {
+            ALCcontext *ctx = get_current_context();
+            ALsource *src = get_source(ctx, name, NULL);
+            if (src) {
+                const ALbuffer *buffer = source_offset_buffer(src);
+                Sint64 offset;
+                Uint64 clock;
+                source_get_offset_clock(ctx, src, &offset, &clock);
+                values[0] = buffer ? ((((ALdouble) offset) / 4294967296.0) / ((ALdouble) buffer->frequency)) : 0.0;
+                if (param == AL_SEC_OFFSET_CLOCK_SOFT) {
+                    values[1] = ((ALdouble) device_frames_to_ns(ctx->device, clock)) / 1000000000.0;
+                } else {
+                    values[1] = ((ALdouble) device_latency_ns(ctx->device)) / 1000000000.0;
+                }
+            }
+            break;
+        }
 
-        case AL_SEC_OFFSET:
-        case AL_SAMPLE_OFFSET:
-        case AL_BYTE_OFFSET:
-            source_set_offset(src, param, *values);
+        case AL_POSITION:
+        case AL_VELOCITY:
+        case AL_DIRECTION:
+            _alGetSource3dSOFT(name, param, &values[0], &values[1], &values[2]);
             break;
 
-        default: set_al_error(ctx, AL_INVALID_ENUM); return;
+        default:
+            _alGetSourcedSOFT(name, param, values);
+            break;
+    }
+}
+ENTRYPOINTVOID(alGetSourcedvSOFT,(ALuint name, ALenum param, ALdouble *values),(name,param,values))
 
+static void _alSourcei64SOFT(const ALuint name, const ALenum param, const ALint64SOFT value)
+{
+    if ((value < SDL_MIN_SINT32) || (value > SDL_MAX_SINT32)) {
+        set_al_error(get_current_context(), AL_INVALID_VALUE);  /* nothing we have takes a value this big. */
+    } else {
+        _alSourcei(name, param, (ALint) value);
     }
+}
+ENTRYPOINTVOID(alSourcei64SOFT,(ALuint name, ALenum param, ALint64SOFT value),(name,param,value))
 
-    source_needs_recalc(src);
+static void _alSource3i64SOFT(const ALuint name, const ALenum param, const ALint64SOFT value1, const ALint64SOFT value2, const ALint64SOFT value3)
+{
+    if ((value1 < SDL_MIN_SINT32) || (value1 > SDL_MAX_SINT32) ||
+        (value2 < SDL_MIN_SINT32) || (value2 > SDL_MAX_SINT32) ||
+        (value3 < SDL_MIN_SINT32) || (value3 > SDL_MAX_SINT32)) {
+        set_al_error(get_current_context(), AL_INVALID_VALUE);
+    } else {
+        _alSource3i(name, param, (ALint) value1, (ALint) value2, (ALint) value3);
+    }
 }
-ENTRYPOINTVOID(alSourcefv,(ALuint name, ALenum param, const ALfloat *values),(name,param,values))
+ENTRYPOINTVOID(alSource3i64SOFT,(ALuint name, ALenum param, ALint64SOFT value1, ALint64SOFT value2, ALint64SOFT value3),(name,param,value1,value2,value3))
 
-static void _alSourcef(const ALuint name, const ALenum param, const ALfloat value)
+static void _alSourcei64vSOFT(const ALuint name, const ALenum param, const ALint64SOFT *values)
 {
     switch (param) {
-        case AL_GAIN:
-        case AL_MIN_GAIN:
-        case AL_MAX_GAIN:
-        case AL_REFERENCE_DISTANCE:
-        case AL_ROLLOFF_FACTOR:
-        case AL_MAX_DISTANCE:
-        case AL_PITCH:
-        case AL_CONE_INNER_ANGLE:
-        case AL_CONE_OUTER_ANGLE:
-        case AL_CONE_OUTER_GAIN:
-        case AL_SEC_OFFSET:
-        case AL_SAMPLE_OFFSET:
-        case AL_BYTE_OFFSET:
-            _alSourcefv(name, param, &value);
+        case AL_POSITION:
+        case AL_VELOCITY:
+        case AL_DIRECTION:
+            _alSource3i64SOFT(name, param, values[0], values[1], values[2]);
+            break;
+        default:
+            _alSourcei64SOFT(name, param, *values);
             break;
-
-        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
     }
 }
-ENTRYPOINTVOID(alSourcef,(ALuint name, ALenum param, ALfloat value),(name,param,value))
+ENTRYPOINTVOID(alSourcei64vSOFT,(ALuint name, ALenum param, const ALint64SOFT *values),(name,param,values))
 
-static void _alSource3f(const ALuint name, const ALenum param, const ALfloat value1, const ALfloat value2, const ALfloat value3)
+static void _alGetSourcei64SOFT(const ALuint name, const ALenum param, ALint64SOFT *value)
+{
+    ALint i = 0;
+    _alGetSourcei(name, param, &i);
+    *value = (ALint64SOFT) i;
+}
+ENTRYPOINTVOID(alGetSourcei64SOFT,(ALuint name, ALenum param, ALint64SOFT *value),(name,param,value))
+
+static void _alGetSource3i64SOFT(const ALuint name, const ALenum param, ALint64SOFT *value1, ALint64SOFT *value2, ALint64SOFT *value3)
+{
+    ALint values[3] = { 0, 0, 0 };
+    _alGetSource3i(name, param, &values[0], &values[1], &values[2]);
+    if (value1) *value1 = (ALint64SOFT) values[0];
+    if (value2) *value2 = (ALint64SOFT) values[1];
+    if (value3) *value3 = (ALint64SOFT) values[2];
+}
+ENTRYPOINTVOID(alGetSource3i64SOFT,(ALuint name, ALenum param, ALint64SOFT *value1, ALint64SOFT *value2, ALint64SOFT *value3),(name,param,value1,value2,value3))
+
+static void _alGetSourcei64vSOFT(const ALuint name, const ALenum param, ALint64SOFT *values)
 {
     switch (param) {
+        case AL_SAMPLE_OFFSET_LATENCY_SOFT:
+        case AL_SAMPLE_OFFSET_CLOCK_SOFT: {
+            ALCcontext *ctx = get_current_context();
+            ALsource *src = get_source(ctx, name, NULL);
+            if (src) {
+                Sint64 offset;
+                Uint64 clock;
+                source_get_offset_clock(ctx, src, &offset, &clock);
+                values[0] = (ALint64SOFT) offset;  /* 32.32 fixed point sample frames. */
+                if (param == AL_SAMPLE_OFFSET_CLOCK_SOFT) {
+                    values[1] = (ALint64SOFT) device_frames_to_ns(ctx->device, clock);  /* nanoseconds. */
+                } else {
+                    values[1] = (ALint64SOFT) device_latency_ns(ctx->device);  /* nanoseconds. */
+                }
+            }
+            break;
+        }
+
         case AL_POSITION:
         case AL_VELOCITY:
-        case AL_DIRECTION: {
-            const ALfloat values[3] = { value1, value2, value3 };
-            _alSourcefv(name, param, values);
+        case AL_DIRECTION:
+            _alGetSource3i64SOFT(name, param, &values[0], &values[1], &values[2]);
+            break;
+
+        default:
+            _alGetSourcei64SOFT(name, param, values);
             break;
-        }
-        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
     }
 }
-ENTRYPOINTVOID(alSource3f,(ALuint name, ALenum param, ALfloat value1, ALfloat value2, ALfloat value3),(name,param,value1,value2,value3))
+ENTRYPOINTVOID(alGetSourcei64vSOFT,(ALuint name, ALenum param, ALint64SOFT *values),(name,param,values))
 
-static void set_source_static_buffer(ALCcontext *ctx, ALsource *src, const ALuint bufname)
+static void source_play(ALCcontext *ctx, const ALsizei n, const ALuint *names)
 {
-    const ALenum state = (const ALenum) SDL_AtomicGet(&src->state);
-    if ((state == AL_PLAYING) || (state == AL_PAUSED)) {
-        set_al_error(ctx, AL_INVALID_OPERATION);  /* can't change buffer on playing/paused sources */
-    } else {
-        ALbuffer *buffer = NULL;
-        if (bufname && ((buffer = get_buffer(ctx, bufname, NULL)) == NULL)) {
-            set_al_error(ctx, AL_INVALID_VALUE);
-        } else {
-            const ALboolean must_lock = SDL_AtomicGet(&src->mixer_accessible) ? AL_TRUE : AL_FALSE;
-            SDL_AudioStream *stream = NULL;
-            SDL_AudioStream *freestream = NULL;
-            /* We only use the stream for resampling, not for channel conversion. */
-            FIXME("keep the existing stream if formats match?");
-            if (buffer && (ctx->device->frequency != buffer->frequency)) {
-                stream = SDL_NewAudioStream(AUDIO_F32SYS, buffer->channels, buffer->frequency, AUDIO_F32SYS, buffer->channels, ctx->device->frequency);
-                if (!stream) {
-                    set_al_error(ctx, AL_OUT_OF_MEMORY);
-                    return;
-                }
-                FIXME("need a way to prealloc space in the stream, so the mixer doesn't have to malloc");
-            }
+    ALboolean failed = AL_FALSE;
+    SourcePlayTodo todo;
+    SourcePlayTodo *todoend = &todo;
+    SourcePlayTodo *todoptr;
+    void *ptr;
+    ALsizei i;
 
-            /* this can happen if you alSource(AL_BUFFER) while the exact source is in the middle of mixing */
-            FIXME("Double-check this lock; we shouldn't be able to reach this if the source is playing.");
-            if (must_lock) {
-                SDL_LockMutex(ctx->source_lock);
-            }
+    if (n <= 0) {
+        return;
+    } else if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
 
-            if (src->buffer != buffer) {
-                if (src->buffer) {
-                    (void) SDL_AtomicDecRef(&src->buffer->refcount);
-                }
-                if (buffer) {
-                    SDL_AtomicIncRef(&buffer->refcount);
-                }
-                src->buffer = buffer;
+    SDL_zero(todo);
+
+    /* Obtain our SourcePlayTodo items upfront; if this runs out of
+       memory, we won't have changed any state. The mixer thread will
+       put items back in the pool when done with them, so this handoff needs
+       to be atomic. */
+    for (i = 0; i < n; i++) {
+        SourcePlayTodo *item;
+        do {
+            ptr = SDL_AtomicGetPtr(&ctx->device->playback.source_todo_pool);
+            item = (SourcePlayTodo *) ptr;
+            if (!item) break;
+            ptr = item->next;
+        } while (!SDL_AtomicCASPtr(&ctx->device->playback.source_todo_pool, item, ptr));
+
+        if (!item) {  /* allocate a new item */
+            item = (SourcePlayTodo *) SDL_calloc(1, sizeof (SourcePlayTodo));
+            if (!item) {
+                set_al_error(ctx, AL_OUT_OF_MEMORY);
+                failed = AL_TRUE;
+                break;
             }
+        }
 
-            src->type = buffer ? AL_STATIC : AL_UNDETERMINED;
-            src->queue_channels = buffer ? buffer->channels : 0;
-            src->queue_frequency = 0;
+        item->next = NULL;
+        todoend->next = item;
+        todoend = item;
+    }
 
-            source_release_buffer_queue(ctx, src);
+    if (failed) {
+        /* put the whole new queue back in the pool for reuse later. */
+        if (todo.next) {
+            do {
+                ptr = SDL_AtomicGetPtr(&ctx->device->playback.source_todo_pool);
+                todoend->next = (SourcePlayTodo *) ptr;
+            } while (!SDL_AtomicCASPtr(&ctx->device->playback.source_todo_pool, ptr, todo.next));
+        }
+        return;
+    }
 
-            if (src->stream != stream) {
-                freestream = src->stream;  /* free this after unlocking. */
-                src->stream = stream;
+    FIXME("What do we do if there's an invalid source in the middle of the names vector?");
+    for (i = 0, todoptr = todo.next; i < n; i++) {
+        const ALuint name = names[i];
+        ALsource *src = get_source(ctx, name, NULL);
+        if (src) {
+            if (src->offset_latched) {
+                src->offset_latched = AL_FALSE;
+            } else if (SDL_AtomicGet(&src->state) != AL_PAUSED) {
+                src->offset = 0;
+                src->offset_frac = 0;
+                src->callback_frames = 0;
+                src->callback_played = 0;
+                src->callback_ended = AL_FALSE;
             }
 
-            if (must_lock) {
-                SDL_UnlockMutex(ctx->source_lock);
+            /* if the mixer can't see this source yet, we're the only writer, so catch up mixed_offset before it can. */
+            if (!SDL_AtomicGet(&src->mixer_accessible)) {
+                const Uint64 clock = device_get_clock_frames(ctx->device);
+                seqlock_write_begin(&src->mixed_offset_seq);
+                src->mixed_offset = source_calculate_offset(src);
+                src->mixed_clock = clock;
+                seqlock_write_end(&src->mixed_offset_seq);
             }
 
-            if (freestream) {
-                SDL_FreeAudioStream(freestream);
-            }
+            /* this used to move right to AL_STOPPED if the device is
+               disconnected, but now we let the mixer thread handle that to
+               avoid race conditions with marking the buffer queue
+               processed, etc. Strictly speaking, ALC_EXT_disconnect
+               says playing a source on a disconnected device should
+               "immediately" progress to STOPPED, but I'm willing to
+               say that the mixer will "immediately" move it as opposed to
+               it stopping when the source would be done mixing (or worse:
+               hang there forever). */
+            SDL_AtomicSet(&src->state, AL_PLAYING);
+
+            /* Mark this as visible to the mixer. This will be set back to zero by the mixer thread when it is done with the source. */
+            SDL_AtomicSet(&src->mixer_accessible, 1);
+
+            todoptr->source = src;
+            todoptr = todoptr->next;
         }
     }
+
+    /* Send the list to the mixer atomically, so all sources start playing in sync!
+       We're going to put these on a linked list called playlist_todo
+       The mixer does an atomiccasptr to grab the current list, swapping
+       in a NULL. Once it has the list, it's safe to do what it likes
+       with it, as nothing else owns the pointers in that list. */
+    do {
+        ptr = SDL_AtomicGetPtr(&ctx->playlist_todo);
+        todoend->next = (SourcePlayTodo*)ptr;
+    } while (!SDL_AtomicCASPtr(&ctx->playlist_todo, ptr, todo.next));
 }
 
-static void _alSourceiv(const ALuint name, const ALenum param, const ALint *values)
+static void _alSourcePlay(const ALuint name)
 {
-    ALCcontext *ctx = get_current_context();
-    ALsource *src = get_source(ctx, name, NULL);
-    if (!src) return;
-
-    switch (param) {
-        case AL_BUFFER: set_source_static_buffer(ctx, src, (ALuint) *values); break;
-        case AL_SOURCE_RELATIVE: src->source_relative = *values ? AL_TRUE : AL_FALSE; break;
-        case AL_LOOPING: src->looping = *values ? AL_TRUE : AL_FALSE; break;
-        case AL_REFERENCE_DISTANCE: src->reference_distance = (ALfloat) *values; break;
-        case AL_ROLLOFF_FACTOR: src->rolloff_factor = (ALfloat) *values; break;
-        case AL_MAX_DISTANCE: src->max_distance = (ALfloat) *values; break;
-        case AL_CONE_INNER_ANGLE: src->cone_inner_angle = (ALfloat) *values; break;
-        case AL_CONE_OUTER_ANGLE: src->cone_outer_angle = (ALfloat) *values; break;
+    source_play(get_current_context(), 1, &name);
+}
+ENTRYPOINTVOID(alSourcePlay,(ALuint name),(name))
 
-        case AL_DIRECTION:
-            src->direction[0] = (ALfloat) values[0];
-            src->direction[1] = (ALfloat) values[1];
-            src->direction[2] = (ALfloat) values[2];
-            break;
+static void _alSourcePlayv(ALsizei n, const ALuint *names)
+{
+    source_play(get_current_context(), n, names);
+}
+ENTRYPOINTVOID(alSourcePlayv,(ALsizei n, const ALuint *names),(n, names))
 
-        case AL_SEC_OFFSET:
-        case AL_SAMPLE_OFFSET:
-        case AL_BYTE_OFFSET:
-            source_set_offset(src, param, (ALfloat)*values);
-            break;
 
-        default: set_al_error(ctx, AL_INVALID_ENUM); return;
+static void source_stop(ALCcontext *ctx, const ALuint name)
+{
+    ALsource *src = get_source(ctx, name, NULL);
+    if (src) {
+        if (SDL_AtomicGet(&src->state) != AL_INITIAL) {
+            const ALboolean must_lock = SDL_AtomicGet(&src->mixer_accessible) ? AL_TRUE : AL_FALSE;
+            if (must_lock) {
+                SDL_LockMutex(ctx->source_lock);
+            }
+            SDL_AtomicSet(&src->state, AL_STOPPED);
+            source_mark_all_buffers_processed(src);
+            if (must_lock) {
+                SDL_UnlockMutex(ctx->source_lock);
+            }
+        }
     }
-
-    source_needs_recalc(src);
 }
-ENTRYPOINTVOID(alSourceiv,(ALuint name, ALenum param, const ALint *values),(name,param,values))
 
-static void _alSourcei(const ALuint name, const ALenum param, const ALint value)
+static void source_rewind(ALCcontext *ctx, const ALuint name)
 {
-    switch (param) {
-        case AL_SOURCE_RELATIVE:
-        case AL_LOOPING:
-        case AL_BUFFER:
-        case AL_REFERENCE_DISTANCE:
-        case AL_ROLLOFF_FACTOR:
-        case AL_MAX_DISTANCE:
-        case AL_CONE_INNER_ANGLE:
-        case AL_CONE_OUTER_ANGLE:
-        case AL_SEC_OFFSET:
-        case AL_SAMPLE_OFFSET:
-        case AL_BYTE_OFFSET:
-            _alSourceiv(name, param, &value);
-            break;
-        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    ALsource *src = get_source(ctx, name, NULL);
+    if (src) {
+        const ALboolean must_lock = SDL_AtomicGet(&src->mixer_accessible) ? AL_TRUE : AL_FALSE;
+        if (must_lock) {
+            SDL_LockMutex(ctx->source_lock);
+        }
+        SDL_AtomicSet(&src->state, AL_INITIAL);
+        src->offset = 0;
+        src->offset_frac = 0;
+        src->callback_frames = 0;
+        src->callback_played = 0;
+        src->callback_ended = AL_FALSE;
+        if (must_lock) {
+            SDL_UnlockMutex(ctx->source_lock);
+        }
     }
 }
-ENTRYPOINTVOID(alSourcei,(ALuint name, ALenum param, ALint value),(name,param,value))
 
-static void _alSource3i(const ALuint name, const ALenum param, const ALint value1, const ALint value2, const ALint value3)
+static void source_pause(ALCcontext *ctx, const ALuint name)
 {
-    switch (param) {
-        case AL_DIRECTION: {
-            const ALint values[3] = { (ALint) value1, (ALint) value2, (ALint) value3 };
-            _alSourceiv(name, param, values);
-            break;
-        }
-        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    ALsource *src = get_source(ctx, name, NULL);
+    if (src) {
+        SDL_AtomicCAS(&src->state, AL_PLAYING, AL_PAUSED);
     }
 }
-ENTRYPOINTVOID(alSource3i,(ALuint name, ALenum param, ALint value1, ALint value2, ALint value3),(name,param,value1,value2,value3))
 
-static void _alGetSourcefv(const ALuint name, const ALenum param, ALfloat *values)
+/* the buffer that offsets are measured in; streaming sources count from the first processed buffer in the queue. */
+static const ALbuffer *source_offset_buffer(const ALsource *src)
 {
-    ALCcontext *ctx = get_current_context();
-    ALsource *src = get_source(ctx, name, NULL);
-    if (!src) return;
-
-    switch (param) {
-        case AL_GAIN: *values = src->gain; break;
-        case AL_POSITION: SDL_memcpy(values, src->position, sizeof (ALfloat) * 3); break;
-        case AL_VELOCITY: SDL_memcpy(values, src->velocity, sizeof (ALfloat) * 3); break;
-        case AL_DIRECTION: SDL_memcpy(values, src->direction, sizeof (ALfloat) * 3); break;
-        case AL_MIN_GAIN: *values = src->min_gain; break;
-        case AL_MAX_GAIN: *values = src->max_gain; break;
-        case AL_REFERENCE_DISTANCE: *values = src->reference_distance; break;
-        case AL_ROLLOFF_FACTOR: *values = src->rolloff_factor; break;
-        case AL_MAX_DISTANCE: *values = src->max_distance; break;
-        case AL_PITCH: *values = src->pitch; break;
-        case AL_CONE_INNER_ANGLE: *values = src->cone_inner_angle; break;
-        case AL_CONE_OUTER_ANGLE: *values = src->cone_outer_angle; break;
-        case AL_CONE_OUTER_GAIN:  *values = src->cone_outer_gain; break;
+    if (src->type == AL_STREAMING) {
+        const BufferQueueItem *item = src->buffer_queue.head;
+        return item ? item->buffer : NULL;
+    }
+    return src->buffer;
+}
 
-        case AL_SEC_OFFSET:
-        case AL_SAMPLE_OFFSET:
-        case AL_BYTE_OFFSET:
-            *values = source_get_offset(src, param);
-            break;
+/* where we are in the source, in 32.32 fixed point sample frames. */
+static Sint64 source_calculate_offset(const ALsource *src)
+{
+    const ALbuffer *buffer = source_offset_buffer(src);
+    Uint64 frames = 0;
+    if (!buffer) {
+        return 0;
+    }
 
-        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    frames = (Uint64) src->offset;
+    if (buffer->callback) {
+        frames += src->callback_played;
+    } else if (src->type == AL_STREAMING) {
+        const ALsizei bufferframes = buffer_frames(buffer);
+        frames += ((Uint64) SDL_AtomicGet((SDL_atomic_t *) &src->buffer_queue_processed.num_items)) * ((Uint64) bufferframes);
     }
+
+    return (Sint64) ((frames << 32) | (((Uint64) src->offset_frac) << (32 - RESAMPLE_FRAC_BITS)));
 }
-ENTRYPOINTVOID(alGetSourcefv,(ALuint name, ALenum param, ALfloat *values),(name,param,values))
 
-static void _alGetSourcef(const ALuint name, const ALenum param, ALfloat *value)
+static float source_get_offset(ALsource *src, ALenum param)
 {
-    switch (param) {
-        case AL_GAIN:
-        case AL_MIN_GAIN:
-        case AL_MAX_GAIN:
-        case AL_REFERENCE_DISTANCE:
-        case AL_ROLLOFF_FACTOR:
-        case AL_MAX_DISTANCE:
-        case AL_PITCH:
-        case AL_CONE_INNER_ANGLE:
-        case AL_CONE_OUTER_ANGLE:
-        case AL_CONE_OUTER_GAIN:
-        case AL_SEC_OFFSET:
-        case AL_SAMPLE_OFFSET:
+    const ALbuffer *buffer = source_offset_buffer(src);
+    const int framesize = (buffer && buffer->framesize) ? (int) buffer->framesize : (int) sizeof (float);
+    const int freq = buffer ? (int) buffer->frequency : 1;
+    const int offset = (int) (source_calculate_offset(src) >> 32);
+    switch(param) {
+        case AL_SAMPLE_OFFSET: return (float) offset; break;
+        case AL_SEC_OFFSET: return ((float) offset) / ((float) freq); break;
         case AL_BYTE_OFFSET:
-            _alGetSourcefv(name, param, value);
-            break;
-        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+            if (buffer && buffer->block_frames) {  /* compressed data only has byte offsets at the start of each block. */
+                return (float) ((offset / buffer->block_frames) * buffer->block_bytes);
+            }
+            return (float) (offset * framesize);
+        default: break;
     }
+
+    return 0.0f;
 }
-ENTRYPOINTVOID(alGetSourcef,(ALuint name, ALenum param, ALfloat *value),(name,param,value))
 
-static void _alGetSource3f(const ALuint name, const ALenum param, ALfloat *value1, ALfloat *value2, ALfloat *value3)
+/* AL_SOFT_buffer_sub_data: where the mixer is reading, and the first frame
+   past what it could read in the next device period, which is where it's
+   safe for alBufferSubDataSOFT to start writing. Bytes are in the app's format. */
+static void source_get_rw_offsets(ALCcontext *ctx, ALsource *src, const ALenum param, ALint *values)
 {
-    switch (param) {
-        case AL_POSITION:
-        case AL_VELOCITY:
-        case AL_DIRECTION: {
-            ALfloat values[3];
-            _alGetSourcefv(name, param, values);
-            if (value1) *value1 = values[0];
-            if (value2) *value2 = values[1];
-            if (value3) *value3 = values[2];
-            break;
+    const ALbuffer *buffer = source_offset_buffer(src);
+    const ALsizei bufferframes = buffer ? buffer_frames(buffer) : 0;
+    ALsizei readpos = 0;
+    ALsizei writepos = 0;
+
+    if (bufferframes > 0) {
+        /* AL_PITCH changes that haven't reached the mixer yet can get there during the next period, so plan for the faster of the two. */
+        const Uint32 step = source_resample_step(ctx, src, buffer, SDL_max(src->pitch, src->mixer_pitch));
+        const Uint64 ahead = ((((Uint64) step) * ((Uint64) ctx->device->period_frames)) >> RESAMPLE_FRAC_BITS) + 2;  /* +2: the resampler reads a frame past where it lands. */
+        readpos = (ALsizei) ((source_calculate_offset(src) >> 32) % bufferframes);
+        if ((src->type == AL_STATIC) && src->looping) {
+            writepos = (ALsizei) ((((Uint64) readpos) + ahead) % ((Uint64) bufferframes));
+        } else {
+            writepos = (ALsizei) SDL_min(((Uint64) readpos) + ahead, (Uint64) bufferframes);
+        }
+    }
+
+    if (param == AL_BYTE_RW_OFFSETS_SOFT) {
+        if (buffer && buffer->block_frames) {  /* round out to whole blocks, since that's all alBufferSubDataSOFT can write. */
+            readpos = (readpos / buffer->block_frames) * buffer->block_bytes;
+            writepos = ((writepos + (buffer->block_frames - 1)) / buffer->block_frames) * buffer->block_bytes;
+        } else {
+            const ALsizei framesize = buffer ? (buffer->channels * (buffer->bits / 8)) : 0;
+            readpos *= framesize;
+            writepos *= framesize;
         }
-        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
     }
+
+    values[0] = (ALint) readpos;
+    values[1] = (ALint) writepos;
 }
-ENTRYPOINTVOID(alGetSource3f,(ALuint name, ALenum param, ALfloat *value1, ALfloat *value2, ALfloat *value3),(name,param,value1,value2,value3))
 
-static void _alGetSourceiv(const ALuint name, const ALenum param, ALint *values)
+/* the offset as of the last mix, and the device clock (in sample frames) when the mix reached it. Doesn't lock anything the mixer uses. */
+static void source_get_offset_clock(ALCcontext *ctx, ALsource *src, Sint64 *offset, Uint64 *clock)
+{
+    if (SDL_AtomicGet(&src->mixer_accessible)) {
+        int seq;
+        do {
+            seq = seqlock_read_begin(&src->mixed_offset_seq);
+            *offset = src->mixed_offset;
+            *clock = src->mixed_clock;
+        } while (seqlock_read_retry(&src->mixed_offset_seq, seq));
+    } else {
+        *offset = source_calculate_offset(src);  /* the mixer can't touch this source right now, so this is current. */
+        *clock = device_get_clock_frames(ctx->device);
+    }
+}
+
+static void source_set_offset(ALsource *src, ALenum param, ALfloat value)
 {
     ALCcontext *ctx = get_current_context();
-    ALsource *src = get_source(ctx, name, NULL);
-    if (!src) return;
+    if (!ctx) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    } else if (src->type == AL_UNDETERMINED) {  /* no buffer to seek in */
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    } else if (src->type == AL_STREAMING) {
+        FIXME("set_offset for streaming sources not implemented");
+        return;
+    } else if (src->buffer->callback) {  /* AL_SOFT_callback_buffer sources can't seek. */
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    const int framesize = src->buffer->framesize ? (int) src->buffer->framesize : (int) sizeof (float);
+    const int bufferframes = (int) buffer_frames(src->buffer);
+    const int freq = (int) src->buffer->frequency;
+    int offset = -1;
 
+    /* offsets are tracked in sample frames, so everything lands on a frame boundary. */
     switch (param) {
-        case AL_SOURCE_STATE: *values = (ALint) SDL_AtomicGet(&src->state); break;
-        case AL_SOURCE_TYPE: *values = (ALint) src->type; break;
-        case AL_BUFFER: *values = (ALint) (src->buffer ? src->buffer->name : 0); break;
-        case AL_BUFFERS_QUEUED: *values = (ALint) SDL_AtomicGet(&src->total_queued_buffers); break;
-        case AL_BUFFERS_PROCESSED: *values = (ALint) SDL_AtomicGet(&src->buffer_queue_processed.num_items); break;
-        case AL_SOURCE_RELATIVE: *values = (ALint) src->source_relative; break;
-        case AL_LOOPING: *values = (ALint) src->looping; break;
-        case AL_REFERENCE_DISTANCE: *values = (ALint) src->reference_distance; break;
-        case AL_ROLLOFF_FACTOR: *values = (ALint) src->rolloff_factor; break;
-        case AL_MAX_DISTANCE: *values = (ALint) src->max_distance; break;
-        case AL_CONE_INNER_ANGLE: *values = (ALint) src->cone_inner_angle; break;
-        case AL_CONE_OUTER_ANGLE: *values = (ALint) src->cone_outer_angle; break;
-        case AL_DIRECTION:
-            values[0] = (ALint) src->direction[0];
-            values[1] = (ALint) src->direction[1];
-            values[2] = (ALint) src->direction[2];
+        case AL_SAMPLE_OFFSET:
+            offset = (int) value;
             break;
-
         case AL_SEC_OFFSET:
-        case AL_SAMPLE_OFFSET:
+            offset = (int) (value * freq);
+            break;
         case AL_BYTE_OFFSET:
-            *values = (ALint) source_get_offset(src, param);
+            if (src->buffer->block_frames) {  /* compressed data can only seek by whole blocks. */
+                offset = (((int) value) / src->buffer->block_bytes) * src->buffer->block_frames;
+            } else {
+                offset = ((int) value) / framesize;
+            }
             break;
+        default:
+            SDL_assert(!"Unexpected source offset type!");
+            set_al_error(ctx, AL_INVALID_ENUM);  /* this is a MojoAL bug, not an app bug, but we'll try to recover. */
+            return;
+    }
 
-        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    if ((offset < 0) || (offset > bufferframes)) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
     }
-}
-ENTRYPOINTVOID(alGetSourceiv,(ALuint name, ALenum param, ALint *values),(name,param,values))
 
-static void _alGetSourcei(const ALuint name, const ALenum param, ALint *value)
-{
-    switch (param) {
-        case AL_SOURCE_STATE:
-        case AL_SOURCE_RELATIVE:
-        case AL_LOOPING:
-        case AL_BUFFER:
-        case AL_BUFFERS_QUEUED:
-        case AL_BUFFERS_PROCESSED:
-        case AL_SOURCE_TYPE:
-        case AL_REFERENCE_DISTANCE:
-        case AL_ROLLOFF_FACTOR:
-        case AL_MAX_DISTANCE:
-        case AL_CONE_INNER_ANGLE:
-        case AL_CONE_OUTER_ANGLE:
-        case AL_SEC_OFFSET:
-        case AL_SAMPLE_OFFSET:
-        case AL_BYTE_OFFSET:
-            _alGetSourceiv(name, param, value);
-            break;
-        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    if (!SDL_AtomicGet(&src->mixer_accessible)) {
+        src->offset = offset;
+        src->offset_frac = 0;
+        src->decoder.buffer = NULL;
+    } else {
+        SDL_LockMutex(ctx->source_lock);
+        src->offset = offset;
+        src->offset_frac = 0;
+        src->decoder.buffer = NULL;  /* the buffer's data might have changed since we last decoded it. */
+        SDL_UnlockMutex(ctx->source_lock);
     }
-}
-ENTRYPOINTVOID(alGetSourcei,(ALuint name, ALenum param, ALint *value),(name,param,value))
 
-static void _alGetSource3i(const ALuint name, const ALenum param, ALint *value1, ALint *value2, ALint *value3)
-{
-    switch (param) {
-        case AL_DIRECTION: {
-            ALint values[3];
-            _alGetSourceiv(name, param, values);
-            if (value1) *value1 = values[0];
-            if (value2) *value2 = values[1];
-            if (value3) *value3 = values[2];
-            break;
-        }
-        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    if (SDL_AtomicGet(&src->state) != AL_PLAYING) {
+        src->offset_latched = SDL_TRUE;
     }
 }
-ENTRYPOINTVOID(alGetSource3i,(ALuint name, ALenum param, ALint *value1, ALint *value2, ALint *value3),(name,param,value1,value2,value3))
 
-static void source_play(ALCcontext *ctx, const ALsizei n, const ALuint *names)
+/* deal with alSourcePlay and alSourcePlayv (etc) boiler plate... */
+#define SOURCE_STATE_TRANSITION_OP(alfn, fn) \
+    void alSource##alfn(ALuint name) { source_##fn(get_current_context(), name); } \
+    void alSource##alfn##v(ALsizei n, const ALuint *sources) { \
+        ALCcontext *ctx = get_current_context(); \
+        if (n < 0) { \
+            set_al_error(ctx, AL_INVALID_VALUE); \
+        } else if (!ctx) { \
+            set_al_error(ctx, AL_INVALID_OPERATION); \
+        } else { \
+            ALsizei i; \
+            if (n > 1) { \
+                FIXME("Can we do this without a full device lock?"); \
+                lock_mixer(ctx->device);  /* lock the mixer so these all start mixing in the same callback. */ \
+                for (i = 0; i < n; i++) { \
+                    source_##fn(ctx, sources[i]); \
+                } \
+                unlock_mixer(ctx->device); \
+            } else if (n == 1) { \
+                source_##fn(ctx, *sources); \
+            } \
+        } \
+    }
+
+SOURCE_STATE_TRANSITION_OP(Stop, stop)
+SOURCE_STATE_TRANSITION_OP(Rewind, rewind)
+SOURCE_STATE_TRANSITION_OP(Pause, pause)
+
+
+static void _alSourceQueueBuffers(const ALuint name, const ALsizei nb, const ALuint *bufnames)
 {
-    ALboolean failed = AL_FALSE;
-    SourcePlayTodo todo;
-    SourcePlayTodo *todoend = &todo;
-    SourcePlayTodo *todoptr;
+    BufferQueueItem *queue = NULL;
+    BufferQueueItem *queueend = NULL;
     void *ptr;
     ALsizei i;
+    ALCcontext *ctx = get_current_context();
+    ALsource *src = get_source(ctx, name, NULL);
+    ALint queue_channels = 0;
+    ALsizei queue_frequency = 0;
+    ALboolean failed = AL_FALSE;
 
-    if (n <= 0) {
+    if (!src) {
         return;
-    } else if (!ctx) {
+    }
+
+    if (src->type == AL_STATIC) {
         set_al_error(ctx, AL_INVALID_OPERATION);
         return;
     }
 
-    SDL_zero(todo);
+    if (nb < 0) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    } else if (nb == 0) {
+        return;  /* not an error, but nothing to do. */
+    }
 
-    /* Obtain our SourcePlayTodo items upfront; if this runs out of
-       memory, we won't have changed any state. The mixer thread will
-       put items back in the pool when done with them, so this handoff needs
-       to be atomic. */
-    for (i = 0; i < n; i++) {
-        SourcePlayTodo *item;
-        do {
-            ptr = SDL_AtomicGetPtr(&ctx->device->playback.source_todo_pool);
-            item = (SourcePlayTodo *) ptr;
-            if (!item) break;
-            ptr = item->next;
-        } while (!SDL_AtomicCASPtr(&ctx->device->playback.source_todo_pool, item, ptr));
+    for (i = nb; i > 0; i--) {  /* build list in reverse */
+        BufferQueueItem *item = NULL;
+        const ALuint bufname = bufnames[i-1];
+        ALbuffer *buffer = bufname ? get_buffer(ctx, bufname, NULL) : NULL;
+        if (!buffer && bufname) {  /* uhoh, bad buffer name! */
+            set_al_error(ctx, AL_INVALID_VALUE);
+            failed = AL_TRUE;
+            break;
+        }
 
-        if (!item) {  /* allocate a new item */
-            item = (SourcePlayTodo *) SDL_calloc(1, sizeof (SourcePlayTodo));
+        if (buffer && (buffer->callback || (buffer->mapped_access && !(buffer->mapped_access & AL_MAP_PERSISTENT_BIT_SOFT)))) {
+            /* AL_SOFT_callback_buffer buffers only work as AL_BUFFER, and only persistently mapped AL_SOFT_map_buffer buffers can play. */
+            set_al_error(ctx, AL_INVALID_OPERATION);
+            failed = AL_TRUE;
+            break;
+        }
+
+        if (buffer) {
+            if (queue_channels == 0) {
+                SDL_assert(queue_frequency == 0);
+                queue_channels = buffer->channels;
+                queue_frequency = buffer->frequency;
+            } else if ((queue_channels != buffer->channels) || (queue_frequency != buffer->frequency)) {
+                /* the whole queue must be the same format. */
+                set_al_error(ctx, AL_INVALID_VALUE);
+                failed = AL_TRUE;
+                break;
+            }
+        }
+
+        item = ctx->device->playback.buffer_queue_pool;
+        if (item) {
+            ctx->device->playback.buffer_queue_pool = (BufferQueueItem*)item->next;
+        } else {  /* allocate a new item */
+            item = (BufferQueueItem *) SDL_calloc(1, sizeof (BufferQueueItem));
             if (!item) {
                 set_al_error(ctx, AL_OUT_OF_MEMORY);
                 failed = AL_TRUE;
@@ -4112,663 +9194,986 @@ static void source_play(ALCcontext *ctx, const ALsizei n, const ALuint *names)
             }
         }
 
-        item->next = NULL;
-        todoend->next = item;
-        todoend = item;
+        if (buffer) {
+            SDL_AtomicIncRef(&buffer->refcount);  /* mark it as in-use. */
+        }
+        item->buffer = buffer;
+
+        SDL_assert((queue != NULL) == (queueend != NULL));
+        if (queueend) {
+            queueend->next = item;
+        } else {
+            queue = item;
+        }
+        queueend = item;
     }
 
-    if (failed) {
-        /* put the whole new queue back in the pool for reuse later. */
-        if (todo.next) {
-            do {
-                ptr = SDL_AtomicGetPtr(&ctx->device->playback.source_todo_pool);
-                todoend->next = (SourcePlayTodo *) ptr;
-            } while (!SDL_AtomicCASPtr(&ctx->device->playback.source_todo_pool, ptr, todo.next));
+    if (!failed) {
+        if (src->queue_frequency && queue_frequency) {  /* could be zero if we only queued AL name 0. */
+            SDL_assert(src->queue_channels);
+            SDL_assert(queue_channels);
+            if ((src->queue_channels != queue_channels) || (src->queue_frequency != queue_frequency)) {
+                set_al_error(ctx, AL_INVALID_VALUE);
+                failed = AL_TRUE;
+            }
         }
-        return;
     }
 
-    FIXME("What do we do if there's an invalid source in the middle of the names vector?");
-    for (i = 0, todoptr = todo.next; i < n; i++) {
-        const ALuint name = names[i];
-        ALsource *src = get_source(ctx, name, NULL);
-        if (src) {
-            if (src->offset_latched) {
-                src->offset_latched = AL_FALSE;
-            } else if (SDL_AtomicGet(&src->state) != AL_PAUSED) {
-                src->offset = 0;
+    if (failed) {
+        if (queue) {
+            /* Drop our claim on any buffers we planned to queue. */
+            BufferQueueItem *item;
+            for (item = queue; item != NULL; item = (BufferQueueItem*)item->next) {
+                if (item->buffer) {
+                    (void) SDL_AtomicDecRef(&item->buffer->refcount);
+                }
             }
 
-            /* this used to move right to AL_STOPPED if the device is
-               disconnected, but now we let the mixer thread handle that to
-               avoid race conditions with marking the buffer queue
-               processed, etc. Strictly speaking, ALC_EXT_disconnect
-               says playing a source on a disconnected device should
-               "immediately" progress to STOPPED, but I'm willing to
-               say that the mixer will "immediately" move it as opposed to
-               it stopping when the source would be done mixing (or worse:
-               hang there forever). */
-            SDL_AtomicSet(&src->state, AL_PLAYING);
+            /* put the whole new queue back in the pool for reuse later. */
+            queueend->next = ctx->device->playback.buffer_queue_pool;
+            ctx->device->playback.buffer_queue_pool = queue;
+        }
+        return;
+    }
 
-            /* Mark this as visible to the mixer. This will be set back to zero by the mixer thread when it is done with the source. */
-            SDL_AtomicSet(&src->mixer_accessible, 1);
+    FIXME("this needs to be set way sooner");
 
-            todoptr->source = src;
-            todoptr = todoptr->next;
-        }
+    FIXME("this used to have a source lock, think this one through");
+    src->type = AL_STREAMING;
+
+    if (!src->queue_channels) {
+        src->queue_channels = queue_channels;
+        src->queue_frequency = queue_frequency;
     }
 
-    /* Send the list to the mixer atomically, so all sources start playing in sync!
-       We're going to put these on a linked list called playlist_todo
-       The mixer does an atomiccasptr to grab the current list, swapping
-       in a NULL. Once it has the list, it's safe to do what it likes
-       with it, as nothing else owns the pointers in that list. */
+    /* so we're going to put these on a linked list called just_queued,
+        where things build up in reverse order, to keep this on a single
+        pointer. The theory is we'll atomicgetptr the pointer, set that
+        pointer as the "next" for our list, and then atomiccasptr our new
+        list against the original pointer. If the CAS succeeds, we have
+        a complete list, atomically set. If it fails, try again with
+        the new pointer we found, updating our next pointer again. If it
+        failed, it's because the pointer became NULL when the mixer thread
+        grabbed the existing list.
+
+        The mixer does an atomiccasptr to grab the current list, swapping
+        in a NULL. Once it has the list, it's safe to do what it likes
+        with it, as nothing else owns the pointers in that list. */
+
     do {
-        ptr = SDL_AtomicGetPtr(&ctx->playlist_todo);
-        todoend->next = (SourcePlayTodo*)ptr;
-    } while (!SDL_AtomicCASPtr(&ctx->playlist_todo, ptr, todo.next));
-}
+        ptr = SDL_AtomicGetPtr(&src->buffer_queue.just_queued);
+        SDL_AtomicSetPtr(&queueend->next, ptr);
+    } while (!SDL_AtomicCASPtr(&src->buffer_queue.just_queued, ptr, queue));
 
-static void _alSourcePlay(const ALuint name)
-{
-    source_play(get_current_context(), 1, &name);
+    SDL_AtomicAdd(&src->total_queued_buffers, (int) nb);
+    SDL_AtomicAdd(&src->buffer_queue.num_items, (int) nb);
 }
-ENTRYPOINTVOID(alSourcePlay,(ALuint name),(name))
+ENTRYPOINTVOID(alSourceQueueBuffers,(ALuint name, ALsizei nb, const ALuint *bufnames),(name,nb,bufnames))
 
-static void _alSourcePlayv(ALsizei n, const ALuint *names)
+static void _alSourceUnqueueBuffers(const ALuint name, const ALsizei nb, ALuint *bufnames)
 {
-    source_play(get_current_context(), n, names);
-}
-ENTRYPOINTVOID(alSourcePlayv,(ALsizei n, const ALuint *names),(n, names))
+    BufferQueueItem *queueend = NULL;
+    BufferQueueItem *queue;
+    BufferQueueItem *item;
+    ALsizei i;
+    ALCcontext *ctx = get_current_context();
+    ALsource *src = get_source(ctx, name, NULL);
+    if (!src) {
+        return;
+    }
 
+    if (src->type == AL_STATIC) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
 
-static void source_stop(ALCcontext *ctx, const ALuint name)
-{
-    ALsource *src = get_source(ctx, name, NULL);
-    if (src) {
-        if (SDL_AtomicGet(&src->state) != AL_INITIAL) {
-            const ALboolean must_lock = SDL_AtomicGet(&src->mixer_accessible) ? AL_TRUE : AL_FALSE;
-            if (must_lock) {
-                SDL_LockMutex(ctx->source_lock);
-            }
-            SDL_AtomicSet(&src->state, AL_STOPPED);
-            source_mark_all_buffers_processed(src);
-            if (src->stream) {
-                SDL_AudioStreamClear(src->stream);
-            }
-            if (must_lock) {
-                SDL_UnlockMutex(ctx->source_lock);
-            }
-        }
+    if (nb < 0) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    } else if (nb == 0) {
+        return;  /* not an error, but nothing to do. */
     }
-}
 
-static void source_rewind(ALCcontext *ctx, const ALuint name)
-{
-    ALsource *src = get_source(ctx, name, NULL);
-    if (src) {
-        const ALboolean must_lock = SDL_AtomicGet(&src->mixer_accessible) ? AL_TRUE : AL_FALSE;
-        if (must_lock) {
-            SDL_LockMutex(ctx->source_lock);
-        }
-        SDL_AtomicSet(&src->state, AL_INITIAL);
-        src->offset = 0;
-        if (must_lock) {
-            SDL_UnlockMutex(ctx->source_lock);
-        }
+    if (((ALsizei) SDL_AtomicGet(&src->buffer_queue_processed.num_items)) < nb) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
     }
-}
 
-static void source_pause(ALCcontext *ctx, const ALuint name)
-{
-    ALsource *src = get_source(ctx, name, NULL);
-    if (src) {
-        SDL_AtomicCAS(&src->state, AL_PLAYING, AL_PAUSED);
+    SDL_AtomicAdd(&src->buffer_queue_processed.num_items, -((int) nb));
+    SDL_AtomicAdd(&src->total_queued_buffers, -((int) nb));
+
+    obtain_newly_queued_buffers(&src->buffer_queue_processed);
+
+    item = queue = src->buffer_queue_processed.head;
+    for (i = 0; i < nb; i++) {
+        /* buffer_queue_processed.num_items said list was long enough. */
+        SDL_assert(item != NULL);
+        item = (BufferQueueItem*)item->next;
+    }
+    src->buffer_queue_processed.head = item;
+    if (!item) {
+        src->buffer_queue_processed.tail = NULL;
     }
-}
 
-static float source_get_offset(ALsource *src, ALenum param)
-{
-    int offset = 0;
-    int framesize = sizeof (float);
-    int freq = 1;
-    if (src->type == AL_STREAMING) {
-        /* streaming: the offset counts from the first processed buffer in the queue. */
-        BufferQueueItem *item = src->buffer_queue.head;
-        if (item) {
-            framesize = (int) (item->buffer->channels * sizeof (float));
-            freq = (int) (item->buffer->frequency);
-            int proc_buf = SDL_AtomicGet(&src->buffer_queue_processed.num_items);
-            offset = (proc_buf * item->buffer->len + src->offset);
+    item = queue;
+    for (i = 0; i < nb; i++) {
+        if (item->buffer) {
+            (void) SDL_AtomicDecRef(&item->buffer->refcount);
         }
-    } else if (src->buffer) {
-        framesize = (int) (src->buffer->channels * sizeof (float));
-        freq = (int) src->buffer->frequency;
-        offset = src->offset;
-    }
-    switch(param) {
-        case AL_SAMPLE_OFFSET: return (float) (offset / framesize); break;
-        case AL_SEC_OFFSET: return ((float) (offset / framesize)) / ((float) freq); break;
-        case AL_BYTE_OFFSET: return (float) offset; break;
-        default: break;
+        bufnames[i] = item->buffer ? item->buffer->name : 0;
+        queueend = item;
+        item = (BufferQueueItem*)item->next;
     }
 
-    return 0.0f;
+    /* put the whole new queue back in the pool for reuse later. */
+    SDL_assert(queueend != NULL);
+    queueend->next = ctx->device->playback.buffer_queue_pool;
+    ctx->device->playback.buffer_queue_pool = queue;
 }
+ENTRYPOINTVOID(alSourceUnqueueBuffers,(ALuint name, ALsizei nb, ALuint *bufnames),(name,nb,bufnames))
 
-static void source_set_offset(ALsource *src, ALenum param, ALfloat value)
+/* !!! FIXME: buffers and sources use almost identical code for blocks */
+static void _alGenBuffers(const ALsizei n, ALuint *names)
 {
     ALCcontext *ctx = get_current_context();
-    if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
+    ALboolean out_of_memory = AL_FALSE;
+    ALsizei totalblocks;
+    ALbuffer *stackobjs[16];
+    ALbuffer **objects = stackobjs;
+    ALsizei found = 0;
+    ALsizei block_offset = 0;
+    ALsizei blocki;
+    ALsizei i;
+
+    if (n < 0) {
+        set_al_error(ctx, AL_INVALID_VALUE);
         return;
-    } else if (src->type == AL_UNDETERMINED) {  /* no buffer to seek in */
+    } else if (!ctx) {
         set_al_error(ctx, AL_INVALID_OPERATION);
         return;
-    } else if (src->type == AL_STREAMING) {
-        FIXME("set_offset for streaming sources not implemented");
-        return;
+    } else if (n == 0) {
+        return;  /* not an error, but nothing to do. */
     }
 
-    const int bufflen = (int) src->buffer->len;
-    const int framesize = (int) (src->buffer->channels * sizeof (float));
-    const int freq = (int) src->buffer->frequency;
-    int offset = -1;
+    if (n <= SDL_arraysize(stackobjs)) {
+        SDL_memset(stackobjs, '\0', sizeof (ALbuffer *) * n);
+    } else {
+        objects = (ALbuffer **) SDL_calloc(n, sizeof (ALbuffer *));
+        if (!objects) {
+            set_al_error(ctx, AL_OUT_OF_MEMORY);
+            return;
+        }
+    }
 
-    switch (param) {
-        case AL_SAMPLE_OFFSET:
-            offset = ((int) value) * framesize;
-            break;
-        case AL_SEC_OFFSET:
-            offset = ((int) value) * freq * framesize;
+    totalblocks = ctx->device->playback.num_buffer_blocks;
+    for (blocki = 0; blocki < totalblocks; blocki++) {
+        BufferBlock *block = ctx->device->playback.buffer_blocks[blocki];
+        block->tmp = 0;
+        if (block->used < SDL_arraysize(block->buffers)) {  /* skip if full */
+            for (i = 0; i < SDL_arraysize(block->buffers); i++) {
+                if (!block->buffers[i].allocated) {
+                    block->tmp++;
+                    objects[found] = &block->buffers[i];
+                    names[found++] = (i + block_offset) + 1;  /* +1 so it isn't zero. */
+                    if (found == n) {
+                        break;
+                    }
+                }
+            }
+
+            if (found == n) {
+                break;
+            }
+        }
+
+        block_offset += SDL_arraysize(block->buffers);
+    }
+
+    while (found < n) {  /* out of blocks? Add new ones. */
+        /* ctx->buffer_blocks is only accessed on the API thread under a mutex, so it's safe to realloc. */
+        void *ptr = SDL_realloc(ctx->device->playback.buffer_blocks, sizeof (BufferBlock *) * (totalblocks + 1));
+        BufferBlock *block;
+
+        if (!ptr) {
+            out_of_memory = AL_TRUE;
             break;
-        case AL_BYTE_OFFSET:
-            offset = (((int) value) / framesize) * framesize;
+        }
+        ctx->device->playback.buffer_blocks = (BufferBlock **) ptr;
+
+        block = (BufferBlock *) SDL_calloc(1, sizeof (BufferBlock));
+        if (!block) {
+            out_of_memory = AL_TRUE;
             break;
-        default:
-            SDL_assert(!"Unexpected source offset type!");
-            set_al_error(ctx, AL_INVALID_ENUM);  /* this is a MojoAL bug, not an app bug, but we'll try to recover. */
-            return;
+        }
+        ctx->device->playback.buffer_blocks[totalblocks] = block;
+        totalblocks++;
+        ctx->device->playback.num_buffer_blocks++;
+
+        for (i = 0; i < SDL_arraysize(block->buffers); i++) {
+            block->tmp++;
+            objects[found] = &block->buffers[i];
+            names[found++] = (i + block_offset) + 1;  /* +1 so it isn't zero. */
+            if (found == n) {
+                break;
+            }
+        }
+        block_offset += SDL_arraysize(block->buffers);
     }
 
-    if ((offset < 0) || (offset > bufflen)) {
-        set_al_error(ctx, AL_INVALID_VALUE);
+    if (out_of_memory) {
+        if (objects != stackobjs) SDL_free(objects);
+        SDL_memset(names, '\0', sizeof (*names) * n);
+        set_al_error(ctx, AL_OUT_OF_MEMORY);
         return;
     }
 
-    /* make sure the offset lands on a sample frame boundary. */
-    offset -= offset % framesize;
+    SDL_assert(found == n);  /* we should have either gotten space or bailed on alloc failure */
 
-    if (!SDL_AtomicGet(&src->mixer_accessible)) {
-        src->offset = offset;
-    } else {
-        SDL_LockMutex(ctx->source_lock);
-        src->offset = offset;
-        SDL_UnlockMutex(ctx->source_lock);
+    /* update the "used" field in blocks with items we are taking now. */
+    found = 0;
+    for (blocki = 0; found < n; blocki++) {
+        BufferBlock *block = ctx->device->playback.buffer_blocks[blocki];
+        SDL_assert(blocki < totalblocks);
+        const int foundhere = block->tmp;
+        if (foundhere) {
+            block->used += foundhere;
+            found += foundhere;
+            block->tmp = 0;
+        }
     }
 
-    if (SDL_AtomicGet(&src->state) != AL_PLAYING) {
-        src->offset_latched = SDL_TRUE;
-    }
-}
+    SDL_assert(found == n);
 
-/* deal with alSourcePlay and alSourcePlayv (etc) boiler plate... */
-#define SOURCE_STATE_TRANSITION_OP(alfn, fn) \
-    void alSource##alfn(ALuint name) { source_##fn(get_current_context(), name); } \
-    void alSource##alfn##v(ALsizei n, const ALuint *sources) { \
-        ALCcontext *ctx = get_current_context(); \
-        if (n < 0) { \
-            set_al_error(ctx, AL_INVALID_VALUE); \
-        } else if (!ctx) { \
-            set_al_error(ctx, AL_INVALID_OPERATION); \
-        } else { \
-            ALsizei i; \
-            if (n > 1) { \
-                FIXME("Can we do this without a full device lock?"); \
-                SDL_LockAudioDevice(ctx->device->sdldevice);  /* lock the SDL device so these all start mixing in the same callback. */ \
-                for (i = 0; i < n; i++) { \
-                    source_##fn(ctx, sources[i]); \
-                } \
-                SDL_UnlockAudioDevice(ctx->device->sdldevice); \
-            } else if (n == 1) { \
-                source_##fn(ctx, *sources); \
-            } \
-        } \
+    for (i = 0; i < n; i++) {
+        ALbuffer *buffer = objects[i];
+        /*printf("Generated buffer %u\n", (unsigned int) names[i]);*/
+        SDL_assert(!buffer->allocated);
+        SDL_zerop(buffer);
+        buffer->name = names[i];
+        buffer->channels = 1;
+        buffer->bits = 16;
+        buffer->allocated = AL_TRUE;  /* we officially own it. */
     }
 
-SOURCE_STATE_TRANSITION_OP(Stop, stop)
-SOURCE_STATE_TRANSITION_OP(Rewind, rewind)
-SOURCE_STATE_TRANSITION_OP(Pause, pause)
+    if (objects != stackobjs) SDL_free(objects);
+}
+ENTRYPOINTVOID(alGenBuffers,(ALsizei n, ALuint *names),(n,names))
 
+/* alBufferDataStatic memory belongs to the app, file buffers get unmapped, everything else is ours. */
+static void free_buffer_data(ALbuffer *buffer)
+{
+    if (buffer->file_mapping) {
+        #if MOJOAL_HAVE_MMAP
+        munmap(buffer->file_mapping, buffer->file_mapping_len);
+        #endif
+    } else if (!buffer->app_owned) {
+        free_simd_aligned((void *) buffer->data);
+    }
+    buffer->data = NULL;
+    buffer->capacity = 0;
+    buffer->app_owned = AL_FALSE;
+    buffer->file_mapping = NULL;
+    buffer->file_mapping_len = 0;
+}
 
-static void _alSourceQueueBuffers(const ALuint name, const ALsizei nb, const ALuint *bufnames)
+static void _alDeleteBuffers(const ALsizei n, const ALuint *names)
 {
-    BufferQueueItem *queue = NULL;
-    BufferQueueItem *queueend = NULL;
-    void *ptr;
-    ALsizei i;
     ALCcontext *ctx = get_current_context();
-    ALsource *src = get_source(ctx, name, NULL);
-    ALint queue_channels = 0;
-    ALsizei queue_frequency = 0;
-    ALboolean failed = AL_FALSE;
-    SDL_AudioStream *stream = NULL;
+    ALsizei i;
 
-    if (!src) {
+    if (n < 0) {
+        set_al_error(ctx, AL_INVALID_VALUE);
         return;
-    }
-
-    if (src->type == AL_STATIC) {
+    } else if (!ctx) {
         set_al_error(ctx, AL_INVALID_OPERATION);
         return;
-    }
-
-    if (nb < 0) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-        return;
-    } else if (nb == 0) {
+    } else if (n == 0) {
         return;  /* not an error, but nothing to do. */
     }
 
-    for (i = nb; i > 0; i--) {  /* build list in reverse */
-        BufferQueueItem *item = NULL;
-        const ALuint bufname = bufnames[i-1];
-        ALbuffer *buffer = bufname ? get_buffer(ctx, bufname, NULL) : NULL;
-        if (!buffer && bufname) {  /* uhoh, bad buffer name! */
-            set_al_error(ctx, AL_INVALID_VALUE);
-            failed = AL_TRUE;
-            break;
-        }
-
-        if (buffer) {
-            if (queue_channels == 0) {
-                SDL_assert(queue_frequency == 0);
-                queue_channels = buffer->channels;
-                queue_frequency = buffer->frequency;
-            } else if ((queue_channels != buffer->channels) || (queue_frequency != buffer->frequency)) {
-                /* the whole queue must be the same format. */
-                set_al_error(ctx, AL_INVALID_VALUE);
-                failed = AL_TRUE;
-                break;
-            }
-        }
-
-        item = ctx->device->playback.buffer_queue_pool;
-        if (item) {
-            ctx->device->playback.buffer_queue_pool = (BufferQueueItem*)item->next;
-        } else {  /* allocate a new item */
-            item = (BufferQueueItem *) SDL_calloc(1, sizeof (BufferQueueItem));
-            if (!item) {
-                set_al_error(ctx, AL_OUT_OF_MEMORY);
-                failed = AL_TRUE;
-                break;
+    for (i = 0; i < n; i++) {
+        const ALuint name = names[i];
+        if (name == 0) {
+            /* ignore it. */
+        } else {
+            ALbuffer *buffer = get_buffer(ctx, name, NULL);
+            if (!buffer) {
+                /* "If one or more of the specified names is not valid, an AL_INVALID_NAME error will be recorded, and no objects will be deleted." */
+                set_al_error(ctx, AL_INVALID_NAME);
+                return;
+            } else if ((SDL_AtomicGet(&buffer->refcount) != 0) || buffer->mapped_access) {
+                set_al_error(ctx, AL_INVALID_OPERATION);  /* still in use */
+                return;
             }
         }
+    }
 
-        if (buffer) {
-            SDL_AtomicIncRef(&buffer->refcount);  /* mark it as in-use. */
-        }
-        item->buffer = buffer;
-
-        SDL_assert((queue != NULL) == (queueend != NULL));
-        if (queueend) {
-            queueend->next = item;
-        } else {
-            queue = item;
+    for (i = 0; i < n; i++) {
+        const ALuint name = names[i];
+        if (name != 0) {
+            BufferBlock *block;
+            ALbuffer *buffer = get_buffer(ctx, name, &block);
+            SDL_assert(buffer != NULL);
+            buffer->allocated = AL_FALSE;
+            free_buffer_data(buffer);
+            block->used--;
         }
-        queueend = item;
     }
+}
+ENTRYPOINTVOID(alDeleteBuffers,(ALsizei n, const ALuint *names),(n,names))
 
-    if (!failed) {
-        if (src->queue_frequency && queue_frequency) {  /* could be zero if we only queued AL name 0. */
-            SDL_assert(src->queue_channels);
-            SDL_assert(queue_channels);
-            if ((src->queue_channels != queue_channels) || (src->queue_frequency != queue_frequency)) {
-                set_al_error(ctx, AL_INVALID_VALUE);
-                failed = AL_TRUE;
-            }
-        }
+static ALboolean _alIsBuffer(ALuint name)
+{
+    ALCcontext *ctx = get_current_context();
+    return (ctx && (get_buffer(ctx, name, NULL) != NULL)) ? AL_TRUE : AL_FALSE;
+}
+ENTRYPOINT(ALboolean,alIsBuffer,(ALuint name),(name))
+
+/* alBufferData is alBufferStorageSOFT with no flags. Same-sized (or smaller)
+   uploads reuse the existing allocation instead of going back to the allocator. */
+static void _alBufferStorageSOFT(const ALuint name, const ALenum alfmt, const ALvoid *data, const ALsizei size, const ALsizei freq, const ALbitfieldSOFT flags)
+{
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+    const ALbitfieldSOFT mapflags = AL_MAP_READ_BIT_SOFT | AL_MAP_WRITE_BIT_SOFT;
+    const ALboolean preserve = (flags & AL_PRESERVE_DATA_BIT_SOFT) ? AL_TRUE : AL_FALSE;
+    SDL_AudioCVT sdlcvt;
+    Uint8 channels;
+    SDL_AudioFormat sdlfmt;
+    SDL_AudioFormat storefmt;
+    ALCsizei framesize;
+    ALsizei block_frames;
+    ALsizei block_bytes;
+    Uint8 *storage;
+    ALsizei capacity;
+    ALsizei len;
+    int rc;
+    int prevrefcount;
+
+    if (!buffer) return;
+
+    if (size < 0) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    } else if (freq < 0) {
+        return;  /* not an error, but nothing to do. */
+    } else if ((flags & ~(mapflags | AL_MAP_PERSISTENT_BIT_SOFT | AL_PRESERVE_DATA_BIT_SOFT)) || ((flags & AL_MAP_PERSISTENT_BIT_SOFT) && !(flags & mapflags))) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
     }
 
-    if (!src->queue_frequency) {
-        SDL_assert(!src->queue_channels);
-        SDL_assert(!src->stream);
-        /* We only use the stream for resampling, not for channel conversion. */
-        if (ctx->device->frequency != queue_frequency) {
-            stream = SDL_NewAudioStream(AUDIO_F32SYS, queue_channels, queue_frequency, AUDIO_F32SYS, queue_channels, ctx->device->frequency);
-            if (!stream) {
-                set_al_error(ctx, AL_OUT_OF_MEMORY);
-                failed = AL_TRUE;
-            }
-            FIXME("need a way to prealloc space in the stream, so the mixer doesn't have to malloc");
-        }
+    if (!alfmt_to_buffer_format(alfmt, &sdlfmt, &channels, &framesize)) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    } else if (!buffer_block_layout(sdlfmt, channels, buffer->unpack_block_alignment, &block_frames, &block_bytes) || (block_bytes && (size % block_bytes))) {
+        set_al_error(ctx, AL_INVALID_VALUE);  /* compressed data has to be whole blocks. */
+        return;
     }
 
-    if (failed) {
-        if (queue) {
-            /* Drop our claim on any buffers we planned to queue. */
-            BufferQueueItem *item;
-            for (item = queue; item != NULL; item = (BufferQueueItem*)item->next) {
-                if (item->buffer) {
-                    (void) SDL_AtomicDecRef(&item->buffer->refcount);
-                }
-            }
+    if (buffer->mapped_access) {
+        set_al_error(ctx, AL_INVALID_OPERATION);  /* can't replace storage the app has a pointer into. */
+        return;
+    }
 
-            /* put the whole new queue back in the pool for reuse later. */
-            queueend->next = ctx->device->playback.buffer_queue_pool;
-            ctx->device->playback.buffer_queue_pool = queue;
-        }
-        if (stream) {
-            SDL_FreeAudioStream(stream);
-        }
+    /* increment refcount so this can't be deleted or alBufferData'd from another thread */
+    prevrefcount = SDL_AtomicIncRef(&buffer->refcount);
+    SDL_assert(prevrefcount >= 0);
+    if (prevrefcount != 0) {
+        /* this buffer is being used by some source. Unqueue it first. */
+        (void) SDL_AtomicDecRef(&buffer->refcount);
+        set_al_error(ctx, AL_INVALID_OPERATION);
         return;
     }
 
-    FIXME("this needs to be set way sooner");
+    /* This check was from the wild west of lock-free programming, now we shouldn't pass get_buffer() if not allocated. */
+    SDL_assert(buffer->allocated);
 
-    FIXME("this used to have a source lock, think this one through");
-    src->type = AL_STREAMING;
+    /* right now we take a moment to convert the data to float32, since that's
+       the format we want to work in, but we don't resample or change the channels.
+       ALC_NATIVE_BUFFER_FORMAT_MOJOAL keeps 8 and 16-bit data as it is instead,
+       at half (or a quarter of) the memory, and the mixer converts as it goes.
+       Mappable buffers always keep the app's format, so the app can write
+       straight into them, and compressed and G.711 ones stay that way, for the mixer to decode. */
+    storefmt = AUDIO_F32SYS;
+    if ((flags & mapflags) || !sdl_converts_format(sdlfmt) || (ctx->native_buffer_format && ((sdlfmt == AUDIO_S16SYS) || (sdlfmt == AUDIO_U8)))) {
+        storefmt = sdlfmt;
+    }
 
-    if (!src->queue_channels) {
-        src->queue_channels = queue_channels;
-        src->queue_frequency = queue_frequency;
-        src->stream = stream;
+    if (preserve && (!buffer->data || (buffer->format != storefmt) || (buffer->channels != (ALint) channels) || (buffer->bits != (ALint) SDL_AUDIO_BITSIZE(sdlfmt)) || (buffer->block_frames != block_frames))) {
+        (void) SDL_AtomicDecRef(&buffer->refcount);
+        set_al_error(ctx, AL_INVALID_VALUE);  /* can only preserve data that's already in this format. */
+        return;
     }
 
-    /* so we're going to put these on a linked list called just_queued,
-        where things build up in reverse order, to keep this on a single
-        pointer. The theory is we'll atomicgetptr the pointer, set that
-        pointer as the "next" for our list, and then atomiccasptr our new
-        list against the original pointer. If the CAS succeeds, we have
-        a complete list, atomically set. If it fails, try again with
-        the new pointer we found, updating our next pointer again. If it
-        failed, it's because the pointer became NULL when the mixer thread
-        grabbed the existing list.
+    SDL_zero(sdlcvt);
+    if (!sdl_converts_format(sdlfmt)) {
+        rc = 0;  /* stored as-is. */
+        sdlcvt.len_mult = 1;
+        len = size;
+    } else {
+        rc = SDL_BuildAudioCVT(&sdlcvt, sdlfmt, channels, (int) freq, storefmt, channels, (int) freq);
+        if (rc == -1) {
+            (void) SDL_AtomicDecRef(&buffer->refcount);
+            set_al_error(ctx, AL_OUT_OF_MEMORY);  /* not really, but oh well. */
+            return;
+        }
+        len = (size / framesize) * (ALsizei) (channels * (SDL_AUDIO_BITSIZE(storefmt) / 8));
+    }
 
-        The mixer does an atomiccasptr to grab the current list, swapping
-        in a NULL. Once it has the list, it's safe to do what it likes
-        with it, as nothing else owns the pointers in that list. */
+    capacity = size * sdlcvt.len_mult;
+    storage = (Uint8 *) buffer->data;
+    if (storage && !buffer->app_owned && (buffer->capacity >= capacity)) {
+        capacity = buffer->capacity;  /* big enough already, convert right into it. */
+    } else {
+        storage = (Uint8 *) calloc_simd_aligned(capacity);
+        if (!storage) {
+            (void) SDL_AtomicDecRef(&buffer->refcount);
+            set_al_error(ctx, AL_OUT_OF_MEMORY);
+            return;
+        }
+        if (preserve) {
+            SDL_memcpy(storage, buffer->data, SDL_min(buffer->len, len));
+        }
+    }
 
-    do {
-        ptr = SDL_AtomicGetPtr(&src->buffer_queue.just_queued);
-        SDL_AtomicSetPtr(&queueend->next, ptr);
-    } while (!SDL_AtomicCASPtr(&src->buffer_queue.just_queued, ptr, queue));
+    if (data) {
+        sdlcvt.buf = storage;
+        sdlcvt.len = sdlcvt.len_cvt = size;
+        SDL_memcpy(sdlcvt.buf, data, size);
+        if (rc == 1) {  /* conversion necessary */
+            rc = SDL_ConvertAudio(&sdlcvt);
+            SDL_assert(rc == 0);  /* this shouldn't fail. */
+        }
+        len = (ALsizei) sdlcvt.len_cvt;
+    } else if (!preserve) {
+        SDL_memset(storage, buffer_silence_byte(storefmt), len);  /* no data means silence. */
+    } else if ((storage == buffer->data) && (len > buffer->len)) {
+        SDL_memset(storage + buffer->len, buffer_silence_byte(storefmt), len - buffer->len);  /* preserved data that grew gets silence at the end. */
+    }
+
+    if (storage != buffer->data) {
+        free_buffer_data(buffer);  /* nuke any previous data. */
+    }
+    buffer->data = storage;
+    buffer->capacity = capacity;
+    buffer->alformat = alfmt;
+    buffer->format = storefmt;
+    buffer->framesize = (ALint) (channels * (SDL_AUDIO_BITSIZE(storefmt) / 8));
+    buffer->block_frames = block_frames;
+    buffer->block_bytes = block_bytes;
+    buffer->channels = (ALint) channels;
+    buffer->bits = (ALint) SDL_AUDIO_BITSIZE(sdlfmt);  /* we might be in float32, though. */
+    buffer->frequency = freq;
+    buffer->len = len;
+    buffer->access = flags & (mapflags | AL_MAP_PERSISTENT_BIT_SOFT);
+    buffer->callback = NULL;
+    buffer->callback_userptr = NULL;
+    (void) SDL_AtomicDecRef(&buffer->refcount);  /* ready to go! */
+}
+ENTRYPOINTVOID(alBufferStorageSOFT,(ALuint name, ALenum alfmt, const ALvoid *data, ALsizei size, ALsizei freq, ALbitfieldSOFT flags),(name,alfmt,data,size,freq,flags))
 
-    SDL_AtomicAdd(&src->total_queued_buffers, (int) nb);
-    SDL_AtomicAdd(&src->buffer_queue.num_items, (int) nb);
+static void _alBufferData(const ALuint name, const ALenum alfmt, const ALvoid *data, const ALsizei size, const ALsizei freq)
+{
+    _alBufferStorageSOFT(name, alfmt, data, size, freq, 0);
 }
-ENTRYPOINTVOID(alSourceQueueBuffers,(ALuint name, ALsizei nb, const ALuint *bufnames),(name,nb,bufnames))
+ENTRYPOINTVOID(alBufferData,(ALuint name, ALenum alfmt, const ALvoid *data, ALsizei size, ALsizei freq),(name,alfmt,data,size,freq))
 
-static void _alSourceUnqueueBuffers(const ALuint name, const ALsizei nb, ALuint *bufnames)
+/* AL_EXT_STATIC_BUFFER: play the app's memory where it is, no copy and no
+   conversion; the mixers read 8-bit, 16-bit and float32 data as-is. The app
+   has to keep (data) valid and unchanged until this buffer is deleted or
+   given new data, neither of which can happen while a source still uses it.
+   We never write to or free it, so a read-only mapping of a file is fine.
+   AL_MOJOAL_file_buffer hands over its mapping here too, for us to unmap
+   when the buffer is done with it; this returns AL_FALSE if it didn't take it. */
+static ALboolean buffer_data_static(ALCcontext *ctx, ALbuffer *buffer, const ALenum alfmt, const void *data, const ALsizei size, const ALsizei freq, const ALsizei alignment, void *mapping, const size_t mapping_len)
 {
-    BufferQueueItem *queueend = NULL;
-    BufferQueueItem *queue;
-    BufferQueueItem *item;
-    ALsizei i;
-    ALCcontext *ctx = get_current_context();
-    ALsource *src = get_source(ctx, name, NULL);
-    if (!src) {
-        return;
+    Uint8 channels;
+    SDL_AudioFormat sdlfmt;
+    ALCsizei framesize;
+    ALsizei block_frames;
+    ALsizei block_bytes;
+    int prevrefcount;
+
+    if ((size < 0) || (size && !data)) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return AL_FALSE;
+    } else if (freq < 0) {
+        return AL_FALSE;  /* not an error, but nothing to do. */
     }
 
-    if (src->type == AL_STATIC) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
+    if (!alfmt_to_buffer_format(alfmt, &sdlfmt, &channels, &framesize) || (((size_t) data) % SDL_max(SDL_AUDIO_BITSIZE(sdlfmt) / 8, 1))) {
+        set_al_error(ctx, AL_INVALID_VALUE);  /* bad format, or samples that aren't aligned for the mixer to read. */
+        return AL_FALSE;
+    } else if (!buffer_block_layout(sdlfmt, channels, alignment, &block_frames, &block_bytes) || (block_bytes && (size % block_bytes))) {
+        set_al_error(ctx, AL_INVALID_VALUE);  /* compressed data has to be whole blocks. */
+        return AL_FALSE;
     }
 
-    if (nb < 0) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-        return;
-    } else if (nb == 0) {
-        return;  /* not an error, but nothing to do. */
+    if (buffer->mapped_access) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return AL_FALSE;
     }
 
-    if (((ALsizei) SDL_AtomicGet(&src->buffer_queue_processed.num_items)) < nb) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-        return;
+    /* increment refcount so this can't be deleted or alBufferData'd from another thread */
+    prevrefcount = SDL_AtomicIncRef(&buffer->refcount);
+    SDL_assert(prevrefcount >= 0);
+    if (prevrefcount != 0) {
+        /* this buffer is being used by some source. Unqueue it first. */
+        (void) SDL_AtomicDecRef(&buffer->refcount);
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return AL_FALSE;
     }
 
-    SDL_AtomicAdd(&src->buffer_queue_processed.num_items, -((int) nb));
-    SDL_AtomicAdd(&src->total_queued_buffers, -((int) nb));
+    SDL_assert(buffer->allocated);
 
-    obtain_newly_queued_buffers(&src->buffer_queue_processed);
+    free_buffer_data(buffer);  /* nuke any previous data. */
+    buffer->data = data;
+    buffer->app_owned = AL_TRUE;
+    buffer->file_mapping = mapping;
+    buffer->file_mapping_len = mapping_len;
+    buffer->alformat = alfmt;
+    buffer->format = sdlfmt;
+    buffer->framesize = (ALint) framesize;
+    buffer->block_frames = block_frames;
+    buffer->block_bytes = block_bytes;
+    buffer->channels = (ALint) channels;
+    buffer->bits = (ALint) SDL_AUDIO_BITSIZE(sdlfmt);
+    buffer->frequency = freq;
+    buffer->len = size;
+    buffer->access = 0;
+    buffer->callback = NULL;
+    buffer->callback_userptr = NULL;
+    (void) SDL_AtomicDecRef(&buffer->refcount);  /* ready to go! */
+    return AL_TRUE;
+}
 
-    item = queue = src->buffer_queue_processed.head;
-    for (i = 0; i < nb; i++) {
-        /* buffer_queue_processed.num_items said list was long enough. */
-        SDL_assert(item != NULL);
-        item = (BufferQueueItem*)item->next;
-    }
-    src->buffer_queue_processed.head = item;
-    if (!item) {
-        src->buffer_queue_processed.tail = NULL;
+static void _alBufferDataStatic(const ALint name, const ALenum alfmt, ALvoid *data, const ALsizei size, const ALsizei freq)
+{
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer = get_buffer(ctx, (ALuint) name, NULL);
+    if (buffer) {
+        (void) buffer_data_static(ctx, buffer, alfmt, data, size, freq, buffer->unpack_block_alignment, NULL, 0);
     }
+}
+ENTRYPOINTVOID(alBufferDataStatic,(const ALint name, ALenum alfmt, ALvoid *data, ALsizei size, ALsizei freq),(name,alfmt,data,size,freq))
 
-    item = queue;
-    for (i = 0; i < nb; i++) {
-        if (item->buffer) {
-            (void) SDL_AtomicDecRef(&item->buffer->refcount);
-        }
-        bufnames[i] = item->buffer ? item->buffer->name : 0;
-        queueend = item;
-        item = (BufferQueueItem*)item->next;
+/* AL_MOJOAL_file_buffer: the mixer reads a read-only memory mapping of the
+   file, like any other alBufferDataStatic data, so the OS pages it in as
+   sources get to it and can throw those pages out again when memory is
+   tight, without us holding a decoded copy of every long ambience bed.
+   Data that isn't aligned for the mixer gets copied in by alBufferData instead.
+   !!! FIXME: a page that isn't in memory yet stalls the mixer until the disk
+   !!! FIXME:  coughs it up; we could touch what playing sources are about to
+   !!! FIXME:  need from another thread first. */
+
+/* WAVE_FORMAT_* tags, in little-endian data, that we can play. */
+static ALenum wav_format_to_alfmt(const int tag, const int bits, const int channels)
+{
+    static const ALenum pcm8[] = { AL_FORMAT_MONO8, AL_FORMAT_STEREO8, AL_NONE, AL_FORMAT_QUAD8, AL_NONE, AL_FORMAT_51CHN8, AL_FORMAT_61CHN8, AL_FORMAT_71CHN8 };
+    static const ALenum pcm16[] = { AL_FORMAT_MONO16, AL_FORMAT_STEREO16, AL_NONE, AL_FORMAT_QUAD16, AL_NONE, AL_FORMAT_51CHN16, AL_FORMAT_61CHN16, AL_FORMAT_71CHN16 };
+    static const ALenum float32[] = { AL_FORMAT_MONO_FLOAT32, AL_FORMAT_STEREO_FLOAT32, AL_NONE, AL_FORMAT_QUAD32, AL_NONE, AL_FORMAT_51CHN32, AL_FORMAT_61CHN32, AL_FORMAT_71CHN32 };
+    const ALboolean stereo = (channels == 2) ? AL_TRUE : AL_FALSE;
+
+    if ((channels < 1) || (channels > (int) SDL_arraysize(pcm8))) {
+        return AL_NONE;
+    } else if ((channels > 2) && (tag != 0x0001) && (tag != 0x0003)) {
+        return AL_NONE;  /* only PCM and float come in more than two channels. */
     }
 
-    /* put the whole new queue back in the pool for reuse later. */
-    SDL_assert(queueend != NULL);
-    queueend->next = ctx->device->playback.buffer_queue_pool;
-    ctx->device->playback.buffer_queue_pool = queue;
+    switch (tag) {
+        case 0x0001: return (bits == 8) ? pcm8[channels - 1] : (bits == 16) ? pcm16[channels - 1] : AL_NONE;  /* PCM */
+        case 0x0003: return (bits == 32) ? float32[channels - 1] : AL_NONE;  /* IEEE_FLOAT */
+        case 0x0006: return (bits == 8) ? (stereo ? AL_FORMAT_STEREO_ALAW_EXT : AL_FORMAT_MONO_ALAW_EXT) : AL_NONE;  /* ALAW */
+        case 0x0007: return (bits == 8) ? (stereo ? AL_FORMAT_STEREO_MULAW_EXT : AL_FORMAT_MONO_MULAW_EXT) : AL_NONE;  /* MULAW */
+        case 0x0011: return (bits == 4) ? (stereo ? AL_FORMAT_STEREO_IMA4 : AL_FORMAT_MONO_IMA4) : AL_NONE;  /* IMA_ADPCM */
+        case 0x0002: return (bits == 4) ? (stereo ? AL_FORMAT_STEREO_MSADPCM_SOFT : AL_FORMAT_MONO_MSADPCM_SOFT) : AL_NONE;  /* ADPCM (Microsoft's) */
+        default: break;
+    }
+    return AL_NONE;
 }
-ENTRYPOINTVOID(alSourceUnqueueBuffers,(ALuint name, ALsizei nb, ALuint *bufnames),(name,nb,bufnames))
 
-/* !!! FIXME: buffers and sources use almost identical code for blocks */
-static void _alGenBuffers(const ALsizei n, ALuint *names)
+static Uint32 read_le16(const Uint8 *ptr) { return ((Uint32) ptr[0]) | (((Uint32) ptr[1]) << 8); }
+static Uint32 read_le32(const Uint8 *ptr) { return read_le16(ptr) | (read_le16(ptr + 2) << 16); }
+
+/* Find the sample data in the (wavlen) bytes of .WAV file at (wav). This only
+   needs the "fmt " and "data" chunks; (data) ends up pointing into (wav). */
+static ALboolean parse_wav(const Uint8 *wav, const size_t wavlen, ALenum *alfmt, ALsizei *freq, ALsizei *alignment, const Uint8 **data, size_t *datalen)
 {
-    ALCcontext *ctx = get_current_context();
-    ALboolean out_of_memory = AL_FALSE;
-    ALsizei totalblocks;
-    ALbuffer *stackobjs[16];
-    ALbuffer **objects = stackobjs;
-    ALsizei found = 0;
-    ALsizei block_offset = 0;
-    ALsizei blocki;
-    ALsizei i;
+    const Uint8 *fmt = NULL;
+    size_t fmtlen = 0;
+    size_t pos = 12;
 
-    if (n < 0) {
-        set_al_error(ctx, AL_INVALID_VALUE);
-        return;
-    } else if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
-        return;
-    } else if (n == 0) {
-        return;  /* not an error, but nothing to do. */
+    if ((wavlen < 12) || (SDL_memcmp(wav, "RIFF", 4) != 0) || (SDL_memcmp(wav + 8, "WAVE", 4) != 0)) {
+        return AL_FALSE;
     }
 
-    if (n <= SDL_arraysize(stackobjs)) {
-        SDL_memset(stackobjs, '\0', sizeof (ALbuffer *) * n);
-    } else {
-        objects = (ALbuffer **) SDL_calloc(n, sizeof (ALbuffer *));
-        if (!objects) {
-            set_al_error(ctx, AL_OUT_OF_MEMORY);
-            return;
+    while ((pos + 8) <= wavlen) {
+        const Uint8 *chunk = wav + pos;
+        const size_t chunklen = (size_t) read_le32(chunk + 4);
+        const size_t avail = wavlen - (pos + 8);
+        if (SDL_memcmp(chunk, "data", 4) == 0) {
+            *data = chunk + 8;
+            *datalen = SDL_min(chunklen, avail);  /* files written while streaming can claim more than is there; play what is. */
+            break;
+        } else if (chunklen > avail) {
+            return AL_FALSE;
+        } else if (SDL_memcmp(chunk, "fmt ", 4) == 0) {
+            fmt = chunk + 8;
+            fmtlen = chunklen;
         }
+        pos += 8 + chunklen + (chunklen & 1);  /* chunks are padded to an even size. */
     }
 
-    totalblocks = ctx->device->playback.num_buffer_blocks;
-    for (blocki = 0; blocki < totalblocks; blocki++) {
-        BufferBlock *block = ctx->device->playback.buffer_blocks[blocki];
-        block->tmp = 0;
-        if (block->used < SDL_arraysize(block->buffers)) {  /* skip if full */
-            for (i = 0; i < SDL_arraysize(block->buffers); i++) {
-                if (!block->buffers[i].allocated) {
-                    block->tmp++;
-                    objects[found] = &block->buffers[i];
-                    names[found++] = (i + block_offset) + 1;  /* +1 so it isn't zero. */
-                    if (found == n) {
-                        break;
-                    }
-                }
-            }
+    if (!fmt || (fmtlen < 16) || ((pos + 8) > wavlen)) {
+        return AL_FALSE;  /* no "data" chunk, or no "fmt " chunk before it. */
+    } else {
+        const int channels = (int) read_le16(fmt + 2);
+        const Uint32 rate = read_le32(fmt + 4);
+        const ALsizei blockalign = (ALsizei) read_le16(fmt + 12);
+        const int bits = (int) read_le16(fmt + 14);
+        int tag = (int) read_le16(fmt);
+        ALsizei unit;
+
+        if ((tag == 0xFFFE) && (fmtlen >= 40)) {  /* WAVE_FORMAT_EXTENSIBLE: the real tag starts the SubFormat GUID. */
+            tag = (int) read_le16(fmt + 24);
+        }
 
-            if (found == n) {
-                break;
+        *alfmt = wav_format_to_alfmt(tag, bits, channels);
+        if ((*alfmt == AL_NONE) || (rate == 0) || (rate > (Uint32) SDL_MAX_SINT32) || (blockalign == 0) || (blockalign % channels)) {
+            return AL_FALSE;
+        }
+        *freq = (ALsizei) rate;
+
+        /* ADPCM block sizes are in bytes in a .WAV, and in sample frames for us. */
+        *alignment = 0;
+        unit = (ALsizei) (channels * (bits / 8));
+        if (tag == 0x0011) {
+            if ((blockalign / channels) < 4) {
+                return AL_FALSE;
             }
+            *alignment = (((blockalign / channels) - 4) * 2) + 1;
+            unit = blockalign;
+        } else if (tag == 0x0002) {
+            int i;
+            if (((blockalign / channels) < 7) || (fmtlen < (size_t) (22 + (4 * SDL_arraysize(msadpcm_coef1)))) || (read_le16(fmt + 20) < SDL_arraysize(msadpcm_coef1))) {
+                return AL_FALSE;
+            }
+            for (i = 0; i < (int) SDL_arraysize(msadpcm_coef1); i++) {  /* we only know the standard predictors. */
+                if (((Sint16) read_le16(fmt + 22 + (i * 4)) != msadpcm_coef1[i]) || ((Sint16) read_le16(fmt + 24 + (i * 4)) != msadpcm_coef2[i])) {
+                    return AL_FALSE;
+                }
+            }
+            *alignment = (((blockalign / channels) - 7) * 2) + 2;
+            unit = blockalign;
         }
 
-        block_offset += SDL_arraysize(block->buffers);
+        *datalen -= *datalen % (size_t) unit;  /* drop a partial frame, or the short block some encoders end with. */
     }
 
-    while (found < n) {  /* out of blocks? Add new ones. */
-        /* ctx->buffer_blocks is only accessed on the API thread under a mutex, so it's safe to realloc. */
-        void *ptr = SDL_realloc(ctx->device->playback.buffer_blocks, sizeof (BufferBlock *) * (totalblocks + 1));
-        BufferBlock *block;
+    return AL_TRUE;
+}
 
-        if (!ptr) {
-            out_of_memory = AL_TRUE;
-            break;
-        }
-        ctx->device->playback.buffer_blocks = (BufferBlock **) ptr;
+/* (region) is the (regionlen) bytes of the file the app asked for. If (mapping) isn't NULL, it's
+   the mmap()'d pages holding them, which the buffer takes over, or this unmaps when it can't. */
+static void buffer_file_region(ALCcontext *ctx, ALbuffer *buffer, void *mapping, const size_t mapping_len, const Uint8 *region, const size_t regionlen, ALenum alfmt, ALsizei freq)
+{
+    const ALboolean wav = (alfmt == AL_NONE) ? AL_TRUE : AL_FALSE;
+    ALsizei alignment = buffer->unpack_block_alignment;
+    const Uint8 *data = region;
+    size_t datalen = regionlen;
+    SDL_AudioFormat sdlfmt;
+    Uint8 channels;
+    ALCsizei framesize;
 
-        block = (BufferBlock *) SDL_calloc(1, sizeof (BufferBlock));
-        if (!block) {
-            out_of_memory = AL_TRUE;
-            break;
+    if (wav && !parse_wav(region, regionlen, &alfmt, &freq, &alignment, &data, &datalen)) {
+        set_al_error(ctx, AL_INVALID_VALUE);  /* not a .WAV file, or not one we can play. */
+    } else if (!alfmt_to_buffer_format(alfmt, &sdlfmt, &channels, &framesize) || (datalen == 0) || (datalen > (size_t) SDL_MAX_SINT32)) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    } else if (wav && (SDL_AUDIO_BITSIZE(sdlfmt) > 8)) {
+        FIXME("byteswap 16 and 32-bit .WAV data on big-endian systems");
+        set_al_error(ctx, AL_INVALID_VALUE);
+#endif
+    } else if (mapping && !(((size_t) data) % SDL_max(SDL_AUDIO_BITSIZE(sdlfmt) / 8, 1))) {
+        if (buffer_data_static(ctx, buffer, alfmt, data, (ALsizei) datalen, freq, alignment, mapping, mapping_len)) {
+            return;  /* the buffer owns the mapping now. */
         }
-        ctx->device->playback.buffer_blocks[totalblocks] = block;
-        totalblocks++;
-        ctx->device->playback.num_buffer_blocks++;
+    } else {
+        const ALsizei unpack_block_alignment = buffer->unpack_block_alignment;
+        buffer->unpack_block_alignment = alignment;  /* a .WAV's ADPCM block size, not the app's. */
+        _alBufferStorageSOFT(buffer->name, alfmt, data, (ALsizei) datalen, freq, 0);
+        buffer->unpack_block_alignment = unpack_block_alignment;
+    }
 
-        for (i = 0; i < SDL_arraysize(block->buffers); i++) {
-            block->tmp++;
-            objects[found] = &block->buffers[i];
-            names[found++] = (i + block_offset) + 1;  /* +1 so it isn't zero. */
-            if (found == n) {
-                break;
-            }
-        }
-        block_offset += SDL_arraysize(block->buffers);
+    #if MOJOAL_HAVE_MMAP
+    if (mapping) {
+        munmap(mapping, mapping_len);
     }
+    #endif
+}
 
-    if (out_of_memory) {
-        if (objects != stackobjs) SDL_free(objects);
-        SDL_memset(names, '\0', sizeof (*names) * n);
-        set_al_error(ctx, AL_OUT_OF_MEMORY);
+/* where the app's (offset) and (size) land in a file that's (filelen) bytes long. */
+static ALboolean file_region_len(const ALint64SOFT offset, const ALsizei size, const Sint64 filelen, size_t *regionlen)
+{
+    Sint64 len;
+    if ((offset < 0) || (size < 0) || (offset >= filelen)) {
+        return AL_FALSE;
+    }
+    len = size ? (Sint64) size : (filelen - offset);
+    if ((len > (filelen - offset)) || (((Uint64) len) > ((Uint64) ((size_t) -1)))) {
+        return AL_FALSE;
+    }
+    *regionlen = (size_t) len;
+    return AL_TRUE;
+}
+
+#if MOJOAL_HAVE_MMAP
+static void buffer_file_descriptor(ALCcontext *ctx, ALbuffer *buffer, const int fd, const ALint64SOFT offset, const ALsizei size, const ALenum alfmt, const ALsizei freq)
+{
+    const Sint64 pagesize = (Sint64) sysconf(_SC_PAGESIZE);
+    struct stat statbuf;
+    size_t regionlen;
+    Sint64 mapoffset;
+    size_t maplen;
+    void *mapping;
+
+    if ((fstat(fd, &statbuf) == -1) || !S_ISREG(statbuf.st_mode) || !file_region_len(offset, size, (Sint64) statbuf.st_size, &regionlen)) {
+        set_al_error(ctx, AL_INVALID_VALUE);
         return;
     }
 
-    SDL_assert(found == n);  /* we should have either gotten space or bailed on alloc failure */
+    /* mappings have to start on a page boundary. */
+    mapoffset = offset - (offset % pagesize);
+    maplen = regionlen + (size_t) (offset - mapoffset);
+    mapping = mmap(NULL, maplen, PROT_READ, MAP_SHARED, fd, (off_t) mapoffset);
+    if (mapping == MAP_FAILED) {
+        set_al_error(ctx, (errno == ENOMEM) ? AL_OUT_OF_MEMORY : AL_INVALID_VALUE);
+        return;
+    }
 
-    /* update the "used" field in blocks with items we are taking now. */
-    found = 0;
-    for (blocki = 0; found < n; blocki++) {
-        BufferBlock *block = ctx->device->playback.buffer_blocks[blocki];
-        SDL_assert(blocki < totalblocks);
-        const int foundhere = block->tmp;
-        if (foundhere) {
-            block->used += foundhere;
-            found += foundhere;
-            block->tmp = 0;
-        }
+    #ifdef MADV_SEQUENTIAL
+    (void) madvise(mapping, maplen, MADV_SEQUENTIAL);  /* sources play front to back; read ahead of them. */
+    #endif
+
+    buffer_file_region(ctx, buffer, mapping, maplen, ((const Uint8 *) mapping) + (offset - mapoffset), regionlen, alfmt, freq);
+}
+#endif
+
+static void _alBufferFileMOJOAL(const ALuint name, const ALchar *path, const ALint64SOFT offset, const ALsizei size, const ALenum alfmt, const ALsizei freq)
+{
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+#if MOJOAL_HAVE_MMAP
+    int fd;
+
+    if (!buffer) return;
+
+    #ifdef O_CLOEXEC
+    fd = path ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+    #else
+    fd = path ? open(path, O_RDONLY) : -1;
+    #endif
+    if (fd == -1) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
     }
 
-    SDL_assert(found == n);
+    buffer_file_descriptor(ctx, buffer, fd, offset, size, alfmt, freq);
+    close(fd);  /* the mapping holds its own reference to the file. */
+#else
+    SDL_RWops *rw;
+    size_t regionlen;
+    Uint8 *region;
 
-    for (i = 0; i < n; i++) {
-        ALbuffer *buffer = objects[i];
-        /*printf("Generated buffer %u\n", (unsigned int) names[i]);*/
-        SDL_assert(!buffer->allocated);
-        SDL_zerop(buffer);
-        buffer->name = names[i];
-        buffer->channels = 1;
-        buffer->bits = 16;
-        buffer->allocated = AL_TRUE;  /* we officially own it. */
+    if (!buffer) return;
+
+    FIXME("map files on Windows, too");
+    rw = path ? SDL_RWFromFile(path, "rb") : NULL;
+    if (!rw) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    } else if (!file_region_len(offset, size, SDL_RWsize(rw), &regionlen) || (regionlen > (size_t) SDL_MAX_SINT32) || (SDL_RWseek(rw, (Sint64) offset, RW_SEEK_SET) != (Sint64) offset)) {
+        SDL_RWclose(rw);
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
     }
 
-    if (objects != stackobjs) SDL_free(objects);
+    region = (Uint8 *) SDL_malloc(regionlen);
+    if (!region) {
+        set_al_error(ctx, AL_OUT_OF_MEMORY);
+    } else if (SDL_RWread(rw, region, 1, regionlen) != regionlen) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+    } else {
+        buffer_file_region(ctx, buffer, NULL, 0, region, regionlen, alfmt, freq);  /* no mapping, so this copies it. */
+    }
+    SDL_free(region);
+    SDL_RWclose(rw);
+#endif
 }
-ENTRYPOINTVOID(alGenBuffers,(ALsizei n, ALuint *names),(n,names))
+ENTRYPOINTVOID(alBufferFileMOJOAL,(ALuint name, const ALchar *path, ALint64SOFT offset, ALsizei size, ALenum alfmt, ALsizei freq),(name,path,offset,size,alfmt,freq))
 
-static void _alDeleteBuffers(const ALsizei n, const ALuint *names)
+static void _alBufferFileDescriptorMOJOAL(const ALuint name, const int fd, const ALint64SOFT offset, const ALsizei size, const ALenum alfmt, const ALsizei freq)
 {
     ALCcontext *ctx = get_current_context();
-    ALsizei i;
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+    if (!buffer) return;
+#if MOJOAL_HAVE_MMAP
+    buffer_file_descriptor(ctx, buffer, fd, offset, size, alfmt, freq);
+#else
+    (void) fd; (void) offset; (void) size; (void) alfmt; (void) freq;
+    set_al_error(ctx, AL_INVALID_OPERATION);  /* no file descriptors to map here. */
+#endif
+}
+ENTRYPOINTVOID(alBufferFileDescriptorMOJOAL,(ALuint name, int fd, ALint64SOFT offset, ALsizei size, ALenum alfmt, ALsizei freq),(name,fd,offset,size,alfmt,freq))
 
-    if (n < 0) {
+/* AL_SOFT_buffer_sub_data: overwrite part of a buffer in place. This is allowed
+   while sources are playing it; keeping clear of what the mixer is reading
+   (see AL_BYTE_RW_OFFSETS_SOFT) is the app's problem. (offset) and (length)
+   are in bytes of (alfmt), which has to be the format the buffer was given. */
+static void _alBufferSubDataSOFT(const ALuint name, const ALenum alfmt, const ALvoid *data, const ALsizei offset, const ALsizei length)
+{
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+    Uint8 channels;
+    SDL_AudioFormat sdlfmt;
+    ALCsizei framesize;
+    ALsizei unitbytes;
+    ALsizei unitframes;
+
+    if (!buffer) return;
+
+    if (buffer->app_owned) {
+        set_al_error(ctx, AL_INVALID_OPERATION);  /* alBufferDataStatic memory isn't ours to write to. */
+        return;
+    } else if (buffer->mapped_access) {
+        set_al_error(ctx, AL_INVALID_OPERATION);  /* the app has a pointer into this storage; alBufferData refuses too. */
+        return;
+    } else if ((alfmt != buffer->alformat) || !alfmt_to_buffer_format(alfmt, &sdlfmt, &channels, &framesize)) {
+        set_al_error(ctx, AL_INVALID_ENUM);  /* a buffer that started as 8-bit and is stored as float32 still only takes 8-bit, not G.711. */
+        return;
+    }
+
+    /* compressed buffers can only be updated a whole block at a time. */
+    unitbytes = buffer->block_frames ? buffer->block_bytes : framesize;
+    unitframes = buffer->block_frames ? buffer->block_frames : 1;
+    if ((offset < 0) || (length < 0) || (offset % unitbytes) || (length % unitbytes) || ((((offset / unitbytes) + (length / unitbytes)) * unitframes) > buffer_frames(buffer))) {
         set_al_error(ctx, AL_INVALID_VALUE);
         return;
-    } else if (!ctx) {
-        set_al_error(ctx, AL_INVALID_OPERATION);
+    } else if ((length > 0) && !data) {
+        set_al_error(ctx, AL_INVALID_VALUE);
         return;
-    } else if (n == 0) {
+    } else if (length == 0) {
         return;  /* not an error, but nothing to do. */
     }
 
-    for (i = 0; i < n; i++) {
-        const ALuint name = names[i];
-        if (name == 0) {
-            /* ignore it. */
+    if (buffer->block_frames) {
+        SDL_memcpy(((Uint8 *) buffer->data) + offset, data, length);
+    } else {
+        Uint8 *dst = (Uint8 *) buffer_frame_data(buffer, offset / framesize);
+        if (buffer->format == sdlfmt) {
+            SDL_memcpy(dst, data, length);
         } else {
-            ALbuffer *buffer = get_buffer(ctx, name, NULL);
-            if (!buffer) {
-                /* "If one or more of the specified names is not valid, an AL_INVALID_NAME error will be recorded, and no objects will be deleted." */
-                set_al_error(ctx, AL_INVALID_NAME);
-                return;
-            } else if (SDL_AtomicGet(&buffer->refcount) != 0) {
-                set_al_error(ctx, AL_INVALID_OPERATION);  /* still in use */
-                return;
-            }
+            SDL_assert(buffer->format == AUDIO_F32SYS);
+            convert_to_float32(sdlfmt, channels, data, (float *) dst, length / framesize);
         }
     }
+}
+ENTRYPOINTVOID(alBufferSubDataSOFT,(ALuint name, ALenum alfmt, const ALvoid *data, ALsizei offset, ALsizei length),(name,alfmt,data,offset,length))
 
-    for (i = 0; i < n; i++) {
-        const ALuint name = names[i];
-        if (name != 0) {
-            BufferBlock *block;
-            ALbuffer *buffer = get_buffer(ctx, name, &block);
-            void *data;
-            SDL_assert(buffer != NULL);
-            data = (void *) buffer->data;
-            buffer->allocated = AL_FALSE;
-            buffer->data = NULL;
-            free_simd_aligned(data);
-            block->used--;
-        }
+/* AL_SOFT_map_buffer: hand the app a pointer right into the buffer's storage.
+   alBufferStorageSOFT keeps mappable buffers in the app's own format, so this is the real thing, not a copy. */
+static void *_alMapBufferSOFT(const ALuint name, const ALsizei offset, const ALsizei length, const ALbitfieldSOFT access)
+{
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+    const ALbitfieldSOFT mapflags = AL_MAP_READ_BIT_SOFT | AL_MAP_WRITE_BIT_SOFT;
+
+    if (!buffer) return NULL;
+
+    if (!(access & mapflags) || (access & ~(mapflags | AL_MAP_PERSISTENT_BIT_SOFT))) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return NULL;
+    } else if ((offset < 0) || (length <= 0) || (offset >= buffer->len) || (length > (buffer->len - offset))) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return NULL;
+    } else if ((access & ~buffer->access) || buffer->mapped_access) {
+        set_al_error(ctx, AL_INVALID_OPERATION);  /* storage doesn't allow this access, or it's already mapped. */
+        return NULL;
+    } else if (!(access & AL_MAP_PERSISTENT_BIT_SOFT) && (SDL_AtomicGet(&buffer->refcount) != 0)) {
+        set_al_error(ctx, AL_INVALID_OPERATION);  /* only persistent mappings can be used while sources have it. */
+        return NULL;
     }
+
+    buffer->mapped_access = access;
+    buffer->mapped_offset = offset;
+    buffer->mapped_len = length;
+    return ((Uint8 *) buffer->data) + offset;
 }
-ENTRYPOINTVOID(alDeleteBuffers,(ALsizei n, const ALuint *names),(n,names))
+ENTRYPOINT(void *,alMapBufferSOFT,(ALuint name, ALsizei offset, ALsizei length, ALbitfieldSOFT access),(name,offset,length,access))
 
-static ALboolean _alIsBuffer(ALuint name)
+static void _alUnmapBufferSOFT(const ALuint name)
 {
     ALCcontext *ctx = get_current_context();
-    return (ctx && (get_buffer(ctx, name, NULL) != NULL)) ? AL_TRUE : AL_FALSE;
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+    if (!buffer) return;
+
+    if (!buffer->mapped_access) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    }
+
+    SDL_MemoryBarrierRelease();  /* make sure the mixer sees whatever the app wrote. */
+    buffer->mapped_access = 0;
+    buffer->mapped_offset = 0;
+    buffer->mapped_len = 0;
 }
-ENTRYPOINT(ALboolean,alIsBuffer,(ALuint name),(name))
+ENTRYPOINTVOID(alUnmapBufferSOFT,(ALuint name),(name))
 
-static void _alBufferData(const ALuint name, const ALenum alfmt, const ALvoid *data, const ALsizei size, const ALsizei freq)
+/* the mapping is the buffer's real storage, so there's nothing to copy; the mixer just needs to see the writes. */
+static void _alFlushMappedBufferSOFT(const ALuint name, const ALsizei offset, const ALsizei length)
+{
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+    if (!buffer) return;
+
+    if (!(buffer->mapped_access & AL_MAP_WRITE_BIT_SOFT)) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
+        return;
+    } else if ((offset < buffer->mapped_offset) || (length <= 0) || (offset >= (buffer->mapped_offset + buffer->mapped_len)) || (length > ((buffer->mapped_offset + buffer->mapped_len) - offset))) {
+        set_al_error(ctx, AL_INVALID_VALUE);
+        return;
+    }
+
+    SDL_MemoryBarrierRelease();
+}
+ENTRYPOINTVOID(alFlushMappedBufferSOFT,(ALuint name, ALsizei offset, ALsizei length),(name,offset,length))
+
+/* AL_SOFT_callback_buffer: no data up front, the mixer calls (callback) for
+   more as it plays, in the app's own format, so nothing converts it ahead of time. */
+static void _alBufferCallbackSOFT(const ALuint name, const ALenum alfmt, const ALsizei freq, const ALBUFFERCALLBACKTYPESOFT callback, ALvoid *userptr)
 {
     ALCcontext *ctx = get_current_context();
     ALbuffer *buffer = get_buffer(ctx, name, NULL);
-    SDL_AudioCVT sdlcvt;
     Uint8 channels;
     SDL_AudioFormat sdlfmt;
     ALCsizei framesize;
-    int rc;
     int prevrefcount;
 
     if (!buffer) return;
 
-    if (size < 0) {
-        set_al_error(ctx, AL_INVALID_VALUE);
+    if (buffer->mapped_access) {
+        set_al_error(ctx, AL_INVALID_OPERATION);
         return;
-    } else if (freq < 0) {
-        return;  /* not an error, but nothing to do. */
-    }
-
-    if (!alcfmt_to_sdlfmt(alfmt, &sdlfmt, &channels, &framesize)) {
+    } else if ((freq < 1) || (callback == NULL)) {
         set_al_error(ctx, AL_INVALID_VALUE);
         return;
+    } else if (!alfmt_to_buffer_format(alfmt, &sdlfmt, &channels, &framesize) || (framesize == 0)) {
+        set_al_error(ctx, AL_INVALID_ENUM);  /* G.711 is fine, but block-compressed data can't be streamed a frame at a time. */
+        return;
     }
 
+    SDL_assert(framesize <= (ALCsizei) OPENAL_CALLBACK_MAX_FRAMESIZE);
+
     /* increment refcount so this can't be deleted or alBufferData'd from another thread */
     prevrefcount = SDL_AtomicIncRef(&buffer->refcount);
     SDL_assert(prevrefcount >= 0);
@@ -4779,50 +10184,24 @@ static void _alBufferData(const ALuint name, const ALenum alfmt, const ALvoid *d
         return;
     }
 
-    /* This check was from the wild west of lock-free programming, now we shouldn't pass get_buffer() if not allocated. */
     SDL_assert(buffer->allocated);
 
-    /* right now we take a moment to convert the data to float32, since that's
-       the format we want to work in, but we don't resample or change the channels */
-    SDL_zero(sdlcvt);
-    rc = SDL_BuildAudioCVT(&sdlcvt, sdlfmt, channels, (int) freq, AUDIO_F32SYS, channels, (int) freq);
-    if (rc == -1) {
-        (void) SDL_AtomicDecRef(&buffer->refcount);
-        set_al_error(ctx, AL_OUT_OF_MEMORY);  /* not really, but oh well. */
-        return;
-    }
-
-    sdlcvt.len = sdlcvt.len_cvt = size;
-    sdlcvt.buf = (Uint8 *) calloc_simd_aligned(size * sdlcvt.len_mult);
-    if (!sdlcvt.buf) {
-        (void) SDL_AtomicDecRef(&buffer->refcount);
-        set_al_error(ctx, AL_OUT_OF_MEMORY);
-        return;
-    }
-    SDL_memcpy(sdlcvt.buf, data, size);
-
-    if (rc == 1) {  /* conversion necessary */
-        rc = SDL_ConvertAudio(&sdlcvt);
-        SDL_assert(rc == 0);  /* this shouldn't fail. */
-        #if 0   /* !!! FIXME: need realloc_simd_aligned. */
-        if (sdlcvt.len_cvt < (size * sdlcvt.len_mult)) {  /* maybe shrink buffer */
-            void *ptr = SDL_realloc(sdlcvt.buf, sdlcvt.len_cvt);
-            if (ptr) {
-                sdlcvt.buf = (Uint8 *) ptr;
-            }
-        }
-        #endif
-    }
-
-    free_simd_aligned((void *) buffer->data);  /* nuke any previous data. */
-    buffer->data = (const float *) sdlcvt.buf;
+    free_buffer_data(buffer);  /* nuke any previous data. */
+    buffer->len = 0;
+    buffer->access = 0;
+    buffer->alformat = alfmt;
+    buffer->format = sdlfmt;
+    buffer->framesize = (ALint) framesize;
+    buffer->block_frames = 0;
+    buffer->block_bytes = 0;
     buffer->channels = (ALint) channels;
-    buffer->bits = (ALint) SDL_AUDIO_BITSIZE(sdlfmt);  /* we're in float32, though. */
+    buffer->bits = (ALint) SDL_AUDIO_BITSIZE(sdlfmt);
     buffer->frequency = freq;
-    buffer->len = (ALsizei) sdlcvt.len_cvt;
+    buffer->callback = callback;
+    buffer->callback_userptr = userptr;
     (void) SDL_AtomicDecRef(&buffer->refcount);  /* ready to go! */
 }
-ENTRYPOINTVOID(alBufferData,(ALuint name, ALenum alfmt, const ALvoid *data, ALsizei size, ALsizei freq),(name,alfmt,data,size,freq))
+ENTRYPOINTVOID(alBufferCallbackSOFT,(ALuint name, ALenum alfmt, ALsizei freq, ALBUFFERCALLBACKTYPESOFT callback, ALvoid *userptr),(name,alfmt,freq,callback,userptr))
 
 static void _alBufferfv(const ALuint name, const ALenum param, const ALfloat *values)
 {
@@ -4844,13 +10223,35 @@ ENTRYPOINTVOID(alBuffer3f,(ALuint name, ALenum param, ALfloat value1, ALfloat va
 
 static void _alBufferiv(const ALuint name, const ALenum param, const ALint *values)
 {
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+    if (!buffer) return;
+
+    switch (param) {
+        case AL_UNPACK_BLOCK_ALIGNMENT_SOFT:  /* only checked against the format when data arrives. */
+        case AL_PACK_BLOCK_ALIGNMENT_SOFT:
+            if ((*values < 0) || (*values > OPENAL_MAX_BLOCK_ALIGNMENT)) {
+                set_al_error(ctx, AL_INVALID_VALUE);
+            } else if (param == AL_UNPACK_BLOCK_ALIGNMENT_SOFT) {
+                buffer->unpack_block_alignment = (ALsizei) *values;
+            } else {
+                buffer->pack_block_alignment = (ALsizei) *values;
+            }
+            break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    }
 }
 ENTRYPOINTVOID(alBufferiv,(ALuint name, ALenum param, const ALint *values),(name,param,values))
 
 static void _alBufferi(const ALuint name, const ALenum param, const ALint value)
 {
-    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in core OpenAL 1.1 uses this */
+    switch (param) {
+        case AL_UNPACK_BLOCK_ALIGNMENT_SOFT:
+        case AL_PACK_BLOCK_ALIGNMENT_SOFT:
+            _alBufferiv(name, param, &value);
+            break;
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;  /* nothing in core OpenAL 1.1 uses this */
+    }
 }
 ENTRYPOINTVOID(alBufferi,(ALuint name, ALenum param, ALint value),(name,param,value))
 
@@ -4885,6 +10286,8 @@ static void _alGetBufferi(const ALuint name, const ALenum param, ALint *value)
         case AL_SIZE:
         case AL_BITS:
         case AL_CHANNELS:
+        case AL_UNPACK_BLOCK_ALIGNMENT_SOFT:
+        case AL_PACK_BLOCK_ALIGNMENT_SOFT:
             alGetBufferiv(name, param, value);
             break;
         default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
@@ -4909,10 +10312,44 @@ static void _alGetBufferiv(const ALuint name, const ALenum param, ALint *values)
         case AL_SIZE: *values = (ALint) buffer->len; break;
         case AL_BITS: *values = (ALint) buffer->bits; break;
         case AL_CHANNELS: *values = (ALint) buffer->channels; break;
+        case AL_UNPACK_BLOCK_ALIGNMENT_SOFT: *values = (ALint) buffer->unpack_block_alignment; break;
+        case AL_PACK_BLOCK_ALIGNMENT_SOFT: *values = (ALint) buffer->pack_block_alignment; break;
         default: set_al_error(ctx, AL_INVALID_ENUM); break;
     }
 }
 ENTRYPOINTVOID(alGetBufferiv,(ALuint name, ALenum param, ALint *values),(name,param,values))
 
+static void _alGetBufferPtrvSOFT(const ALuint name, const ALenum param, ALvoid **values)
+{
+    ALCcontext *ctx = get_current_context();
+    ALbuffer *buffer = get_buffer(ctx, name, NULL);
+    if (!buffer) return;
+
+    switch (param) {
+        case AL_BUFFER_CALLBACK_FUNCTION_SOFT: *values = (ALvoid *) buffer->callback; break;
+        case AL_BUFFER_CALLBACK_USER_PARAM_SOFT: *values = buffer->callback_userptr; break;
+        default: set_al_error(ctx, AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetBufferPtrvSOFT,(ALuint name, ALenum param, ALvoid **values),(name,param,values))
+
+static void _alGetBufferPtrSOFT(const ALuint name, const ALenum param, ALvoid **value)
+{
+    switch (param) {
+        case AL_BUFFER_CALLBACK_FUNCTION_SOFT:
+        case AL_BUFFER_CALLBACK_USER_PARAM_SOFT:
+            alGetBufferPtrvSOFT(name, param, value);
+            break;
+        default: set_al_error(get_current_context(), AL_INVALID_ENUM); break;
+    }
+}
+ENTRYPOINTVOID(alGetBufferPtrSOFT,(ALuint name, ALenum param, ALvoid **value),(name,param,value))
+
+static void _alGetBuffer3PtrSOFT(const ALuint name, const ALenum param, ALvoid **value1, ALvoid **value2, ALvoid **value3)
+{
+    set_al_error(get_current_context(), AL_INVALID_ENUM);  /* nothing in AL_SOFT_callback_buffer uses this */
+}
+ENTRYPOINTVOID(alGetBuffer3PtrSOFT,(ALuint name, ALenum param, ALvoid **value1, ALvoid **value2, ALvoid **value3),(name,param,value1,value2,value3))
+
 /* end of mojoal.c ... */
 
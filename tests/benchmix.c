@@ -0,0 +1,647 @@
+/**
+ * MojoAL; a simple drop-in OpenAL implementation.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by Ryan C. Gordon.
+ */
+
+/* This is just test code, you don't need to compile this with MojoAL. */
+
+/* This benchmarks the mixer. It compiles mojoal.c directly into itself so it
+   can call the internal mixing functions, so build it once normally and once
+   with -DFORCE_SCALAR_FALLBACK=1 to compare the SIMD kernels to the scalar
+   ones (CMake builds both, as benchmix and benchmix_scalar).
+
+   Everything runs through a loopback device, so this doesn't need (or touch)
+   any audio hardware, and results aren't limited to realtime.
+
+   Numbers are reported as nanoseconds per output frame per voice; multiply by
+   your device's sample rate to see how much of a core each voice costs.
+
+   Pitched scenes are run both as a plain playback rate change (what AL_PITCH
+   does by default) and through the AL_MOJOAL_phase_vocoder_pitch pitch
+   shifter, which is much slower and is capped at max_vocoder_voices.
+
+   The context is created with ALC_FAST_MATH_MOJOAL, so the vocoder and
+   spatialization numbers are for the fast approximations, not libm.
+
+   Spatialization is reported separately, as nanoseconds per voice each time
+   the listener moves, since that happens once per mix instead of per frame.
+   So is the API overhead of updating every source's position, both with
+   alSource3f and with alSourcefvBatchMOJOAL.
+
+   Compressed (IMA4) buffers are played at a few sample rates with very long
+   blocks, counting every frame the decoder produces along the way. Each frame
+   should only be decoded once; if any are decoded again (say, because a
+   resampled mix made the decoder start a block over), that's reported as a
+   failure and benchmix exits with 1.
+
+   Usage: benchmix [max_voices] [max_vocoder_voices] [mixer_threads]
+   (mixer_threads is passed to ALC_MIXER_THREADS_MOJOAL; 0 means all cores.) */
+
+/* counts every frame the compressed buffer decoder produces; see bench_compressed(). */
+static unsigned long long bench_decoded_frames = 0;
+#define COUNT_DECODED_FRAMES(decoder) bench_decoded_frames++
+
+#include "../mojoal.c"
+
+#include <stdio.h>
+
+#define BENCH_FREQ 48000
+#define BENCH_PERIOD 1024
+#define BENCH_MIN_NS 250000000.0  /* run each test for at least this long, so slow ones don't take forever and fast ones aren't noise. */
+#define BENCH_MIN_ITERATIONS 4
+
+
+static Uint64 perf_freq;
+static float *bench_stream;
+static float *bench_data;
+static Sint16 *bench_data_s16;
+
+static double ns_since(const Uint64 start)
+{
+    return ((double) (SDL_GetPerformanceCounter() - start) * 1000000000.0) / ((double) perf_freq);
+}
+
+static int check_openal_error(const char *where)
+{
+    const ALenum err = alGetError();
+    if (err != AL_NONE) {
+        printf("OpenAL Error at %s! %s (%u)\n", where, alGetString(err), (unsigned int) err);
+        return 1;
+    }
+    return 0;
+}
+
+static void bench_kernel(const char *kernels, const char *name, MixFloat32Fn fn)
+{
+    static const ALfloat panning[OPENAL_MAX_OUTPUT_CHANNELS] = { 0.7f, 0.3f };
+    const Uint64 start = SDL_GetPerformanceCounter();
+    double elapsed = 0.0;
+    int iterations = 0;
+
+    fn(panning, bench_data, bench_stream, BENCH_PERIOD);  /* warm the cache. */
+
+    while ((iterations < BENCH_MIN_ITERATIONS) || ((elapsed = ns_since(start)) < BENCH_MIN_NS)) {
+        fn(panning, bench_data, bench_stream, BENCH_PERIOD);
+        iterations++;
+    }
+
+    printf("  %-9s %-16s %8.3f ns/frame\n", kernels, name, elapsed / ((double) iterations * BENCH_PERIOD));
+}
+
+static void bench_resample(const char *kernels, const char *name, ResampleFloat32Fn fn)
+{
+    static const ALfloat panning[OPENAL_MAX_OUTPUT_CHANNELS] = { 0.7f, 0.3f };
+    const Uint32 step = calculate_resample_step(44100, BENCH_FREQ, 1.0f);  /* always reads less than BENCH_PERIOD frames, so we stay inside bench_data. */
+    const Uint64 start = SDL_GetPerformanceCounter();
+    double elapsed = 0.0;
+    int iterations = 0;
+    Uint32 frac = 0;
+
+    fn(panning, bench_data, bench_stream, BENCH_PERIOD - 1, &frac, step);  /* warm the cache. */
+
+    while ((iterations < BENCH_MIN_ITERATIONS) || ((elapsed = ns_since(start)) < BENCH_MIN_NS)) {
+        frac = 0;
+        fn(panning, bench_data, bench_stream, BENCH_PERIOD - 1, &frac, step);
+        iterations++;
+    }
+
+    printf("  %-9s %-16s %8.3f ns/frame\n", kernels, name, elapsed / ((double) iterations * (BENCH_PERIOD - 1)));
+}
+
+/* these are what ALC_NATIVE_BUFFER_FORMAT_MOJOAL buffers of 16-bit data mix through. */
+static void bench_kernel_s16(const char *kernels, const char *name, MixSint16Fn fn)
+{
+    static const ALfloat panning[OPENAL_MAX_OUTPUT_CHANNELS] = { 0.7f, 0.3f };
+    const Uint64 start = SDL_GetPerformanceCounter();
+    double elapsed = 0.0;
+    int iterations = 0;
+
+    fn(panning, bench_data_s16, bench_stream, BENCH_PERIOD);  /* warm the cache. */
+
+    while ((iterations < BENCH_MIN_ITERATIONS) || ((elapsed = ns_since(start)) < BENCH_MIN_NS)) {
+        fn(panning, bench_data_s16, bench_stream, BENCH_PERIOD);
+        iterations++;
+    }
+
+    printf("  %-9s %-16s %8.3f ns/frame\n", kernels, name, elapsed / ((double) iterations * BENCH_PERIOD));
+}
+
+static void bench_resample_s16(const char *kernels, const char *name, ResampleSint16Fn fn)
+{
+    static const ALfloat panning[OPENAL_MAX_OUTPUT_CHANNELS] = { 0.7f, 0.3f };
+    const Uint32 step = calculate_resample_step(44100, BENCH_FREQ, 1.0f);
+    const Uint64 start = SDL_GetPerformanceCounter();
+    double elapsed = 0.0;
+    int iterations = 0;
+    Uint32 frac = 0;
+
+    fn(panning, bench_data_s16, bench_stream, BENCH_PERIOD - 1, &frac, step);  /* warm the cache. */
+
+    while ((iterations < BENCH_MIN_ITERATIONS) || ((elapsed = ns_since(start)) < BENCH_MIN_NS)) {
+        frac = 0;
+        fn(panning, bench_data_s16, bench_stream, BENCH_PERIOD - 1, &frac, step);
+        iterations++;
+    }
+
+    printf("  %-9s %-16s %8.3f ns/frame\n", kernels, name, elapsed / ((double) iterations * (BENCH_PERIOD - 1)));
+}
+
+static void bench_surround(const char *kernels, const char *name, MixFloat32SurroundFn fn, const int outchannels)
+{
+    static const ALfloat panning[OPENAL_MAX_OUTPUT_CHANNELS] = { 0.1f, 0.7f, 0.0f, 0.0f, 0.3f, 0.0f, 0.0f, 0.2f };
+    const Uint64 start = SDL_GetPerformanceCounter();
+    double elapsed = 0.0;
+    int iterations = 0;
+
+    fn(panning, bench_data, bench_stream, BENCH_PERIOD, outchannels);  /* warm the cache. */
+
+    while ((iterations < BENCH_MIN_ITERATIONS) || ((elapsed = ns_since(start)) < BENCH_MIN_NS)) {
+        fn(panning, bench_data, bench_stream, BENCH_PERIOD, outchannels);
+        iterations++;
+    }
+
+    printf("  %-9s %-16s %8.3f ns/frame\n", kernels, name, elapsed / ((double) iterations * BENCH_PERIOD));
+}
+
+static void bench_accumulate(const char *kernels, AccumulateFloat32Fn fn)
+{
+    const Uint64 start = SDL_GetPerformanceCounter();
+    double elapsed = 0.0;
+    int iterations = 0;
+
+    fn(bench_data, bench_stream, BENCH_PERIOD * 2);  /* warm the cache. */
+
+    while ((iterations < BENCH_MIN_ITERATIONS) || ((elapsed = ns_since(start)) < BENCH_MIN_NS)) {
+        fn(bench_data, bench_stream, BENCH_PERIOD * 2);
+        iterations++;
+    }
+
+    printf("  %-9s %-16s %8.3f ns/frame\n", kernels, "accumulate", elapsed / ((double) iterations * BENCH_PERIOD));
+}
+
+static void bench_kernel_set(const MixerKernels *kernels)
+{
+    bench_kernel(kernels->name, "mix_float32_c1", kernels->mix_float32_c1);
+    bench_kernel(kernels->name, "mix_float32_c2", kernels->mix_float32_c2);
+    bench_resample(kernels->name, "resample_f32_c1", kernels->resample_float32_c1);
+    bench_resample(kernels->name, "resample_f32_c2", kernels->resample_float32_c2);
+    bench_kernel_s16(kernels->name, "mix_sint16_c1", kernels->mix_sint16_c1);
+    bench_kernel_s16(kernels->name, "mix_sint16_c2", kernels->mix_sint16_c2);
+    bench_resample_s16(kernels->name, "resample_s16_c1", kernels->resample_sint16_c1);
+    bench_resample_s16(kernels->name, "resample_s16_c2", kernels->resample_sint16_c2);
+    bench_accumulate(kernels->name, kernels->accumulate_float32);
+    bench_surround(kernels->name, "mix_f32_c1_5.1", kernels->mix_float32_c1_surround, 6);
+    bench_surround(kernels->name, "mix_f32_c1_7.1", kernels->mix_float32_c1_surround, 8);
+    bench_surround(kernels->name, "mix_f32_c2_7.1", kernels->mix_float32_c2_surround, 8);
+}
+
+static void bench_kernels(void)
+{
+    printf("Mixing kernels (%d frames per call, mixer is using %s):\n", BENCH_PERIOD, mixer_kernels.name);
+    bench_kernel_set(&mixer_kernels_scalar);
+    #ifdef __SSE__
+    if (has_sse) {
+        bench_kernel_set(&mixer_kernels_sse);
+    }
+    #endif
+    #ifdef __ARM_NEON__
+    if (has_neon) {
+        bench_kernel_set(&mixer_kernels_neon);
+    }
+    #endif
+    #if HAVE_AVX_MIXERS
+    if (SDL_HasAVX()) {
+        bench_kernel_set(&mixer_kernels_avx);
+    }
+    if (SDL_HasAVX2()) {
+        bench_kernel_set(&mixer_kernels_avx2);
+    }
+    #endif
+    printf("\n");
+}
+
+static void bench_mix_buffer(ALCcontext *ctx, const ALuint bid, const ALboolean vocoder)
+{
+    static const ALfloat panning[OPENAL_MAX_OUTPUT_CHANNELS] = { 0.7f, 0.3f };
+    const ALbuffer *buffer;
+    ALsource *src;
+    ALuint sid = 0;
+    Uint64 start;
+    double elapsed = 0.0;
+    int iterations = 0;
+
+    alGenSources(1, &sid);
+    if (check_openal_error("alGenSources")) {
+        return;
+    }
+    alSourcei(sid, AL_PHASE_VOCODER_PITCH_MOJOAL, vocoder);
+    alSourcef(sid, AL_PITCH, vocoder ? 1.5f : 1.0f);
+
+    buffer = get_buffer(ctx, bid, NULL);
+    src = get_source(ctx, sid, NULL);
+    SDL_assert(buffer && src);
+
+    mix_buffer(&ctx->scratch, src, buffer, panning, buffer->data, buffer->format, bench_stream, BENCH_PERIOD, ctx->device->channels);  /* warm the cache. */
+
+    start = SDL_GetPerformanceCounter();
+    while ((iterations < BENCH_MIN_ITERATIONS) || ((elapsed = ns_since(start)) < BENCH_MIN_NS)) {
+        mix_buffer(&ctx->scratch, src, buffer, panning, buffer->data, buffer->format, bench_stream, BENCH_PERIOD, ctx->device->channels);
+        iterations++;
+    }
+
+    printf("  mix_buffer %s, %s %8.3f ns/frame\n", (buffer->channels == 1) ? "mono  " : "stereo",
+           vocoder ? "vocoder on " : "vocoder off", elapsed / ((double) iterations * BENCH_PERIOD));
+
+    alDeleteSources(1, &sid);
+}
+
+/* pitched is 0 for no pitch change, 1 for a playback rate change, 2 for the phase vocoder. */
+static void bench_scene(ALCcontext *ctx, const ALsizei voices, const ALuint bid, const ALboolean mono, const ALboolean resampled, const int pitched)
+{
+    const int len = BENCH_PERIOD * ctx->device->framesize;
+    ALuint *sids;
+    Uint64 start;
+    double elapsed = 0.0;
+    int iterations = 0;
+    ALsizei i;
+
+    sids = (ALuint *) SDL_calloc(voices, sizeof (ALuint));
+    if (!sids) {
+        printf("Out of memory!\n");
+        return;
+    }
+
+    alGenSources(voices, sids);
+    if (check_openal_error("alGenSources")) {
+        SDL_free(sids);
+        return;
+    }
+
+    for (i = 0; i < voices; i++) {
+        /* spread mono sources in a circle around the listener, so spatialization has real work to do. */
+        const ALfloat angle = (ALfloat) ((2.0 * M_PI * i) / voices);
+        alSource3f(sids[i], AL_POSITION, SDL_cosf(angle) * 5.0f, 0.0f, SDL_sinf(angle) * 5.0f);
+        alSourcei(sids[i], AL_PHASE_VOCODER_PITCH_MOJOAL, (pitched == 2) ? AL_TRUE : AL_FALSE);
+        alSourcef(sids[i], AL_PITCH, pitched ? 1.5f : 1.0f);
+        alSourcei(sids[i], AL_LOOPING, AL_TRUE);
+        alSourcei(sids[i], AL_BUFFER, (ALint) bid);
+    }
+    alSourcePlayv(voices, sids);
+    check_openal_error("scene setup");
+
+    mix_context(ctx, bench_stream, len);  /* first pass does all the spatialization and stream setup. */
+
+    start = SDL_GetPerformanceCounter();
+    while ((iterations < BENCH_MIN_ITERATIONS) || ((elapsed = ns_since(start)) < BENCH_MIN_NS)) {
+        mix_context(ctx, bench_stream, len);
+        iterations++;
+    }
+
+    printf("  %5d voices, %s, resample %s, pitch %s %8.3f ns/frame/voice\n", (int) voices,
+           mono ? "mono  " : "stereo", resampled ? "on " : "off", (pitched == 2) ? "voc" : pitched ? "on " : "off",
+           elapsed / ((double) iterations * BENCH_PERIOD * voices));
+
+    alSourceStopv(voices, sids);
+    alDeleteSources(voices, sids);
+    check_openal_error("scene teardown");
+    SDL_free(sids);
+}
+
+/* When the listener moves, every playing source has to be spatialized again
+   before the next mix, so this is what a moving camera costs on top of mixing. */
+static void bench_spatialize(ALCcontext *ctx, const ALsizei voices, const ALuint bid)
+{
+    const int len = BENCH_PERIOD * ctx->device->framesize;
+    ALuint *sids;
+    Uint64 start;
+    double elapsed = 0.0;
+    int iterations = 0;
+    ALsizei i;
+
+    sids = (ALuint *) SDL_calloc(voices, sizeof (ALuint));
+    if (!sids) {
+        printf("Out of memory!\n");
+        return;
+    }
+
+    alGenSources(voices, sids);
+    if (check_openal_error("alGenSources")) {
+        SDL_free(sids);
+        return;
+    }
+
+    for (i = 0; i < voices; i++) {
+        const ALfloat angle = (ALfloat) ((2.0 * M_PI * i) / voices);
+        alSource3f(sids[i], AL_POSITION, SDL_cosf(angle) * 5.0f, (ALfloat) (i % 3), SDL_sinf(angle) * 5.0f);
+        alSource3f(sids[i], AL_VELOCITY, 0.0f, 0.0f, (ALfloat) (i % 5));
+        alSourcei(sids[i], AL_LOOPING, AL_TRUE);
+        alSourcei(sids[i], AL_BUFFER, (ALint) bid);
+    }
+    alSourcePlayv(voices, sids);
+    check_openal_error("scene setup");
+
+    mix_context(ctx, bench_stream, len);  /* get everything into the playlist. */
+
+    start = SDL_GetPerformanceCounter();
+    while ((iterations < BENCH_MIN_ITERATIONS) || ((elapsed = ns_since(start)) < BENCH_MIN_NS)) {
+        alListener3f(AL_POSITION, (ALfloat) (iterations % 100) * 0.1f, 0.0f, 0.0f);
+        spatialize_playlist(ctx);
+        iterations++;
+    }
+
+    printf("  %5d voices %8.3f ns/voice\n", (int) voices, elapsed / ((double) iterations * voices));
+
+    alSourceStopv(voices, sids);
+    alDeleteSources(voices, sids);
+    check_openal_error("scene teardown");
+    SDL_free(sids);
+}
+
+/* A game updates every moving source's position once a frame; this compares
+   doing that with one alSource3f call per source to one AL_MOJOAL_source_batch
+   call for all of them. Nothing plays, so this is purely API overhead. */
+static void bench_source_updates(const ALsizei voices)
+{
+    ALuint *sids;
+    ALfloat *positions;
+    Uint64 start;
+    double elapsed[2] = { 0.0, 0.0 };
+    int iterations[2] = { 0, 0 };
+    int batched;
+    ALsizei i;
+
+    sids = (ALuint *) SDL_calloc(voices, sizeof (ALuint));
+    positions = (ALfloat *) SDL_calloc(voices * 3, sizeof (ALfloat));
+    if (!sids || !positions) {
+        printf("Out of memory!\n");
+        SDL_free(positions);
+        SDL_free(sids);
+        return;
+    }
+
+    alGenSources(voices, sids);
+    if (check_openal_error("alGenSources")) {
+        SDL_free(positions);
+        SDL_free(sids);
+        return;
+    }
+
+    for (batched = 0; batched <= 1; batched++) {
+        start = SDL_GetPerformanceCounter();
+        while ((iterations[batched] < BENCH_MIN_ITERATIONS) || ((elapsed[batched] = ns_since(start)) < BENCH_MIN_NS)) {
+            for (i = 0; i < voices * 3; i++) {
+                positions[i] = (ALfloat) ((iterations[batched] + i) % 100) * 0.1f;
+            }
+            if (batched) {
+                alSourcefvBatchMOJOAL(voices, sids, AL_POSITION, positions);
+            } else {
+                for (i = 0; i < voices; i++) {
+                    alSource3f(sids[i], AL_POSITION, positions[i * 3], positions[(i * 3) + 1], positions[(i * 3) + 2]);
+                }
+            }
+            iterations[batched]++;
+        }
+    }
+
+    check_openal_error("source updates");
+    printf("  %5d voices %8.3f ns/voice one at a time, %8.3f ns/voice batched\n", (int) voices,
+           elapsed[0] / ((double) iterations[0] * voices), elapsed[1] / ((double) iterations[1] * voices));
+
+    alDeleteSources(voices, sids);
+    SDL_free(positions);
+    SDL_free(sids);
+}
+
+/* a mono IMA4 buffer with huge blocks, so decoding any block over again
+   shows up as a lot of extra frames. Returns nonzero if that happened. */
+static int bench_compressed(ALCcontext *ctx, const ALsizei freq)
+{
+    const ALsizei block_frames = 65537;  /* a 4 byte header and then 65536 frames at 4 bits each. */
+    const ALsizei block_bytes = 4 + ((block_frames - 1) / 2);
+    const ALsizei blocks = 4;
+    const int len = BENCH_PERIOD * ctx->device->framesize;
+    const int periods = 200;
+    Uint8 *data = (Uint8 *) SDL_malloc(block_bytes * blocks);
+    const ALsource *src;
+    ALuint bid = 0;
+    ALuint sid = 0;
+    Uint64 start;
+    double elapsed;
+    unsigned long long played;
+    int failed;
+    int i;
+
+    if (!data) {
+        printf("Out of memory!\n");
+        return 1;
+    }
+
+    for (i = 0; i < (block_bytes * blocks); i++) {
+        data[i] = (Uint8) ((i * 37) ^ (i >> 5));
+    }
+    for (i = 0; i < blocks; i++) {
+        data[(i * block_bytes) + 2] = 0;  /* step index; keep it sane. */
+    }
+
+    alGenBuffers(1, &bid);
+    alBufferi(bid, AL_UNPACK_BLOCK_ALIGNMENT_SOFT, block_frames);
+    alBufferData(bid, AL_FORMAT_MONO_IMA4, data, block_bytes * blocks, freq);
+    SDL_free(data);
+    alGenSources(1, &sid);
+    alSourcei(sid, AL_BUFFER, (ALint) bid);
+    alSourcePlay(sid);
+    if (check_openal_error("compressed setup")) {
+        alDeleteSources(1, &sid);
+        alDeleteBuffers(1, &bid);
+        return 1;
+    }
+
+    src = get_source(ctx, sid, NULL);
+    SDL_assert(src != NULL);
+
+    bench_decoded_frames = 0;
+    start = SDL_GetPerformanceCounter();
+    for (i = 0; i < periods; i++) {
+        mix_context(ctx, bench_stream, len);
+    }
+    elapsed = ns_since(start);
+
+    /* the mix decodes up to one frame past where it stops, to interpolate toward. */
+    played = (unsigned long long) src->offset;
+    failed = (bench_decoded_frames > (played + 1)) ? 1 : 0;
+    printf("  %5d Hz: %8.3f ns/frame, %llu frames decoded to play %llu%s\n", (int) freq,
+           elapsed / ((double) periods * BENCH_PERIOD), bench_decoded_frames, played,
+           failed ? "  FAILED, some were decoded more than once!" : "");
+
+    alSourceStop(sid);
+    alDeleteSources(1, &sid);
+    alDeleteBuffers(1, &bid);
+    check_openal_error("compressed teardown");
+    return failed;
+}
+
+/* one second of noise; it doesn't matter what we mix, just that we mix it. */
+static ALuint make_buffer(const ALboolean mono, const ALsizei freq)
+{
+    const ALenum fmt = mono ? AL_FORMAT_MONO_FLOAT32 : AL_FORMAT_STEREO_FLOAT32;
+    const ALsizei samples = freq * (mono ? 1 : 2);
+    float *data = (float *) SDL_malloc(samples * sizeof (float));
+    ALuint bid = 0;
+    ALsizei i;
+
+    if (!data) {
+        return 0;
+    }
+
+    for (i = 0; i < samples; i++) {
+        data[i] = ((float) (i % 97) / 48.5f) - 1.0f;
+    }
+
+    alGenBuffers(1, &bid);
+    alBufferData(bid, fmt, data, samples * sizeof (float), freq);
+    SDL_free(data);
+
+    return check_openal_error("alBufferData") ? 0 : bid;
+}
+
+int main(int argc, char **argv)
+{
+    static const ALsizei voice_counts[] = { 1, 10, 100, 1000, 10000 };
+    ALCint attrs[] = {
+        ALC_FREQUENCY, BENCH_FREQ,
+        ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+        ALC_FORMAT_TYPE_SOFT, ALC_FLOAT_SOFT,
+        ALC_MIXER_THREADS_MOJOAL, 1,
+        ALC_FAST_MATH_MOJOAL, ALC_TRUE,  /* off by default, but it's what anyone worried about speed will use. */
+        0
+    };
+    ALsizei max_vocoder_voices = 1000;  /* the phase vocoder state is big, 10000 of them is a lot of memory. */
+    ALsizei max_voices = 10000;
+    ALCdevice *device;
+    ALCcontext *context;
+    static const ALsizei compressed_freqs[] = { 22050, 44100, BENCH_FREQ };
+    ALuint buffers[2][2];  /* [mono][resampled] */
+    int mono, resampled, pitched;
+    int failures = 0;
+    size_t i;
+
+    if (argc > 1) {
+        max_voices = (ALsizei) SDL_atoi(argv[1]);
+    }
+    if (argc > 2) {
+        max_vocoder_voices = (ALsizei) SDL_atoi(argv[2]);
+    }
+    if (argc > 3) {
+        attrs[7] = (ALCint) SDL_atoi(argv[3]);  /* ALC_MIXER_THREADS_MOJOAL */
+    }
+
+    perf_freq = SDL_GetPerformanceFrequency();
+
+    device = alcLoopbackOpenDeviceSOFT(NULL);
+    if (!device) {
+        printf("Couldn't open OpenAL loopback device.\n");
+        return 2;
+    }
+
+    context = alcCreateContext(device, attrs);
+    if (!context) {
+        printf("Couldn't create OpenAL context.\n");
+        alcCloseDevice(device);
+        return 3;
+    }
+
+    alcMakeContextCurrent(context);
+
+    bench_stream = (float *) calloc_simd_aligned(BENCH_PERIOD * sizeof (float) * OPENAL_MAX_OUTPUT_CHANNELS);  /* big enough for the 7.1 kernels. */
+    bench_data = (float *) calloc_simd_aligned(BENCH_PERIOD * sizeof (float) * 2);
+    bench_data_s16 = (Sint16 *) calloc_simd_aligned(BENCH_PERIOD * sizeof (Sint16) * 2);
+    if (!bench_stream || !bench_data || !bench_data_s16) {
+        printf("Out of memory!\n");
+        return 4;
+    }
+
+    for (i = 0; i < BENCH_PERIOD * 2; i++) {
+        bench_data[i] = ((float) (i % 97) / 48.5f) - 1.0f;
+        bench_data_s16[i] = (Sint16) (bench_data[i] * 32767.0f);
+    }
+
+    printf("MojoAL mixer benchmark (%s build, %d mixer thread%s)\n\n", FORCE_SCALAR_FALLBACK ? "forced scalar" : "default",
+           context->num_mixer_threads, (context->num_mixer_threads == 1) ? "" : "s");
+
+    bench_kernels();
+
+    for (mono = 1; mono >= 0; mono--) {
+        for (resampled = 0; resampled <= 1; resampled++) {
+            buffers[mono][resampled] = make_buffer(mono, resampled ? 44100 : BENCH_FREQ);
+            if (!buffers[mono][resampled]) {
+                return 5;
+            }
+        }
+    }
+
+    printf("mix_buffer (%d frames per call):\n", BENCH_PERIOD);
+    for (mono = 1; mono >= 0; mono--) {
+        for (pitched = 0; pitched <= 1; pitched++) {
+            bench_mix_buffer(context, buffers[mono][0], (ALboolean) pitched);
+        }
+    }
+    printf("\n");
+
+    printf("mix_context (%d frames per call):\n", BENCH_PERIOD);
+    for (i = 0; i < SDL_arraysize(voice_counts); i++) {
+        const ALsizei voices = voice_counts[i];
+        if (voices > max_voices) {
+            break;
+        }
+        for (mono = 1; mono >= 0; mono--) {
+            for (resampled = 0; resampled <= 1; resampled++) {
+                for (pitched = 0; pitched <= 2; pitched++) {
+                    if ((pitched < 2) || (voices <= max_vocoder_voices)) {
+                        bench_scene(context, voices, buffers[mono][resampled], mono, resampled, pitched);
+                    }
+                }
+            }
+        }
+    }
+    printf("\n");
+
+    printf("Spatialization with a moving listener (once per mix):\n");
+    for (i = 0; i < SDL_arraysize(voice_counts); i++) {
+        if (voice_counts[i] > max_voices) {
+            break;
+        }
+        bench_spatialize(context, voice_counts[i], buffers[1][0]);
+    }
+    printf("\n");
+
+    printf("Setting AL_POSITION on every source:\n");
+    for (i = 0; i < SDL_arraysize(voice_counts); i++) {
+        if (voice_counts[i] > max_voices) {
+            break;
+        }
+        bench_source_updates(voice_counts[i]);
+    }
+    printf("\n");
+
+    printf("Playing IMA4 with %d frame blocks (%d frames per call):\n", 65537, BENCH_PERIOD);
+    for (i = 0; i < SDL_arraysize(compressed_freqs); i++) {
+        failures += bench_compressed(context, compressed_freqs[i]);
+    }
+    printf("\n");
+
+    free_simd_aligned(bench_data_s16);
+    free_simd_aligned(bench_data);
+    free_simd_aligned(bench_stream);
+
+    alDeleteBuffers(4, &buffers[0][0]);
+    alcMakeContextCurrent(NULL);
+    alcDestroyContext(context);
+    alcCloseDevice(device);
+
+    return failures ? 1 : 0;
+}
+
+/* end of benchmix.c ... */
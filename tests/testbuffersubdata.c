@@ -0,0 +1,233 @@
+/**
+ * MojoAL; a simple drop-in OpenAL implementation.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by Ryan C. Gordon.
+ */
+
+/* This is just test code, you don't need to compile this with MojoAL. */
+
+/* This checks that alBufferSubDataSOFT only takes data in the format the
+   buffer was given. An 8-bit buffer is stored as float32, so it looks a lot
+   like any other 8-bit format by the time sub-data shows up; mu-law bytes
+   written into it would just be mixed as 8-bit PCM. Each mismatch has to
+   fail with AL_INVALID_ENUM and leave the buffer alone, which we check by
+   rendering it through a loopback device before and after. A NULL pointer
+   (AL_INVALID_VALUE) and a buffer the app has mapped (AL_INVALID_OPERATION)
+   have to be refused the same way.
+   Exits with 1 if anything is wrong. */
+
+#include <stdio.h>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+#include "SDL.h"
+
+#define RENDER_FREQ 48000
+#define RENDER_FRAMES 1024
+#define TEST_FRAMES 2048
+
+static LPALCLOOPBACKOPENDEVICESOFT palcLoopbackOpenDeviceSOFT;
+static LPALCRENDERSAMPLESSOFT palcRenderSamplesSOFT;
+static LPALBUFFERSUBDATASOFT palBufferSubDataSOFT;
+static LPALBUFFERSTORAGESOFT palBufferStorageSOFT;
+static LPALMAPBUFFERSOFT palMapBufferSOFT;
+static LPALUNMAPBUFFERSOFT palUnmapBufferSOFT;
+
+static ALCdevice *device;
+static ALuint sid;
+static int failures;
+
+static void render(const ALuint bid, Sint16 *rendered)
+{
+    alSourcei(sid, AL_BUFFER, bid);
+    alSourcePlay(sid);
+    palcRenderSamplesSOFT(device, rendered, RENDER_FRAMES);
+    alSourceStop(sid);
+    alSourcei(sid, AL_BUFFER, 0);
+}
+
+static void check_result(const char *what, const ALenum err, const ALenum expected, const Sint16 *before, const Sint16 *after)
+{
+    if (err != expected) {
+        printf("FAIL: %s: expected error %#x, got %#x\n", what, (unsigned int) expected, (unsigned int) err);
+        failures++;
+    } else if ((expected != AL_NO_ERROR) && (SDL_memcmp(before, after, sizeof (Sint16) * RENDER_FRAMES * 2) != 0)) {
+        printf("FAIL: %s: rejected sub-data changed the buffer anyway\n", what);
+        failures++;
+    } else if ((expected == AL_NO_ERROR) && (SDL_memcmp(before, after, sizeof (Sint16) * RENDER_FRAMES * 2) == 0)) {
+        printf("FAIL: %s: accepted sub-data didn't change the buffer\n", what);
+        failures++;
+    } else {
+        printf("ok: %s\n", what);
+    }
+}
+
+static void fill_data(Uint8 *data, const int len)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        data[i] = (Uint8) ((i * 37) ^ (i >> 3));
+    }
+}
+
+static void test_subdata(const char *what, const ALenum bufferfmt, const ALenum subfmt, const ALenum expected)
+{
+    static Uint8 data[TEST_FRAMES * 2];
+    static Sint16 before[RENDER_FRAMES * 2];
+    static Sint16 after[RENDER_FRAMES * 2];
+    ALuint bid = 0;
+    ALenum err;
+    int i;
+
+    fill_data(data, (int) sizeof (data));
+
+    alGenBuffers(1, &bid);
+    alBufferData(bid, bufferfmt, data, sizeof (data), RENDER_FREQ);
+    render(bid, before);
+    alGetError();  /* clear anything the setup left behind. */
+
+    for (i = 0; i < (int) sizeof (data); i++) {
+        data[i] = (Uint8) ~data[i];
+    }
+    palBufferSubDataSOFT(bid, subfmt, data, 0, 64);
+    err = alGetError();
+    render(bid, after);
+    check_result(what, err, expected, before, after);
+
+    alDeleteBuffers(1, &bid);
+}
+
+static void test_subdata_null(void)
+{
+    static Uint8 data[TEST_FRAMES * 2];
+    static Sint16 before[RENDER_FRAMES * 2];
+    static Sint16 after[RENDER_FRAMES * 2];
+    ALuint bid = 0;
+    ALenum err;
+
+    fill_data(data, (int) sizeof (data));
+    alGenBuffers(1, &bid);
+    alBufferData(bid, AL_FORMAT_MONO16, data, sizeof (data), RENDER_FREQ);
+    render(bid, before);
+    alGetError();
+
+    palBufferSubDataSOFT(bid, AL_FORMAT_MONO16, NULL, 0, 64);
+    err = alGetError();
+    render(bid, after);
+    check_result("NULL data", err, AL_INVALID_VALUE, before, after);
+
+    alDeleteBuffers(1, &bid);
+}
+
+static void test_subdata_mapped(void)
+{
+    static Uint8 data[TEST_FRAMES * 2];
+    static Sint16 before[RENDER_FRAMES * 2];
+    static Sint16 after[RENDER_FRAMES * 2];
+    const ALbitfieldSOFT access = AL_MAP_READ_BIT_SOFT | AL_MAP_WRITE_BIT_SOFT | AL_MAP_PERSISTENT_BIT_SOFT;
+    ALuint bid = 0;
+    ALenum err;
+    int i;
+
+    fill_data(data, (int) sizeof (data));
+    alGenBuffers(1, &bid);
+    palBufferStorageSOFT(bid, AL_FORMAT_MONO16, data, sizeof (data), RENDER_FREQ, access);
+    render(bid, before);
+    alGetError();
+
+    for (i = 0; i < (int) sizeof (data); i++) {
+        data[i] = (Uint8) ~data[i];
+    }
+
+    if (palMapBufferSOFT(bid, 0, sizeof (data), access) == NULL) {
+        printf("FAIL: mapped buffer: couldn't map it\n");
+        failures++;
+    } else {
+        palBufferSubDataSOFT(bid, AL_FORMAT_MONO16, data, 0, 64);
+        err = alGetError();
+        palUnmapBufferSOFT(bid);
+        render(bid, after);
+        check_result("mapped buffer", err, AL_INVALID_OPERATION, before, after);
+    }
+
+    alDeleteBuffers(1, &bid);
+}
+
+int main(int argc, char **argv)
+{
+    const ALCint attrs[] = {
+        ALC_FREQUENCY, RENDER_FREQ,
+        ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+        ALC_FORMAT_TYPE_SOFT, ALC_SHORT_SOFT,
+        0
+    };
+    ALenum mulaw;
+    ALenum alaw;
+    ALCcontext *context;
+
+    (void) argc;
+    (void) argv;
+
+    if (!alcIsExtensionPresent(NULL, "ALC_SOFT_loopback")) {
+        printf("ALC_SOFT_loopback isn't supported!\n");
+        return 2;
+    }
+
+    palcLoopbackOpenDeviceSOFT = (LPALCLOOPBACKOPENDEVICESOFT) alcGetProcAddress(NULL, "alcLoopbackOpenDeviceSOFT");
+    palcRenderSamplesSOFT = (LPALCRENDERSAMPLESSOFT) alcGetProcAddress(NULL, "alcRenderSamplesSOFT");
+
+    device = palcLoopbackOpenDeviceSOFT(NULL);
+    if (!device) {
+        printf("Couldn't open OpenAL loopback device.\n");
+        return 2;
+    }
+
+    context = alcCreateContext(device, attrs);
+    if (!context) {
+        printf("Couldn't create OpenAL context.\n");
+        alcCloseDevice(device);
+        return 3;
+    }
+
+    alcMakeContextCurrent(context);
+
+    if (!alIsExtensionPresent("AL_SOFT_buffer_sub_data") || !alIsExtensionPresent("AL_SOFT_map_buffer") || !alIsExtensionPresent("AL_EXT_MULAW") || !alIsExtensionPresent("AL_EXT_ALAW")) {
+        printf("AL_SOFT_buffer_sub_data, AL_SOFT_map_buffer, AL_EXT_MULAW or AL_EXT_ALAW isn't supported!\n");
+        alcMakeContextCurrent(NULL);
+        alcDestroyContext(context);
+        alcCloseDevice(device);
+        return 2;
+    }
+
+    palBufferSubDataSOFT = (LPALBUFFERSUBDATASOFT) alGetProcAddress("alBufferSubDataSOFT");
+    palBufferStorageSOFT = (LPALBUFFERSTORAGESOFT) alGetProcAddress("alBufferStorageSOFT");
+    palMapBufferSOFT = (LPALMAPBUFFERSOFT) alGetProcAddress("alMapBufferSOFT");
+    palUnmapBufferSOFT = (LPALUNMAPBUFFERSOFT) alGetProcAddress("alUnmapBufferSOFT");
+    mulaw = alGetEnumValue("AL_FORMAT_MONO_MULAW_EXT");
+    alaw = alGetEnumValue("AL_FORMAT_MONO_ALAW_EXT");
+
+    alGenSources(1, &sid);
+
+    test_subdata("8-bit into 8-bit", AL_FORMAT_MONO8, AL_FORMAT_MONO8, AL_NO_ERROR);
+    test_subdata("mu-law into mu-law", mulaw, mulaw, AL_NO_ERROR);
+    test_subdata("mu-law into 8-bit", AL_FORMAT_MONO8, mulaw, AL_INVALID_ENUM);
+    test_subdata("A-law into 8-bit", AL_FORMAT_MONO8, alaw, AL_INVALID_ENUM);
+    test_subdata("8-bit into mu-law", mulaw, AL_FORMAT_MONO8, AL_INVALID_ENUM);
+    test_subdata("A-law into mu-law", mulaw, alaw, AL_INVALID_ENUM);
+    test_subdata("stereo 8-bit into mono 16-bit", AL_FORMAT_MONO16, AL_FORMAT_STEREO8, AL_INVALID_ENUM);
+    test_subdata_null();
+    test_subdata_mapped();
+
+    alDeleteSources(1, &sid);
+
+    alcMakeContextCurrent(NULL);
+    alcDestroyContext(context);
+    alcCloseDevice(device);
+
+    printf("%s\n", failures ? "FAILED!" : "All tests passed.");
+    return failures ? 1 : 0;
+}
+
+/* end of testbuffersubdata.c ... */
@@ -0,0 +1,300 @@
+/**
+ * MojoAL; a simple drop-in OpenAL implementation.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by Ryan C. Gordon.
+ */
+
+/* This is just test code, you don't need to compile this with MojoAL. */
+
+/* This checks the fastmath_* approximations against the C runtime. Like
+   benchmix, it compiles mojoal.c directly into itself to get at them, so
+   build it once normally to test the SIMD versions and once with
+   -DFORCE_SCALAR_FALLBACK=1 to test the scalar ones (CMake builds both, as
+   testfastmath and testfastmath_scalar).
+
+   Each function is run over a large sweep of pseudorandom inputs and
+   compared to the double precision libm result. The worst error is reported,
+   along with the input that caused it and how long each call takes compared
+   to the float version from libm. If anything is worse than the bounds
+   documented in mojoal.c, this reports a failure and exits with 1. */
+
+#include "../mojoal.c"
+
+#include <stdio.h>
+
+#define TEST_VALUES (1 << 20)
+#define TEST_TIMING_RUNS 8
+
+typedef void (*TestFn)(const float *a, const float *b, float *out, const int count);
+typedef double (*ReferenceFn)(const double a, const double b);
+typedef void (*InputFn)(float *a, float *b, const int count);
+
+typedef struct FastMathTest
+{
+    const char *name;
+    const char *variant;
+    TestFn fn;
+    TestFn libm;
+    ReferenceFn reference;
+    InputFn inputs;
+    int relative;  /* nonzero to measure error relative to the reference, instead of absolute. */
+    double bound;
+} FastMathTest;
+
+static Uint32 rng_state = 0x12345678;
+
+static float random_float(const float lo, const float hi)
+{
+    rng_state ^= rng_state << 13;  /* xorshift32; deterministic, so failures are reproducible. */
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return lo + ((hi - lo) * ((float) (rng_state >> 8) * (1.0f / 16777216.0f)));
+}
+
+static void inputs_atan2(float *a, float *b, const int count)
+{
+    int i;
+    for (i = 0; i < count; i++) {
+        const float ysign = (random_float(0.0f, 1.0f) < 0.5f) ? -1.0f : 1.0f;
+        const float xsign = (random_float(0.0f, 1.0f) < 0.5f) ? -1.0f : 1.0f;
+        a[i] = ysign * (float) pow(10.0, random_float(-6.0f, 6.0f));
+        b[i] = xsign * (float) pow(10.0, random_float(-6.0f, 6.0f));
+    }
+    a[0] = 0.0f; b[0] = 1.0f;  /* make sure the axes are covered. */
+    a[1] = 1.0f; b[1] = 0.0f;
+    a[2] = 0.0f; b[2] = -1.0f;
+    a[3] = -1.0f; b[3] = 0.0f;
+}
+
+static void inputs_angle(float *a, float *b, const int count)
+{
+    int i;
+    for (i = 0; i < count; i++) {
+        a[i] = random_float(-FASTMATH_PI, FASTMATH_PI);
+        b[i] = 0.0f;
+    }
+    a[0] = -FASTMATH_PI;
+    a[1] = FASTMATH_PI;
+    a[2] = 0.0f;
+}
+
+static void inputs_acos(float *a, float *b, const int count)
+{
+    int i;
+    for (i = 0; i < count; i++) {
+        a[i] = random_float(-1.0f, 1.0f);
+        b[i] = 0.0f;
+    }
+    a[0] = -1.0f;
+    a[1] = 1.0f;
+    a[2] = 0.0f;
+}
+
+static void inputs_log2(float *a, float *b, const int count)
+{
+    int i;
+    for (i = 0; i < count; i++) {
+        a[i] = (float) exp2(random_float(-126.0f, 127.99f));
+        b[i] = 0.0f;
+    }
+    a[0] = 1.0f;
+    a[1] = FLT_MIN;
+    a[2] = FLT_MAX;
+}
+
+static void inputs_exp2(float *a, float *b, const int count)
+{
+    int i;
+    for (i = 0; i < count; i++) {
+        a[i] = random_float(FASTMATH_EXP2_MIN, FASTMATH_EXP2_MAX);
+        b[i] = 0.0f;
+    }
+    a[0] = 0.0f;
+    a[1] = FASTMATH_EXP2_MIN;
+    a[2] = FASTMATH_EXP2_MAX;
+}
+
+/* distance ratios and rolloff factors like the exponent distance model sees; |y * log2(x)| < 16. */
+static void inputs_pow(float *a, float *b, const int count)
+{
+    int i;
+    for (i = 0; i < count; i++) {
+        a[i] = (float) exp2(random_float(-8.0f, 8.0f));
+        b[i] = random_float(-2.0f, 2.0f);
+    }
+}
+
+/* the whole range that doesn't hit the clamp; |y * log2(x)| < 120. */
+static void inputs_pow_wide(float *a, float *b, const int count)
+{
+    int i;
+    for (i = 0; i < count; i++) {
+        a[i] = (float) exp2(random_float(-40.0f, 40.0f));
+        b[i] = random_float(-3.0f, 3.0f);
+    }
+}
+
+static double reference_atan2(const double a, const double b) { return atan2(a, b); }
+static double reference_sin(const double a, const double b) { (void) b; return sin(a); }
+static double reference_cos(const double a, const double b) { (void) b; return cos(a); }
+static double reference_acos(const double a, const double b) { (void) b; return acos(a); }
+static double reference_log2(const double a, const double b) { (void) b; return log2(a); }
+static double reference_exp2(const double a, const double b) { (void) b; return exp2(a); }
+static double reference_pow(const double a, const double b) { return pow(a, b); }
+
+static void libm_atan2(const float *a, const float *b, float *out, const int count) { int i; for (i = 0; i < count; i++) { out[i] = atan2f(a[i], b[i]); } }
+static void libm_sin(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i++) { out[i] = sinf(a[i]); } }
+static void libm_cos(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i++) { out[i] = cosf(a[i]); } }
+static void libm_acos(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i++) { out[i] = acosf(a[i]); } }
+static void libm_log2(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i++) { out[i] = log2f(a[i]); } }
+static void libm_exp2(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i++) { out[i] = exp2f(a[i]); } }
+static void libm_pow(const float *a, const float *b, float *out, const int count) { int i; for (i = 0; i < count; i++) { out[i] = powf(a[i], b[i]); } }
+
+static void scalar_atan2(const float *a, const float *b, float *out, const int count) { int i; for (i = 0; i < count; i++) { out[i] = fastmath_atan2f(a[i], b[i]); } }
+static void scalar_sin(const float *a, const float *b, float *out, const int count) { int i; float c; (void) b; for (i = 0; i < count; i++) { fastmath_sincosf(a[i], &out[i], &c); } }
+static void scalar_cos(const float *a, const float *b, float *out, const int count) { int i; float s; (void) b; for (i = 0; i < count; i++) { fastmath_sincosf(a[i], &s, &out[i]); } }
+#if NEED_SCALAR_FALLBACK
+static void scalar_acos(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i++) { out[i] = fastmath_acosf(a[i]); } }
+static void scalar_log2(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i++) { out[i] = fastmath_log2f(a[i]); } }
+static void scalar_exp2(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i++) { out[i] = fastmath_exp2f(a[i]); } }
+static void scalar_pow(const float *a, const float *b, float *out, const int count) { int i; for (i = 0; i < count; i++) { out[i] = fastmath_powf(a[i], b[i]); } }
+#endif
+
+#ifdef __SSE__
+static void sse_atan2(const float *a, const float *b, float *out, const int count) { int i; for (i = 0; i < count; i += 4) { _mm_store_ps(out + i, fastmath_atan2_sse(_mm_load_ps(a + i), _mm_load_ps(b + i))); } }
+static void sse_sin(const float *a, const float *b, float *out, const int count) { int i; __m128 s, c; (void) b; for (i = 0; i < count; i += 4) { fastmath_sincos_sse(_mm_load_ps(a + i), &s, &c); _mm_store_ps(out + i, s); } }
+static void sse_cos(const float *a, const float *b, float *out, const int count) { int i; __m128 s, c; (void) b; for (i = 0; i < count; i += 4) { fastmath_sincos_sse(_mm_load_ps(a + i), &s, &c); _mm_store_ps(out + i, c); } }
+static void sse_acos(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i += 4) { _mm_store_ps(out + i, fastmath_acos_sse(_mm_load_ps(a + i))); } }
+#ifdef __SSE2__
+static void sse_log2(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i += 4) { _mm_store_ps(out + i, fastmath_log2_sse(_mm_load_ps(a + i))); } }
+static void sse_exp2(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i += 4) { _mm_store_ps(out + i, fastmath_exp2_sse(_mm_load_ps(a + i))); } }
+static void sse_pow(const float *a, const float *b, float *out, const int count) { int i; for (i = 0; i < count; i += 4) { _mm_store_ps(out + i, fastmath_pow_sse(_mm_load_ps(a + i), _mm_load_ps(b + i))); } }
+#endif
+#endif
+
+#ifdef __ARM_NEON__
+static void neon_atan2(const float *a, const float *b, float *out, const int count) { int i; for (i = 0; i < count; i += 4) { vst1q_f32(out + i, fastmath_atan2_neon(vld1q_f32(a + i), vld1q_f32(b + i))); } }
+static void neon_sin(const float *a, const float *b, float *out, const int count) { int i; float32x4_t s, c; (void) b; for (i = 0; i < count; i += 4) { fastmath_sincos_neon(vld1q_f32(a + i), &s, &c); vst1q_f32(out + i, s); } }
+static void neon_cos(const float *a, const float *b, float *out, const int count) { int i; float32x4_t s, c; (void) b; for (i = 0; i < count; i += 4) { fastmath_sincos_neon(vld1q_f32(a + i), &s, &c); vst1q_f32(out + i, c); } }
+static void neon_acos(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i += 4) { vst1q_f32(out + i, fastmath_acos_neon(vld1q_f32(a + i))); } }
+static void neon_log2(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i += 4) { vst1q_f32(out + i, fastmath_log2_neon(vld1q_f32(a + i))); } }
+static void neon_exp2(const float *a, const float *b, float *out, const int count) { int i; (void) b; for (i = 0; i < count; i += 4) { vst1q_f32(out + i, fastmath_exp2_neon(vld1q_f32(a + i))); } }
+static void neon_pow(const float *a, const float *b, float *out, const int count) { int i; for (i = 0; i < count; i += 4) { vst1q_f32(out + i, fastmath_pow_neon(vld1q_f32(a + i), vld1q_f32(b + i))); } }
+#endif
+
+/* these bounds are the ones documented with the fastmath functions in mojoal.c. */
+static const FastMathTest tests[] = {
+    { "atan2", "scalar", scalar_atan2, libm_atan2, reference_atan2, inputs_atan2, 0, 4e-7 },
+    { "sin", "scalar", scalar_sin, libm_sin, reference_sin, inputs_angle, 0, 3e-7 },
+    { "cos", "scalar", scalar_cos, libm_cos, reference_cos, inputs_angle, 0, 3e-7 },
+    #if NEED_SCALAR_FALLBACK
+    { "acos", "scalar", scalar_acos, libm_acos, reference_acos, inputs_acos, 0, 5e-7 },
+    { "log2", "scalar", scalar_log2, libm_log2, reference_log2, inputs_log2, 0, 3e-7 },
+    { "exp2", "scalar", scalar_exp2, libm_exp2, reference_exp2, inputs_exp2, 1, 3e-7 },
+    { "pow", "scalar", scalar_pow, libm_pow, reference_pow, inputs_pow, 1, 1e-6 },
+    { "pow (wide)", "scalar", scalar_pow, libm_pow, reference_pow, inputs_pow_wide, 1, 1e-5 },
+    #endif
+    #ifdef __SSE__
+    { "atan2", "SSE", sse_atan2, libm_atan2, reference_atan2, inputs_atan2, 0, 4e-7 },
+    { "sin", "SSE", sse_sin, libm_sin, reference_sin, inputs_angle, 0, 3e-7 },
+    { "cos", "SSE", sse_cos, libm_cos, reference_cos, inputs_angle, 0, 3e-7 },
+    { "acos", "SSE", sse_acos, libm_acos, reference_acos, inputs_acos, 0, 5e-7 },
+    #ifdef __SSE2__
+    { "log2", "SSE2", sse_log2, libm_log2, reference_log2, inputs_log2, 0, 3e-7 },
+    { "exp2", "SSE2", sse_exp2, libm_exp2, reference_exp2, inputs_exp2, 1, 3e-7 },
+    { "pow", "SSE2", sse_pow, libm_pow, reference_pow, inputs_pow, 1, 1e-6 },
+    { "pow (wide)", "SSE2", sse_pow, libm_pow, reference_pow, inputs_pow_wide, 1, 1e-5 },
+    #endif
+    #endif
+    #ifdef __ARM_NEON__
+    { "atan2", "NEON", neon_atan2, libm_atan2, reference_atan2, inputs_atan2, 0, 4e-7 },
+    { "sin", "NEON", neon_sin, libm_sin, reference_sin, inputs_angle, 0, 3e-7 },
+    { "cos", "NEON", neon_cos, libm_cos, reference_cos, inputs_angle, 0, 3e-7 },
+    { "acos", "NEON", neon_acos, libm_acos, reference_acos, inputs_acos, 0, 5e-7 },
+    { "log2", "NEON", neon_log2, libm_log2, reference_log2, inputs_log2, 0, 3e-7 },
+    { "exp2", "NEON", neon_exp2, libm_exp2, reference_exp2, inputs_exp2, 1, 3e-7 },
+    { "pow", "NEON", neon_pow, libm_pow, reference_pow, inputs_pow, 1, 1e-6 },
+    { "pow (wide)", "NEON", neon_pow, libm_pow, reference_pow, inputs_pow_wide, 1, 1e-5 },
+    #endif
+};
+
+static double time_fn(const TestFn fn, const float *a, const float *b, float *out)
+{
+    const Uint64 start = SDL_GetPerformanceCounter();
+    int i;
+    for (i = 0; i < TEST_TIMING_RUNS; i++) {
+        fn(a, b, out, TEST_VALUES);
+    }
+    return ((double) (SDL_GetPerformanceCounter() - start) * 1000000000.0) / ((double) SDL_GetPerformanceFrequency()) / ((double) TEST_VALUES * TEST_TIMING_RUNS);
+}
+
+static int run_test(const FastMathTest *test, float *a, float *b, float *out)
+{
+    double worst = 0.0;
+    int worst_index = 0;
+    double fast_ns, libm_ns;
+    int i;
+
+    rng_state = 0x12345678;
+    test->inputs(a, b, TEST_VALUES);
+    test->fn(a, b, out, TEST_VALUES);
+
+    for (i = 0; i < TEST_VALUES; i++) {
+        const double expected = test->reference((double) a[i], (double) b[i]);
+        double error = fabs(((double) out[i]) - expected);
+        if (test->relative) {
+            error /= fabs(expected);
+        }
+        if (!(error <= worst)) {  /* written this way so NaNs count as the worst error. */
+            worst = error;
+            worst_index = i;
+        }
+    }
+
+    fast_ns = time_fn(test->fn, a, b, out);
+    libm_ns = time_fn(test->libm, a, b, out);
+
+    printf("%-10s %-7s max %s error %.3g at (%.9g, %.9g), %.2f ns per value (libm: %.2f) %s\n",
+           test->name, test->variant, test->relative ? "relative" : "absolute",
+           worst, a[worst_index], b[worst_index], fast_ns, libm_ns,
+           (worst <= test->bound) ? "" : "FAILED!");
+
+    return (worst <= test->bound) ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    float *a = (float *) calloc_simd_aligned(TEST_VALUES * sizeof (float));
+    float *b = (float *) calloc_simd_aligned(TEST_VALUES * sizeof (float));
+    float *out = (float *) calloc_simd_aligned(TEST_VALUES * sizeof (float));
+    int failures = 0;
+    size_t i;
+
+    (void) argc;
+    (void) argv;
+
+    if (!a || !b || !out) {
+        printf("Out of memory!\n");
+        return 1;
+    }
+
+    for (i = 0; i < SDL_arraysize(tests); i++) {
+        #ifdef __ARM_NEON__
+        if ((SDL_strcmp(tests[i].variant, "NEON") == 0) && !SDL_HasNEON()) {
+            continue;  /* some ARMv7 chips don't have it. */
+        }
+        #endif
+        failures += run_test(&tests[i], a, b, out);
+    }
+
+    free_simd_aligned(out);
+    free_simd_aligned(b);
+    free_simd_aligned(a);
+
+    printf("\n%d failure%s.\n", failures, (failures == 1) ? "" : "s");
+    return (failures == 0) ? 0 : 1;
+}
+
+/* end of testfastmath.c ... */
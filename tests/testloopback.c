@@ -0,0 +1,208 @@
+/**
+ * MojoAL; a simple drop-in OpenAL implementation.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by Ryan C. Gordon.
+ */
+
+/* This is just test code, you don't need to compile this with MojoAL. */
+
+#include <stdio.h>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+#include "SDL.h"
+
+#define RENDER_FREQ 48000
+#define RENDER_FRAMES 4096
+
+static LPALCLOOPBACKOPENDEVICESOFT palcLoopbackOpenDeviceSOFT;
+static LPALCISRENDERFORMATSUPPORTEDSOFT palcIsRenderFormatSupportedSOFT;
+static LPALCRENDERSAMPLESSOFT palcRenderSamplesSOFT;
+
+static int check_openal_error(const char *where)
+{
+    const ALenum err = alGetError();
+    if (err != AL_NONE) {
+        printf("OpenAL Error at %s! %s (%u)\n", where, alGetString(err), (unsigned int) err);
+        return 1;
+    }
+    return 0;
+}
+
+static ALenum get_openal_format(const SDL_AudioSpec *spec)
+{
+    if ((spec->channels == 1) && (spec->format == AUDIO_U8)) {
+        return AL_FORMAT_MONO8;
+    } else if ((spec->channels == 1) && (spec->format == AUDIO_S16SYS)) {
+        return AL_FORMAT_MONO16;
+    } else if ((spec->channels == 2) && (spec->format == AUDIO_U8)) {
+        return AL_FORMAT_STEREO8;
+    } else if ((spec->channels == 2) && (spec->format == AUDIO_S16SYS)) {
+        return AL_FORMAT_STEREO16;
+    } else if ((spec->channels == 1) && (spec->format == AUDIO_F32SYS)) {
+        return alIsExtensionPresent("AL_EXT_FLOAT32") ? alGetEnumValue("AL_FORMAT_MONO_FLOAT32") : AL_NONE;
+    } else if ((spec->channels == 2) && (spec->format == AUDIO_F32SYS)) {
+        return alIsExtensionPresent("AL_EXT_FLOAT32") ? alGetEnumValue("AL_FORMAT_STEREO_FLOAT32") : AL_NONE;
+    }
+    return AL_NONE;
+}
+
+static void write_wav_header(SDL_RWops *rw, const Uint32 datalen)
+{
+    SDL_WriteLE32(rw, 0x46464952);  /* "RIFF" */
+    SDL_WriteLE32(rw, datalen + 36);
+    SDL_WriteLE32(rw, 0x45564157);  /* "WAVE" */
+    SDL_WriteLE32(rw, 0x20746D66);  /* "fmt " */
+    SDL_WriteLE32(rw, 16);
+    SDL_WriteLE16(rw, 1);  /* PCM */
+    SDL_WriteLE16(rw, 2);
+    SDL_WriteLE32(rw, RENDER_FREQ);
+    SDL_WriteLE32(rw, RENDER_FREQ * 4);
+    SDL_WriteLE16(rw, 4);
+    SDL_WriteLE16(rw, 16);
+    SDL_WriteLE32(rw, 0x61746164);  /* "data" */
+    SDL_WriteLE32(rw, datalen);
+}
+
+static void renderwav(ALCdevice *device, const char *fname, const char *outfname)
+{
+    SDL_AudioSpec spec;
+    ALenum alfmt = AL_NONE;
+    Uint8 *buf = NULL;
+    Uint32 buflen = 0;
+    ALuint sid = 0;
+    ALuint bid = 0;
+    ALint state = AL_PLAYING;
+    Sint16 *rendered = NULL;
+    Uint32 datalen = 0;
+    SDL_RWops *rw = NULL;
+    Uint32 ticks;
+
+    if (!SDL_LoadWAV(fname, &spec, &buf, &buflen)) {
+        printf("Loading '%s' failed! %s\n", fname, SDL_GetError());
+        return;
+    } else if ((alfmt = get_openal_format(&spec)) == AL_NONE) {
+        printf("Can't render '%s', format not supported by the AL.\n", fname);
+        SDL_FreeWAV(buf);
+        return;
+    } else if ((rw = SDL_RWFromFile(outfname, "wb")) == NULL) {
+        printf("Can't open '%s' for writing! %s\n", outfname, SDL_GetError());
+        SDL_FreeWAV(buf);
+        return;
+    }
+
+    rendered = (Sint16 *) SDL_malloc(RENDER_FRAMES * sizeof (Sint16) * 2);
+    if (!rendered) {
+        printf("Out of memory!\n");
+        SDL_RWclose(rw);
+        SDL_FreeWAV(buf);
+        return;
+    }
+
+    write_wav_header(rw, 0);  /* we'll fix this up at the end. */
+
+    check_openal_error("startup");
+
+    printf("Now rendering '%s' to '%s'...\n", fname, outfname);
+
+    alGenSources(1, &sid);
+    check_openal_error("alGenSources");
+    alGenBuffers(1, &bid);
+    check_openal_error("alGenBuffers");
+    alBufferData(bid, alfmt, buf, buflen, spec.freq);
+    check_openal_error("alBufferData");
+    SDL_FreeWAV(buf);
+    alSourcei(sid, AL_BUFFER, bid);
+    check_openal_error("alSourcei");
+    alSourcePlay(sid);
+    check_openal_error("alSourcePlay");
+
+    /* we don't wait on a real device here, so this should finish much faster than realtime. */
+    ticks = SDL_GetTicks();
+    while (state == AL_PLAYING) {
+        palcRenderSamplesSOFT(device, rendered, RENDER_FRAMES);
+        if (SDL_RWwrite(rw, rendered, RENDER_FRAMES * sizeof (Sint16) * 2, 1) != 1) {
+            printf("Write to '%s' failed! %s\n", outfname, SDL_GetError());
+            break;
+        }
+        datalen += RENDER_FRAMES * sizeof (Sint16) * 2;
+        alGetSourcei(sid, AL_SOURCE_STATE, &state);
+        if (check_openal_error("alGetSourcei")) {
+            break;
+        }
+    }
+    ticks = SDL_GetTicks() - ticks;
+
+    printf("Rendered %u frames in %u milliseconds.\n", (unsigned int) (datalen / 4), (unsigned int) ticks);
+
+    SDL_RWseek(rw, 0, RW_SEEK_SET);
+    write_wav_header(rw, datalen);
+    SDL_RWclose(rw);
+    SDL_free(rendered);
+
+    alDeleteSources(1, &sid);
+    check_openal_error("alDeleteSources");
+    alDeleteBuffers(1, &bid);
+    check_openal_error("alDeleteBuffers");
+}
+
+
+int main(int argc, char **argv)
+{
+    const ALCint attrs[] = {
+        ALC_FREQUENCY, RENDER_FREQ,
+        ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+        ALC_FORMAT_TYPE_SOFT, ALC_SHORT_SOFT,
+        0
+    };
+    ALCdevice *device;
+    ALCcontext *context;
+
+    if (argc != 3) {
+        fprintf(stderr, "USAGE: %s [input.wav] [output.wav]\n", argv[0]);
+        return 1;
+    }
+
+    if (!alcIsExtensionPresent(NULL, "ALC_SOFT_loopback")) {
+        printf("ALC_SOFT_loopback isn't supported!\n");
+        return 2;
+    }
+
+    palcLoopbackOpenDeviceSOFT = (LPALCLOOPBACKOPENDEVICESOFT) alcGetProcAddress(NULL, "alcLoopbackOpenDeviceSOFT");
+    palcIsRenderFormatSupportedSOFT = (LPALCISRENDERFORMATSUPPORTEDSOFT) alcGetProcAddress(NULL, "alcIsRenderFormatSupportedSOFT");
+    palcRenderSamplesSOFT = (LPALCRENDERSAMPLESSOFT) alcGetProcAddress(NULL, "alcRenderSamplesSOFT");
+
+    device = palcLoopbackOpenDeviceSOFT(NULL);
+    if (!device) {
+        printf("Couldn't open OpenAL loopback device.\n");
+        return 2;
+    }
+
+    if (!palcIsRenderFormatSupportedSOFT(device, RENDER_FREQ, ALC_STEREO_SOFT, ALC_SHORT_SOFT)) {
+        printf("Loopback device doesn't support our render format.\n");
+        alcCloseDevice(device);
+        return 2;
+    }
+
+    context = alcCreateContext(device, attrs);
+    if (!context) {
+        printf("Couldn't create OpenAL context.\n");
+        alcCloseDevice(device);
+        return 3;
+    }
+
+    alcMakeContextCurrent(context);
+
+    renderwav(device, argv[1], argv[2]);
+
+    alcMakeContextCurrent(NULL);
+    alcDestroyContext(context);
+    alcCloseDevice(device);
+
+    printf("Done!\n");
+    return 0;
+}
+
+/* end of testloopback.c ... */